@@ -386,6 +386,6 @@ NEON_INLINE unsigned long nn_valdict_hashkey(NNHashPtrTable* dict, void* key)
     {
         return dict->funchashfn(key);
     }
-    return nn_util_hashdata(key, dict->keytypesize);
+    return nn_util_hashdata(key, dict->keytypesize, dict->pstate->hashseed);
 }
 
@@ -1,4 +1,98 @@
 
+/*
+* NNHashValTable is an open-addressing table in the style of SwissTable:
+* every slot has a control byte, which is either NEON_TABLEVAL_CTRLEMPTY,
+* NEON_TABLEVAL_CTRLDELETED, or the lower 7 bits of the hash of the key stored in it.
+* slots are probed in aligned groups of NEON_TABLEVAL_GROUPSIZE, and a whole group
+* is matched against the hash fragment at once, so keys are only compared when
+* their fragment matches.
+* keys, values and control bytes live in separate arrays of a single allocation.
+*/
+
+NEON_FORCEINLINE unsigned int nn_tableval_ctz(uint32_t bits)
+{
+    #if defined(__GNUC__) || defined(__clang__)
+        return (unsigned int)__builtin_ctz(bits);
+    #else
+        unsigned int n;
+        n = 0;
+        while((bits & 1) == 0)
+        {
+            bits >>= 1;
+            n++;
+        }
+        return n;
+    #endif
+}
+
+/* returns a bitmask with bit i set if group[i] == ctrl. */
+NEON_FORCEINLINE uint32_t nn_tableval_groupmatch(const uint8_t* group, uint8_t ctrl)
+{
+    #if defined(NEON_PLAT_HAVESSE2)
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)group), _mm_set1_epi8((char)ctrl)));
+    #else
+        int i;
+        uint32_t mask;
+        mask = 0;
+        for(i = 0; i < NEON_TABLEVAL_GROUPSIZE; i++)
+        {
+            if(group[i] == ctrl)
+            {
+                mask |= (1u << i);
+            }
+        }
+        return mask;
+    #endif
+}
+
+/* returns a bitmask with bit i set if group[i] is either empty or deleted. */
+NEON_FORCEINLINE uint32_t nn_tableval_groupmatchfree(const uint8_t* group)
+{
+    #if defined(NEON_PLAT_HAVESSE2)
+        /* both NEON_TABLEVAL_CTRLEMPTY and NEON_TABLEVAL_CTRLDELETED have the high bit set. */
+        return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+    #else
+        int i;
+        uint32_t mask;
+        mask = 0;
+        for(i = 0; i < NEON_TABLEVAL_GROUPSIZE; i++)
+        {
+            if((group[i] & 0x80) != 0)
+            {
+                mask |= (1u << i);
+            }
+        }
+        return mask;
+    #endif
+}
+
+NEON_FORCEINLINE bool nn_tableval_slotisfull(NNHashValTable* table, int slot)
+{
+    return (table->ctrl[slot] & 0x80) == 0;
+}
+
+NEON_FORCEINLINE uint32_t nn_tableval_hashkey(NNValue key)
+{
+    if(nn_value_isstring(key))
+    {
+        return nn_value_asstring(key)->hash;
+    }
+    return nn_value_hashvalue(key);
+}
+
+NEON_FORCEINLINE bool nn_tableval_keyequal(NNState* state, NNValue entkey, NNValue key)
+{
+    if(nn_value_isstring(entkey) != nn_value_isstring(key))
+    {
+        return false;
+    }
+    if(nn_value_isnull(entkey) || nn_value_isnull(key))
+    {
+        return nn_value_isnull(entkey) && nn_value_isnull(key);
+    }
+    return nn_value_compare(state, key, entkey);
+}
+
 NNHashValTable* nn_tableval_make(NNState* state)
 {
     NNHashValTable* table;
@@ -10,8 +104,11 @@ NNHashValTable* nn_tableval_make(NNState* state)
     table->pstate = state;
     table->active = true;
     table->count = 0;
+    table->deleted = 0;
     table->capacity = 0;
-    table->entries = NULL;
+    table->ctrl = NULL;
+    table->keys = NULL;
+    table->values = NULL;
     return table;
 }
 
@@ -19,186 +116,168 @@ void nn_tableval_destroy(NNHashValTable* table)
 {
     if(table != NULL)
     {
-        nn_memory_free(table->entries);
+        /* $values is the start of the single allocation holding all three arrays. */
+        nn_memory_free(table->values);
         memset(table, 0, sizeof(NNHashValTable));
         nn_memory_free(table);
     }
 }
 
-NNHashValEntry* nn_tableval_findentrybyvalue(NNHashValTable* table, NNHashValEntry* entries, int capacity, NNValue key)
+/*
+* returns the slot holding a string key equal to $kstr, or -1.
+* if $valkey is not null, non-string keys are compared against it as well.
+*/
+int nn_tableval_findslotbystr(NNHashValTable* table, NNValue valkey, const char* kstr, size_t klen, uint32_t hash)
 {
-    uint32_t hash;
-    uint32_t index;
-    NNState* state;
-    NNHashValEntry* entry;
-    NNHashValEntry* tombstone;
-    state = table->pstate;
-    hash = nn_value_hashvalue(key);
-    #if defined(DEBUG_TABLE) && DEBUG_TABLE
-    fprintf(stderr, "looking for key ");
-    nn_printer_printvalue(state->debugwriter, key, true, false);
-    fprintf(stderr, " with hash %u in table...\n", hash);
-    #endif
-    index = hash & (capacity - 1);
-    tombstone = NULL;
+    int slot;
+    uint32_t step;
+    uint32_t group;
+    uint32_t match;
+    uint32_t groupmask;
+    const uint8_t* ctrl;
+    NNValue entkey;
+    NNObjString* entoskey;
+    if(table->count == 0)
+    {
+        return -1;
+    }
+    groupmask = (uint32_t)(table->capacity / NEON_TABLEVAL_GROUPSIZE) - 1;
+    group = (hash >> 7) & groupmask;
+    step = 0;
     while(true)
     {
-        entry = &entries[index];
-        if(nn_value_isnull(entry->key))
+        ctrl = &table->ctrl[group * NEON_TABLEVAL_GROUPSIZE];
+        match = nn_tableval_groupmatch(ctrl, (uint8_t)(hash & 0x7F));
+        while(match != 0)
         {
-            if(nn_value_isnull(entry->value.value))
+            slot = (int)(group * NEON_TABLEVAL_GROUPSIZE + nn_tableval_ctz(match));
+            entkey = table->keys[slot];
+            if(nn_value_isstring(entkey))
             {
-                /* empty entry */
-                if(tombstone != NULL)
+                entoskey = nn_value_asstring(entkey);
+                if((entoskey->sbuf->length == klen) && (memcmp(kstr, entoskey->sbuf->data, klen) == 0))
                 {
-                    return tombstone;
-                }
-                else
-                {
-                    return entry;
+                    return slot;
                 }
             }
-            else
+            else if(!nn_value_isnull(valkey))
             {
-                /* we found a tombstone. */
-                if(tombstone == NULL)
+                if(nn_tableval_keyequal(table->pstate, entkey, valkey))
                 {
-                    tombstone = entry;
+                    return slot;
                 }
             }
+            match &= match - 1;
         }
-        else if(nn_value_compare(state, key, entry->key))
+        /* an empty slot means that no key on this probe sequence was ever placed beyond this group. */
+        if(nn_tableval_groupmatch(ctrl, NEON_TABLEVAL_CTRLEMPTY) != 0)
         {
-            return entry;
+            return -1;
         }
-        index = (index + 1) & (capacity - 1);
+        step++;
+        if(step > groupmask)
+        {
+            return -1;
+        }
+        group = (group + step) & groupmask;
     }
-    return NULL;
+    return -1;
 }
 
-NNHashValEntry* nn_tableval_findentrybystr(NNHashValTable* table, NNHashValEntry* entries, int capacity, NNValue valkey, const char* kstr, size_t klen, uint32_t hash)
+int nn_tableval_findslotbyvalue(NNHashValTable* table, NNValue key)
 {
-    bool havevalhash;
-    uint32_t index;
-    uint32_t valhash;
-    NNObjString* entoskey;
-    NNHashValEntry* entry;
-    NNHashValEntry* tombstone;
-    NNState* state;
-    state = table->pstate;
-    (void)valhash;
-    (void)havevalhash;
-    #if defined(DEBUG_TABLE) && DEBUG_TABLE
-    fprintf(stderr, "looking for key ");
-    nn_printer_printvalue(state->debugwriter, key, true, false);
-    fprintf(stderr, " with hash %u in table...\n", hash);
-    #endif
-    valhash = 0;
-    havevalhash = false;
-    index = hash & (capacity - 1);
-    tombstone = NULL;
+    int slot;
+    uint32_t hash;
+    uint32_t step;
+    uint32_t group;
+    uint32_t match;
+    uint32_t groupmask;
+    const uint8_t* ctrl;
+    NNObjString* oskey;
+    if(table->count == 0)
+    {
+        return -1;
+    }
+    if(nn_value_isstring(key))
+    {
+        oskey = nn_value_asstring(key);
+        return nn_tableval_findslotbystr(table, key, oskey->sbuf->data, oskey->sbuf->length, oskey->hash);
+    }
+    hash = nn_value_hashvalue(key);
+    groupmask = (uint32_t)(table->capacity / NEON_TABLEVAL_GROUPSIZE) - 1;
+    group = (hash >> 7) & groupmask;
+    step = 0;
     while(true)
     {
-        entry = &entries[index];
-        if(nn_value_isnull(entry->key))
+        ctrl = &table->ctrl[group * NEON_TABLEVAL_GROUPSIZE];
+        match = nn_tableval_groupmatch(ctrl, (uint8_t)(hash & 0x7F));
+        while(match != 0)
         {
-            if(nn_value_isnull(entry->value.value))
+            slot = (int)(group * NEON_TABLEVAL_GROUPSIZE + nn_tableval_ctz(match));
+            if(nn_tableval_keyequal(table->pstate, table->keys[slot], key))
             {
-                /* empty entry */
-                if(tombstone != NULL)
-                {
-                    return tombstone;
-                }
-                else
-                {
-                    return entry;
-                }
-            }
-            else
-            {
-                /* we found a tombstone. */
-                if(tombstone == NULL)
-                {
-                    tombstone = entry;
-                }
+                return slot;
             }
+            match &= match - 1;
         }
-        if(nn_value_isstring(entry->key))
+        if(nn_tableval_groupmatch(ctrl, NEON_TABLEVAL_CTRLEMPTY) != 0)
         {
-            entoskey = nn_value_asstring(entry->key);
-            if(entoskey->sbuf->length == klen)
-            {
-                if(memcmp(kstr, entoskey->sbuf->data, klen) == 0)
-                {
-                    return entry;
-                }
-            }
+            return -1;
         }
-        else
+        step++;
+        if(step > groupmask)
         {
-            if(!nn_value_isnull(valkey))
-            {
-                if(nn_value_compare(state, valkey, entry->key))
-                {
-                    return entry;
-                }
-            }
+            return -1;
         }
-        index = (index + 1) & (capacity - 1);
+        group = (group + step) & groupmask;
     }
-    return NULL;
+    return -1;
 }
 
-NNProperty* nn_tableval_getfieldbyvalue(NNHashValTable* table, NNValue key)
+/* returns the first empty or deleted slot on the probe sequence of $hash. */
+int nn_tableval_findfreeslot(NNHashValTable* table, uint32_t hash)
 {
-    NNState* state;
-    NNHashValEntry* entry;
-    (void)state;
-    state = table->pstate;
-    if(table->count == 0 || table->entries == NULL)
+    uint32_t step;
+    uint32_t group;
+    uint32_t match;
+    uint32_t groupmask;
+    groupmask = (uint32_t)(table->capacity / NEON_TABLEVAL_GROUPSIZE) - 1;
+    group = (hash >> 7) & groupmask;
+    step = 0;
+    while(true)
     {
-        return NULL;
+        match = nn_tableval_groupmatchfree(&table->ctrl[group * NEON_TABLEVAL_GROUPSIZE]);
+        if(match != 0)
+        {
+            return (int)(group * NEON_TABLEVAL_GROUPSIZE + nn_tableval_ctz(match));
+        }
+        /* the triangular sequence visits every group, and the load factor guarantees a free slot. */
+        step++;
+        group = (group + step) & groupmask;
     }
-    #if defined(DEBUG_TABLE) && DEBUG_TABLE
-    fprintf(stderr, "getting entry with hash %u...\n", nn_value_hashvalue(key));
-    #endif
-    entry = nn_tableval_findentrybyvalue(table, table->entries, table->capacity, key);
-    if(nn_value_isnull(entry->key) || nn_value_isnull(entry->key))
+    return -1;
+}
+
+NNProperty* nn_tableval_getfieldbyvalue(NNHashValTable* table, NNValue key)
+{
+    int slot;
+    slot = nn_tableval_findslotbyvalue(table, key);
+    if(slot < 0)
     {
         return NULL;
     }
-    #if defined(DEBUG_TABLE) && DEBUG_TABLE
-    fprintf(stderr, "found entry for hash %u == ", nn_value_hashvalue(entry->key));
-    nn_printer_printvalue(state->debugwriter, entry->value.value, true, false);
-    fprintf(stderr, "\n");
-    #endif
-    return &entry->value;
+    return &table->values[slot];
 }
 
 NNProperty* nn_tableval_getfieldbystr(NNHashValTable* table, NNValue valkey, const char* kstr, size_t klen, uint32_t hash)
 {
-    NNState* state;
-    NNHashValEntry* entry;
-    (void)state;
-    state = table->pstate;
-    if(table->count == 0 || table->entries == NULL)
-    {
-        return NULL;
-    }
-    #if defined(DEBUG_TABLE) && DEBUG_TABLE
-    fprintf(stderr, "getting entry with hash %u...\n", nn_value_hashvalue(key));
-    #endif
-    entry = nn_tableval_findentrybystr(table, table->entries, table->capacity, valkey, kstr, klen, hash);
-    if(nn_value_isnull(entry->key) || nn_value_isnull(entry->key))
+    int slot;
+    slot = nn_tableval_findslotbystr(table, valkey, kstr, klen, hash);
+    if(slot < 0)
     {
         return NULL;
     }
-    #if defined(DEBUG_TABLE) && DEBUG_TABLE
-    fprintf(stderr, "found entry for hash %u == ", nn_value_hashvalue(entry->key));
-    nn_printer_printvalue(state->debugwriter, entry->value.value, true, false);
-    fprintf(stderr, "\n");
-    #endif
-    return &entry->value;
+    return &table->values[slot];
 }
 
 NNProperty* nn_tableval_getfieldbyostr(NNHashValTable* table, NNObjString* str)
@@ -211,18 +290,12 @@ NNProperty* nn_tableval_getfieldbycstr(NNHashValTable* table, const char* kstr)
     size_t klen;
     uint32_t hash;
     klen = strlen(kstr);
-    hash = nn_util_hashstring(kstr, klen);
+    hash = nn_util_hashstring(table->pstate, kstr, klen);
     return nn_tableval_getfieldbystr(table, nn_value_makenull(), kstr, klen, hash);
 }
 
 NNProperty* nn_tableval_getfield(NNHashValTable* table, NNValue key)
 {
-    NNObjString* oskey;
-    if(nn_value_isstring(key))
-    {
-        oskey = nn_value_asstring(key);
-        return nn_tableval_getfieldbystr(table, key, oskey->sbuf->data, oskey->sbuf->length, oskey->hash);
-    }
     return nn_tableval_getfieldbyvalue(table, key);
 }
 
@@ -241,59 +314,74 @@ bool nn_tableval_get(NNHashValTable* table, NNValue key, NNValue* value)
 void nn_tableval_adjustcapacity(NNHashValTable* table, int capacity)
 {
     int i;
-    NNState* state;
-    NNHashValEntry* dest;
-    NNHashValEntry* entry;
-    NNHashValEntry* entries;
-    state = table->pstate;
-    entries = (NNHashValEntry*)nn_memory_malloc(sizeof(NNHashValEntry) * capacity);
-    for(i = 0; i < capacity; i++)
-    {
-        entries[i].key = nn_value_makenull();
-        entries[i].value = nn_property_make(state, nn_value_makenull(), NEON_PROPTYPE_VALUE);
-    }
-    table->count = 0;
-    for(i = 0; i < table->capacity; i++)
+    int slot;
+    int oldcapacity;
+    uint8_t* oldctrl;
+    NNValue* oldkeys;
+    NNProperty* oldvalues;
+    oldcapacity = table->capacity;
+    oldctrl = table->ctrl;
+    oldkeys = table->keys;
+    oldvalues = table->values;
+    table->values = (NNProperty*)nn_memory_malloc(capacity * (sizeof(NNProperty) + sizeof(NNValue) + sizeof(uint8_t)));
+    table->keys = (NNValue*)(table->values + capacity);
+    table->ctrl = (uint8_t*)(table->keys + capacity);
+    memset(table->ctrl, NEON_TABLEVAL_CTRLEMPTY, capacity);
+    table->capacity = capacity;
+    table->deleted = 0;
+    for(i = 0; i < oldcapacity; i++)
     {
-        entry = &table->entries[i];
-        if(nn_value_isnull(entry->key))
+        if((oldctrl[i] & 0x80) == 0)
         {
-            continue;
+            slot = nn_tableval_findfreeslot(table, nn_tableval_hashkey(oldkeys[i]));
+            table->ctrl[slot] = oldctrl[i];
+            table->keys[slot] = oldkeys[i];
+            table->values[slot] = oldvalues[i];
         }
-        dest = nn_tableval_findentrybyvalue(table, entries, capacity, entry->key);
-        dest->key = entry->key;
-        dest->value = entry->value;
-        table->count++;
     }
-    nn_memory_free(table->entries);
-    table->entries = entries;
-    table->capacity = capacity;
+    nn_memory_free(oldvalues);
 }
 
-
 bool nn_tableval_setwithtype(NNHashValTable* table, NNValue key, NNValue value, NNFieldType ftyp, bool keyisstring)
 {
-    bool isnew;
+    int slot;
     int capacity;
+    uint32_t hash;
     NNState* state;
-    NNHashValEntry* entry;
     (void)keyisstring;
     state = table->pstate;
-    if(table->count + 1 > table->capacity * NEON_CONFIG_MAXTABLELOAD)
+    slot = nn_tableval_findslotbyvalue(table, key);
+    if(slot >= 0)
+    {
+        /* overwrites existing entries. */
+        table->values[slot] = nn_property_make(state, value, ftyp);
+        return false;
+    }
+    if(table->count + table->deleted + 1 > table->capacity * NEON_CONFIG_MAXTABLELOAD)
     {
-        capacity = GROW_CAPACITY(table->capacity);
+        capacity = table->capacity;
+        if(capacity == 0)
+        {
+            capacity = NEON_TABLEVAL_GROUPSIZE;
+        }
+        /* if the load is mostly deleted slots, rehashing at the same size is enough. */
+        else if(table->count + 1 > (table->capacity * NEON_CONFIG_MAXTABLELOAD) / 2)
+        {
+            capacity *= 2;
+        }
         nn_tableval_adjustcapacity(table, capacity);
     }
-    entry = nn_tableval_findentrybyvalue(table, table->entries, table->capacity, key);
-    isnew = nn_value_isnull(entry->key);
-    if(isnew && nn_value_isnull(entry->value.value))
+    hash = nn_tableval_hashkey(key);
+    slot = nn_tableval_findfreeslot(table, hash);
+    if(table->ctrl[slot] == NEON_TABLEVAL_CTRLDELETED)
     {
-        table->count++;
+        table->deleted--;
     }
-    /* overwrites existing entries. */
-    entry->key = key;
-    entry->value = nn_property_make(state, value, ftyp);
-    return isnew;
+    table->ctrl[slot] = (uint8_t)(hash & 0x7F);
+    table->keys[slot] = key;
+    table->values[slot] = nn_property_make(state, value, ftyp);
+    table->count++;
+    return true;
 }
 
 bool nn_tableval_set(NNHashValTable* table, NNValue key, NNValue value)
@@ -301,36 +389,46 @@ bool nn_tableval_set(NNHashValTable* table, NNValue key, NNValue value)
     return nn_tableval_setwithtype(table, key, value, NEON_PROPTYPE_VALUE, nn_value_isstring(key));
 }
 
-
-bool nn_tableval_delete(NNHashValTable* table, NNValue key)
+void nn_tableval_deleteslot(NNHashValTable* table, int slot)
 {
-    NNHashValEntry* entry;
-    if(table->count == 0)
+    /*
+    * no probe sequence continues past a group that still has an empty slot,
+    * so within such a group the slot can simply become empty again.
+    */
+    if(nn_tableval_groupmatch(&table->ctrl[slot - (slot % NEON_TABLEVAL_GROUPSIZE)], NEON_TABLEVAL_CTRLEMPTY) != 0)
     {
-        return false;
+        table->ctrl[slot] = NEON_TABLEVAL_CTRLEMPTY;
     }
-    /* find the entry */
-    entry = nn_tableval_findentrybyvalue(table, table->entries, table->capacity, key);
-    if(nn_value_isnull(entry->key))
+    else
+    {
+        table->ctrl[slot] = NEON_TABLEVAL_CTRLDELETED;
+        table->deleted++;
+    }
+    table->keys[slot] = nn_value_makenull();
+    table->values[slot].value = nn_value_makenull();
+    table->count--;
+}
+
+bool nn_tableval_delete(NNHashValTable* table, NNValue key)
+{
+    int slot;
+    slot = nn_tableval_findslotbyvalue(table, key);
+    if(slot < 0)
     {
         return false;
     }
-    /* place a tombstone in the entry. */
-    entry->key = nn_value_makenull();
-    entry->value = nn_property_make(table->pstate, nn_value_makebool(true), NEON_PROPTYPE_VALUE);
+    nn_tableval_deleteslot(table, slot);
     return true;
 }
 
 void nn_tableval_addall(NNHashValTable* from, NNHashValTable* to)
 {
     int i;
-    NNHashValEntry* entry;
     for(i = 0; i < from->capacity; i++)
     {
-        entry = &from->entries[i];
-        if(!nn_value_isnull(entry->key))
+        if(nn_tableval_slotisfull(from, i))
         {
-            nn_tableval_setwithtype(to, entry->key, entry->value.value, entry->value.type, false);
+            nn_tableval_setwithtype(to, from->keys[i], from->values[i].value, from->values[i].type, false);
         }
     }
 }
@@ -338,18 +436,18 @@ void nn_tableval_addall(NNHashValTable* from, NNHashValTable* to)
 void nn_tableval_importall(NNHashValTable* from, NNHashValTable* to)
 {
     int i;
-    NNHashValEntry* entry;
+    NNValue key;
     for(i = 0; i < (int)from->capacity; i++)
     {
-        entry = &from->entries[i];
-        if(!nn_value_isnull(entry->key) && !nn_value_ismodule(entry->value.value))
+        key = from->keys[i];
+        if(nn_tableval_slotisfull(from, i) && !nn_value_ismodule(from->values[i].value))
         {
             /* Don't import private values */
-            if(nn_value_isstring(entry->key) && nn_value_asstring(entry->key)->sbuf->data[0] == '_')
+            if(nn_value_isstring(key) && nn_value_asstring(key)->sbuf->data[0] == '_')
             {
                 continue;
             }
-            nn_tableval_setwithtype(to, entry->key, entry->value.value, entry->value.type, false);
+            nn_tableval_setwithtype(to, key, from->values[i].value, from->values[i].type, false);
         }
     }
 }
@@ -358,67 +456,37 @@ void nn_tableval_copy(NNHashValTable* from, NNHashValTable* to)
 {
     int i;
     NNState* state;
-    NNHashValEntry* entry;
     state = from->pstate;
     for(i = 0; i < (int)from->capacity; i++)
     {
-        entry = &from->entries[i];
-        if(!nn_value_isnull(entry->key))
+        if(nn_tableval_slotisfull(from, i))
         {
-            nn_tableval_setwithtype(to, entry->key, nn_value_copyvalue(state, entry->value.value), entry->value.type, false);
+            nn_tableval_setwithtype(to, from->keys[i], nn_value_copyvalue(state, from->values[i].value), from->values[i].type, false);
         }
     }
 }
 
 NNObjString* nn_tableval_findstring(NNHashValTable* table, const char* chars, size_t length, uint32_t hash)
 {
-    size_t slen;
-    uint32_t index;
-    const char* sdata;
-    NNHashValEntry* entry;
-    NNObjString* string;
-    if(table->count == 0)
+    int slot;
+    slot = nn_tableval_findslotbystr(table, nn_value_makenull(), chars, length, hash);
+    if(slot < 0)
     {
         return NULL;
     }
-    index = hash & (table->capacity - 1);
-    while(true)
-    {
-        entry = &table->entries[index];
-        if(nn_value_isnull(entry->key))
-        {
-            /*
-            // stop if we find an empty non-tombstone entry
-            //if (nn_value_isnull(entry->value))
-            */
-            {
-                return NULL;
-            }
-        }
-        string = nn_value_asstring(entry->key);
-        slen = string->sbuf->length;
-        sdata = string->sbuf->data;
-        if((slen == length) && (string->hash == hash) && memcmp(sdata, chars, length) == 0)
-        {
-            /* we found it */
-            return string;
-        }
-        index = (index + 1) & (table->capacity - 1);
-    }
+    return nn_value_asstring(table->keys[slot]);
 }
 
 NNValue nn_tableval_findkey(NNHashValTable* table, NNValue value)
 {
     int i;
-    NNHashValEntry* entry;
     for(i = 0; i < (int)table->capacity; i++)
     {
-        entry = &table->entries[i];
-        if(!nn_value_isnull(entry->key) && !nn_value_isnull(entry->key))
+        if(nn_tableval_slotisfull(table, i))
         {
-            if(nn_value_compare(table->pstate, entry->value.value, value))
+            if(nn_value_compare(table->pstate, table->values[i].value, value))
             {
-                return entry->key;
+                return table->keys[i];
             }
         }
     }
@@ -430,15 +498,13 @@ NNObjArray* nn_tableval_getkeys(NNHashValTable* table)
     int i;
     NNState* state;
     NNObjArray* list;
-    NNHashValEntry* entry;
     state = table->pstate;
     list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
     for(i = 0; i < table->capacity; i++)
     {
-        entry = &table->entries[i];
-        if(!nn_value_isnull(entry->key) && !nn_value_isnull(entry->key))
+        if(nn_tableval_slotisfull(table, i))
         {
-            nn_vallist_push(list->varray, entry->key);
+            nn_vallist_push(list->varray, table->keys[i]);
         }
     }
     return list;
@@ -447,7 +513,6 @@ NNObjArray* nn_tableval_getkeys(NNHashValTable* table)
 void nn_tableval_mark(NNState* state, NNHashValTable* table)
 {
     int i;
-    NNHashValEntry* entry;
     if(table == NULL)
     {
         return;
@@ -459,14 +524,10 @@ void nn_tableval_mark(NNState* state, NNHashValTable* table)
     }
     for(i = 0; i < table->capacity; i++)
     {
-        entry = &table->entries[i];
-        if(entry != NULL)
+        if(nn_tableval_slotisfull(table, i))
         {
-            if(entry->key != NEON_VALUE_NULL)
-            {
-                nn_gcmem_markvalue(state, entry->key);
-                nn_gcmem_markvalue(state, entry->value.value);
-            }
+            nn_gcmem_markvalue(state, table->keys[i]);
+            nn_gcmem_markvalue(state, table->values[i].value);
         }
     }
 }
@@ -474,13 +535,13 @@ void nn_tableval_mark(NNState* state, NNHashValTable* table)
 void nn_tableval_removewhites(NNState* state, NNHashValTable* table)
 {
     int i;
-    NNHashValEntry* entry;
+    NNValue key;
     for(i = 0; i < table->capacity; i++)
     {
-        entry = &table->entries[i];
-        if(nn_value_isobject(entry->key) && nn_value_asobject(entry->key)->mark != state->markvalue)
+        key = table->keys[i];
+        if(nn_tableval_slotisfull(table, i) && nn_value_isobject(key) && nn_value_asobject(key)->mark != state->markvalue)
         {
-            nn_tableval_delete(table, entry->key);
+            nn_tableval_deleteslot(table, i);
         }
     }
 }
@@ -68,6 +68,30 @@
     #define NEON_PLAT_ISLINUX
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define NEON_PLAT_HAVESSE2
+#endif
+
+#if defined(NEON_PLAT_ISLINUX) && !defined(NEON_PLAT_ISWASM)
+    #include <sys/mman.h>
+    #include <sys/uio.h>
+    #include <sys/wait.h>
+    #include <spawn.h>
+    #include <poll.h>
+    #define NEON_PLAT_HAVEMMAP
+    #define NEON_PLAT_HAVEWRITEV
+    #define NEON_PLAT_HAVESPAWN
+    extern char** environ;
+#endif
+
+#if defined(__linux__) && !defined(NEON_PLAT_ISWASM)
+    #include <sys/sendfile.h>
+    #include <sys/syscall.h>
+    #define NEON_PLAT_HAVESENDFILE
+    #define NEON_PLAT_HAVEGETDENTS
+#endif
+
 #include "strbuf.h"
 #include "optparse.h"
 #include "os.h"
@@ -133,6 +157,11 @@
 
 /* global debug mode flag */
 #define NEON_CONFIG_BUILDDEBUGMODE 0
+
+/* set to 1 (e.g. with -DNEON_CONFIG_BENCHSTATS=1) to add Dict.probeStats(), used by hashbench.nn */
+#if !defined(NEON_CONFIG_BENCHSTATS)
+    #define NEON_CONFIG_BENCHSTATS 0
+#endif
 #define NEON_CONFIG_MAXSYNTAXERRORS 10
 
 
@@ -179,6 +208,70 @@
 /* growth factor for GC heap objects */
 #define NEON_CONFIG_GCHEAPGROWTHFACTOR (1.25)
 
+/*
+* substrings of at least this many bytes may share the buffer of their parent string
+* instead of copying (see nn_string_makeslice). set to 0 to disable slicing.
+*/
+#define NEON_CONFIG_STRSLICEMINLEN (64)
+
+/* a slice may only pin its parent if it covers at least 1/N of the parent buffer */
+#define NEON_CONFIG_STRSLICEMAXRATIO (4)
+
+/* size of the stdio buffer of files opened by File() */
+#define NEON_CONFIG_FILEBUFSIZE (64 * 1024)
+
+/* how much copy_file_range() and sendfile() are asked to copy at once */
+#define NEON_CONFIG_COPYCHUNKSIZE (1024 * 1024 * 1024)
+
+/* the most buffers passed to a single writev() call; POSIX guarantees at least 16, Linux allows 1024 */
+#define NEON_CONFIG_IOVMAX (1024)
+
+/* size of the getdents64() buffer of each directory that os.walk() has open */
+#define NEON_CONFIG_WALKBUFSIZE (32 * 1024)
+
+/* how much output Process.run() makes room for up front, per stream; it grows as needed */
+#define NEON_CONFIG_RUNBUFSIZE (64 * 1024)
+
+/* size of the output buffer of the stdout printer. it is line buffered if stdout is a terminal. */
+#define NEON_CONFIG_PRINTBUFSIZE (64 * 1024)
+
+/* how many codepoints lie between two entries of the codepoint index of a non-ASCII string */
+#define NEON_CONFIG_UTF8INDEXSTRIDE (32)
+
+/* maximum number of tokens a regex pattern may be parsed into */
+#define NEON_CONFIG_REGEXMAXTOKENS (128*4)
+
+/* maximum number of capture groups reported by a regex match */
+#define NEON_CONFIG_REGEXMAXCAPTURES (128)
+
+/* how many parsed patterns are kept for String.match and friends */
+#define NEON_CONFIG_REGEXCACHESIZE (16)
+
+/* maximum number of instructions of a program compiled by the linear regex engine */
+#define NEON_CONFIG_REGEXMAXPROGRAM (1024 * 8)
+
+/* how many states each lazily built DFA of the linear regex engine may hold before giving up */
+#define NEON_CONFIG_REGEXDFAMAXSTATES (128)
+
+/* runs shorter than this are extended with insertion sort before merging, see nn_sort_minrun */
+#define NEON_CONFIG_SORTMINMERGE (32)
+
+/* size of the index table of a dictionary when its first entry is added; must be a power of two */
+#define NEON_CONFIG_DICTMININDEX (8)
+
+/* how deeply arrays and objects may be nested in JSON.parse() */
+#define NEON_CONFIG_JSONMAXDEPTH (512)
+
+/* size of the buffer nn_util_formatnumber() writes to; enough for any double */
+#define NEON_CONFIG_NUMBERBUFSIZE (32)
+
+/* size of the buffer through which JSON.write() writes to a file */
+#define NEON_CONFIG_JSONWRITEBUFSIZE (64 * 1024)
+
+#define NEON_STRASCII_UNKNOWN (0)
+#define NEON_STRASCII_YES (1)
+#define NEON_STRASCII_NO (2)
+
 #define NEON_INFO_COPYRIGHT "based on the Blade Language, Copyright (c) 2021 - 2023 Ore Richard Muyiwa"
 
 #if defined(__GNUC__)
@@ -501,6 +594,62 @@ enum NNPrMode
     NEON_PRMODE_FILE
 };
 
+/*
+* what the elements of a NNValArray are known to be. a list starts out EMPTY, takes the
+* kind of its first element, and widens to GENERIC on the first element of another kind;
+* it never narrows again until it is emptied.
+*/
+enum NNElemKind
+{
+    NEON_ELEMKIND_EMPTY,
+    NEON_ELEMKIND_NUMBER,
+    NEON_ELEMKIND_STRING,
+    NEON_ELEMKIND_GENERIC
+};
+
+enum NNIterKind
+{
+    /* sources */
+    NEON_ITERKIND_ARRAY,
+    NEON_ITERKIND_RANGE,
+    NEON_ITERKIND_DICT,
+    NEON_ITERKIND_FILE,
+    NEON_ITERKIND_JSONLINES,
+    NEON_ITERKIND_CSV,
+    NEON_ITERKIND_WALK,
+    /* stages, which pull from another iterator */
+    NEON_ITERKIND_MAP,
+    NEON_ITERKIND_FILTER,
+    NEON_ITERKIND_TAKE,
+    NEON_ITERKIND_SKIP,
+    NEON_ITERKIND_ZIP,
+    NEON_ITERKIND_ENUMERATE,
+    NEON_ITERKIND_CHUNK
+};
+
+/* where a standard stream of a program started by Process.spawn() goes */
+enum NNSpawnMode
+{
+    NEON_SPAWNMODE_INHERIT,
+    NEON_SPAWNMODE_PIPE,
+    NEON_SPAWNMODE_NULL,
+    NEON_SPAWNMODE_FILE,
+    /* for stderr only: wherever stdout goes */
+    NEON_SPAWNMODE_STDOUT
+};
+
+/* the events passed to the callback of JSON.events() */
+enum NNJSONEvent
+{
+    NEON_JSONEVENT_STARTOBJECT,
+    NEON_JSONEVENT_ENDOBJECT,
+    NEON_JSONEVENT_STARTARRAY,
+    NEON_JSONEVENT_ENDARRAY,
+    NEON_JSONEVENT_KEY,
+    NEON_JSONEVENT_VALUE,
+    NEON_JSONEVENT_COUNT
+};
+
 enum NNObjType
 {
     /* containers */
@@ -509,6 +658,9 @@ enum NNObjType
     NEON_OBJTYPE_ARRAY,
     NEON_OBJTYPE_DICT,
     NEON_OBJTYPE_FILE,
+    NEON_OBJTYPE_TYPEDARRAY,
+    NEON_OBJTYPE_SET,
+    NEON_OBJTYPE_ITERATOR,
 
     /* base object types */
     NEON_OBJTYPE_UPVALUE,
@@ -518,6 +670,7 @@ enum NNObjType
     NEON_OBJTYPE_INSTANCE,
     NEON_OBJTYPE_FUNCNATIVE,
     NEON_OBJTYPE_CLASS,
+    NEON_OBJTYPE_REGEX,
 
     /* non-user objects */
     NEON_OBJTYPE_MODULE,
@@ -589,6 +742,9 @@ typedef enum /**/ NNStatus NNStatus;
 typedef enum /**/ NNAstTokType NNAstTokType;
 typedef enum /**/ NNAstPrecedence NNAstPrecedence;
 typedef enum /**/ NNPrMode NNPrMode;
+typedef enum /**/ NNIterKind NNIterKind;
+typedef enum /**/ NNElemKind NNElemKind;
+typedef enum /**/ NNSpawnMode NNSpawnMode;
 
 typedef struct /**/ NNProcessInfo NNProcessInfo;
 typedef struct /**/NNFormatInfo NNFormatInfo;
@@ -596,6 +752,7 @@ typedef struct /**/NNIOResult NNIOResult;
 typedef struct /**/ NNAstFuncCompiler NNAstFuncCompiler;
 typedef struct /**/ NNObject NNObject;
 typedef struct /**/ NNObjString NNObjString;
+typedef struct /**/ NNUtf8Index NNUtf8Index;
 typedef struct /**/ NNObjArray NNObjArray;
 typedef struct /**/ NNObjUpvalue NNObjUpvalue;
 typedef struct /**/ NNObjClass NNObjClass;
@@ -606,17 +763,27 @@ typedef struct /**/ NNObjFuncClosure NNObjFuncClosure;
 typedef struct /**/ NNObjInstance NNObjInstance;
 typedef struct /**/ NNObjFuncBound NNObjFuncBound;
 typedef struct /**/ NNObjRange NNObjRange;
+typedef struct /**/ NNObjRegex NNObjRegex;
+typedef struct /**/ NNObjTypedArray NNObjTypedArray;
+typedef struct /**/ NNObjSet NNObjSet;
+typedef struct /**/ NNObjIterator NNObjIterator;
+typedef struct /**/ NNBytesAccessor NNBytesAccessor;
+typedef struct /**/ NNRxInstr NNRxInstr;
+typedef struct /**/ NNRxNode NNRxNode;
+typedef struct /**/ NNRxParser NNRxParser;
+typedef struct /**/ NNRxDfaState NNRxDfaState;
+typedef struct /**/ NNRxDfa NNRxDfa;
+typedef struct /**/ NNRxProgram NNRxProgram;
+typedef struct /**/ NNDictEntry NNDictEntry;
 typedef struct /**/ NNObjDict NNObjDict;
 typedef struct /**/ NNObjFile NNObjFile;
 typedef struct /**/ NNObjSwitch NNObjSwitch;
 typedef struct /**/ NNObjUserdata NNObjUserdata;
 
 
-typedef struct /**/NNPropGetSet NNPropGetSet;
 typedef struct /**/NNProperty NNProperty;
 typedef struct /**/ NNValArray NNValArray;
 typedef struct /**/ NNBlob NNBlob;
-typedef struct /**/ NNHashValEntry NNHashValEntry;
 typedef struct /**/ NNHashValTable NNHashValTable;
 typedef struct /**/ NNExceptionFrame NNExceptionFrame;
 typedef struct /**/ NNCallFrame NNCallFrame;
@@ -634,6 +801,19 @@ typedef struct /**/ NNRegModule NNRegModule;
 typedef struct /**/ NNState NNState;
 typedef struct /**/ NNPrinter NNPrinter;
 typedef struct /**/ NNArgCheck NNArgCheck;
+typedef struct /**/ NNSortState NNSortState;
+typedef struct /**/ NNJSONParser NNJSONParser;
+typedef struct /**/ NNJSONWriter NNJSONWriter;
+typedef struct /**/ NNJSONMember NNJSONMember;
+typedef struct /**/ NNCSVOptions NNCSVOptions;
+typedef struct /**/ NNCSVColumn NNCSVColumn;
+typedef struct /**/ NNCSVReader NNCSVReader;
+typedef struct /**/ NNWalkLevel NNWalkLevel;
+typedef struct /**/ NNWalkEntry NNWalkEntry;
+typedef struct /**/ NNDirWalker NNDirWalker;
+typedef struct /**/ NNSpawnStream NNSpawnStream;
+typedef struct /**/ NNSpawnOptions NNSpawnOptions;
+typedef struct /**/ NNSpawnBuffer NNSpawnBuffer;
 typedef struct /**/ NNArguments NNArguments;
 typedef struct /**/NNInstruction NNInstruction;
 typedef struct utf8iterator_t utf8iterator_t;
@@ -701,6 +881,8 @@ struct NNPrinter
     bool shouldclose;
     /* if file: should write operations be flushed via fflush()? */
     bool shouldflush;
+    /* if file, and buffered: flush whenever a newline is written? */
+    bool linebuffered;
     /* if string: true if $strbuf was taken via nn_printer_take */
     bool stringtaken;
     /* was this writer instance created on stack? */
@@ -713,6 +895,10 @@ struct NNPrinter
     NNState* pstate;
     StringBuffer* strbuf;
     FILE* handle;
+    /* if file: output is collected here, and written out by nn_printer_flush. NULL if unbuffered. */
+    char* iobuf;
+    size_t iolength;
+    size_t iocapacity;
 };
 
 struct NNFormatInfo
@@ -762,20 +948,18 @@ struct NNObject
     NNObject* next;
 };
 
-struct NNPropGetSet
-{
-    NNValue getter;
-    NNValue setter;
-};
-
 struct NNProperty
 {
-    bool havegetset;
-    NNFieldType type;
     NNValue value;
-    NNPropGetSet getset;
+    NNFieldType type;
 };
 
+/*
+* $listitems points at the first element, which need not be the start of the allocation:
+* shifting from the front only advances it, leaving $listoffset unused slots before it,
+* which unshift can reuse. $listcapacity counts the slots from $listitems onwards.
+* anything that stores into $listitems directly must update $listkind via nn_vallist_notekind.
+*/
 struct NNValArray
 {
     NNState* pstate;
@@ -783,6 +967,8 @@ struct NNValArray
     NNValue* listitems;
     size_t listcapacity;
     size_t listcount;
+    size_t listoffset;
+    NNElemKind listkind;
 };
 
 struct NNInstruction
@@ -805,11 +991,9 @@ struct NNBlob
     NNValArray* argdefvals;
 };
 
-struct NNHashValEntry
-{
-    NNValue key;
-    NNProperty value;
-};
+#define NEON_TABLEVAL_GROUPSIZE (16)
+#define NEON_TABLEVAL_CTRLEMPTY (0x80)
+#define NEON_TABLEVAL_CTRLDELETED (0xFE)
 
 struct NNHashValTable
 {
@@ -822,10 +1006,16 @@ struct NNHashValTable
     * read after being freed, but for now, this will work(-ish).
     */
     bool active;
+    /* number of full slots */
     int count;
+    /* number of slots whose control byte is NEON_TABLEVAL_CTRLDELETED */
+    int deleted;
     int capacity;
     NNState* pstate;
-    NNHashValEntry* entries;
+    /* one control byte per slot, see hashtabval.h */
+    uint8_t* ctrl;
+    NNValue* keys;
+    NNProperty* values;
 };
 
 struct NNHashPtrTable
@@ -846,11 +1036,35 @@ struct NNHashPtrTable
 };
 
 
+/*
+* sparse codepoint index of a non-ASCII string:
+* offsets[i] is the byte offset of codepoint (i * NEON_CONFIG_UTF8INDEXSTRIDE).
+*/
+struct NNUtf8Index
+{
+    size_t cpcount;
+    size_t offcount;
+    size_t* offsets;
+};
+
 struct NNObjString
 {
     NNObject objpadding;
     uint32_t hash;
     StringBuffer* sbuf;
+    /*
+    * if not NULL, sbuf->data points into the buffer of this string, and is not owned.
+    * slices are not interned; see nn_string_makeslice.
+    */
+    NNObjString* parent;
+    /* true once a slice was made that points into sbuf; see nn_string_makewritable. */
+    bool hasslices;
+    /* holds a buffer that was given up by nn_string_makewritable, and that slices still point into. */
+    NNObjString* retired;
+    /* one of NEON_STRASCII_*; computed on first use by nn_string_isascii. */
+    int8_t asciistate;
+    /* built on first use by nn_string_utf8offset; NULL for ASCII strings. */
+    NNUtf8Index* utf8index;
 };
 
 struct NNObjUpvalue
@@ -978,6 +1192,86 @@ struct NNObjArray
     NNValArray* varray;
 };
 
+enum NNTypedArrayKind
+{
+    NEON_TYPEDARRAY_FLOAT64,
+    NEON_TYPEDARRAY_INT32,
+    NEON_TYPEDARRAY_UINT32,
+    NEON_TYPEDARRAY_UINT8,
+    /* Bytes: like Uint8Array, plus binary reading/writing and string conversion */
+    NEON_TYPEDARRAY_BYTES,
+    NEON_TYPEDARRAY_KINDCOUNT
+};
+
+/*
+* a fixed-length array of unboxed numbers of one kind.
+* views made by subarray() point into the storage of parent, which owns it and is kept
+* alive by the view; parent is NULL for arrays that own their storage.
+*/
+struct NNObjTypedArray
+{
+    NNObject objpadding;
+    int kind;
+    size_t length;
+    uint8_t* data;
+    NNObjTypedArray* parent;
+    /* if not 0, $data was mapped by File.mmap(), and is unmapped instead of freed. */
+    size_t mapsize;
+};
+
+/* the members of a set are the keys of $items, all mapping to null. */
+struct NNObjSet
+{
+    NNObject objpadding;
+    NNObjDict* items;
+};
+
+/*
+* a lazy iterator. sources walk $source (an array, range, dict or file) one element at a time,
+* stages pull from the iterator in $source, so a pipeline only ever holds the current element.
+*/
+struct NNObjIterator
+{
+    NNObject objpadding;
+    NNIterKind kind;
+    bool finished;
+    /* set if $callable, or that of an upstream stage, threw; the exception is propagated already */
+    bool failed;
+    /* arity of $callable, as returned by nn_nestcall_prepare */
+    int arity;
+    /* elements consumed so far; the entry index for dicts */
+    int64_t position;
+    /* count for take/skip/chunk; for ranges, the number of elements */
+    int64_t limit;
+    /* first element and direction of a range, copied since ranges are mutated by foreach */
+    int64_t rangestart;
+    int64_t rangestep;
+    NNValue source;
+    /* the second iterator of zip */
+    NNValue other;
+    NNValue callable;
+    /* the element most recently produced by @itern */
+    NNValue current;
+    NNObjArray* nestargs;
+    /* whether file sources strip line terminators */
+    bool chomp;
+    /* the reader of csv.reader() iterators, owned by the iterator */
+    NNCSVReader* csv;
+    /* the walker of os.walk() iterators, owned by the iterator */
+    NNDirWalker* walker;
+};
+
+/* describes one of the readX/writeX methods of Bytes; passed to them as userptr. */
+struct NNBytesAccessor
+{
+    const char* readname;
+    const char* writename;
+    int size;
+    bool issigned;
+    bool isfloat;
+    bool littleendian;
+};
+
 struct NNObjRange
 {
     NNObject objpadding;
@@ -986,11 +1280,169 @@ struct NNObjRange
     int range;
 };
 
+enum NNRxOpCode
+{
+    NEON_RXOP_CHAR,
+    NEON_RXOP_ANY,
+    NEON_RXOP_CLASS,
+    NEON_RXOP_SPLIT,
+    NEON_RXOP_JMP,
+    NEON_RXOP_SAVE,
+    NEON_RXOP_BOL,
+    NEON_RXOP_EOL,
+    NEON_RXOP_WORDB,
+    NEON_RXOP_NWORDB,
+    NEON_RXOP_MATCH
+};
+
+enum NNRxNodeKind
+{
+    NEON_RXNODE_EMPTY,
+    NEON_RXNODE_CHAR,
+    NEON_RXNODE_ANY,
+    NEON_RXNODE_CLASS,
+    NEON_RXNODE_ASSERT,
+    NEON_RXNODE_CAT,
+    NEON_RXNODE_ALT,
+    NEON_RXNODE_GROUP,
+    NEON_RXNODE_REPEAT
+};
+
+enum NNRegexEngine
+{
+    /* the backtracking matcher in deps/myregex */
+    NEON_REGEX_ENGINEBACKTRACK,
+    /* nn_rxvm: pike VM + lazy DFA; never worse than linear in the input */
+    NEON_REGEX_ENGINELINEAR
+};
+
+struct NNRxInstr
+{
+    uint8_t op;
+    int32_t x;
+    int32_t y;
+};
+
+/* parse tree of the linear regex engine; children are indices into NNRxParser.nodes. */
+struct NNRxNode
+{
+    int kind;
+    /* CHAR: the byte; CLASS: class index; ASSERT: opcode; GROUP: capture index or -1; REPEAT: minimum */
+    int a;
+    /* REPEAT: maximum, or -1 */
+    int b;
+    int left;
+    int right;
+    bool greedy;
+};
+
+struct NNRxParser
+{
+    const char* pattern;
+    size_t length;
+    size_t pos;
+    int nodecount;
+    int nodecapacity;
+    NNRxNode* nodes;
+    NNRxProgram* prog;
+};
+
+struct NNRxDfaState
+{
+    uint32_t hash;
+    bool ismatch;
+    /* -1 if not yet known whether the state matches at the end of input */
+    int8_t eolmatch;
+    int pccount;
+    int* pcs;
+    /* index of the next state for each input byte; -1 if not computed yet */
+    int32_t next[256];
+};
+
+struct NNRxDfa
+{
+    bool unanchored;
+    /* set when the state limit was hit; the pike VM is used from then on */
+    bool gaveup;
+    int statecount;
+    int startbol;
+    int startnobol;
+    NNRxDfaState* states;
+    /* open addressing table of state indices, by hash of their pc set */
+    int32_t* lookup;
+};
+
+struct NNRxProgram
+{
+    int count;
+    int capacity;
+    int classcount;
+    /* number of capture groups, including group 0 for the whole match */
+    int capcount;
+    bool usedfa;
+    NNRxInstr* code;
+    uint8_t* classes;
+    NNRxDfa dfaanchored;
+    NNRxDfa dfasearch;
+    /* scratch space for nn_rxvm_exec and the DFA builder, sized for count */
+    int* marks;
+    int64_t* stack;
+    int* clistpcs;
+    int* nlistpcs;
+    int64_t* clistcaps;
+    int64_t* nlistcaps;
+    int64_t* workcaps;
+    /* capture positions of the last successful nn_rxvm_exec done by the Regex functions */
+    int64_t* matchcaps;
+    char errorbuf[128];
+};
+
+/* a parsed regular expression, which can be matched any number of times. */
+struct NNObjRegex
+{
+    NNObject objpadding;
+    int engine;
+    NNObjString* pattern;
+    RegexToken* tokens;
+    RegexContext ctx;
+    RegexContext* pctx;
+    NNRxProgram* program;
+};
+
+#define NEON_DICT_IXEMPTY (-1)
+#define NEON_DICT_IXDUMMY (-2)
+/* largest index tables whose slots still fit into 8 and 16 bits respectively */
+#define NEON_DICT_MAXINDEX8 (128)
+#define NEON_DICT_MAXINDEX16 (32768)
+/* entries kept per index table; the remaining third of its slots keeps probe sequences short */
+#define NEON_DICT_USABLE(indexcapacity) (((indexcapacity) * 2) / 3)
+
+struct NNDictEntry
+{
+    /* false once the entry was removed; its slot is reclaimed by the next rebuild. */
+    bool live;
+    uint32_t hash;
+    NNValue key;
+    NNProperty value;
+};
+
+/*
+* insertion-ordered dictionary, laid out like CPython's compact dict:
+* $entries holds the entries densely, in the order they were added, and $indices
+* is an open-addressed table mapping hashes to positions in $entries.
+* the slots of $indices are 8, 16 or 32 bits wide, depending on $indexcapacity.
+*/
 struct NNObjDict
 {
     NNObject objpadding;
-    NNValArray* names;
-    NNHashValTable* htab;
+    /* number of live entries */
+    size_t count;
+    /* number of used slots in $entries, including removed ones */
+    size_t entrycount;
+    size_t entrycapacity;
+    size_t indexcapacity;
+    NNDictEntry* entries;
+    void* indices;
 };
 
 struct NNObjFile
@@ -1003,6 +1455,13 @@ struct NNObjFile
     FILE* handle;
     NNObjString* mode;
     NNObjString* path;
+    /* buffer of nn_file_readline, reused for every line */
+    char* linebuf;
+    size_t linecap;
+    /* the line most recently read by foreach, returned by @iter */
+    NNObjString* iterline;
+    /* pipes to other processes have no path to be reopened from once closed */
+    bool ispipe;
 };
 
 struct NNObjSwitch
@@ -1074,6 +1533,8 @@ struct NNState
         size_t stackcapacity;
         size_t framecapacity;
         size_t framecount;
+        /* frames below this one belong to a native that called back into the script. */
+        size_t nestbase;
         NNInstruction currentinstr;
         NNCallFrame* currentframe;
         NNObjUpvalue* openupvalues;
@@ -1104,6 +1565,17 @@ struct NNState
 
     NNValue lastreplvalue;
 
+    /* seed for nn_util_hashstring; randomized per state. */
+    uint64_t hashseed;
+
+    /* recently used regex patterns; see nn_regex_cacheget. */
+    struct
+    {
+        uint64_t clock;
+        uint64_t lastused[NEON_CONFIG_REGEXCACHESIZE];
+        NNObjRegex* items[NEON_CONFIG_REGEXCACHESIZE];
+    } regexcache;
+
     void* memuserptr;
     const char* rootphysfile;
 
@@ -1139,6 +1611,12 @@ struct NNState
     NNObjClass* classprimfile;
     /* class for range constructs */
     NNObjClass* classprimrange;
+    /* class for parsed regular expressions */
+    NNObjClass* classprimregex;
+    /* Float64Array, Int32Array, ..., indexed by NNTypedArrayKind */
+    NNObjClass* classprimtypedarray[NEON_TYPEDARRAY_KINDCOUNT];
+    NNObjClass* classprimset;
+    NNObjClass* classprimiterator;
     /* class for anything callable: functions, lambdas, constructors ... */
     NNObjClass* classprimcallable;
     NNObjClass* classprimprocess;
@@ -1301,6 +1779,248 @@ struct NNRegModule
     NNModLoaderFN unloader;
 };
 
+enum NNSortKind
+{
+    /* every key is a number, or every key is a string: compared directly */
+    NEON_SORT_NUMBERS,
+    NEON_SORT_STRINGS,
+    /* mixed keys, compared by nn_value_sortcompare */
+    NEON_SORT_GENERIC,
+    /* keys are compared by calling a script function */
+    NEON_SORT_CALLBACK
+};
+
+/*
+* state of one merge sort. keys are the values compared; vals, if not NULL, are moved along
+* with them (used when sorting by a key function).
+* the temporary arrays are NNObjArrays, so that values held only there survive a garbage
+* collection triggered by a comparator.
+*/
+struct NNSortState
+{
+    NNState* pstate;
+    int kind;
+    NNValue comparator;
+    NNValue thisval;
+    NNObjArray* nestargs;
+    int arity;
+    /* set once the comparator threw; nothing is compared after that. */
+    bool failed;
+    NNValue* keys;
+    NNValue* vals;
+    NNObjArray* tmpkeys;
+    NNObjArray* tmpvals;
+    int runcount;
+    size_t runbase[85];
+    size_t runlength[85];
+};
+
+/*
+* state of one run of the JSON parser over $source, which need not be NUL-terminated.
+* values are built on $stack, an NNObjArray that the caller keeps reachable, so everything parsed
+* so far survives a garbage collection. a finished array or object takes its elements off the top
+* of $stack, and is pushed in their place.
+* with a $callback, nothing is built, and every token is passed to the callback instead.
+*/
+struct NNJSONParser
+{
+    NNState* pstate;
+    const char* source;
+    size_t length;
+    size_t position;
+    /* the first error, and where it happened */
+    const char* error;
+    size_t errorpos;
+    NNObjArray* stack;
+    /* buffer for strings that contain escape sequences */
+    char* strbuf;
+    size_t strcap;
+    NNValue callback;
+    NNObjArray* nestargs;
+    int arity;
+    /* set if the callback asked to stop, or threw */
+    bool stopped;
+    bool threw;
+    NNObjString* events[NEON_JSONEVENT_COUNT];
+};
+
+/*
+* state of JSON.stringify() and JSON.write(). output collects in $buf; with a $handle, the buffer
+* is written out whenever it fills up, otherwise it grows and becomes the resulting string.
+*/
+struct NNJSONWriter
+{
+    NNState* pstate;
+    FILE* handle;
+    char* buf;
+    size_t length;
+    size_t capacity;
+    /* the string to indent by, or NULL to write everything on one line */
+    const char* indent;
+    size_t indentlen;
+    bool sortkeys;
+    int depth;
+    /* the arrays and objects currently being written, to detect cycles */
+    NNObject* path[NEON_CONFIG_JSONMAXDEPTH];
+    const char* error;
+};
+
+/* a key and value of an object, collected so they can be sorted. */
+struct NNJSONMember
+{
+    NNValue key;
+    NNValue value;
+    size_t order;
+};
+
+/* the options of the functions of the csv module; see nn_csv_getoptions. */
+struct NNCSVOptions
+{
+    char delimiter;
+    char quote;
+    bool header;
+    /* names or indices of the columns to read, or the keys to write; NULL for all */
+    NNObjArray* columns;
+    int64_t batch;
+};
+
+/* a column asked for by csv.reader(), by $name if not NULL, by $index otherwise. */
+struct NNCSVColumn
+{
+    char* name;
+    size_t namelen;
+    size_t index;
+};
+
+/*
+* state of csv.reader() and csv.parse(). records are read a physical line at a time, from
+* $file, or from $source if $file is NULL; quoted fields spanning lines pull in more lines.
+* only the columns in $slots get strings made for them.
+*/
+struct NNCSVReader
+{
+    NNState* pstate;
+    NNObjFile* file;
+    const char* source;
+    size_t sourcelen;
+    size_t sourcepos;
+    /* the current line; $lineend excludes its line terminator, $linelen does not */
+    const char* line;
+    size_t linelen;
+    size_t lineend;
+    int64_t linenumber;
+    char delimiter;
+    char quote;
+    bool header;
+    NNCSVColumn* wanted;
+    size_t wantedcount;
+    /* for each column, where it goes in a row, or -1; NULL if all columns are wanted */
+    int64_t* slots;
+    size_t slotcount;
+    /* with a header, the names of the columns of a row; kept reachable by the owner */
+    NNObjArray* names;
+    /* buffer for quoted fields */
+    char* fieldbuf;
+    size_t fieldcap;
+    const char* error;
+};
+
+/* a directory that os.walk() has open, and how far it has been read. */
+struct NNWalkLevel
+{
+    int fd;
+    /* the DIR of $fd, where getdents64() is not available */
+    void* dir;
+    /* getdents64() output; kept when the level is closed, for the next directory at this depth */
+    char* buf;
+    size_t bufpos;
+    size_t buflen;
+    /* the length of the path of this directory, in the path buffer of the walker */
+    size_t pathlen;
+    /* identifies the directory, to detect loops when following symlinks */
+    uint64_t dev;
+    uint64_t ino;
+};
+
+/* an entry found by nn_walker_next. $name points into the path buffer of the walker. */
+struct NNWalkEntry
+{
+    const char* name;
+    size_t namelen;
+    const char* type;
+    /* -1 if the size is unknown, or not wanted */
+    int64_t size;
+    int64_t depth;
+};
+
+/*
+* the state of os.walk(): the directories currently open, deepest last, which are walked depth-first.
+* $path holds the path of the entry read last, and $pathlen its length.
+*/
+struct NNDirWalker
+{
+    NNWalkLevel* levels;
+    size_t levelcount;
+    size_t levelcap;
+    char* path;
+    size_t pathlen;
+    size_t pathcap;
+    /* how deep to descend; 0 for no limit */
+    int64_t maxdepth;
+    /* whether regular files are stat'ed for their size */
+    bool wantsize;
+    bool followlinks;
+    /* if not NULL, only entries whose name matches this wildcard are returned */
+    char* pattern;
+    size_t patternlen;
+    /* set, with errno saved in $errnum, when the walk stopped on an error */
+    const char* error;
+    int errnum;
+};
+
+struct NNSpawnStream
+{
+    NNSpawnMode mode;
+    /* with NEON_SPAWNMODE_FILE, the File the stream goes to */
+    NNObjFile* file;
+    /* with NEON_SPAWNMODE_PIPE, the end of the pipe kept by this process, and the one given to the program */
+    int parentfd;
+    int childfd;
+};
+
+/* the options of Process.spawn() and Process.run(); see nn_spawn_getoptions. */
+struct NNSpawnOptions
+{
+    /* stdin, stdout and stderr */
+    NNSpawnStream streams[3];
+    /* variables to set in the environment of the program; null values unset them */
+    NNObjDict* env;
+    bool clearenv;
+    /* for run(), what is written to the stdin of the program */
+    const char* input;
+    size_t inputlen;
+};
+
+/* output captured by Process.run() */
+struct NNSpawnBuffer
+{
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+#if defined(NEON_PLAT_HAVEGETDENTS)
+/* the records getdents64() fills its buffer with, as declared in getdents(2) */
+struct NNLinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
 struct NNArgCheck
 {
     NNState* pstate;
@@ -1620,6 +2340,26 @@ NEON_FORCEINLINE bool nn_value_isrange(NNValue v)
     return nn_value_isobjtype(v, NEON_OBJTYPE_RANGE);
 }
 
+NEON_FORCEINLINE bool nn_value_isregex(NNValue v)
+{
+    return nn_value_isobjtype(v, NEON_OBJTYPE_REGEX);
+}
+
+NEON_FORCEINLINE bool nn_value_istypedarray(NNValue v)
+{
+    return nn_value_isobjtype(v, NEON_OBJTYPE_TYPEDARRAY);
+}
+
+NEON_FORCEINLINE bool nn_value_isset(NNValue v)
+{
+    return nn_value_isobjtype(v, NEON_OBJTYPE_SET);
+}
+
+NEON_FORCEINLINE bool nn_value_isiterator(NNValue v)
+{
+    return nn_value_isobjtype(v, NEON_OBJTYPE_ITERATOR);
+}
+
 NEON_FORCEINLINE bool nn_value_ismodule(NNValue v)
 {
     return nn_value_isobjtype(v, NEON_OBJTYPE_MODULE);
@@ -1735,34 +2475,112 @@ NEON_FORCEINLINE NNObjRange* nn_value_asrange(NNValue v)
     return ((NNObjRange*)nn_value_asobject(v));
 }
 
-#if !defined(NEON_CONFIG_USENANTAGGING) || (NEON_CONFIG_USENANTAGGING == 0)
-    NEON_FORCEINLINE NNValue nn_value_makevalue(NNValType type)
-    {
-        NNValue v;
-        v.type = type;
-        return v;
-    }
-#endif
+NEON_FORCEINLINE NNObjRegex* nn_value_asregex(NNValue v)
+{
+    return ((NNObjRegex*)nn_value_asobject(v));
+}
 
-NEON_FORCEINLINE NNValue nn_value_makenull()
+NEON_FORCEINLINE NNObjTypedArray* nn_value_astypedarray(NNValue v)
 {
-    #if defined(NEON_CONFIG_USENANTAGGING) && (NEON_CONFIG_USENANTAGGING == 1)
-        return NEON_VALUE_NULL;
-    #else
-        NNValue v;
-        v = nn_value_makevalue(NEON_VALTYPE_NULL);
-        return v;
-    #endif
+    return ((NNObjTypedArray*)nn_value_asobject(v));
 }
 
-NEON_FORCEINLINE NNValue nn_value_makebool(bool b)
+NEON_FORCEINLINE NNObjSet* nn_value_asset(NNValue v)
 {
-    #if defined(NEON_CONFIG_USENANTAGGING) && (NEON_CONFIG_USENANTAGGING == 1)
-        if(b)
-        {
-            return NEON_VALUE_TRUE;
-        }
-        return NEON_VALUE_FALSE;
+    return ((NNObjSet*)nn_value_asobject(v));
+}
+
+NEON_FORCEINLINE NNObjIterator* nn_value_asiterator(NNValue v)
+{
+    return ((NNObjIterator*)nn_value_asobject(v));
+}
+
+/*
+* converts a number to an integer modulo 2^32, like the integer typed arrays of javascript do:
+* the fraction is dropped, and NaN and infinities become 0.
+*/
+NEON_FORCEINLINE uint32_t nn_util_numbertouint32(double d)
+{
+    double m;
+    if((d >= -2147483648.0) && (d < 4294967296.0))
+    {
+        return (uint32_t)(int64_t)d;
+    }
+    if(isnan(d) || isinf(d))
+    {
+        return 0;
+    }
+    m = fmod(trunc(d), 4294967296.0);
+    if(m < 0)
+    {
+        m += 4294967296.0;
+    }
+    return (uint32_t)m;
+}
+
+NEON_FORCEINLINE double nn_typedarray_get(NNObjTypedArray* ta, size_t idx)
+{
+    switch(ta->kind)
+    {
+        case NEON_TYPEDARRAY_FLOAT64:
+            return ((double*)ta->data)[idx];
+        case NEON_TYPEDARRAY_INT32:
+            return ((int32_t*)ta->data)[idx];
+        case NEON_TYPEDARRAY_UINT32:
+            return ((uint32_t*)ta->data)[idx];
+        default:
+            break;
+    }
+    return ta->data[idx];
+}
+
+NEON_FORCEINLINE void nn_typedarray_set(NNObjTypedArray* ta, size_t idx, double val)
+{
+    switch(ta->kind)
+    {
+        case NEON_TYPEDARRAY_FLOAT64:
+            ((double*)ta->data)[idx] = val;
+            break;
+        case NEON_TYPEDARRAY_INT32:
+            ((int32_t*)ta->data)[idx] = (int32_t)nn_util_numbertouint32(val);
+            break;
+        case NEON_TYPEDARRAY_UINT32:
+            ((uint32_t*)ta->data)[idx] = nn_util_numbertouint32(val);
+            break;
+        default:
+            ta->data[idx] = (uint8_t)nn_util_numbertouint32(val);
+            break;
+    }
+}
+
+#if !defined(NEON_CONFIG_USENANTAGGING) || (NEON_CONFIG_USENANTAGGING == 0)
+    NEON_FORCEINLINE NNValue nn_value_makevalue(NNValType type)
+    {
+        NNValue v;
+        v.type = type;
+        return v;
+    }
+#endif
+
+NEON_FORCEINLINE NNValue nn_value_makenull()
+{
+    #if defined(NEON_CONFIG_USENANTAGGING) && (NEON_CONFIG_USENANTAGGING == 1)
+        return NEON_VALUE_NULL;
+    #else
+        NNValue v;
+        v = nn_value_makevalue(NEON_VALTYPE_NULL);
+        return v;
+    #endif
+}
+
+NEON_FORCEINLINE NNValue nn_value_makebool(bool b)
+{
+    #if defined(NEON_CONFIG_USENANTAGGING) && (NEON_CONFIG_USENANTAGGING == 1)
+        if(b)
+        {
+            return NEON_VALUE_TRUE;
+        }
+        return NEON_VALUE_FALSE;
     #else
         NNValue v;
         v = nn_value_makevalue(NEON_VALTYPE_BOOL);
@@ -1817,6 +2635,7 @@ NEON_FORCEINLINE NNValue nn_value_internstr(NNState* state, const char* str)
 #include "vallist.h"
 #include "hashtabval.h"
 #include "dictvaldict.h"
+#include "regexvm.h"
 
 NNObject* nn_gcmem_protect(NNState* state, NNObject* object)
 {
@@ -1899,21 +2718,149 @@ size_t nn_util_upperpowoftwo(size_t v)
     return v;
 }
 
-size_t nn_util_hashdata(const void* ptr, size_t len)
+/*
+* wide-word hashing, after wyhash (final version 4) by Wang Yi, released into the public domain.
+* reads 8 bytes at a time, and mixes them with a 64x64->128 bit multiplication.
+*/
+static const uint64_t g_hashsecret[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+NEON_FORCEINLINE void nn_util_hashmum(uint64_t* a, uint64_t* b)
+{
+    #if defined(__SIZEOF_INT128__)
+        __uint128_t r;
+        r = *a;
+        r *= *b;
+        *a = (uint64_t)r;
+        *b = (uint64_t)(r >> 64);
+    #else
+        uint64_t ha;
+        uint64_t hb;
+        uint64_t la;
+        uint64_t lb;
+        uint64_t rh;
+        uint64_t rm0;
+        uint64_t rm1;
+        uint64_t rl;
+        uint64_t t;
+        uint64_t lo;
+        uint64_t c;
+        ha = *a >> 32;
+        hb = *b >> 32;
+        la = (uint32_t)*a;
+        lb = (uint32_t)*b;
+        rh = ha * hb;
+        rm0 = ha * lb;
+        rm1 = hb * la;
+        rl = la * lb;
+        t = rl + (rm0 << 32);
+        c = (t < rl);
+        lo = t + (rm1 << 32);
+        c += (lo < t);
+        *a = lo;
+        *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    #endif
+}
+
+NEON_FORCEINLINE uint64_t nn_util_hashmix(uint64_t a, uint64_t b)
+{
+    nn_util_hashmum(&a, &b);
+    return a ^ b;
+}
+
+NEON_FORCEINLINE uint64_t nn_util_hashread8(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+NEON_FORCEINLINE uint64_t nn_util_hashread4(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+uint64_t nn_util_hashwide(const void* ptr, size_t len, uint64_t seed)
 {
-    /* djb2 */
     size_t i;
-    size_t hash;
-    uint8_t val;
-    const uint8_t* up;
-    up = (const uint8_t*)ptr;
-    hash = 5381;
-    for(i = 0; i < len; i++)
+    uint64_t a;
+    uint64_t b;
+    uint64_t see1;
+    uint64_t see2;
+    const uint8_t* p;
+    p = (const uint8_t*)ptr;
+    seed ^= nn_util_hashmix(seed ^ g_hashsecret[0], g_hashsecret[1]);
+    if(nn_util_likely(len <= 16))
+    {
+        if(nn_util_likely(len >= 4))
+        {
+            a = (nn_util_hashread4(p) << 32) | nn_util_hashread4(p + ((len >> 3) << 2));
+            b = (nn_util_hashread4(p + len - 4) << 32) | nn_util_hashread4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if(nn_util_likely(len > 0))
+        {
+            a = (((uint64_t)p[0]) << 16) | (((uint64_t)p[len >> 1]) << 8) | p[len - 1];
+            b = 0;
+        }
+        else
+        {
+            a = 0;
+            b = 0;
+        }
+    }
+    else
     {
-        val = up[i];
-        hash = ((hash << 5) + hash) + val;
+        i = len;
+        if(nn_util_unlikely(i > 48))
+        {
+            see1 = seed;
+            see2 = seed;
+            do
+            {
+                seed = nn_util_hashmix(nn_util_hashread8(p) ^ g_hashsecret[1], nn_util_hashread8(p + 8) ^ seed);
+                see1 = nn_util_hashmix(nn_util_hashread8(p + 16) ^ g_hashsecret[2], nn_util_hashread8(p + 24) ^ see1);
+                see2 = nn_util_hashmix(nn_util_hashread8(p + 32) ^ g_hashsecret[3], nn_util_hashread8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while(nn_util_likely(i > 48));
+            seed ^= see1 ^ see2;
+        }
+        while(nn_util_unlikely(i > 16))
+        {
+            seed = nn_util_hashmix(nn_util_hashread8(p) ^ g_hashsecret[1], nn_util_hashread8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = nn_util_hashread8(p + i - 16);
+        b = nn_util_hashread8(p + i - 8);
     }
-    return hash;
+    a ^= g_hashsecret[1];
+    b ^= seed;
+    nn_util_hashmum(&a, &b);
+    return nn_util_hashmix(a ^ g_hashsecret[0] ^ len, b ^ g_hashsecret[1]);
+}
+
+size_t nn_util_hashdata(const void* ptr, size_t len, uint64_t seed)
+{
+    return (size_t)nn_util_hashwide(ptr, len, seed);
+}
+
+/*
+* makes a seed for string hashing that differs between runs, so that colliding
+* dictionary keys cannot be precomputed.
+*/
+uint64_t nn_util_makehashseed(void* uptr)
+{
+    uint64_t seed;
+    struct timeval tv;
+    osfn_gettimeofday(&tv, NULL);
+    seed = ((uint64_t)tv.tv_sec << 20) ^ (uint64_t)tv.tv_usec;
+    seed ^= ((uint64_t)osfn_getpid() << 32);
+    /* mixes in ASLR, if any. */
+    seed ^= (uint64_t)(uintptr_t)uptr;
+    seed ^= (uint64_t)(uintptr_t)&seed;
+    return nn_util_hashmix(seed ^ g_hashsecret[2], g_hashsecret[3]);
 }
 
 char* nn_util_strndup(const char* src, size_t len)
@@ -2044,47 +2991,281 @@ char* nn_util_filegetshandle(char* s, int size, FILE *f, size_t* lendest)
 }
 
 
-int nn_util_filegetlinehandle(char **lineptr, size_t *destlen, FILE* hnd)
+/*
+* copies everything from offset $pos of $infd onwards to $outfd, at its current offset.
+* where it can, the kernel does the copying - with copy_file_range(), which may even share
+* extents between the files, or else sendfile() - so the data never passes through this process.
+* anything those cannot handle, such as appending, goes through read() and write().
+* returns the number of bytes copied, or -1 on an error, with errno set.
+*/
+int64_t nn_util_copyfd(int infd, int64_t pos, int outfd)
 {
-    enum { kInitialStrBufSize = 256 };
-    static char stackbuf[kInitialStrBufSize];
-    char *heapbuf;
-    size_t getlen;
-    unsigned int linelen;
-    getlen = 0;
-    if(lineptr == NULL || destlen == NULL)
+    int64_t total;
+    int64_t rt;
+    int64_t wr;
+    int64_t done;
+    char* buf;
+    total = 0;
+    #if defined(NEON_PLAT_HAVESENDFILE)
     {
-        errno = EINVAL;
-        return -1;
+        off_t off;
+        #if defined(SYS_copy_file_range)
+        {
+            int64_t off64;
+            while(true)
+            {
+                off64 = pos;
+                rt = syscall(SYS_copy_file_range, infd, &off64, outfd, NULL, NEON_CONFIG_COPYCHUNKSIZE, 0);
+                if((rt < 0) && (errno == EINTR))
+                {
+                    continue;
+                }
+                if(rt <= 0)
+                {
+                    break;
+                }
+                pos += rt;
+                total += rt;
+            }
+            /* some files, like those in /proc, claim to be empty to copy_file_range(). */
+            if((rt == 0) && (total > 0))
+            {
+                return total;
+            }
+        }
+        #endif
+        while(true)
+        {
+            off = pos;
+            rt = sendfile(outfd, infd, &off, NEON_CONFIG_COPYCHUNKSIZE);
+            if((rt < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            if(rt <= 0)
+            {
+                break;
+            }
+            pos += rt;
+            total += rt;
+        }
+        if((rt == 0) && (total > 0))
+        {
+            return total;
+        }
     }
-    if(ferror(hnd))
+    #endif
+    if(lseek(infd, pos, SEEK_SET) < 0)
     {
         return -1;
     }
-    if (feof(hnd))
+    buf = (char*)nn_memory_malloc(NEON_CONFIG_FILEBUFSIZE);
+    while(true)
     {
-        return -1;     
+        rt = read(infd, buf, NEON_CONFIG_FILEBUFSIZE);
+        if(rt < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            total = -1;
+            break;
+        }
+        if(rt == 0)
+        {
+            break;
+        }
+        done = 0;
+        while(done < rt)
+        {
+            wr = write(outfd, buf + done, rt - done);
+            if(wr < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+                nn_memory_free(buf);
+                return -1;
+            }
+            done += wr;
+        }
+        total += rt;
     }
-    nn_util_filegetshandle(stackbuf,kInitialStrBufSize,hnd, &getlen);
-    heapbuf = strchr(stackbuf,'\n');   
-    if(heapbuf)
+    nn_memory_free(buf);
+    return total;
+}
+
+#if defined(NEON_PLAT_HAVEWRITEV)
+/*
+* writes all of the $count buffers in $iov to $fd, $NEON_CONFIG_IOVMAX at a time,
+* retrying after partial writes. $iov is modified in the process.
+*/
+bool nn_util_writevall(int fd, struct iovec* iov, int count)
+{
+    int cnt;
+    ssize_t rt;
+    while(count > 0)
     {
-        *heapbuf = '\0';
+        cnt = (count > NEON_CONFIG_IOVMAX) ? NEON_CONFIG_IOVMAX : count;
+        rt = writev(fd, iov, cnt);
+        if(rt < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        /* skip past whatever did get written, and try again with the rest. */
+        while((count > 0) && ((size_t)rt >= iov[0].iov_len))
+        {
+            rt -= iov[0].iov_len;
+            iov++;
+            count--;
+        }
+        if(count > 0)
+        {
+            iov[0].iov_base = (char*)iov[0].iov_base + rt;
+            iov[0].iov_len -= rt;
+        }
+    }
+    return true;
+}
+#endif
+
+/*
+* matches the bracket expression starting at $pat[$pi] against $ch. sets $endp to just past
+* its closing ']', or to 0 if there is none, in which case the '[' is an ordinary character.
+*/
+bool nn_util_globclass(const char* pat, size_t plen, size_t pi, unsigned char ch, size_t* endp)
+{
+    size_t i;
+    bool first;
+    bool negate;
+    bool matched;
+    unsigned char lo;
+    unsigned char hi;
+    i = pi + 1;
+    negate = false;
+    matched = false;
+    if((i < plen) && ((pat[i] == '!') || (pat[i] == '^')))
+    {
+        negate = true;
+        i++;
     }
-    linelen = getlen;
-    if((linelen+1) < kInitialStrBufSize)
+    /* a ']' right after the '[' is a member, not the end. */
+    first = true;
+    while((i < plen) && (first || (pat[i] != ']')))
     {
-        heapbuf = (char*)realloc(*lineptr, kInitialStrBufSize);
-        if(heapbuf == NULL)
+        first = false;
+        if((pat[i] == '\\') && ((i + 1) < plen))
         {
-            return -1;
+            i++;
+        }
+        lo = pat[i];
+        hi = lo;
+        i++;
+        if(((i + 1) < plen) && (pat[i] == '-') && (pat[i + 1] != ']'))
+        {
+            i++;
+            if((pat[i] == '\\') && ((i + 1) < plen))
+            {
+                i++;
+            }
+            hi = pat[i];
+            i++;
+        }
+        if((ch >= lo) && (ch <= hi))
+        {
+            matched = true;
+        }
+    }
+    if(i >= plen)
+    {
+        *endp = 0;
+        return false;
+    }
+    *endp = i + 1;
+    return (matched != negate);
+}
+
+/*
+* whether $str matches the shell wildcard $pat: '*' matches any run of characters, '?' any one,
+* and [abc], [a-z] or [!abc] one out of a set. a backslash makes the character after it literal.
+* a '*' is retried at later positions only once what follows it fails, which takes linear time
+* for the usual patterns, and never backtracks further than the last '*'.
+*/
+bool nn_util_globmatch(const char* pat, size_t plen, const char* str, size_t slen)
+{
+    size_t pi;
+    size_t si;
+    size_t end;
+    size_t starpi;
+    size_t starsi;
+    bool havestar;
+    pi = 0;
+    si = 0;
+    starpi = 0;
+    starsi = 0;
+    havestar = false;
+    while(si < slen)
+    {
+        if(pi < plen)
+        {
+            if(pat[pi] == '*')
+            {
+                havestar = true;
+                pi++;
+                starpi = pi;
+                starsi = si;
+                continue;
+            }
+            if(pat[pi] == '?')
+            {
+                pi++;
+                si++;
+                continue;
+            }
+            if(pat[pi] == '[')
+            {
+                if(nn_util_globclass(pat, plen, pi, (unsigned char)str[si], &end))
+                {
+                    pi = end;
+                    si++;
+                    continue;
+                }
+                if(end != 0)
+                {
+                    goto mismatch;
+                }
+            }
+            else if((pat[pi] == '\\') && ((pi + 1) < plen))
+            {
+                pi++;
+            }
+            if(pat[pi] == str[si])
+            {
+                pi++;
+                si++;
+                continue;
+            }
         }
-        *lineptr = heapbuf;
-        *destlen = kInitialStrBufSize;
+    mismatch:
+        if(!havestar)
+        {
+            return false;
+        }
+        starsi++;
+        si = starsi;
+        pi = starpi;
+    }
+    while((pi < plen) && (pat[pi] == '*'))
+    {
+        pi++;
     }
-    strcpy(*lineptr,stackbuf);
-    *destlen = linelen;
-    return linelen;
+    return (pi == plen);
 }
 
 /* returns the number of bytes contained in a unicode character */
@@ -2372,26 +3553,216 @@ char* nn_util_strtolower(char* str, size_t length)
     return str;
 }
 
-
-#if 0
-    #define NEON_APIDEBUG(state, ...) \
-        if((nn_util_unlikely((state)->conf.enableapidebug))) \
-        { \
-            nn_state_apidebug(state, __FUNCTION__, __VA_ARGS__); \
+/*
+* writes the shortest decimal form of $num that reads back as the same double into $dest, which
+* must hold at least NEON_CONFIG_NUMBERBUFSIZE bytes, and returns its length.
+* integers that a double holds exactly are converted directly, without going through printf;
+* other numbers take the first of 15, 16 and 17 significant digits that round-trips. any decimal
+* of up to 15 digits survives the trip through a normal double, so %.15g of one already is the
+* shortest; subnormals hold fewer digits, so for them the search starts at 1.
+*/
+size_t nn_util_formatnumber(double num, char* dest)
+{
+    int len;
+    int prec;
+    uint64_t uval;
+    char* p;
+    char tmp[24];
+    if((num > -9007199254740992.0) && (num < 9007199254740992.0) && (num == (double)(int64_t)num) && !((num == 0) && signbit(num)))
+    {
+        p = dest;
+        uval = (num < 0) ? (uint64_t)(-num) : (uint64_t)num;
+        if(num < 0)
+        {
+            *p++ = '-';
         }
-#else
-    #define NEON_APIDEBUG(state, ...)
-#endif
-
-#if defined(__STRICT_ANSI__)
-    #define NEON_ASTDEBUG(state, ...)
-#else
-    #define NEON_ASTDEBUG(state, ...) \
-        if((nn_util_unlikely((state)->conf.enableastdebug))) \
-        { \
-            nn_state_astdebug(state, __FUNCTION__, __VA_ARGS__); \
+        len = 0;
+        do
+        {
+            tmp[len++] = '0' + (uval % 10);
+            uval /= 10;
+        } while(uval > 0);
+        while(len > 0)
+        {
+            *p++ = tmp[--len];
         }
-#endif
+        *p = 0;
+        return p - dest;
+    }
+    len = 0;
+    prec = (fpclassify(num) == FP_SUBNORMAL) ? 1 : 15;
+    for(; prec <= 17; prec++)
+    {
+        len = snprintf(dest, NEON_CONFIG_NUMBERBUFSIZE, "%.*g", prec, num);
+        if(isnan(num) || isinf(num) || (nn_util_strtod(dest, len, NULL) == num))
+        {
+            break;
+        }
+    }
+    return len;
+}
+
+/*
+* parses a decimal number from the first $len bytes of $str, stopping at the first character that
+* is not part of it, and stores where that is in $endp, if not NULL.
+* a mantissa of up to 15 digits, scaled by a power of ten of up to 22, is computed exactly in
+* double arithmetic (Clinger's fast path), which covers almost every number found in source code,
+* CSV and JSON. anything else - more digits, large exponents, hex, inf and nan - is left to strtod.
+*/
+double nn_util_strtod(const char* str, size_t len, const char** endp)
+{
+    int digits;
+    int exp;
+    int expval;
+    bool isneg;
+    bool expneg;
+    size_t i;
+    uint64_t mant;
+    double value;
+    char tmp[64];
+    char* numstr;
+    char* numend;
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    i = 0;
+    isneg = false;
+    mant = 0;
+    digits = 0;
+    exp = 0;
+    if((i < len) && ((str[i] == '-') || (str[i] == '+')))
+    {
+        isneg = (str[i] == '-');
+        i++;
+    }
+    while((i < len) && (str[i] == '0'))
+    {
+        i++;
+    }
+    while((i < len) && isdigit((unsigned char)str[i]))
+    {
+        mant = (mant * 10) + (str[i] - '0');
+        digits++;
+        i++;
+    }
+    if((i < len) && (str[i] == '.'))
+    {
+        i++;
+        if(mant == 0)
+        {
+            while((i < len) && (str[i] == '0'))
+            {
+                exp--;
+                i++;
+            }
+        }
+        while((i < len) && isdigit((unsigned char)str[i]))
+        {
+            mant = (mant * 10) + (str[i] - '0');
+            digits++;
+            exp--;
+            i++;
+        }
+    }
+    if((i < len) && ((str[i] == 'e') || (str[i] == 'E')) && (i > 0) && isdigit((unsigned char)str[i - 1]))
+    {
+        i++;
+        expneg = false;
+        if((i < len) && ((str[i] == '-') || (str[i] == '+')))
+        {
+            expneg = (str[i] == '-');
+            i++;
+        }
+        if((i >= len) || !isdigit((unsigned char)str[i]))
+        {
+            goto slowpath;
+        }
+        expval = 0;
+        while((i < len) && isdigit((unsigned char)str[i]))
+        {
+            if(expval < 10000)
+            {
+                expval = (expval * 10) + (str[i] - '0');
+            }
+            i++;
+        }
+        exp += expneg ? -expval : expval;
+    }
+    /* nothing recognized, or something strtod might read further, such as "0x1f" or "inf". */
+    if((i == 0) || !isdigit((unsigned char)str[i - 1]) || ((i < len) && isalpha((unsigned char)str[i])))
+    {
+        goto slowpath;
+    }
+    if(mant == 0)
+    {
+        value = 0;
+    }
+    else if((digits <= 15) && (exp >= -22) && (exp <= 22))
+    {
+        value = (double)mant;
+        value = (exp < 0) ? (value / powers[-exp]) : (value * powers[exp]);
+    }
+    else
+    {
+        goto slowpath;
+    }
+    if(endp != NULL)
+    {
+        *endp = str + i;
+    }
+    return isneg ? -value : value;
+slowpath:
+    /* $str need not be NUL-terminated, so strtod gets a copy of the part that could be a number. */
+    i = 0;
+    while((i < len) && isspace((unsigned char)str[i]))
+    {
+        i++;
+    }
+    while((i < len) && (isalnum((unsigned char)str[i]) || (str[i] == '.') || (str[i] == '+') || (str[i] == '-')))
+    {
+        i++;
+    }
+    len = i;
+    numstr = tmp;
+    if(len >= sizeof(tmp))
+    {
+        numstr = (char*)nn_memory_malloc(len + 1);
+    }
+    memcpy(numstr, str, len);
+    numstr[len] = 0;
+    value = strtod(numstr, &numend);
+    if(endp != NULL)
+    {
+        *endp = str + (numend - numstr);
+    }
+    if(numstr != tmp)
+    {
+        nn_memory_free(numstr);
+    }
+    return value;
+}
+
+
+#if 0
+    #define NEON_APIDEBUG(state, ...) \
+        if((nn_util_unlikely((state)->conf.enableapidebug))) \
+        { \
+            nn_state_apidebug(state, __FUNCTION__, __VA_ARGS__); \
+        }
+#else
+    #define NEON_APIDEBUG(state, ...)
+#endif
+
+#if defined(__STRICT_ANSI__)
+    #define NEON_ASTDEBUG(state, ...)
+#else
+    #define NEON_ASTDEBUG(state, ...) \
+        if((nn_util_unlikely((state)->conf.enableastdebug))) \
+        { \
+            nn_state_astdebug(state, __FUNCTION__, __VA_ARGS__); \
+        }
+#endif
 
 /*
 NEON_FORCEINLINE void nn_state_apidebugv(NNState* state, const char* funcname, const char* format, va_list va)
@@ -2546,15 +3917,18 @@ void nn_gcmem_blackenobject(NNState* state, NNObject* object)
             {
                 NNObjDict* dict;
                 dict = (NNObjDict*)object;
-                nn_vallist_mark(dict->names);
-                nn_tableval_mark(state, dict->htab);
+                nn_dict_mark(state, dict);
             }
             break;
         case NEON_OBJTYPE_ARRAY:
             {
                 NNObjArray* list;
                 list = (NNObjArray*)object;
-                nn_vallist_mark(list->varray);
+                /* numbers are not objects, so there is nothing to trace. */
+                if(list->varray->listkind != NEON_ELEMKIND_NUMBER)
+                {
+                    nn_vallist_mark(list->varray);
+                }
             }
             break;
         case NEON_OBJTYPE_FUNCBOUND:
@@ -2571,6 +3945,7 @@ void nn_gcmem_blackenobject(NNState* state, NNObject* object)
                 klass = (NNObjClass*)object;
                 nn_gcmem_markobject(state, (NNObject*)klass->name);
                 nn_tableval_mark(state, klass->instmethods);
+                nn_tableval_mark(state, klass->instproperties);
                 nn_tableval_mark(state, klass->staticmethods);
                 nn_tableval_mark(state, klass->staticproperties);
                 nn_gcmem_markvalue(state, klass->constructor);
@@ -2614,10 +3989,49 @@ void nn_gcmem_blackenobject(NNState* state, NNObject* object)
                 nn_gcmem_markvalue(state, ((NNObjUpvalue*)object)->closed);
             }
             break;
+        case NEON_OBJTYPE_REGEX:
+            {
+                nn_gcmem_markobject(state, (NNObject*)((NNObjRegex*)object)->pattern);
+            }
+            break;
+        case NEON_OBJTYPE_TYPEDARRAY:
+            {
+                nn_gcmem_markobject(state, (NNObject*)((NNObjTypedArray*)object)->parent);
+            }
+            break;
+        case NEON_OBJTYPE_SET:
+            {
+                nn_gcmem_markobject(state, (NNObject*)((NNObjSet*)object)->items);
+            }
+            break;
+        case NEON_OBJTYPE_ITERATOR:
+            {
+                NNObjIterator* iter;
+                iter = (NNObjIterator*)object;
+                nn_gcmem_markvalue(state, iter->source);
+                nn_gcmem_markvalue(state, iter->other);
+                nn_gcmem_markvalue(state, iter->callable);
+                nn_gcmem_markvalue(state, iter->current);
+                nn_gcmem_markobject(state, (NNObject*)iter->nestargs);
+            }
+            break;
+        case NEON_OBJTYPE_STRING:
+            {
+                NNObjString* string;
+                string = (NNObjString*)object;
+                if(string->parent != NULL)
+                {
+                    nn_gcmem_markobject(state, (NNObject*)string->parent);
+                }
+                if(string->retired != NULL)
+                {
+                    nn_gcmem_markobject(state, (NNObject*)string->retired);
+                }
+            }
+            break;
         case NEON_OBJTYPE_RANGE:
         case NEON_OBJTYPE_FUNCNATIVE:
         case NEON_OBJTYPE_USERDATA:
-        case NEON_OBJTYPE_STRING:
             break;
     }
 }
@@ -2652,8 +4066,7 @@ void nn_gcmem_destroyobject(NNState* state, NNObject* object)
             {
                 NNObjDict* dict;
                 dict = (NNObjDict*)object;
-                nn_vallist_destroy(dict->names);
-                nn_tableval_destroy(dict->htab);
+                nn_dict_clear(dict);
                 nn_gcmem_release(state, object, sizeof(NNObjDict));
             }
             break;
@@ -2723,6 +4136,53 @@ void nn_gcmem_destroyobject(NNState* state, NNObject* object)
                 nn_gcmem_release(state, object, sizeof(NNObjRange));
             }
             break;
+        case NEON_OBJTYPE_REGEX:
+            {
+                nn_regex_destroy(state, (NNObjRegex*)object);
+            }
+            break;
+        case NEON_OBJTYPE_TYPEDARRAY:
+            {
+                NNObjTypedArray* ta;
+                ta = (NNObjTypedArray*)object;
+                if(ta->parent == NULL)
+                {
+                    #if defined(NEON_PLAT_HAVEMMAP)
+                        if(ta->mapsize > 0)
+                        {
+                            munmap(ta->data, ta->mapsize);
+                        }
+                        else
+                    #endif
+                    {
+                        nn_memory_free(ta->data);
+                    }
+                }
+                nn_gcmem_release(state, object, sizeof(NNObjTypedArray));
+            }
+            break;
+        case NEON_OBJTYPE_SET:
+            {
+                nn_gcmem_release(state, object, sizeof(NNObjSet));
+            }
+            break;
+        case NEON_OBJTYPE_ITERATOR:
+            {
+                NNObjIterator* iter;
+                iter = (NNObjIterator*)object;
+                if(iter->csv != NULL)
+                {
+                    nn_csv_destroyreader(iter->csv);
+                    nn_memory_free(iter->csv);
+                }
+                if(iter->walker != NULL)
+                {
+                    nn_walker_destroy(iter->walker);
+                    nn_memory_free(iter->walker);
+                }
+                nn_gcmem_release(state, object, sizeof(NNObjIterator));
+            }
+            break;
         case NEON_OBJTYPE_STRING:
             {
                 NNObjString* string;
@@ -2782,6 +4242,10 @@ void nn_gcmem_markroots(NNState* state)
     nn_tableval_mark(state, state->declaredglobals);
     nn_tableval_mark(state, state->openedmodules);
     nn_gcmem_markobject(state, (NNObject*)state->exceptions.stdexception);
+    for(i = 0; i < NEON_CONFIG_REGEXCACHESIZE; i++)
+    {
+        nn_gcmem_markobject(state, (NNObject*)state->regexcache.items[i]);
+    }
     nn_gcmem_markcompilerroots(state);
 }
 
@@ -3346,29 +4810,11 @@ NNProperty nn_property_makewithpointer(NNState* state, NNValue val, NNFieldType
 {
     NNProperty vf;
     (void)state;
-    memset(&vf, 0, sizeof(NNProperty));
     vf.type = type;
     vf.value = val;
-    vf.havegetset = false;
     return vf;
 }
 
-NNProperty nn_property_makewithgetset(NNState* state, NNValue val, NNValue getter, NNValue setter, NNFieldType type)
-{
-    bool getisfn;
-    bool setisfn;
-    NNProperty np;
-    np = nn_property_makewithpointer(state, val, type);
-    setisfn = nn_value_iscallable(setter);
-    getisfn = nn_value_iscallable(getter);
-    if(getisfn || setisfn)
-    {
-        np.getset.setter = setter;
-        np.getset.getter = getter;
-    }
-    return np;
-}
-
 NNProperty nn_property_make(NNState* state, NNValue val, NNFieldType type)
 {
     return nn_property_makewithpointer(state, val, type);
@@ -3378,18 +4824,19 @@ NNProperty nn_property_make(NNState* state, NNValue val, NNFieldType type)
 void nn_tableval_print(NNState* state, NNPrinter* pr, NNHashValTable* table, const char* name)
 {
     int i;
-    NNHashValEntry* entry;
+    int n;
     (void)state;
     nn_printer_printf(pr, "<HashTable of %s : {\n", name);
+    n = 0;
     for(i = 0; i < table->capacity; i++)
     {
-        entry = &table->entries[i];
-        if(!nn_value_isnull(entry->key))
+        if(nn_tableval_slotisfull(table, i))
         {
-            nn_printer_printvalue(pr, entry->key, true, true);
+            nn_printer_printvalue(pr, table->keys[i], true, true);
             nn_printer_printf(pr, ": ");
-            nn_printer_printvalue(pr, entry->value.value, true, true);
-            if(i != table->capacity - 1)
+            nn_printer_printvalue(pr, table->values[i].value, true, true);
+            n++;
+            if(n != table->count)
             {
                 nn_printer_printf(pr, ",\n");
             }
@@ -3405,12 +4852,16 @@ void nn_printer_initvars(NNState* state, NNPrinter* pr, NNPrMode mode)
     pr->wrmode = NEON_PRMODE_UNDEFINED;
     pr->shouldclose = false;
     pr->shouldflush = false;
+    pr->linebuffered = false;
     pr->stringtaken = false;
     pr->shortenvalues = false;
     pr->jsonmode = false;
     pr->maxvallength = 15;
     pr->strbuf = NULL;
     pr->handle = NULL;
+    pr->iobuf = NULL;
+    pr->iolength = 0;
+    pr->iocapacity = 0;
     pr->wrmode = mode;
 }
 
@@ -3484,6 +4935,8 @@ void nn_printer_destroy(NNPrinter* pr)
     }
     else if(pr->wrmode == NEON_PRMODE_FILE)
     {
+        nn_printer_flush(pr);
+        nn_memory_free(pr->iobuf);
         if(pr->shouldclose)
         {
             #if 0
@@ -3504,15 +4957,103 @@ NNObjString* nn_printer_takestring(NNPrinter* pr)
     NNState* state;
     NNObjString* os;
     state = pr->pstate;
-    hash = nn_util_hashstring(pr->strbuf->data, pr->strbuf->length);
+    hash = nn_util_hashstring(pr->pstate, pr->strbuf->data, pr->strbuf->length);
     os = nn_string_makefromstrbuf(state, pr->strbuf, hash);
     pr->stringtaken = true;
     return os;
 }
 
+/*
+* gives a file printer an output buffer of $size bytes, or takes it away if $size is 0.
+* with $linebuffered, the buffer is also flushed after every newline, like stdio does for terminals.
+*/
+void nn_printer_setbuffer(NNPrinter* pr, size_t size, bool linebuffered)
+{
+    if(pr->wrmode != NEON_PRMODE_FILE)
+    {
+        return;
+    }
+    nn_printer_flush(pr);
+    nn_memory_free(pr->iobuf);
+    pr->iobuf = NULL;
+    pr->iocapacity = 0;
+    pr->linebuffered = linebuffered;
+    if(size > 0)
+    {
+        pr->iobuf = (char*)nn_memory_malloc(size);
+        pr->iocapacity = size;
+    }
+}
+
+/*
+* writes the buffered output, followed by $extra (which may be NULL), to the file.
+* on posix, both go out in a single writev() call; stdio's own buffer is flushed first,
+* so that anything written to the same FILE directly still comes out in order.
+*/
+bool nn_printer_writeout(NNPrinter* pr, const char* extra, size_t extralen)
+{
+    #if defined(NEON_PLAT_HAVEWRITEV)
+        int cnt;
+        struct iovec iov[2];
+        fflush(pr->handle);
+        cnt = 0;
+        if(pr->iolength > 0)
+        {
+            iov[cnt].iov_base = pr->iobuf;
+            iov[cnt].iov_len = pr->iolength;
+            cnt++;
+        }
+        if(extralen > 0)
+        {
+            iov[cnt].iov_base = (void*)extra;
+            iov[cnt].iov_len = extralen;
+            cnt++;
+        }
+        pr->iolength = 0;
+        if(!nn_util_writevall(fileno(pr->handle), iov, cnt))
+        {
+            return false;
+        }
+    #else
+        fwrite(pr->iobuf, sizeof(char), pr->iolength, pr->handle);
+        fwrite(extra, sizeof(char), extralen, pr->handle);
+        fflush(pr->handle);
+        pr->iolength = 0;
+    #endif
+    return true;
+}
+
+/* writes out whatever a file printer has buffered. */
+bool nn_printer_flush(NNPrinter* pr)
+{
+    if((pr->wrmode != NEON_PRMODE_FILE) || (pr->iolength == 0))
+    {
+        return true;
+    }
+    return nn_printer_writeout(pr, NULL, 0);
+}
+
 bool nn_printer_writestringl(NNPrinter* pr, const char* estr, size_t elen)
 {
-    if(pr->wrmode == NEON_PRMODE_FILE)
+    if((pr->wrmode == NEON_PRMODE_FILE) && (pr->iobuf != NULL))
+    {
+        if(pr->iolength + elen > pr->iocapacity)
+        {
+            if(elen >= pr->iocapacity)
+            {
+                /* too big to be worth copying: write it out along with the buffer. */
+                return nn_printer_writeout(pr, estr, elen);
+            }
+            nn_printer_flush(pr);
+        }
+        memcpy(pr->iobuf + pr->iolength, estr, elen);
+        pr->iolength += elen;
+        if(pr->linebuffered && (memchr(estr, '\n', elen) != NULL))
+        {
+            nn_printer_flush(pr);
+        }
+    }
+    else if(pr->wrmode == NEON_PRMODE_FILE)
     {
         fwrite(estr, sizeof(char), elen, pr->handle);
         if(pr->shouldflush)
@@ -3539,7 +5080,7 @@ bool nn_printer_writestring(NNPrinter* pr, const char* estr)
 bool nn_printer_writechar(NNPrinter* pr, int b)
 {
     char ch;
-    if(pr->wrmode == NEON_PRMODE_STRING)
+    if((pr->wrmode == NEON_PRMODE_STRING) || (pr->iobuf != NULL))
     {
         ch = b;
         nn_printer_writestringl(pr, &ch, 1);
@@ -3666,12 +5207,49 @@ bool nn_printer_vwritefmttostring(NNPrinter* pr, const char* fmt, va_list va)
     return true;
 }
 
+/* formats straight into the output buffer of a buffered file printer. */
+bool nn_printer_vwritefmttobuffer(NNPrinter* pr, const char* fmt, va_list va)
+{
+    int needed;
+    size_t avail;
+    va_list copy;
+    avail = pr->iocapacity - pr->iolength;
+    va_copy(copy, va);
+    needed = vsnprintf(pr->iobuf + pr->iolength, avail, fmt, copy);
+    va_end(copy);
+    if(needed < 0)
+    {
+        return false;
+    }
+    if((size_t)needed >= avail)
+    {
+        nn_printer_flush(pr);
+        if((size_t)needed >= pr->iocapacity)
+        {
+            vfprintf(pr->handle, fmt, va);
+            fflush(pr->handle);
+            return true;
+        }
+        vsnprintf(pr->iobuf, pr->iocapacity, fmt, va);
+    }
+    pr->iolength += needed;
+    if(pr->linebuffered && (memchr(pr->iobuf + pr->iolength - needed, '\n', needed) != NULL))
+    {
+        nn_printer_flush(pr);
+    }
+    return true;
+}
+
 bool nn_printer_vwritefmt(NNPrinter* pr, const char* fmt, va_list va)
 {
     if(pr->wrmode == NEON_PRMODE_STRING)
     {
         return nn_printer_vwritefmttostring(pr, fmt, va);
     }
+    else if((pr->wrmode == NEON_PRMODE_FILE) && (pr->iobuf != NULL))
+    {
+        return nn_printer_vwritefmttobuffer(pr, fmt, va);
+    }
     else if(pr->wrmode == NEON_PRMODE_FILE)
     {
         vfprintf(pr->handle, fmt, va);
@@ -3714,6 +5292,26 @@ void nn_printer_printfunction(NNPrinter* pr, NNObjFuncScript* func)
     }
 }
 
+void nn_printer_printtypedarray(NNPrinter* pr, NNObjTypedArray* ta)
+{
+    size_t i;
+    nn_printer_printf(pr, "%s[", nn_typedarray_kindname(ta->kind));
+    for(i = 0; i < ta->length; i++)
+    {
+        nn_printer_printvalue(pr, nn_value_makenumber(nn_typedarray_get(ta, i)), true, true);
+        if(i != ta->length - 1)
+        {
+            nn_printer_printf(pr, ",");
+        }
+        if(pr->shortenvalues && (i >= pr->maxvallength))
+        {
+            nn_printer_printf(pr, " [%ld items]", ta->length);
+            break;
+        }
+    }
+    nn_printer_printf(pr, "]");
+}
+
 void nn_printer_printarray(NNPrinter* pr, NNObjArray* list)
 {
     size_t i;
@@ -3756,22 +5354,59 @@ void nn_printer_printarray(NNPrinter* pr, NNObjArray* list)
     nn_printer_printf(pr, "]");
 }
 
+void nn_printer_printset(NNPrinter* pr, NNObjSet* set)
+{
+    size_t i;
+    size_t n;
+    NNObjDict* items;
+    items = set->items;
+    nn_printer_printf(pr, "Set{");
+    n = 0;
+    for(i = 0; i < items->entrycount; i++)
+    {
+        if(!items->entries[i].live)
+        {
+            continue;
+        }
+        if(nn_value_isset(items->entries[i].key) && (nn_value_asset(items->entries[i].key) == set))
+        {
+            nn_printer_printf(pr, "<recursion>");
+        }
+        else
+        {
+            nn_printer_printvalue(pr, items->entries[i].key, true, true);
+        }
+        n++;
+        if(n != items->count)
+        {
+            nn_printer_printf(pr, ", ");
+        }
+    }
+    nn_printer_printf(pr, "}");
+}
+
 void nn_printer_printdict(NNPrinter* pr, NNObjDict* dict)
 {
     size_t i;
+    size_t n;
     size_t dsz;
     bool keyisrecur;
     bool valisrecur;
     NNValue val;
     NNObjDict* subdict;
     NNProperty* field;
-    dsz = dict->names->listcount;
+    dsz = dict->count;
     nn_printer_printf(pr, "{");
-    for(i = 0; i < dsz; i++)
+    n = 0;
+    for(i = 0; i < dict->entrycount; i++)
     {
+        if(!dict->entries[i].live)
+        {
+            continue;
+        }
         valisrecur = false;
         keyisrecur = false;
-        val = dict->names->listitems[i];
+        val = dict->entries[i].key;
         if(nn_value_isdict(val))
         {
             subdict = nn_value_asdict(val);
@@ -3789,35 +5424,33 @@ void nn_printer_printdict(NNPrinter* pr, NNObjDict* dict)
             nn_printer_printvalue(pr, val, true, true);
         }
         nn_printer_printf(pr, ": ");
-        field = nn_tableval_getfield(dict->htab, dict->names->listitems[i]);
-        if(field != NULL)
+        field = &dict->entries[i].value;
+        if(nn_value_isdict(field->value))
         {
-            if(nn_value_isdict(field->value))
-            {
-                subdict = nn_value_asdict(field->value);
-                if(subdict == dict)
-                {
-                    keyisrecur = true;
-                }
-            }
-            if(keyisrecur)
-            {
-                nn_printer_printf(pr, "<recursion>");
-            }
-            else
+            subdict = nn_value_asdict(field->value);
+            if(subdict == dict)
             {
-                nn_printer_printvalue(pr, field->value, true, true);
+                keyisrecur = true;
             }
         }
-        if(i != dsz - 1)
+        if(keyisrecur)
+        {
+            nn_printer_printf(pr, "<recursion>");
+        }
+        else
+        {
+            nn_printer_printvalue(pr, field->value, true, true);
+        }
+        if(n != dsz - 1)
         {
             nn_printer_printf(pr, ", ");
         }
-        if(pr->shortenvalues && (pr->maxvallength >= i))
+        if(pr->shortenvalues && (pr->maxvallength >= n))
         {
             nn_printer_printf(pr, " [%ld items]", dsz);
             break;
         }
+        n++;
     }
     nn_printer_printf(pr, "}");
 }
@@ -3871,25 +5504,23 @@ void nn_printer_printinstance(NNPrinter* pr, NNObjInstance* instance, bool invme
 //void nn_printer_printvalue(NNPrinter *pr, NNValue value, bool fixstring, bool invmethod);
 void nn_printer_printtable(NNPrinter* pr, NNHashValTable* table)
 {
-    size_t i;
-    NNHashValEntry* entry;
+    int i;
+    int n;
     nn_printer_printf(pr, "{");
-    for(i = 0; i < (size_t)table->capacity; i++)
+    n = 0;
+    for(i = 0; i < table->capacity; i++)
     {
-        entry = &table->entries[i];
-        if(nn_value_isnull(entry->key))
+        if(!nn_tableval_slotisfull(table, i))
         {
             continue;
         }
-        nn_printer_printvalue(pr, entry->key, true, false);
+        nn_printer_printvalue(pr, table->keys[i], true, false);
         nn_printer_printf(pr, ":");
-        nn_printer_printvalue(pr, entry->value.value, true, false);
-        if(!nn_value_isnull(table->entries[i+1].key))
+        nn_printer_printvalue(pr, table->values[i].value, true, false);
+        n++;
+        if(n != table->count)
         {
-            if((i+1) < (size_t)table->capacity)
-            {
-                nn_printer_printf(pr, ",");
-            }
+            nn_printer_printf(pr, ",");
         }
     }
     nn_printer_printf(pr, "}");
@@ -3975,6 +5606,26 @@ void nn_printer_printobject(NNPrinter* pr, NNValue value, bool fixstring, bool i
                 nn_printer_printf(pr, "<range %d .. %d>", range->lower, range->upper);
             }
             break;
+        case NEON_OBJTYPE_REGEX:
+            {
+                nn_printer_printf(pr, "<regex /%s/>", nn_value_asregex(value)->pattern->sbuf->data);
+            }
+            break;
+        case NEON_OBJTYPE_TYPEDARRAY:
+            {
+                nn_printer_printtypedarray(pr, nn_value_astypedarray(value));
+            }
+            break;
+        case NEON_OBJTYPE_SET:
+            {
+                nn_printer_printset(pr, nn_value_asset(value));
+            }
+            break;
+        case NEON_OBJTYPE_ITERATOR:
+            {
+                nn_printer_printf(pr, "<iterator %s>", nn_iterator_kindname(nn_value_asiterator(value)->kind));
+            }
+            break;
         case NEON_OBJTYPE_FILE:
             {
                 nn_printer_printfile(pr, nn_value_asfile(value));
@@ -4062,7 +5713,10 @@ void nn_printer_printobject(NNPrinter* pr, NNValue value, bool fixstring, bool i
 
 void nn_printer_printnumber(NNPrinter* pr, NNValue value)
 {
-    nn_printer_printf(pr, "%.16g", nn_value_asnumber(value));
+    size_t len;
+    char buf[NEON_CONFIG_NUMBERBUFSIZE];
+    len = nn_util_formatnumber(nn_value_asnumber(value), buf);
+    nn_printer_writestringl(pr, buf, len);
 }
 
 void nn_printer_printvalue(NNPrinter* pr, NNValue value, bool fixstring, bool invmethod)
@@ -4103,6 +5757,14 @@ const char* nn_value_objecttypename(NNObject* object)
             return "module";
         case NEON_OBJTYPE_RANGE:
             return "range";
+        case NEON_OBJTYPE_REGEX:
+            return "regex";
+        case NEON_OBJTYPE_TYPEDARRAY:
+            return "typedarray";
+        case NEON_OBJTYPE_SET:
+            return "set";
+        case NEON_OBJTYPE_ITERATOR:
+            return "iterator";
         case NEON_OBJTYPE_FILE:
             return "file";
         case NEON_OBJTYPE_DICT:
@@ -4205,6 +5867,22 @@ const char* nn_value_typefromfunction(NNValIsFuncFN func)
     {
         return "range";
     }
+    else if(func == nn_value_isregex)
+    {
+        return "regex";
+    }
+    else if(func == nn_value_istypedarray)
+    {
+        return "typedarray";
+    }
+    else if(func == nn_value_isset)
+    {
+        return "set";
+    }
+    else if(func == nn_value_isiterator)
+    {
+        return "iterator";
+    }
     else if(func == nn_value_ismodule)
     {
         return "module";
@@ -4331,18 +6009,11 @@ uint32_t nn_util_hashdouble(double value)
     return nn_util_hashbits(bits.bits);
 }
 
-uint32_t nn_util_hashstring(const char* key, int length)
+uint32_t nn_util_hashstring(NNState* state, const char* key, size_t length)
 {
-    uint32_t hash;
-    const char* be;
-    hash = 2166136261u;
-    be = key + length;
-    while(key < be)
-    {
-        hash = (hash ^ *key++) * 16777619;
-    }
-    return hash;
-    /* return siphash24(127, 255, key, length); */
+    uint64_t hash;
+    hash = nn_util_hashwide(key, length, state->hashseed);
+    return (uint32_t)(hash ^ (hash >> 32));
 }
 
 uint32_t nn_object_hashobject(NNObject* object)
@@ -4373,10 +6044,17 @@ uint32_t nn_object_hashobject(NNObject* object)
                 return ((NNObjString*)object)->hash;
             }
             break;
+        case NEON_OBJTYPE_ARRAY:
+            {
+                /* arrays compare by content, which may change, so they all share one hash. */
+                return 0;
+            }
+            break;
         default:
             break;
     }
-    return 0;
+    /* everything else compares by identity. */
+    return nn_util_hashbits((uint64_t)(uintptr_t)object);
 }
 
 uint32_t nn_value_hashvalue(NNValue value)
@@ -4499,7 +6177,7 @@ NNValue nn_value_findgreater(NNValue a, NNValue b)
         }
         else if(nn_value_isdict(a) && nn_value_isdict(b))
         {
-            if(nn_value_asdict(a)->names->listcount >= nn_value_asdict(b)->names->listcount)
+            if(nn_value_asdict(a)->count >= nn_value_asdict(b)->count)
             {
                 return a;
             }
@@ -4529,35 +6207,459 @@ NNValue nn_value_findgreater(NNValue a, NNValue b)
     return a;
 }
 
-/**
- * sorts values in an array using the bubble-sort algorithm
- */
-void nn_value_sortvalues(NNState* state, NNValue* values, int count)
+/*
+* the ordering used by sort() without a comparator: null < booleans < numbers < objects.
+* strings compare bytewise; other objects of the same type compare like nn_value_findgreater.
+*/
+int nn_value_sortcompare(NNState* state, NNValue a, NNValue b)
 {
-    int i;
-    int j;
-    NNValue temp;
-    for(i = 0; i < count; i++)
+    int ra;
+    int rb;
+    size_t minlen;
+    int res;
+    double na;
+    double nb;
+    NNObjString* osa;
+    NNObjString* osb;
+    NNObject* oa;
+    NNObject* ob;
+    (void)state;
+    if(nn_value_isnumber(a) && nn_value_isnumber(b))
+    {
+        na = nn_value_asnumber(a);
+        nb = nn_value_asnumber(b);
+        return (na < nb) ? -1 : ((na > nb) ? 1 : 0);
+    }
+    if(nn_value_isstring(a) && nn_value_isstring(b))
     {
-        for(j = 0; j < count; j++)
+        osa = nn_value_asstring(a);
+        osb = nn_value_asstring(b);
+        minlen = (osa->sbuf->length < osb->sbuf->length) ? osa->sbuf->length : osb->sbuf->length;
+        res = memcmp(osa->sbuf->data, osb->sbuf->data, minlen);
+        if(res != 0)
         {
-            if(nn_value_compare(state, values[j], nn_value_findgreater(values[i], values[j])))
+            return res;
+        }
+        return (osa->sbuf->length < osb->sbuf->length) ? -1 : ((osa->sbuf->length > osb->sbuf->length) ? 1 : 0);
+    }
+    ra = nn_value_isnull(a) ? 0 : (nn_value_isbool(a) ? 1 : (nn_value_isnumber(a) ? 2 : 3));
+    rb = nn_value_isnull(b) ? 0 : (nn_value_isbool(b) ? 1 : (nn_value_isnumber(b) ? 2 : 3));
+    if(ra != rb)
+    {
+        return ra - rb;
+    }
+    if(ra == 1)
+    {
+        return (int)nn_value_asbool(a) - (int)nn_value_asbool(b);
+    }
+    if(ra != 3)
+    {
+        return 0;
+    }
+    oa = nn_value_asobject(a);
+    ob = nn_value_asobject(b);
+    if(oa->type != ob->type)
+    {
+        return (oa->type < ob->type) ? -1 : 1;
+    }
+    switch(oa->type)
+    {
+        case NEON_OBJTYPE_ARRAY:
+            return (int)(nn_value_asarray(a)->varray->listcount > nn_value_asarray(b)->varray->listcount) - (int)(nn_value_asarray(a)->varray->listcount < nn_value_asarray(b)->varray->listcount);
+        case NEON_OBJTYPE_DICT:
+            return (int)(nn_value_asdict(a)->count > nn_value_asdict(b)->count) - (int)(nn_value_asdict(a)->count < nn_value_asdict(b)->count);
+        case NEON_OBJTYPE_RANGE:
+            return (int)(nn_value_asrange(a)->lower > nn_value_asrange(b)->lower) - (int)(nn_value_asrange(a)->lower < nn_value_asrange(b)->lower);
+        case NEON_OBJTYPE_FILE:
+            return strcmp(nn_value_asfile(a)->path->sbuf->data, nn_value_asfile(b)->path->sbuf->data);
+        default:
+            break;
+    }
+    return 0;
+}
+
+/*
+* sorts values in an array, using the default ordering.
+*/
+void nn_value_sortvalues(NNState* state, NNValue* values, int count)
+{
+    nn_sort_values(state, values, NULL, count, nn_value_makenull(), nn_value_makenull());
+}
+
+/*
+* merge sort on NNValue arrays, after timsort: existing ascending or strictly descending runs
+* are found (descending ones are reversed), short runs are extended with binary insertion
+* sort, and runs are merged while keeping the run lengths balanced. the sort is stable.
+*/
+NEON_INLINE int nn_sort_compare(NNSortState* ss, NNValue a, NNValue b)
+{
+    int res;
+    size_t minlen;
+    double na;
+    double nb;
+    NNObjString* sa;
+    NNObjString* sb;
+    NNValue callres;
+    switch(ss->kind)
+    {
+        case NEON_SORT_NUMBERS:
+            {
+                na = nn_value_asnumber(a);
+                nb = nn_value_asnumber(b);
+                return (na < nb) ? -1 : ((na > nb) ? 1 : 0);
+            }
+        case NEON_SORT_STRINGS:
+            {
+                /* bytewise, the shorter string first on a common prefix; same order as nn_value_sortcompare. */
+                sa = nn_value_asstring(a);
+                sb = nn_value_asstring(b);
+                if(sa == sb)
+                {
+                    return 0;
+                }
+                minlen = (sa->sbuf->length < sb->sbuf->length) ? sa->sbuf->length : sb->sbuf->length;
+                res = memcmp(sa->sbuf->data, sb->sbuf->data, minlen);
+                if(res != 0)
+                {
+                    return (res < 0) ? -1 : 1;
+                }
+                return (sa->sbuf->length < sb->sbuf->length) ? -1 : ((sa->sbuf->length > sb->sbuf->length) ? 1 : 0);
+            }
+        case NEON_SORT_CALLBACK:
             {
-                temp = values[i];
-                values[i] = values[j];
-                values[j] = temp;
-                if(nn_value_isarray(values[i]))
+                /* the comparator returns a number: negative if a comes first, positive if b does. */
+                if(ss->failed)
                 {
-                    nn_value_sortvalues(state, nn_value_asarray(values[i])->varray->listitems, nn_value_asarray(values[i])->varray->listcount);
+                    return 0;
                 }
-
-                if(nn_value_isarray(values[j]))
+                if(ss->arity > 0)
+                {
+                    ss->nestargs->varray->listitems[0] = a;
+                    if(ss->arity > 1)
+                    {
+                        ss->nestargs->varray->listitems[1] = b;
+                    }
+                }
+                if(!nn_nestcall_callfunction(ss->pstate, ss->comparator, ss->thisval, ss->nestargs, &callres))
+                {
+                    ss->failed = true;
+                    return 0;
+                }
+                if(nn_value_isnumber(callres))
                 {
-                    nn_value_sortvalues(state, nn_value_asarray(values[j])->varray->listitems, nn_value_asarray(values[j])->varray->listcount);
+                    na = nn_value_asnumber(callres);
+                    return (na < 0) ? -1 : ((na > 0) ? 1 : 0);
                 }
+                return 0;
+            }
+        default:
+            break;
+    }
+    return nn_value_sortcompare(ss->pstate, a, b);
+}
+
+NEON_INLINE void nn_sort_move(NNSortState* ss, size_t dest, size_t src, size_t count)
+{
+    memmove(ss->keys + dest, ss->keys + src, sizeof(NNValue) * count);
+    if(ss->vals != NULL)
+    {
+        memmove(ss->vals + dest, ss->vals + src, sizeof(NNValue) * count);
+    }
+}
+
+void nn_sort_reverse(NNSortState* ss, size_t lo, size_t hi)
+{
+    NNValue tmp;
+    while((lo + 1) < hi)
+    {
+        hi--;
+        tmp = ss->keys[lo];
+        ss->keys[lo] = ss->keys[hi];
+        ss->keys[hi] = tmp;
+        if(ss->vals != NULL)
+        {
+            tmp = ss->vals[lo];
+            ss->vals[lo] = ss->vals[hi];
+            ss->vals[hi] = tmp;
+        }
+        lo++;
+    }
+}
+
+/* sorts [lo, hi), where [lo, start) is already sorted. */
+void nn_sort_insertion(NNSortState* ss, size_t lo, size_t hi, size_t start)
+{
+    size_t i;
+    size_t l;
+    size_t r;
+    size_t m;
+    NNValue pivotkey;
+    NNValue pivotval;
+    pivotval = nn_value_makenull();
+    for(i = start; i < hi; i++)
+    {
+        pivotkey = ss->keys[i];
+        l = lo;
+        r = i;
+        /* finds the first element greater than the pivot, so that equal elements keep their order. */
+        while(l < r)
+        {
+            m = l + ((r - l) / 2);
+            if(nn_sort_compare(ss, pivotkey, ss->keys[m]) < 0)
+            {
+                r = m;
+            }
+            else
+            {
+                l = m + 1;
+            }
+        }
+        if(l == i)
+        {
+            continue;
+        }
+        if(ss->vals != NULL)
+        {
+            pivotval = ss->vals[i];
+        }
+        nn_sort_move(ss, l + 1, l, i - l);
+        ss->keys[l] = pivotkey;
+        if(ss->vals != NULL)
+        {
+            ss->vals[l] = pivotval;
+        }
+    }
+}
+
+/* returns the length of the run starting at lo, reversing it if it is descending. */
+size_t nn_sort_countrun(NNSortState* ss, size_t lo, size_t hi)
+{
+    size_t run;
+    run = lo + 1;
+    if(run == hi)
+    {
+        return 1;
+    }
+    if(nn_sort_compare(ss, ss->keys[run], ss->keys[lo]) < 0)
+    {
+        run++;
+        while((run < hi) && (nn_sort_compare(ss, ss->keys[run], ss->keys[run - 1]) < 0))
+        {
+            run++;
+        }
+        nn_sort_reverse(ss, lo, run);
+    }
+    else
+    {
+        run++;
+        while((run < hi) && (nn_sort_compare(ss, ss->keys[run], ss->keys[run - 1]) >= 0))
+        {
+            run++;
+        }
+    }
+    return run - lo;
+}
+
+size_t nn_sort_minrun(size_t count)
+{
+    size_t r;
+    r = 0;
+    while(count >= NEON_CONFIG_SORTMINMERGE)
+    {
+        r |= (count & 1);
+        count >>= 1;
+    }
+    return count + r;
+}
+
+/* merges the runs at ri and ri + 1. */
+void nn_sort_mergeat(NNSortState* ss, int ri)
+{
+    size_t i;
+    size_t j;
+    size_t k;
+    size_t base1;
+    size_t len1;
+    size_t base2;
+    size_t end2;
+    NNValue* tk;
+    NNValue* tv;
+    base1 = ss->runbase[ri];
+    len1 = ss->runlength[ri];
+    base2 = ss->runbase[ri + 1];
+    end2 = base2 + ss->runlength[ri + 1];
+    ss->runlength[ri] = len1 + ss->runlength[ri + 1];
+    if(ri == (ss->runcount - 3))
+    {
+        ss->runbase[ri + 1] = ss->runbase[ri + 2];
+        ss->runlength[ri + 1] = ss->runlength[ri + 2];
+    }
+    ss->runcount--;
+    /* nothing to do if the runs are already in order, which is common for partially sorted input. */
+    if(nn_sort_compare(ss, ss->keys[base2], ss->keys[base2 - 1]) >= 0)
+    {
+        return;
+    }
+    tk = ss->tmpkeys->varray->listitems;
+    tv = NULL;
+    memcpy(tk, ss->keys + base1, sizeof(NNValue) * len1);
+    if(ss->vals != NULL)
+    {
+        tv = ss->tmpvals->varray->listitems;
+        memcpy(tv, ss->vals + base1, sizeof(NNValue) * len1);
+    }
+    i = 0;
+    j = base2;
+    k = base1;
+    while((i < len1) && (j < end2))
+    {
+        if(nn_sort_compare(ss, ss->keys[j], tk[i]) < 0)
+        {
+            ss->keys[k] = ss->keys[j];
+            if(tv != NULL)
+            {
+                ss->vals[k] = ss->vals[j];
+            }
+            j++;
+        }
+        else
+        {
+            ss->keys[k] = tk[i];
+            if(tv != NULL)
+            {
+                ss->vals[k] = tv[i];
+            }
+            i++;
+        }
+        k++;
+    }
+    memcpy(ss->keys + k, tk + i, sizeof(NNValue) * (len1 - i));
+    if(tv != NULL)
+    {
+        memcpy(ss->vals + k, tv + i, sizeof(NNValue) * (len1 - i));
+    }
+}
+
+void nn_sort_mergecollapse(NNSortState* ss)
+{
+    int n;
+    while(ss->runcount > 1)
+    {
+        n = ss->runcount - 2;
+        if(((n > 0) && (ss->runlength[n - 1] <= (ss->runlength[n] + ss->runlength[n + 1]))) || ((n > 1) && (ss->runlength[n - 2] <= (ss->runlength[n - 1] + ss->runlength[n]))))
+        {
+            if(ss->runlength[n - 1] < ss->runlength[n + 1])
+            {
+                n--;
             }
         }
+        else if(ss->runlength[n] > ss->runlength[n + 1])
+        {
+            break;
+        }
+        nn_sort_mergeat(ss, n);
+    }
+}
+
+NNObjArray* nn_sort_maketemp(NNState* state, size_t count)
+{
+    NNObjArray* arr;
+    arr = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    nn_vallist_ensurecapacity(arr->varray, count, nn_value_makenull(), false);
+    arr->varray->listcount = count;
+    arr->varray->listkind = NEON_ELEMKIND_GENERIC;
+    return arr;
+}
+
+/*
+* sorts count keys, and moves vals (if not NULL) along with them.
+* if comparator is null, the default ordering of nn_value_sortcompare is used, with fast
+* paths for arrays of only numbers or only strings. otherwise, comparator is called with
+* two keys, and thisval as 'this'. keys and vals must stay reachable for the garbage
+* collector, and must not be resized by the comparator.
+* returns false if the comparator threw, in which case keys are left in no particular order.
+*/
+bool nn_sort_values(NNState* state, NNValue* keys, NNValue* vals, size_t count, NNValue comparator, NNValue thisval)
+{
+    size_t i;
+    size_t lo;
+    size_t force;
+    size_t minrun;
+    size_t runlen;
+    size_t remaining;
+    bool allnumbers;
+    bool allstrings;
+    NNSortState ss;
+    if(count < 2)
+    {
+        return true;
+    }
+    ss.pstate = state;
+    ss.comparator = comparator;
+    ss.thisval = thisval;
+    ss.nestargs = NULL;
+    ss.arity = 0;
+    ss.failed = false;
+    ss.keys = keys;
+    ss.vals = vals;
+    ss.tmpvals = NULL;
+    ss.runcount = 0;
+    if(nn_value_isnull(comparator))
+    {
+        allnumbers = true;
+        allstrings = true;
+        for(i = 0; (i < count) && (allnumbers || allstrings); i++)
+        {
+            allnumbers = allnumbers && nn_value_isnumber(keys[i]);
+            allstrings = allstrings && nn_value_isstring(keys[i]);
+        }
+        ss.kind = allnumbers ? NEON_SORT_NUMBERS : (allstrings ? NEON_SORT_STRINGS : NEON_SORT_GENERIC);
+    }
+    else
+    {
+        ss.kind = NEON_SORT_CALLBACK;
+        ss.nestargs = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+        ss.arity = nn_nestcall_prepare(state, comparator, thisval, ss.nestargs);
+    }
+    ss.tmpkeys = nn_sort_maketemp(state, count);
+    if(vals != NULL)
+    {
+        ss.tmpvals = nn_sort_maketemp(state, count);
+    }
+    minrun = nn_sort_minrun(count);
+    lo = 0;
+    remaining = count;
+    while((remaining > 0) && !ss.failed)
+    {
+        runlen = nn_sort_countrun(&ss, lo, count);
+        if(runlen < minrun)
+        {
+            force = (remaining < minrun) ? remaining : minrun;
+            nn_sort_insertion(&ss, lo, lo + force, lo + runlen);
+            runlen = force;
+        }
+        ss.runbase[ss.runcount] = lo;
+        ss.runlength[ss.runcount] = runlen;
+        ss.runcount++;
+        nn_sort_mergecollapse(&ss);
+        lo += runlen;
+        remaining -= runlen;
+    }
+    while((ss.runcount > 1) && !ss.failed)
+    {
+        i = ss.runcount - 2;
+        if((i > 0) && (ss.runlength[i - 1] < ss.runlength[i + 1]))
+        {
+            i--;
+        }
+        nn_sort_mergeat(&ss, i);
+    }
+    ss.tmpkeys->varray->listcount = 0;
+    if(ss.tmpvals != NULL)
+    {
+        ss.tmpvals->varray->listcount = 0;
     }
+    return !ss.failed;
 }
 
 NNValue nn_value_copyvalue(NNState* state, NNValue value)
@@ -4703,26 +6805,74 @@ NNObjDict* nn_object_makedict(NNState* state)
 {
     NNObjDict* dict;
     dict = (NNObjDict*)nn_object_allocobject(state, sizeof(NNObjDict), NEON_OBJTYPE_DICT);
-    dict->names = nn_vallist_make(state);
-    dict->htab = nn_tableval_make(state);
+    dict->count = 0;
+    dict->entrycount = 0;
+    dict->entrycapacity = 0;
+    dict->indexcapacity = 0;
+    dict->entries = NULL;
+    dict->indices = NULL;
     return dict;
 }
 
+NNObjSet* nn_object_makeset(NNState* state)
+{
+    NNObjSet* set;
+    set = (NNObjSet*)nn_object_allocobject(state, sizeof(NNObjSet), NEON_OBJTYPE_SET);
+    set->items = NULL;
+    /* gc fix */
+    nn_vm_stackpush(state, nn_value_fromobject(set));
+    set->items = nn_object_makedict(state);
+    nn_vm_stackpop(state);
+    return set;
+}
+
+NNObjIterator* nn_object_makeiterator(NNState* state, NNIterKind kind, NNValue source)
+{
+    NNObjIterator* iter;
+    iter = (NNObjIterator*)nn_object_allocobject(state, sizeof(NNObjIterator), NEON_OBJTYPE_ITERATOR);
+    iter->kind = kind;
+    iter->finished = false;
+    iter->failed = false;
+    iter->arity = 0;
+    iter->position = 0;
+    iter->limit = 0;
+    iter->rangestart = 0;
+    iter->rangestep = 1;
+    iter->source = source;
+    iter->other = nn_value_makenull();
+    iter->callable = nn_value_makenull();
+    iter->current = nn_value_makenull();
+    iter->nestargs = NULL;
+    iter->chomp = true;
+    iter->csv = NULL;
+    iter->walker = NULL;
+    return iter;
+}
+
 NNObjFile* nn_object_makefile(NNState* state, FILE* handle, bool isstd, const char* path, const char* mode)
 {
     NNObjFile* file;
     file = (NNObjFile*)nn_object_allocobject(state, sizeof(NNObjFile), NEON_OBJTYPE_FILE);
     file->isopen = false;
-    file->mode = nn_string_copycstr(state, mode);
-    file->path = nn_string_copycstr(state, path);
+    file->mode = NULL;
+    file->path = NULL;
     file->isstd = isstd;
     file->handle = handle;
     file->istty = false;
     file->number = -1;
+    file->linebuf = NULL;
+    file->linecap = 0;
+    file->iterline = NULL;
+    file->ispipe = false;
     if(file->handle != NULL)
     {
         file->isopen = true;
     }
+    /* gc fix */
+    nn_vm_stackpush(state, nn_value_fromobject(file));
+    file->mode = nn_string_copycstr(state, mode);
+    file->path = nn_string_copycstr(state, path);
+    nn_vm_stackpop(state);
     return file;
 }
 
@@ -4731,6 +6881,7 @@ void nn_file_destroy(NNObjFile* file)
     NNState* state;
     state = ((NNObject*)file)->pstate;
     nn_fileobject_close(file);
+    nn_memory_free(file->linebuf);
     nn_gcmem_release(state, file, sizeof(NNObjFile));
 }
 
@@ -4740,35 +6891,129 @@ void nn_file_mark(NNObjFile* file)
     state = ((NNObject*)file)->pstate;
     nn_gcmem_markobject(state, (NNObject*)file->mode);
     nn_gcmem_markobject(state, (NNObject*)file->path);
+    nn_gcmem_markobject(state, (NNObject*)file->iterline);
 }
 
-bool nn_file_read(NNObjFile* file, size_t readhowmuch, NNIOResult* dest)
+/*
+* reads the next line of $file into its line buffer, and stores its length in $lendest.
+* the line keeps its terminator ("\n" or "\r\n") unless $chomp is set.
+* returns false at the end of the file.
+*/
+bool nn_file_readline(NNState* state, NNObjFile* file, bool chomp, size_t* lendest)
 {
-    NNState* state;
-    size_t filesizereal;
-    struct stat stats;
-    state = ((NNObject*)file)->pstate;
-    filesizereal = -1;
-    dest->success = false;
-    dest->length = 0;
-    dest->data = NULL;
-    if(!file->isstd)
+    size_t len;
+    if(file->isstd)
     {
-        if(!nn_util_fsfileexists(state, file->path->sbuf->data))
+        /* so that prompts show up before waiting for input */
+        nn_printer_flush(state->stdoutprinter);
+    }
+    else if(!file->isopen)
+    {
+        nn_fileobject_open(file);
+    }
+    if(file->handle == NULL)
+    {
+        return false;
+    }
+    len = 0;
+    while(true)
+    {
+        if(len + 2 > file->linecap)
         {
-            return false;
+            file->linecap = (file->linecap == 0) ? 256 : (file->linecap * 2);
+            file->linebuf = (char*)nn_memory_realloc(file->linebuf, file->linecap);
         }
-        /* file is in write only mode */
-        /*
-        else if(strstr(file->mode->sbuf->data, "w") != NULL && strstr(file->mode->sbuf->data, "+") == NULL)
+        if(fgets(file->linebuf + len, file->linecap - len, file->handle) == NULL)
         {
-            FILE_ERROR(Unsupported, "cannot read file in write mode");
+            break;
         }
-        */
-        if(!file->isopen)
+        len += strlen(file->linebuf + len);
+        if((len > 0) && (file->linebuf[len - 1] == '\n'))
         {
-            /* open the file if it isn't open */
-            nn_fileobject_open(file);
+            break;
+        }
+    }
+    if(len == 0)
+    {
+        return false;
+    }
+    if(chomp && (file->linebuf[len - 1] == '\n'))
+    {
+        len--;
+        if((len > 0) && (file->linebuf[len - 1] == '\r'))
+        {
+            len--;
+        }
+    }
+    *lendest = len;
+    return true;
+}
+
+/*
+* reads from a pipe, which has no size to go by: up to $readhowmuch bytes, or with -1, everything
+* until the other end is closed. an empty result at the end is not an error.
+*/
+bool nn_file_readpipe(NNObjFile* file, size_t readhowmuch, NNIOResult* dest)
+{
+    size_t n;
+    size_t cap;
+    if(file->handle == NULL)
+    {
+        errno = EBADF;
+        return false;
+    }
+    cap = (readhowmuch == (size_t)-1) ? NEON_CONFIG_FILEBUFSIZE : readhowmuch;
+    dest->data = (char*)nn_memory_malloc(cap + 1);
+    while(true)
+    {
+        n = fread(dest->data + dest->length, sizeof(char), cap - dest->length, file->handle);
+        dest->length += n;
+        if((n == 0) || ((readhowmuch != (size_t)-1) && (dest->length == cap)))
+        {
+            break;
+        }
+        if(dest->length == cap)
+        {
+            cap *= 2;
+            dest->data = (char*)nn_memory_realloc(dest->data, cap + 1);
+        }
+    }
+    dest->data[dest->length] = '\0';
+    dest->success = true;
+    return true;
+}
+
+bool nn_file_read(NNObjFile* file, size_t readhowmuch, NNIOResult* dest)
+{
+    NNState* state;
+    size_t filesizereal;
+    struct stat stats;
+    state = ((NNObject*)file)->pstate;
+    filesizereal = -1;
+    dest->success = false;
+    dest->length = 0;
+    dest->data = NULL;
+    if(file->ispipe)
+    {
+        return nn_file_readpipe(file, readhowmuch, dest);
+    }
+    if(!file->isstd)
+    {
+        if(!nn_util_fsfileexists(state, file->path->sbuf->data))
+        {
+            return false;
+        }
+        /* file is in write only mode */
+        /*
+        else if(strstr(file->mode->sbuf->data, "w") != NULL && strstr(file->mode->sbuf->data, "+") == NULL)
+        {
+            FILE_ERROR(Unsupported, "cannot read file in write mode");
+        }
+        */
+        if(!file->isopen)
+        {
+            /* open the file if it isn't open */
+            nn_fileobject_open(file);
         }
         else if(file->handle == NULL)
         {
@@ -5106,6 +7351,11 @@ NNObjString* nn_string_makefromstrbuf(NNState* state, StringBuffer* sbuf, uint32
     rs = (NNObjString*)nn_object_allocobject(state, sizeof(NNObjString), NEON_OBJTYPE_STRING);
     rs->sbuf = sbuf;
     rs->hash = hash;
+    rs->parent = NULL;
+    rs->hasslices = false;
+    rs->retired = NULL;
+    rs->asciistate = NEON_STRASCII_UNKNOWN;
+    rs->utf8index = NULL;
     nn_vm_stackpush(state, nn_value_fromobject(rs));
     nn_tableval_set(state->allocatedstrings, nn_value_fromobject(rs), nn_value_makenull());
     nn_vm_stackpop(state);
@@ -5145,6 +7395,7 @@ const char* nn_string_getcstr(NNObjString* os)
 
 void nn_string_destroy(NNState* state, NNObjString* str)
 {
+    nn_string_dropcache(str);
     dyn_strbuf_destroy(str->sbuf);
     nn_gcmem_release(state, str, sizeof(NNObjString));
 }
@@ -5153,7 +7404,7 @@ NNObjString* nn_string_takelen(NNState* state, char* chars, int length)
 {
     uint32_t hash;
     NNObjString* rs;
-    hash = nn_util_hashstring(chars, length);
+    hash = nn_util_hashstring(state, chars, length);
     rs = nn_tableval_findstring(state->allocatedstrings, chars, length, hash);
     if(rs == NULL)
     {
@@ -5163,6 +7414,29 @@ NNObjString* nn_string_takelen(NNState* state, char* chars, int length)
     return rs;
 }
 
+/*
+* like nn_string_takelen, but the new string adopts $chars (which must be NUL-terminated,
+* and $capacity bytes large) instead of copying it.
+*/
+NNObjString* nn_string_takebuffer(NNState* state, char* chars, size_t length, size_t capacity)
+{
+    uint32_t hash;
+    NNObjString* rs;
+    StringBuffer* sbuf;
+    hash = nn_util_hashstring(state, chars, length);
+    rs = nn_tableval_findstring(state->allocatedstrings, chars, length, hash);
+    if(rs != NULL)
+    {
+        nn_memory_free(chars);
+        return rs;
+    }
+    sbuf = dyn_strbuf_makebasicempty(length, true);
+    sbuf->isintern = false;
+    sbuf->data = chars;
+    sbuf->capacity = capacity;
+    return nn_string_makefromstrbuf(state, sbuf, hash);
+}
+
 NNObjString* nn_string_takecstr(NNState* state, char* chars)
 {
     return nn_string_takelen(state, chars, strlen(chars));
@@ -5172,7 +7446,7 @@ NNObjString* nn_string_copylen(NNState* state, const char* chars, int length)
 {
     uint32_t hash;
     NNObjString* rs;
-    hash = nn_util_hashstring(chars, length);
+    hash = nn_util_hashstring(state, chars, length);
     rs = nn_tableval_findstring(state->allocatedstrings, chars, length, hash);
     if(rs != NULL)
     {
@@ -5190,7 +7464,7 @@ NNObjString* nn_string_copycstr(NNState* state, const char* chars)
 
 NNObjString* nn_string_copyobject(NNState* state, NNObjString* origos)
 {
-    if(origos->sbuf->isintern)
+    if(origos->sbuf->isintern && (origos->parent == NULL))
     {
         return nn_string_internlen(state, origos->sbuf->data, origos->sbuf->length);
     }
@@ -5202,7 +7476,7 @@ NNObjString* nn_string_internlen(NNState* state, const char* chars, int length)
 {
     uint32_t hash;
     NNObjString* rs;
-    hash = nn_util_hashstring(chars, length);
+    hash = nn_util_hashstring(state, chars, length);
     rs = nn_tableval_findstring(state->allocatedstrings, chars, length, hash);
     if(rs != NULL)
     {
@@ -5222,6 +7496,285 @@ NNObjString* nn_string_copyobjstr(NNState* state, NNObjString* os)
     return nn_string_copylen(state, os->sbuf->data, os->sbuf->length);
 }
 
+/*
+* returns the substring [start, start+length) of parent.
+* if the substring is long enough, and reaches the end of parent (so that it stays
+* NUL-terminated), the result shares the buffer of parent instead of copying it.
+* slices keep the (root) parent alive through the GC, are never interned, and are turned
+* into regular strings by nn_string_materialize when they are modified or used as a dict key.
+* their parent keeps the data they point into when it is modified; see nn_string_makewritable.
+* slices that would only cover a small part of their parent are copied instead, so that
+* a short slice does not pin a large buffer.
+*/
+NNObjString* nn_string_makeslice(NNState* state, NNObjString* parent, size_t start, size_t length)
+{
+    uint32_t hash;
+    size_t rootlen;
+    const char* data;
+    NNObjString* rs;
+    NNObjString* root;
+    data = parent->sbuf->data + start;
+    if((NEON_CONFIG_STRSLICEMINLEN == 0) || (length < NEON_CONFIG_STRSLICEMINLEN) || ((start + length) != parent->sbuf->length))
+    {
+        return nn_string_copylen(state, data, length);
+    }
+    root = parent;
+    if(parent->parent != NULL)
+    {
+        root = parent->parent;
+    }
+    rootlen = root->sbuf->length;
+    if((length * NEON_CONFIG_STRSLICEMAXRATIO) < rootlen)
+    {
+        return nn_string_copylen(state, data, length);
+    }
+    if((start == 0) && (parent == root))
+    {
+        return parent;
+    }
+    hash = nn_util_hashstring(state, data, length);
+    rs = nn_tableval_findstring(state->allocatedstrings, data, length, hash);
+    if(rs != NULL)
+    {
+        return rs;
+    }
+    /* root is reachable from the caller, and data lives in its buffer for as long as root does. */
+    rs = (NNObjString*)nn_object_allocobject(state, sizeof(NNObjString), NEON_OBJTYPE_STRING);
+    rs->sbuf = dyn_strbuf_makebasicempty(length, true);
+    rs->sbuf->data = (char*)data;
+    rs->hash = hash;
+    rs->parent = root;
+    rs->hasslices = false;
+    rs->retired = NULL;
+    root->hasslices = true;
+    rs->asciistate = parent->asciistate;
+    if(parent->asciistate != NEON_STRASCII_YES)
+    {
+        rs->asciistate = NEON_STRASCII_UNKNOWN;
+    }
+    rs->utf8index = NULL;
+    return rs;
+}
+
+/*
+* gives a slice its own copy of its data, detaching it from its parent.
+* the object itself is kept, so existing references remain valid.
+*/
+NNObjString* nn_string_materialize(NNState* state, NNObjString* str)
+{
+    StringBuffer* sbuf;
+    (void)state;
+    if(str->parent == NULL)
+    {
+        return str;
+    }
+    sbuf = dyn_strbuf_makebasicempty(0, false);
+    dyn_strbuf_appendstrn(sbuf, str->sbuf->data, str->sbuf->length);
+    dyn_strbuf_destroy(str->sbuf);
+    str->sbuf = sbuf;
+    str->parent = NULL;
+    return str;
+}
+
+/*
+* makes $str safe to modify in place: a slice is materialized, and a string that slices
+* point into continues with a copy of its buffer. the old buffer is handed to a hidden
+* string in $str->retired, which lives for as long as $str, and thus as long as the slices.
+*/
+NNObjString* nn_string_makewritable(NNState* state, NNObjString* str)
+{
+    NNObjString* holder;
+    StringBuffer* sbuf;
+    if(str->parent != NULL)
+    {
+        return nn_string_materialize(state, str);
+    }
+    if(!str->hasslices)
+    {
+        return str;
+    }
+    /* str is reachable from the caller, so allocating may not collect it. */
+    holder = (NNObjString*)nn_object_allocobject(state, sizeof(NNObjString), NEON_OBJTYPE_STRING);
+    holder->sbuf = str->sbuf;
+    holder->hash = str->hash;
+    holder->parent = NULL;
+    holder->hasslices = false;
+    holder->retired = str->retired;
+    holder->asciistate = NEON_STRASCII_UNKNOWN;
+    holder->utf8index = NULL;
+    sbuf = dyn_strbuf_makebasicempty(0, false);
+    dyn_strbuf_appendstrn(sbuf, holder->sbuf->data, holder->sbuf->length);
+    str->sbuf = sbuf;
+    str->retired = holder;
+    str->hasslices = false;
+    return str;
+}
+
+/*
+* checks 8 bytes at a time whether any byte has its high bit set.
+*/
+bool nn_util_isasciibuffer(const char* data, size_t length)
+{
+    size_t i;
+    uint64_t word;
+    uint64_t acc;
+    acc = 0;
+    i = 0;
+    for(; (i + 32) <= length; i += 32)
+    {
+        memcpy(&word, data + i, 8);
+        acc |= word;
+        memcpy(&word, data + i + 8, 8);
+        acc |= word;
+        memcpy(&word, data + i + 16, 8);
+        acc |= word;
+        memcpy(&word, data + i + 24, 8);
+        acc |= word;
+        if((acc & 0x8080808080808080ULL) != 0)
+        {
+            return false;
+        }
+    }
+    for(; (i + 8) <= length; i += 8)
+    {
+        memcpy(&word, data + i, 8);
+        acc |= word;
+    }
+    if((acc & 0x8080808080808080ULL) != 0)
+    {
+        return false;
+    }
+    for(; i < length; i++)
+    {
+        if((uint8_t)data[i] & 0x80)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+* forgets the cached ASCII flag and codepoint index; must be called whenever the contents change.
+*/
+void nn_string_dropcache(NNObjString* str)
+{
+    if(str->utf8index != NULL)
+    {
+        nn_memory_free(str->utf8index->offsets);
+        nn_memory_free(str->utf8index);
+        str->utf8index = NULL;
+    }
+    str->asciistate = NEON_STRASCII_UNKNOWN;
+}
+
+bool nn_string_isascii(NNObjString* str)
+{
+    if(str->asciistate == NEON_STRASCII_UNKNOWN)
+    {
+        str->asciistate = NEON_STRASCII_NO;
+        if(nn_util_isasciibuffer(str->sbuf->data, str->sbuf->length))
+        {
+            str->asciistate = NEON_STRASCII_YES;
+        }
+    }
+    return (str->asciistate == NEON_STRASCII_YES);
+}
+
+NNUtf8Index* nn_string_getutf8index(NNObjString* str)
+{
+    size_t i;
+    size_t cp;
+    size_t length;
+    size_t offcap;
+    const char* data;
+    NNUtf8Index* idx;
+    if(str->utf8index != NULL)
+    {
+        return str->utf8index;
+    }
+    data = str->sbuf->data;
+    length = str->sbuf->length;
+    idx = (NNUtf8Index*)nn_memory_malloc(sizeof(NNUtf8Index));
+    offcap = (length / NEON_CONFIG_UTF8INDEXSTRIDE) + 1;
+    idx->offsets = (size_t*)nn_memory_malloc(sizeof(size_t) * offcap);
+    idx->offcount = 0;
+    cp = 0;
+    for(i = 0; i < length; i++)
+    {
+        /* continuation bytes do not start a codepoint. */
+        if(((uint8_t)data[i] & 0xC0) != 0x80)
+        {
+            if((cp % NEON_CONFIG_UTF8INDEXSTRIDE) == 0)
+            {
+                idx->offsets[idx->offcount] = i;
+                idx->offcount++;
+            }
+            cp++;
+        }
+    }
+    idx->cpcount = cp;
+    str->utf8index = idx;
+    return idx;
+}
+
+/*
+* returns the number of codepoints in str.
+*/
+size_t nn_string_utf8length(NNObjString* str)
+{
+    if(nn_string_isascii(str))
+    {
+        return str->sbuf->length;
+    }
+    return nn_string_getutf8index(str)->cpcount;
+}
+
+/*
+* returns the byte offset of codepoint cpidx, or the byte length of str if cpidx is the
+* number of codepoints. ASCII strings map 1:1, other strings use the sparse index, so that
+* at most NEON_CONFIG_UTF8INDEXSTRIDE codepoints are walked.
+*/
+int64_t nn_string_utf8offset(NNObjString* str, size_t cpidx)
+{
+    size_t i;
+    size_t skip;
+    size_t length;
+    const char* data;
+    NNUtf8Index* idx;
+    length = str->sbuf->length;
+    if(nn_string_isascii(str))
+    {
+        if(cpidx > length)
+        {
+            return -1;
+        }
+        return cpidx;
+    }
+    idx = nn_string_getutf8index(str);
+    if(cpidx >= idx->cpcount)
+    {
+        if(cpidx == idx->cpcount)
+        {
+            return length;
+        }
+        return -1;
+    }
+    data = str->sbuf->data;
+    i = idx->offsets[cpidx / NEON_CONFIG_UTF8INDEXSTRIDE];
+    skip = cpidx % NEON_CONFIG_UTF8INDEXSTRIDE;
+    while(skip > 0)
+    {
+        i++;
+        while((i < length) && (((uint8_t)data[i] & 0xC0) == 0x80))
+        {
+            i++;
+        }
+        skip--;
+    }
+    return i;
+}
+
 NNObjUpvalue* nn_object_makeupvalue(NNState* state, NNValue* slot, int stackpos)
 {
     NNObjUpvalue* upvalue;
@@ -6176,6 +8729,7 @@ bool nn_astparser_raiseerroratv(NNAstParser* prs, NNAstToken* t, const char* mes
     const char* colreset;    
     colred = nn_util_color(NEON_COLOR_RED);
     colreset = nn_util_color(NEON_COLOR_RESET);
+    nn_printer_flush(prs->pstate->stdoutprinter);
     fflush(stdout);
     if(prs->stopprintingsyntaxerrors)
     {
@@ -7729,7 +10283,7 @@ bool nn_astparser_rulegrouping(NNAstParser* prs, bool canassign)
     return true;
 }
 
-NNValue nn_astparser_compilestrnumber(NNAstTokType type, const char* source)
+NNValue nn_astparser_compilestrnumber(NNAstTokType type, const char* source, size_t length)
 {
     double dbval;
     long longval;
@@ -7749,14 +10303,14 @@ NNValue nn_astparser_compilestrnumber(NNAstTokType type, const char* source)
         longval = strtol(source, NULL, 16);
         return nn_value_makenumber(longval);
     }
-    dbval = strtod(source, NULL);
+    dbval = nn_util_strtod(source, length, NULL);
     return nn_value_makenumber(dbval);
 }
 
 NNValue nn_astparser_compilenumber(NNAstParser* prs)
 {
     NEON_ASTDEBUG(prs->pstate, "");
-    return nn_astparser_compilestrnumber(prs->prevtoken.type, prs->prevtoken.start);
+    return nn_astparser_compilestrnumber(prs->prevtoken.type, prs->prevtoken.start, prs->prevtoken.length);
 }
 
 bool nn_astparser_rulenumber(NNAstParser* prs, bool canassign)
@@ -8555,9 +11109,12 @@ void nn_astparser_parsefuncparamlist(NNAstParser* prs)
 void nn_astfunccompiler_compilebody(NNAstParser* prs, NNAstFuncCompiler* compiler, bool closescope, bool isanon)
 {
     int i;
+    bool wastrying;
     NNObjFuncScript* function;
     (void)isanon;
-    /* compile the body */
+    /* compile the body. a function written inside a try block does not return from it. */
+    wastrying = prs->istrying;
+    prs->istrying = false;
     nn_astparser_ignorewhitespace(prs);
     nn_astparser_consume(prs, NEON_ASTTOK_BRACEOPEN, "expected '{' before function body");
     nn_astparser_parseblock(prs);
@@ -8567,6 +11124,7 @@ void nn_astfunccompiler_compilebody(NNAstParser* prs, NNAstFuncCompiler* compile
         nn_astparser_scopeend(prs);
     }
     function = nn_astparser_endcompiler(prs, false);
+    prs->istrying = wastrying;
     nn_vm_stackpush(prs->pstate, nn_value_fromobject(function));
     nn_astemit_emitbyteandshort(prs, NEON_OP_MAKECLOSURE, nn_astparser_pushconst(prs, nn_value_fromobject(function)));
     for(i = 0; i < function->upvalcount; i++)
@@ -9637,7 +12195,7 @@ NNValue nn_modfn_os_readdir(NNState* state, NNArguments* args)
     dirn = os->sbuf->data;
     if(fslib_diropen(&rd, dirn))
     {
-        res = nn_array_make(state);
+        res = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_array_make(state));
         while(fslib_dirread(&rd, &itm))
         {
             aval = nn_string_copycstr(state, itm.name);
@@ -9653,2678 +12211,8182 @@ NNValue nn_modfn_os_readdir(NNState* state, NNArguments* args)
     return nn_value_makenull();
 }
 
-NNRegModule* nn_natmodule_load_os(NNState* state)
-{
-    static NNRegFunc modfuncs[] =
+/*
+* copyFile(source, dest) copies the file $source to $dest, which is created or truncated,
+* keeping the permissions of $source. returns the number of bytes copied.
+*/
+NNValue nn_modfn_os_copyfile(NNState* state, NNArguments* args)
+{
+    int infd;
+    int outfd;
+    int64_t copied;
+    struct stat srcstat;
+    struct stat deststat;
+    const char* srcpath;
+    const char* destpath;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isstring);
+    srcpath = nn_value_asstring(args->args[0])->sbuf->data;
+    destpath = nn_value_asstring(args->args[1])->sbuf->data;
+    infd = open(srcpath, O_RDONLY);
+    if((infd < 0) || (fstat(infd, &srcstat) != 0))
     {
-        {"readdir",   true,  nn_modfn_os_readdir},
-        {NULL,     false, NULL},
-    };
-    static NNRegField modfields[] =
+        if(infd >= 0)
+        {
+            close(infd);
+        }
+        return nn_exceptions_throw(state, "copyFile: cannot open '%s': %s", srcpath, strerror(errno));
+    }
+    /* truncating the source would lose it. */
+    if((stat(destpath, &deststat) == 0) && (deststat.st_dev == srcstat.st_dev) && (deststat.st_ino == srcstat.st_ino))
     {
-        /*{"platform", true, get_os_platform},*/
-        {NULL,       false, NULL},
-    };
-    static NNRegModule module;
-    (void)state;
-    module.name = "os";
-    module.fields = modfields;
-    module.functions = modfuncs;
-    module.classes = NULL;
-    module.preloader= &nn_modfn_os_preloader;
-    module.unloader = NULL;
-    return &module;
+        close(infd);
+        return nn_exceptions_throw(state, "copyFile: '%s' and '%s' are the same file", srcpath, destpath);
+    }
+    outfd = nn_file_opencopydest(destpath, srcstat.st_mode & 0777);
+    if(outfd < 0)
+    {
+        close(infd);
+        return nn_exceptions_throw(state, "copyFile: cannot create '%s': %s", destpath, strerror(errno));
+    }
+    copied = nn_util_copyfd(infd, 0, outfd);
+    close(infd);
+    if((close(outfd) != 0) || (copied < 0))
+    {
+        return nn_exceptions_throw(state, "copyFile: cannot copy '%s' to '%s': %s", srcpath, destpath, strerror(errno));
+    }
+    return nn_value_makenumber(copied);
 }
 
-NNValue nn_modfn_astscan_scan(NNState* state, NNArguments* args)
+/*
+* reads the options of os.walk() from the dict at $args[$argi], if any:
+*   maxDepth:    how many levels to descend; 1 lists only the directory itself. no limit by default.
+*   pattern:     a wildcard (see nn_util_globmatch) that the names of returned entries must match.
+*                directories are still descended into when their name does not match.
+*   size:        whether to stat regular files for their size; true by default.
+*   followLinks: whether to descend into symlinks to directories; false by default.
+*/
+bool nn_walker_getoptions(NNState* state, NNArguments* args, size_t argi, NNDirWalker* w)
 {
-    const char* cstr;
-    NNObjString* insrc;
-    NNAstLexer* scn;
-    NNObjArray* arr;
-    NNObjDict* itm;
-    NNAstToken token;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    insrc = nn_value_asstring(args->args[0]);
-    scn = nn_astlex_make(state, insrc->sbuf->data);
-    arr = nn_array_make(state);
-    while(!nn_astlex_isatend(scn))
+    NNValue val;
+    NNObjDict* dict;
+    NNObjString* os;
+    if((args->count <= argi) || nn_value_isnull(args->args[argi]))
     {
-        itm = nn_object_makedict(state);
-        token = nn_astlex_scantoken(scn);
-        nn_dict_addentrycstr(itm, "line", nn_value_makenumber(token.line));
-        cstr = nn_astutil_toktype2str(token.type);
-        /* 12 == "NEON_ASTTOK_".length */
-        nn_dict_addentrycstr(itm, "type", nn_value_fromobject(nn_string_intern(state, cstr + 12)));
-        nn_dict_addentrycstr(itm, "source", nn_value_fromobject(nn_string_internlen(state, token.start, token.length)));
-        nn_array_push(arr, nn_value_fromobject(itm));
+        return true;
     }
-    nn_astlex_destroy(state, scn);
-    return nn_value_fromobject(arr);
+    if(!nn_value_isdict(args->args[argi]))
+    {
+        nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() expects options as a dict, %s given", args->name, nn_value_typename(args->args[argi]));
+        return false;
+    }
+    dict = nn_value_asdict(args->args[argi]);
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "maxDepth")), &val) && !nn_value_isnull(val))
+    {
+        if(!nn_value_isnumber(val) || (nn_value_asnumber(val) < 1))
+        {
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): maxDepth must be a number of at least 1", args->name);
+            return false;
+        }
+        w->maxdepth = nn_value_asnumber(val);
+    }
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "pattern")), &val) && !nn_value_isnull(val))
+    {
+        if(!nn_value_isstring(val))
+        {
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): pattern must be a string", args->name);
+            return false;
+        }
+        os = nn_value_asstring(val);
+        w->patternlen = os->sbuf->length;
+        w->pattern = (char*)nn_memory_malloc(w->patternlen + 1);
+        memcpy(w->pattern, os->sbuf->data, w->patternlen + 1);
+    }
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "size")), &val))
+    {
+        w->wantsize = !nn_value_isfalse(val);
+    }
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "followLinks")), &val))
+    {
+        w->followlinks = !nn_value_isfalse(val);
+    }
+    return true;
 }
 
-NNRegModule* nn_natmodule_load_astscan(NNState* state)
+void nn_walker_init(NNDirWalker* w)
 {
-    NNRegModule* ret;
-    static NNRegFunc modfuncs[] =
+    memset(w, 0, sizeof(NNDirWalker));
+    w->wantsize = true;
+}
+
+void nn_walker_destroy(NNDirWalker* w)
+{
+    size_t i;
+    while(w->levelcount > 0)
     {
-        {"scan",   true,  nn_modfn_astscan_scan},
-        {NULL,     false, NULL},
-    };
-    static NNRegField modfields[] =
+        nn_walker_pop(w);
+    }
+    for(i = 0; i < w->levelcap; i++)
     {
-        {NULL,       false, NULL},
-    };
-    static NNRegModule module;
-    (void)state;
-    module.name = "astscan";
-    module.fields = modfields;
-    module.functions = modfuncs;
-    module.classes = NULL;
-    module.preloader= NULL;
-    module.unloader = NULL;
-    ret = &module;
-    return ret;
+        nn_memory_free(w->levels[i].buf);
+    }
+    nn_memory_free(w->levels);
+    nn_memory_free(w->path);
+    nn_memory_free(w->pattern);
+    w->levels = NULL;
+    w->levelcap = 0;
+    w->path = NULL;
+    w->pattern = NULL;
 }
 
-NNModInitFN g_builtinmodules[] =
+/* sets the path buffer to its first $at bytes, followed by a slash and $name. */
+void nn_walker_setpath(NNDirWalker* w, size_t at, const char* name, size_t namelen)
 {
-    nn_natmodule_load_null,
-    nn_natmodule_load_os,
-    nn_natmodule_load_astscan,
-    NULL,
-};
+    size_t need;
+    need = at + namelen + 2;
+    if(need > w->pathcap)
+    {
+        w->pathcap = (need > (w->pathcap * 2)) ? need : (w->pathcap * 2);
+        w->path = (char*)nn_memory_realloc(w->path, w->pathcap);
+    }
+    w->path[at] = '/';
+    memcpy(w->path + at + 1, name, namelen);
+    w->pathlen = at + namelen + 1;
+    w->path[w->pathlen] = '\0';
+}
 
-bool nn_import_loadnativemodule(NNState* state, NNModInitFN init_fn, char* importname, const char* source, void* dlw)
+/* makes the directory open as $fd, whose path is what the path buffer holds, the one read next. */
+bool nn_walker_push(NNDirWalker* w, int fd, uint64_t dev, uint64_t ino)
 {
-    int j;
-    int k;
-    NNValue v;
-    NNValue fieldname;
-    NNValue funcname;
-    NNValue funcrealvalue;
-    NNRegFunc func;
-    NNRegField field;
-    NNRegModule* module;
-    NNObjModule* themodule;
-    NNRegClass klassreg;
-    NNObjString* classname;
-    NNObjFuncNative* native;
-    NNObjClass* klass;
-    NNHashValTable* tabdest;
-    module = init_fn(state);
-    if(module != NULL)
+    size_t ncap;
+    NNWalkLevel* lv;
+    if(w->levelcount == w->levelcap)
     {
-        themodule = (NNObjModule*)nn_gcmem_protect(state, (NNObject*)nn_module_make(state, (char*)module->name, source, false));
-        themodule->preloader = (void*)module->preloader;
-        themodule->unloader = (void*)module->unloader;
-        if(module->fields != NULL)
+        ncap = MC_UTIL_INCCAPACITY(w->levelcap);
+        w->levels = (NNWalkLevel*)nn_memory_realloc(w->levels, sizeof(NNWalkLevel) * ncap);
+        memset(w->levels + w->levelcap, 0, sizeof(NNWalkLevel) * (ncap - w->levelcap));
+        w->levelcap = ncap;
+    }
+    lv = &w->levels[w->levelcount];
+    lv->fd = fd;
+    lv->dir = NULL;
+    lv->bufpos = 0;
+    lv->buflen = 0;
+    lv->pathlen = w->pathlen;
+    lv->dev = dev;
+    lv->ino = ino;
+    #if defined(NEON_PLAT_ISLINUX) && !defined(NEON_PLAT_HAVEGETDENTS)
+        lv->dir = fdopendir(fd);
+        if(lv->dir == NULL)
         {
-            for(j = 0; module->fields[j].name != NULL; j++)
-            {
-                field = module->fields[j];
-                fieldname = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, field.name)));
-                v = field.fieldvalfn(state);
-                nn_vm_stackpush(state, v);
-                nn_tableval_set(themodule->deftable, fieldname, v);
-                nn_vm_stackpop(state);
-            }
+            w->error = "cannot read directory";
+            w->errnum = errno;
+            close(fd);
+            return false;
         }
-        if(module->functions != NULL)
+    #endif
+    w->levelcount++;
+    return true;
+}
+
+void nn_walker_pop(NNDirWalker* w)
+{
+    NNWalkLevel* lv;
+    lv = &w->levels[w->levelcount - 1];
+    #if defined(NEON_PLAT_ISLINUX)
+        if(lv->dir != NULL)
         {
-            for(j = 0; module->functions[j].name != NULL; j++)
-            {
-                func = module->functions[j];
-                funcname = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, func.name)));
-                funcrealvalue = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_object_makefuncnative(state, func.function, func.name, NULL)));
-                nn_vm_stackpush(state, funcrealvalue);
-                nn_tableval_set(themodule->deftable, funcname, funcrealvalue);
-                nn_vm_stackpop(state);
-            }
+            closedir((DIR*)lv->dir);
         }
-        if(module->classes != NULL)
+        else
         {
-            for(j = 0; module->classes[j].name != NULL; j++)
+            close(lv->fd);
+        }
+    #endif
+    lv->dir = NULL;
+    w->levelcount--;
+}
+
+/*
+* reads the next entry of $lv into $name and $dtype, skipping "." and "..". on Linux, entries are
+* read with getdents64(), as many as fit into NEON_CONFIG_WALKBUFSIZE at once.
+*/
+bool nn_walker_readdir(NNDirWalker* w, NNWalkLevel* lv, const char** name, unsigned char* dtype)
+{
+    #if defined(NEON_PLAT_HAVEGETDENTS)
+        long rt;
+        struct NNLinuxDirent64* de;
+        while(true)
+        {
+            if(lv->bufpos >= lv->buflen)
             {
-                klassreg = module->classes[j];
-                classname = (NNObjString*)nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, klassreg.name));
-                klass = (NNObjClass*)nn_gcmem_protect(state, (NNObject*)nn_object_makeclass(state, classname, state->classprimobject));
-                if(klassreg.functions != NULL)
+                if(lv->buf == NULL)
                 {
-                    for(k = 0; klassreg.functions[k].name != NULL; k++)
-                    {
-                        func = klassreg.functions[k];
-                        funcname = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, func.name)));
-                        native = (NNObjFuncNative*)nn_gcmem_protect(state, (NNObject*)nn_object_makefuncnative(state, func.function, func.name, NULL));
-                        if(func.isstatic)
-                        {
-                            native->type = NEON_FUNCTYPE_STATIC;
-                        }
-                        else if(strlen(func.name) > 0 && func.name[0] == '_')
-                        {
-                            native->type = NEON_FUNCTYPE_PRIVATE;
-                        }
-                        nn_tableval_set(klass->instmethods, funcname, nn_value_fromobject(native));
-                    }
+                    lv->buf = (char*)nn_memory_malloc(NEON_CONFIG_WALKBUFSIZE);
                 }
-                if(klassreg.fields != NULL)
+                rt = syscall(SYS_getdents64, lv->fd, lv->buf, NEON_CONFIG_WALKBUFSIZE);
+                if(rt <= 0)
                 {
-                    for(k = 0; klassreg.fields[k].name != NULL; k++)
+                    if((rt < 0) && (errno == EINTR))
                     {
-                        field = klassreg.fields[k];
-                        fieldname = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, field.name)));
-                        v = field.fieldvalfn(state);
-                        nn_vm_stackpush(state, v);
-                        tabdest = klass->instproperties;
-                        if(field.isstatic)
-                        {
-                            tabdest = klass->staticproperties;
-                        }
-                        nn_tableval_set(tabdest, fieldname, v);
-                        nn_vm_stackpop(state);
+                        continue;
                     }
+                    if(rt < 0)
+                    {
+                        w->error = "cannot read directory";
+                        w->errnum = errno;
+                    }
+                    return false;
                 }
-                nn_tableval_set(themodule->deftable, nn_value_fromobject(classname), nn_value_fromobject(klass));
+                lv->bufpos = 0;
+                lv->buflen = rt;
             }
+            de = (struct NNLinuxDirent64*)(lv->buf + lv->bufpos);
+            lv->bufpos += de->d_reclen;
+            if((de->d_name[0] == '.') && ((de->d_name[1] == '\0') || ((de->d_name[1] == '.') && (de->d_name[2] == '\0'))))
+            {
+                continue;
+            }
+            *name = de->d_name;
+            *dtype = de->d_type;
+            return true;
         }
-        if(dlw != NULL)
+    #elif defined(NEON_PLAT_ISLINUX)
+        struct dirent* de;
+        while(true)
         {
-            themodule->handle = dlw;
+            errno = 0;
+            de = readdir((DIR*)lv->dir);
+            if(de == NULL)
+            {
+                if(errno != 0)
+                {
+                    w->error = "cannot read directory";
+                    w->errnum = errno;
+                }
+                return false;
+            }
+            if((de->d_name[0] == '.') && ((de->d_name[1] == '\0') || ((de->d_name[1] == '.') && (de->d_name[2] == '\0'))))
+            {
+                continue;
+            }
+            *name = de->d_name;
+            *dtype = de->d_type;
+            return true;
         }
-        nn_import_addnativemodule(state, themodule, themodule->name->sbuf->data);
-        nn_gcmem_clearprotect(state);
-        return true;
-    }
-    else
-    {
-        nn_state_warn(state, "Error loading module: %s\n", importname);
-    }
+    #else
+        (void)w;
+        (void)lv;
+        (void)name;
+        (void)dtype;
+    #endif
     return false;
 }
 
-void nn_import_addnativemodule(NNState* state, NNObjModule* module, const char* as)
-{
-    NNValue name;
-    if(as != NULL)
-    {
-        module->name = nn_string_copycstr(state, as);
-    }
-    name = nn_value_fromobject(nn_string_copyobjstr(state, module->name));
-    nn_vm_stackpush(state, name);
-    nn_vm_stackpush(state, nn_value_fromobject(module));
-    nn_tableval_set(state->openedmodules, name, nn_value_fromobject(module));
-    nn_vm_stackpopn(state, 2);
-}
-
-void nn_import_loadbuiltinmodules(NNState* state)
+const char* nn_walker_typefromdtype(unsigned char dtype)
 {
-    int i;
-    for(i = 0; g_builtinmodules[i] != NULL; i++)
-    {
-        nn_import_loadnativemodule(state, g_builtinmodules[i], NULL, "<__native__>", NULL);
-    }
+    #if defined(NEON_PLAT_ISLINUX)
+        switch(dtype)
+        {
+            case DT_REG:
+                return "file";
+            case DT_DIR:
+                return "dir";
+            case DT_LNK:
+                return "link";
+            case DT_FIFO:
+                return "fifo";
+            case DT_SOCK:
+                return "socket";
+            case DT_CHR:
+                return "chardev";
+            case DT_BLK:
+                return "blockdev";
+            default:
+                break;
+        }
+    #else
+        (void)dtype;
+    #endif
+    return "unknown";
 }
 
-void nn_import_closemodule(void* hnd)
+const char* nn_walker_typefrommode(unsigned int mode)
 {
-    (void)hnd;
+    #if defined(NEON_PLAT_ISLINUX)
+        if(S_ISREG(mode))
+        {
+            return "file";
+        }
+        if(S_ISDIR(mode))
+        {
+            return "dir";
+        }
+        if(S_ISLNK(mode))
+        {
+            return "link";
+        }
+        if(S_ISFIFO(mode))
+        {
+            return "fifo";
+        }
+        if(S_ISSOCK(mode))
+        {
+            return "socket";
+        }
+        if(S_ISCHR(mode))
+        {
+            return "chardev";
+        }
+        if(S_ISBLK(mode))
+        {
+            return "blockdev";
+        }
+    #else
+        (void)mode;
+    #endif
+    return "unknown";
 }
 
-bool nn_util_fsfileexists(NNState* state, const char* filepath)
+/* opens the directory at $path, from where the walk starts. */
+bool nn_walker_open(NNDirWalker* w, const char* path, size_t pathlen)
 {
-    (void)state;
-    #if !defined(NEON_PLAT_ISWINDOWS)
-        return access(filepath, F_OK) == 0;
-    #else
-        struct stat sb;
-        if(stat(filepath, &sb) == -1)
+    #if defined(NEON_PLAT_ISLINUX)
+        int fd;
+        struct stat st;
+        /* entries are appended with a slash, so the root should not end with one. */
+        w->pathcap = pathlen + 1;
+        w->path = (char*)nn_memory_malloc(w->pathcap);
+        memcpy(w->path, path, pathlen + 1);
+        w->pathlen = pathlen;
+        while((w->pathlen > 0) && (w->path[w->pathlen - 1] == '/'))
+        {
+            w->pathlen--;
+        }
+        w->path[w->pathlen] = '\0';
+        fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if((fd < 0) || (fstat(fd, &st) != 0))
         {
+            w->error = "cannot open directory";
+            w->errnum = errno;
+            if(fd >= 0)
+            {
+                close(fd);
+            }
             return false;
         }
-        return true;
+        return nn_walker_push(w, fd, st.st_dev, st.st_ino);
+    #else
+        (void)path;
+        (void)pathlen;
+        w->error = "cannot walk directories on this platform";
+        w->errnum = 0;
+        return false;
     #endif
 }
 
-bool nn_util_fsfileistype(NNState* state, const char* filepath, int typ)
+/*
+* enters the directory $name of the deepest open directory, whose path is in the path buffer.
+* directories that cannot be opened, such as for lack of permission, are skipped, as are symlinks
+* that lead back to a directory that is already open. only running out of descriptors is an error.
+*/
+bool nn_walker_descend(NNDirWalker* w, const char* name)
 {
-    int tmp;
-    struct stat st;
-    (void)state;
-    (void)filepath;
-    if(stat(filepath, &st) == -1)
-    {
-        return false;
-    }
-    tmp = (st.st_mode & S_IFMT);
+    #if defined(NEON_PLAT_ISLINUX)
+        int fd;
+        int flags;
+        size_t i;
+        struct stat st;
+        flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+        if(!w->followlinks)
+        {
+            flags |= O_NOFOLLOW;
+        }
+        fd = openat(w->levels[w->levelcount - 1].fd, name, flags);
+        if(fd < 0)
+        {
+            if((errno == EMFILE) || (errno == ENFILE) || (errno == ENOMEM))
+            {
+                w->error = "cannot open directory";
+                w->errnum = errno;
+                return false;
+            }
+            return true;
+        }
+        st.st_dev = 0;
+        st.st_ino = 0;
+        if(w->followlinks)
+        {
+            if(fstat(fd, &st) != 0)
+            {
+                close(fd);
+                return true;
+            }
+            for(i = 0; i < w->levelcount; i++)
+            {
+                if((w->levels[i].dev == (uint64_t)st.st_dev) && (w->levels[i].ino == (uint64_t)st.st_ino))
+                {
+                    close(fd);
+                    return true;
+                }
+            }
+        }
+        return nn_walker_push(w, fd, st.st_dev, st.st_ino);
+    #else
+        (void)w;
+        (void)name;
+        return false;
+    #endif
+}
+
+/*
+* reads the next entry into $ent, in pre-order: a directory comes before what it contains.
+* the type of an entry comes from the directory itself where the filesystem records it, so
+* entries are only stat'ed for sizes, for symlinks that are followed, and where it does not.
+* returns false at the end, or on an error, which sets $error.
+*/
+bool nn_walker_next(NNDirWalker* w, NNWalkEntry* ent)
+{
+    #if defined(NEON_PLAT_ISLINUX)
+        bool isdir;
+        bool needstat;
+        size_t namelen;
+        unsigned char dtype;
+        const char* name;
+        struct stat st;
+        NNWalkLevel* lv;
+        while(w->levelcount > 0)
+        {
+            lv = &w->levels[w->levelcount - 1];
+            if(!nn_walker_readdir(w, lv, &name, &dtype))
+            {
+                /* errors name the directory that could not be read. */
+                w->pathlen = lv->pathlen;
+                w->path[w->pathlen] = '\0';
+                nn_walker_pop(w);
+                if(w->error != NULL)
+                {
+                    return false;
+                }
+                continue;
+            }
+            namelen = strlen(name);
+            nn_walker_setpath(w, lv->pathlen, name, namelen);
+            ent->name = w->path + lv->pathlen + 1;
+            ent->namelen = namelen;
+            ent->type = nn_walker_typefromdtype(dtype);
+            ent->size = -1;
+            ent->depth = w->levelcount;
+            isdir = (dtype == DT_DIR);
+            needstat = ((dtype == DT_UNKNOWN) || ((dtype == DT_LNK) && w->followlinks) || ((dtype == DT_REG) && w->wantsize));
+            if(needstat)
+            {
+                /* a dangling symlink is still listed, as a link. */
+                if((fstatat(lv->fd, ent->name, &st, w->followlinks ? 0 : AT_SYMLINK_NOFOLLOW) == 0) || (w->followlinks && (fstatat(lv->fd, ent->name, &st, AT_SYMLINK_NOFOLLOW) == 0)))
+                {
+                    ent->type = nn_walker_typefrommode(st.st_mode);
+                    isdir = S_ISDIR(st.st_mode);
+                    if(S_ISREG(st.st_mode) && w->wantsize)
+                    {
+                        ent->size = st.st_size;
+                    }
+                }
+            }
+            if(isdir && ((w->maxdepth == 0) || (ent->depth < w->maxdepth)))
+            {
+                if(!nn_walker_descend(w, ent->name))
+                {
+                    return false;
+                }
+            }
+            if((w->pattern != NULL) && !nn_util_globmatch(w->pattern, w->patternlen, ent->name, namelen))
+            {
+                continue;
+            }
+            return true;
+        }
+    #else
+        (void)w;
+        (void)ent;
+    #endif
+    return false;
+}
+
+/*
+* the next element of an os.walk() iterator: a dict of the path, name, type, size and depth of
+* an entry. the walker is in $walker; $other holds the keys of the dict.
+*/
+bool nn_iterator_nextwalk(NNState* state, NNObjIterator* iter, NNValue* dest)
+{
+    NNWalkEntry ent;
+    NNValue* keys;
+    NNObjDict* dict;
+    NNDirWalker* w;
+    w = iter->walker;
+    if(!nn_walker_next(w, &ent))
+    {
+        if(w->error != NULL)
+        {
+            nn_exceptions_throw(state, "walk: %s '%s': %s", w->error, w->path, strerror(w->errnum));
+        }
+        return false;
+    }
+    keys = nn_value_asarray(iter->other)->varray->listitems;
+    dict = nn_object_makedict(state);
+    nn_vm_stackpush(state, nn_value_fromobject(dict));
+    nn_dict_rebuild(dict, 5);
+    nn_dict_setentry(dict, keys[0], nn_value_fromobject(nn_string_copylen(state, w->path, w->pathlen)));
+    nn_dict_setentry(dict, keys[1], nn_value_fromobject(nn_string_copylen(state, ent.name, ent.namelen)));
+    nn_dict_setentry(dict, keys[2], nn_value_fromobject(nn_string_intern(state, ent.type)));
+    nn_dict_setentry(dict, keys[3], (ent.size < 0) ? nn_value_makenull() : nn_value_makenumber(ent.size));
+    nn_dict_setentry(dict, keys[4], nn_value_makenumber(ent.depth));
+    nn_vm_stackpop(state);
+    *dest = nn_value_fromobject(dict);
+    return true;
+}
+
+/*
+* walk(path, options) returns an Iterator over everything below the directory $path, which
+* reads directories as it goes. each entry is a dict with the keys path, name, type ("file",
+* "dir", "link", ...), size (null for anything but regular files) and depth (1 for the entries
+* of $path). see nn_walker_getoptions for the options.
+*/
+NNValue nn_modfn_os_walk(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNDirWalker* w;
+    NNObjString* os;
+    NNObjArray* keys;
+    NNObjIterator* iter;
+    NNArgCheck check;
+    static const char* keynames[] = {"path", "name", "type", "size", "depth"};
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    os = nn_value_asstring(args->args[0]);
+    w = (NNDirWalker*)nn_memory_malloc(sizeof(NNDirWalker));
+    nn_walker_init(w);
+    if(!nn_walker_getoptions(state, args, 1, w))
+    {
+        nn_walker_destroy(w);
+        nn_memory_free(w);
+        return nn_value_makenull();
+    }
+    if(!nn_walker_open(w, os->sbuf->data, os->sbuf->length))
+    {
+        nn_exceptions_throw(state, "walk: %s '%s': %s", w->error, os->sbuf->data, strerror(w->errnum));
+        nn_walker_destroy(w);
+        nn_memory_free(w);
+        return nn_value_makenull();
+    }
+    iter = (NNObjIterator*)nn_gcmem_protect(state, (NNObject*)nn_object_makeiterator(state, NEON_ITERKIND_WALK, args->args[0]));
+    iter->walker = w;
+    keys = nn_object_makearray(state);
+    iter->other = nn_value_fromobject(keys);
+    for(i = 0; i < (sizeof(keynames) / sizeof(keynames[0])); i++)
+    {
+        nn_array_push(keys, nn_value_fromobject(nn_string_intern(state, keynames[i])));
+    }
+    return nn_value_fromobject(iter);
+}
+
+NNRegModule* nn_natmodule_load_os(NNState* state)
+{
+    static NNRegFunc modfuncs[] =
+    {
+        {"readdir",   true,  nn_modfn_os_readdir},
+        {"copyFile",  true,  nn_modfn_os_copyfile},
+        {"walk",      true,  nn_modfn_os_walk},
+        {NULL,     false, NULL},
+    };
+    static NNRegField modfields[] =
+    {
+        /*{"platform", true, get_os_platform},*/
+        {NULL,       false, NULL},
+    };
+    static NNRegModule module;
+    (void)state;
+    module.name = "os";
+    module.fields = modfields;
+    module.functions = modfuncs;
+    module.classes = NULL;
+    module.preloader= &nn_modfn_os_preloader;
+    module.unloader = NULL;
+    return &module;
+}
+
+NNValue nn_modfn_astscan_scan(NNState* state, NNArguments* args)
+{
+    const char* cstr;
+    NNObjString* insrc;
+    NNAstLexer* scn;
+    NNObjArray* arr;
+    NNObjDict* itm;
+    NNAstToken token;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    insrc = nn_value_asstring(args->args[0]);
+    scn = nn_astlex_make(state, insrc->sbuf->data);
+    arr = nn_array_make(state);
+    while(!nn_astlex_isatend(scn))
+    {
+        itm = nn_object_makedict(state);
+        token = nn_astlex_scantoken(scn);
+        nn_dict_addentrycstr(itm, "line", nn_value_makenumber(token.line));
+        cstr = nn_astutil_toktype2str(token.type);
+        /* 12 == "NEON_ASTTOK_".length */
+        nn_dict_addentrycstr(itm, "type", nn_value_fromobject(nn_string_intern(state, cstr + 12)));
+        nn_dict_addentrycstr(itm, "source", nn_value_fromobject(nn_string_internlen(state, token.start, token.length)));
+        nn_array_push(arr, nn_value_fromobject(itm));
+    }
+    nn_astlex_destroy(state, scn);
+    return nn_value_fromobject(arr);
+}
+
+NNRegModule* nn_natmodule_load_astscan(NNState* state)
+{
+    NNRegModule* ret;
+    static NNRegFunc modfuncs[] =
+    {
+        {"scan",   true,  nn_modfn_astscan_scan},
+        {NULL,     false, NULL},
+    };
+    static NNRegField modfields[] =
+    {
+        {NULL,       false, NULL},
+    };
+    static NNRegModule module;
+    (void)state;
+    module.name = "astscan";
+    module.fields = modfields;
+    module.functions = modfuncs;
+    module.classes = NULL;
+    module.preloader= NULL;
+    module.unloader = NULL;
+    ret = &module;
+    return ret;
+}
+
+/*
+* reads the options dict of the csv functions, if there is one at $argi:
+* delimiter and quote (single characters), header (bool), columns (an array of names or
+* indices) and batch (a number of rows). throws and returns false if any of them is invalid.
+*/
+bool nn_csv_getoptions(NNState* state, NNArguments* args, size_t argi, NNCSVOptions* opts)
+{
+    NNValue val;
+    NNObjDict* dict;
+    opts->delimiter = ',';
+    opts->quote = '"';
+    opts->header = false;
+    opts->columns = NULL;
+    opts->batch = 0;
+    if((args->count <= argi) || nn_value_isnull(args->args[argi]))
+    {
+        return true;
+    }
+    if(!nn_value_isdict(args->args[argi]))
+    {
+        nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() expects options as a dict, %s given", args->name, nn_value_typename(args->args[argi]));
+        return false;
+    }
+    dict = nn_value_asdict(args->args[argi]);
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "delimiter")), &val))
+    {
+        if(!nn_value_isstring(val) || (nn_value_asstring(val)->sbuf->length != 1))
+        {
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): delimiter must be a single character", args->name);
+            return false;
+        }
+        opts->delimiter = nn_value_asstring(val)->sbuf->data[0];
+    }
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "quote")), &val))
+    {
+        if(!nn_value_isstring(val) || (nn_value_asstring(val)->sbuf->length != 1))
+        {
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): quote must be a single character", args->name);
+            return false;
+        }
+        opts->quote = nn_value_asstring(val)->sbuf->data[0];
+    }
+    if(opts->delimiter == opts->quote)
+    {
+        nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): delimiter and quote must differ", args->name);
+        return false;
+    }
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "header")), &val))
+    {
+        opts->header = !nn_value_isfalse(val);
+    }
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "batch")), &val))
+    {
+        if(!nn_value_isnumber(val) || (nn_value_asnumber(val) < 0))
+        {
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): batch must be a positive number", args->name);
+            return false;
+        }
+        opts->batch = nn_value_asnumber(val);
+    }
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "columns")), &val) && !nn_value_isnull(val))
+    {
+        if(!nn_value_isarray(val))
+        {
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): columns must be an array", args->name);
+            return false;
+        }
+        opts->columns = nn_value_asarray(val);
+    }
+    return true;
+}
+
+/* copies the columns option into $rd, since it must outlive the options dict. */
+bool nn_csv_initreader(NNState* state, NNCSVReader* rd, NNCSVOptions* opts)
+{
+    size_t i;
+    NNValue val;
+    NNObjString* os;
+    memset(rd, 0, sizeof(NNCSVReader));
+    rd->pstate = state;
+    rd->delimiter = opts->delimiter;
+    rd->quote = opts->quote;
+    rd->header = opts->header;
+    if(opts->columns == NULL)
+    {
+        return true;
+    }
+    rd->wantedcount = opts->columns->varray->listcount;
+    rd->wanted = (NNCSVColumn*)nn_memory_malloc(sizeof(NNCSVColumn) * (rd->wantedcount + 1));
+    for(i = 0; i < rd->wantedcount; i++)
+    {
+        val = opts->columns->varray->listitems[i];
+        rd->wanted[i].name = NULL;
+        rd->wanted[i].index = 0;
+        if(nn_value_isstring(val) && rd->header)
+        {
+            os = nn_value_asstring(val);
+            rd->wanted[i].name = nn_util_strndup(os->sbuf->data, os->sbuf->length);
+            rd->wanted[i].namelen = os->sbuf->length;
+        }
+        else if(nn_value_isnumber(val) && (nn_value_asnumber(val) >= 0))
+        {
+            rd->wanted[i].index = nn_value_asnumber(val);
+        }
+        else
+        {
+            rd->wantedcount = i;
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "columns must be indices, or names if there is a header");
+            return false;
+        }
+    }
+    return true;
+}
+
+void nn_csv_destroyreader(NNCSVReader* rd)
+{
+    size_t i;
+    for(i = 0; i < rd->wantedcount; i++)
+    {
+        nn_memory_free(rd->wanted[i].name);
+    }
+    nn_memory_free(rd->wanted);
+    nn_memory_free(rd->slots);
+    nn_memory_free(rd->fieldbuf);
+}
+
+/* moves on to the next physical line, from the file, or from $source. */
+bool nn_csv_nextline(NNCSVReader* rd)
+{
+    size_t len;
+    const char* nl;
+    if(rd->file != NULL)
+    {
+        if(!nn_file_readline(rd->pstate, rd->file, false, &len))
+        {
+            return false;
+        }
+        rd->line = rd->file->linebuf;
+    }
+    else
+    {
+        if(rd->sourcepos >= rd->sourcelen)
+        {
+            return false;
+        }
+        rd->line = rd->source + rd->sourcepos;
+        nl = (const char*)memchr(rd->line, '\n', rd->sourcelen - rd->sourcepos);
+        len = (nl == NULL) ? (rd->sourcelen - rd->sourcepos) : (size_t)((nl - rd->line) + 1);
+        rd->sourcepos += len;
+    }
+    rd->linelen = len;
+    if((len > 0) && (rd->line[len - 1] == '\n'))
+    {
+        len--;
+    }
+    if((len > 0) && (rd->line[len - 1] == '\r'))
+    {
+        len--;
+    }
+    rd->lineend = len;
+    rd->linenumber++;
+    return true;
+}
+
+void nn_csv_appendfield(NNCSVReader* rd, size_t* len, const char* chars, size_t count)
+{
+    if(*len + count + 1 > rd->fieldcap)
+    {
+        while(*len + count + 1 > rd->fieldcap)
+        {
+            rd->fieldcap = (rd->fieldcap == 0) ? 256 : (rd->fieldcap * 2);
+        }
+        rd->fieldbuf = (char*)nn_memory_realloc(rd->fieldbuf, rd->fieldcap);
+    }
+    memcpy(rd->fieldbuf + *len, chars, count);
+    *len += count;
+}
+
+/* the position in a row of column $col, or -1 if it is not wanted. */
+NEON_FORCEINLINE int64_t nn_csv_slotof(NNCSVReader* rd, size_t col)
+{
+    if(rd->slots != NULL)
+    {
+        return (col < rd->slotcount) ? rd->slots[col] : -1;
+    }
+    if(rd->header && (rd->names != NULL))
+    {
+        return (col < rd->names->varray->listcount) ? (int64_t)col : -1;
+    }
+    return col;
+}
+
+/*
+* reads the fields of the next record into $scratch, which must be reachable by the caller.
+* with $all, every field is appended; otherwise each wanted field goes into its slot, and no
+* string is created for the rest. quoted fields may span lines.
+* returns false at the end of input, or on an error, which is then in $error.
+*/
+bool nn_csv_readfields(NNCSVReader* rd, NNObjArray* scratch, bool all)
+{
+    bool wanted;
+    size_t col;
+    size_t pos;
+    size_t flen;
+    size_t start;
+    int64_t slot;
+    const char* p;
+    NNValue value;
+    NNState* state;
+    state = rd->pstate;
+    value = nn_value_makenull();
+    do
+    {
+        if(!nn_csv_nextline(rd))
+        {
+            return false;
+        }
+    } while(rd->lineend == 0);
+    col = 0;
+    pos = 0;
+    while(true)
+    {
+        slot = all ? (int64_t)col : nn_csv_slotof(rd, col);
+        wanted = (slot >= 0);
+        if((pos < rd->lineend) && (rd->line[pos] == rd->quote))
+        {
+            flen = 0;
+            pos++;
+            while(true)
+            {
+                p = (const char*)memchr(rd->line + pos, rd->quote, rd->linelen - pos);
+                if(p == NULL)
+                {
+                    /* the field goes on past the end of this line, newline included. */
+                    if(wanted)
+                    {
+                        nn_csv_appendfield(rd, &flen, rd->line + pos, rd->linelen - pos);
+                    }
+                    if(!nn_csv_nextline(rd))
+                    {
+                        rd->error = "unterminated quoted field";
+                        return false;
+                    }
+                    pos = 0;
+                    continue;
+                }
+                if(wanted)
+                {
+                    nn_csv_appendfield(rd, &flen, rd->line + pos, (p - rd->line) - pos);
+                }
+                pos = (p - rd->line) + 1;
+                if((pos < rd->linelen) && (rd->line[pos] == rd->quote))
+                {
+                    if(wanted)
+                    {
+                        nn_csv_appendfield(rd, &flen, p, 1);
+                    }
+                    pos++;
+                    continue;
+                }
+                break;
+            }
+            /* like most readers, keep anything between the closing quote and the delimiter. */
+            start = pos;
+            while((pos < rd->lineend) && (rd->line[pos] != rd->delimiter))
+            {
+                pos++;
+            }
+            if(wanted)
+            {
+                nn_csv_appendfield(rd, &flen, rd->line + start, pos - start);
+                value = nn_value_fromobject(nn_string_copylen(state, rd->fieldbuf, flen));
+            }
+        }
+        else
+        {
+            start = pos;
+            p = (const char*)memchr(rd->line + pos, rd->delimiter, rd->lineend - pos);
+            pos = (p == NULL) ? rd->lineend : (size_t)(p - rd->line);
+            if(wanted)
+            {
+                value = nn_value_fromobject(nn_string_copylen(state, rd->line + start, pos - start));
+            }
+        }
+        if(wanted)
+        {
+            if(all || (rd->slots == NULL && !rd->header))
+            {
+                nn_array_push(scratch, value);
+            }
+            else
+            {
+                scratch->varray->listitems[slot] = value;
+            }
+        }
+        col++;
+        if((pos < rd->lineend) && (rd->line[pos] == rd->delimiter))
+        {
+            pos++;
+            continue;
+        }
+        break;
+    }
+    return true;
+}
+
+/*
+* takes the column names from the first record, and works out which columns are wanted.
+* $names becomes the names of the columns of a row, in order; the caller keeps it reachable.
+*/
+bool nn_csv_readheader(NNCSVReader* rd, NNObjArray* scratch, NNObjArray* names)
+{
+    size_t i;
+    size_t j;
+    size_t count;
+    int64_t index;
+    NNObjString* os;
+    if(!nn_csv_readfields(rd, scratch, true))
+    {
+        return false;
+    }
+    count = scratch->varray->listcount;
+    rd->names = names;
+    if(rd->wanted == NULL)
+    {
+        for(i = 0; i < count; i++)
+        {
+            nn_array_push(names, scratch->varray->listitems[i]);
+        }
+        scratch->varray->listcount = 0;
+        return true;
+    }
+    rd->slotcount = count;
+    rd->slots = (int64_t*)nn_memory_malloc(sizeof(int64_t) * (count + 1));
+    for(i = 0; i < count; i++)
+    {
+        rd->slots[i] = -1;
+    }
+    for(i = 0; i < rd->wantedcount; i++)
+    {
+        index = -1;
+        if(rd->wanted[i].name == NULL)
+        {
+            if(rd->wanted[i].index < count)
+            {
+                index = rd->wanted[i].index;
+            }
+        }
+        else
+        {
+            for(j = 0; j < count; j++)
+            {
+                os = nn_value_asstring(scratch->varray->listitems[j]);
+                if((os->sbuf->length == rd->wanted[i].namelen) && (memcmp(os->sbuf->data, rd->wanted[i].name, os->sbuf->length) == 0))
+                {
+                    index = j;
+                    break;
+                }
+            }
+        }
+        if(index < 0)
+        {
+            rd->error = "header has no such column";
+            scratch->varray->listcount = 0;
+            return false;
+        }
+        rd->slots[index] = i;
+        nn_array_push(names, scratch->varray->listitems[index]);
+    }
+    scratch->varray->listcount = 0;
+    return true;
+}
+
+/* sets up the slots for columns picked by index, when there is no header. */
+void nn_csv_resolveindices(NNCSVReader* rd)
+{
+    size_t i;
+    rd->slotcount = 0;
+    for(i = 0; i < rd->wantedcount; i++)
+    {
+        if(rd->wanted[i].index + 1 > rd->slotcount)
+        {
+            rd->slotcount = rd->wanted[i].index + 1;
+        }
+    }
+    rd->slots = (int64_t*)nn_memory_malloc(sizeof(int64_t) * (rd->slotcount + 1));
+    for(i = 0; i < rd->slotcount; i++)
+    {
+        rd->slots[i] = -1;
+    }
+    for(i = 0; i < rd->wantedcount; i++)
+    {
+        rd->slots[rd->wanted[i].index] = i;
+    }
+}
+
+/*
+* reads the next record into $dest: an array of strings, or with a header, a dict mapping
+* column names to strings. fields missing from a short record are null.
+* $scratch and $names are reused for every record, and must be kept reachable by the caller.
+*/
+bool nn_csv_readrecord(NNCSVReader* rd, NNObjArray* scratch, NNObjArray* names, NNValue* dest)
+{
+    size_t i;
+    size_t count;
+    NNObjArray* row;
+    NNObjDict* dict;
+    NNState* state;
+    state = rd->pstate;
+    if(rd->header && (rd->names == NULL))
+    {
+        if(!nn_csv_readheader(rd, scratch, names))
+        {
+            return false;
+        }
+    }
+    else if((rd->wanted != NULL) && (rd->slots == NULL))
+    {
+        nn_csv_resolveindices(rd);
+    }
+    count = 0;
+    if(rd->header)
+    {
+        count = names->varray->listcount;
+    }
+    else if(rd->wanted != NULL)
+    {
+        count = rd->wantedcount;
+    }
+    scratch->varray->listcount = 0;
+    for(i = 0; i < count; i++)
+    {
+        nn_array_push(scratch, nn_value_makenull());
+    }
+    if(!nn_csv_readfields(rd, scratch, false))
+    {
+        scratch->varray->listcount = 0;
+        return false;
+    }
+    count = scratch->varray->listcount;
+    if(rd->header)
+    {
+        dict = nn_object_makedict(state);
+        nn_vm_stackpush(state, nn_value_fromobject(dict));
+        nn_dict_rebuild(dict, count);
+        for(i = 0; i < count; i++)
+        {
+            nn_dict_setentry(dict, names->varray->listitems[i], scratch->varray->listitems[i]);
+        }
+        nn_vm_stackpop(state);
+        *dest = nn_value_fromobject(dict);
+    }
+    else
+    {
+        row = nn_object_makearray(state);
+        nn_vallist_resize(row->varray, count);
+        for(i = 0; i < count; i++)
+        {
+            nn_vallist_push(row->varray, scratch->varray->listitems[i]);
+        }
+        *dest = nn_value_fromobject(row);
+    }
+    scratch->varray->listcount = 0;
+    return true;
+}
+
+/*
+* the next element of a csv.reader() iterator: a record, or with a batch size in $limit, an
+* array of up to that many records. the reader is in $csv; $other holds [scratch, names].
+*/
+bool nn_iterator_nextcsv(NNState* state, NNObjIterator* iter, NNValue* dest)
+{
+    NNValue row;
+    NNObjArray* batch;
+    NNObjArray* scratch;
+    NNObjArray* names;
+    NNObjArray* holder;
+    holder = nn_value_asarray(iter->other);
+    scratch = nn_value_asarray(holder->varray->listitems[0]);
+    names = nn_value_asarray(holder->varray->listitems[1]);
+    if(iter->limit == 0)
+    {
+        if(!nn_csv_readrecord(iter->csv, scratch, names, dest))
+        {
+            goto failed;
+        }
+        return true;
+    }
+    batch = nn_object_makearray(state);
+    iter->current = nn_value_fromobject(batch);
+    while((int64_t)batch->varray->listcount < iter->limit)
+    {
+        if(!nn_csv_readrecord(iter->csv, scratch, names, &row))
+        {
+            if(iter->csv->error != NULL)
+            {
+                goto failed;
+            }
+            break;
+        }
+        nn_array_push(batch, row);
+    }
+    if(batch->varray->listcount == 0)
+    {
+        return false;
+    }
+    *dest = nn_value_fromobject(batch);
+    return true;
+failed:
+    if(iter->csv->error != NULL)
+    {
+        nn_exceptions_throw(state, "csv: %s on line %ld", iter->csv->error, (long)iter->csv->linenumber);
+    }
+    return false;
+}
+
+/*
+* reader(file, options) returns an Iterator over the records of $file, reading it as it goes.
+* see nn_csv_getoptions for the options; with a batch size, the iterator yields arrays of records.
+*/
+NNValue nn_modfn_csv_reader(NNState* state, NNArguments* args)
+{
+    NNCSVOptions opts;
+    NNCSVReader* rd;
+    NNObjArray* holder;
+    NNObjIterator* iter;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isfile);
+    if(!nn_csv_getoptions(state, args, 1, &opts))
+    {
+        return nn_value_makenull();
+    }
+    rd = (NNCSVReader*)nn_memory_malloc(sizeof(NNCSVReader));
+    if(!nn_csv_initreader(state, rd, &opts))
+    {
+        nn_csv_destroyreader(rd);
+        nn_memory_free(rd);
+        return nn_value_makenull();
+    }
+    rd->file = nn_value_asfile(args->args[0]);
+    iter = (NNObjIterator*)nn_gcmem_protect(state, (NNObject*)nn_object_makeiterator(state, NEON_ITERKIND_CSV, args->args[0]));
+    iter->csv = rd;
+    iter->limit = opts.batch;
+    holder = nn_object_makearray(state);
+    iter->other = nn_value_fromobject(holder);
+    nn_array_push(holder, nn_value_fromobject(nn_object_makearray(state)));
+    nn_array_push(holder, nn_value_fromobject(nn_object_makearray(state)));
+    return nn_value_fromobject(iter);
+}
+
+/* parse(string, options) returns all records of $string as an array. */
+NNValue nn_modfn_csv_parse(NNState* state, NNArguments* args)
+{
+    NNValue row;
+    NNObjString* os;
+    NNObjArray* rows;
+    NNObjArray* scratch;
+    NNObjArray* names;
+    NNCSVOptions opts;
+    NNCSVReader rd;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    if(!nn_csv_getoptions(state, args, 1, &opts))
+    {
+        return nn_value_makenull();
+    }
+    if(!nn_csv_initreader(state, &rd, &opts))
+    {
+        nn_csv_destroyreader(&rd);
+        return nn_value_makenull();
+    }
+    os = nn_value_asstring(args->args[0]);
+    rd.source = os->sbuf->data;
+    rd.sourcelen = os->sbuf->length;
+    rows = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    scratch = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    names = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    while(nn_csv_readrecord(&rd, scratch, names, &row))
+    {
+        nn_array_push(rows, row);
+    }
+    nn_csv_destroyreader(&rd);
+    if(rd.error != NULL)
+    {
+        return nn_exceptions_throw(state, "csv: %s on line %ld", rd.error, (long)rd.linenumber);
+    }
+    return nn_value_fromobject(rows);
+}
+
+/* writes $str as a field, quoted if it contains the delimiter, the quote, or a line break. */
+void nn_csv_writestring(NNPrinter* pr, NNCSVOptions* opts, const char* str, size_t len)
+{
+    size_t i;
+    size_t start;
+    bool needquote;
+    needquote = false;
+    for(i = 0; i < len; i++)
+    {
+        if((str[i] == opts->delimiter) || (str[i] == opts->quote) || (str[i] == '\n') || (str[i] == '\r'))
+        {
+            needquote = true;
+            break;
+        }
+    }
+    if(!needquote)
+    {
+        nn_printer_writestringl(pr, str, len);
+        return;
+    }
+    nn_printer_writechar(pr, opts->quote);
+    start = 0;
+    for(i = 0; i < len; i++)
+    {
+        if(str[i] == opts->quote)
+        {
+            /* quotes are doubled: write up to and including this one, and it goes out again next. */
+            nn_printer_writestringl(pr, str + start, (i - start) + 1);
+            start = i;
+        }
+    }
+    nn_printer_writestringl(pr, str + start, len - start);
+    nn_printer_writechar(pr, opts->quote);
+}
+
+/* writes a field: strings as they are, null as an empty field, and anything else as it prints. */
+void nn_csv_writefield(NNPrinter* pr, NNCSVOptions* opts, NNValue value)
+{
+    NNObjString* os;
+    if(nn_value_isnull(value))
+    {
+        return;
+    }
+    if(nn_value_isnumber(value))
+    {
+        nn_printer_printnumber(pr, value);
+        return;
+    }
+    if(nn_value_isstring(value))
+    {
+        os = nn_value_asstring(value);
+    }
+    else
+    {
+        os = nn_value_tostring(pr->pstate, value);
+    }
+    nn_csv_writestring(pr, opts, os->sbuf->data, os->sbuf->length);
+}
+
+/*
+* writes $row, an array or a dict, as one record. the values of a dict are written in the order
+* of $opts->columns if given, leaving keys it lacks empty; otherwise in the order of the dict.
+*/
+bool nn_csv_writerecord(NNState* state, NNPrinter* pr, NNCSVOptions* opts, NNValue row)
+{
+    size_t i;
+    size_t n;
+    NNValue val;
+    NNValArray* list;
+    NNObjDict* dict;
+    if(nn_value_isarray(row))
+    {
+        list = nn_value_asarray(row)->varray;
+        for(i = 0; i < list->listcount; i++)
+        {
+            if(i > 0)
+            {
+                nn_printer_writechar(pr, opts->delimiter);
+            }
+            nn_csv_writefield(pr, opts, list->listitems[i]);
+        }
+    }
+    else if(nn_value_isdict(row))
+    {
+        dict = nn_value_asdict(row);
+        if(opts->columns != NULL)
+        {
+            for(i = 0; i < opts->columns->varray->listcount; i++)
+            {
+                if(i > 0)
+                {
+                    nn_printer_writechar(pr, opts->delimiter);
+                }
+                if(nn_dict_get(dict, opts->columns->varray->listitems[i], &val))
+                {
+                    nn_csv_writefield(pr, opts, val);
+                }
+            }
+        }
+        else
+        {
+            n = 0;
+            for(i = 0; i < dict->entrycount; i++)
+            {
+                if(dict->entries[i].live)
+                {
+                    if(n > 0)
+                    {
+                        nn_printer_writechar(pr, opts->delimiter);
+                    }
+                    nn_csv_writefield(pr, opts, dict->entries[i].value.value);
+                    n++;
+                }
+            }
+        }
+    }
+    else
+    {
+        nn_exceptions_throw(state, "csv: a record must be an array or a dict, not %s", nn_value_typename(row));
+        return false;
+    }
+    nn_printer_writechar(pr, '\n');
+    return true;
+}
+
+/* writes the header, which is $opts->columns. */
+bool nn_csv_writeheader(NNState* state, NNPrinter* pr, NNCSVOptions* opts)
+{
+    if(opts->columns == NULL)
+    {
+        nn_exceptions_throw(state, "csv: a header needs either the columns option, or dicts as records");
+        return false;
+    }
+    return nn_csv_writerecord(state, pr, opts, nn_value_fromobject(opts->columns));
+}
+
+/*
+* writes $rows, an array or an iterator of records, preceded by a header if asked to.
+* without the columns option, the keys of a first record that is a dict become the columns, so
+* that every dict is written in the same order, and the header fits all of them.
+*/
+bool nn_csv_writerecords(NNState* state, NNPrinter* pr, NNCSVOptions* opts, NNValue rows, size_t* countdest)
+{
+    size_t i;
+    size_t pushed;
+    NNValue row;
+    NNObjDict* dict;
+    NNObjIterator* iter;
+    *countdest = 0;
+    iter = nn_iterator_fromvalue(state, rows);
+    if(iter == NULL)
+    {
+        nn_exceptions_throwclass(state, state->exceptions.argumenterror, "csv: cannot write records from %s", nn_value_typename(rows));
+        return false;
+    }
+    nn_vm_stackpush(state, nn_value_fromobject(iter));
+    pushed = 1;
+    while(nn_iterator_next(state, iter, &row))
+    {
+        if((*countdest == 0) && (opts->columns == NULL) && nn_value_isdict(row))
+        {
+            dict = nn_value_asdict(row);
+            opts->columns = nn_object_makearray(state);
+            nn_vm_stackpush(state, nn_value_fromobject(opts->columns));
+            pushed++;
+            for(i = 0; i < dict->entrycount; i++)
+            {
+                if(dict->entries[i].live)
+                {
+                    nn_array_push(opts->columns, dict->entries[i].key);
+                }
+            }
+        }
+        if((*countdest == 0) && opts->header)
+        {
+            if(!nn_csv_writeheader(state, pr, opts))
+            {
+                nn_vm_stackpopn(state, pushed);
+                return false;
+            }
+        }
+        if(!nn_csv_writerecord(state, pr, opts, row))
+        {
+            nn_vm_stackpopn(state, pushed);
+            return false;
+        }
+        (*countdest)++;
+    }
+    if(iter->failed)
+    {
+        return false;
+    }
+    nn_vm_stackpopn(state, pushed);
+    if((*countdest == 0) && opts->header && (opts->columns != NULL))
+    {
+        return nn_csv_writeheader(state, pr, opts);
+    }
+    return true;
+}
+
+/* sets up $pr to write to $file through a buffer of NEON_CONFIG_PRINTBUFSIZE bytes. */
+bool nn_csv_openwriter(NNState* state, NNPrinter* pr, NNObjFile* file)
+{
+    if(file->isstd)
+    {
+        nn_printer_flush(state->stdoutprinter);
+    }
+    else if(!file->isopen)
+    {
+        nn_fileobject_open(file);
+    }
+    if(file->handle == NULL)
+    {
+        nn_exceptions_throw(state, "csv: could not write to %s", file->path->sbuf->data);
+        return false;
+    }
+    nn_printer_makestackio(state, pr, file->handle, false);
+    nn_printer_setbuffer(pr, NEON_CONFIG_PRINTBUFSIZE, false);
+    return true;
+}
+
+/* write(file, rows, options) writes $rows to $file, and returns how many were written. */
+NNValue nn_modfn_csv_write(NNState* state, NNArguments* args)
+{
+    bool ok;
+    size_t count;
+    NNPrinter pr;
+    NNCSVOptions opts;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 2, 3);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isfile);
+    if(!nn_csv_getoptions(state, args, 2, &opts) || !nn_csv_openwriter(state, &pr, nn_value_asfile(args->args[0])))
+    {
+        return nn_value_makenull();
+    }
+    ok = nn_csv_writerecords(state, &pr, &opts, args->args[1], &count);
+    nn_printer_destroy(&pr);
+    if(!ok)
+    {
+        return nn_value_makenull();
+    }
+    return nn_value_makenumber(count);
+}
+
+/* writerow(file, row, options) writes a single record to $file. */
+NNValue nn_modfn_csv_writerow(NNState* state, NNArguments* args)
+{
+    bool ok;
+    NNPrinter pr;
+    NNCSVOptions opts;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 2, 3);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isfile);
+    if(!nn_csv_getoptions(state, args, 2, &opts) || !nn_csv_openwriter(state, &pr, nn_value_asfile(args->args[0])))
+    {
+        return nn_value_makenull();
+    }
+    ok = nn_csv_writerecord(state, &pr, &opts, args->args[1]);
+    nn_printer_destroy(&pr);
+    return nn_value_makebool(ok);
+}
+
+/* format(rows, options) returns $rows as a string. */
+NNValue nn_modfn_csv_format(NNState* state, NNArguments* args)
+{
+    size_t count;
+    NNPrinter pr;
+    NNCSVOptions opts;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    if(!nn_csv_getoptions(state, args, 1, &opts))
+    {
+        return nn_value_makenull();
+    }
+    nn_printer_makestackstring(state, &pr);
+    if(!nn_csv_writerecords(state, &pr, &opts, args->args[0], &count))
+    {
+        nn_printer_destroy(&pr);
+        return nn_value_makenull();
+    }
+    return nn_value_fromobject(nn_printer_takestring(&pr));
+}
+
+NNRegModule* nn_natmodule_load_csv(NNState* state)
+{
+    static NNRegFunc modfuncs[] =
+    {
+        {"reader",   true,  nn_modfn_csv_reader},
+        {"parse",    true,  nn_modfn_csv_parse},
+        {"write",    true,  nn_modfn_csv_write},
+        {"writerow", true,  nn_modfn_csv_writerow},
+        {"format",   true,  nn_modfn_csv_format},
+        {NULL,     false, NULL},
+    };
+    static NNRegField modfields[] =
+    {
+        {NULL,       false, NULL},
+    };
+    static NNRegModule module;
+    (void)state;
+    module.name = "csv";
+    module.fields = modfields;
+    module.functions = modfuncs;
+    module.classes = NULL;
+    module.preloader= NULL;
+    module.unloader = NULL;
+    return &module;
+}
+
+NNModInitFN g_builtinmodules[] =
+{
+    nn_natmodule_load_null,
+    nn_natmodule_load_os,
+    nn_natmodule_load_astscan,
+    nn_natmodule_load_csv,
+    NULL,
+};
+
+bool nn_import_loadnativemodule(NNState* state, NNModInitFN init_fn, char* importname, const char* source, void* dlw)
+{
+    int j;
+    int k;
+    NNValue v;
+    NNValue fieldname;
+    NNValue funcname;
+    NNValue funcrealvalue;
+    NNRegFunc func;
+    NNRegField field;
+    NNRegModule* module;
+    NNObjModule* themodule;
+    NNRegClass klassreg;
+    NNObjString* classname;
+    NNObjFuncNative* native;
+    NNObjClass* klass;
+    NNHashValTable* tabdest;
+    module = init_fn(state);
+    if(module != NULL)
+    {
+        themodule = (NNObjModule*)nn_gcmem_protect(state, (NNObject*)nn_module_make(state, (char*)module->name, source, false));
+        themodule->preloader = (void*)module->preloader;
+        themodule->unloader = (void*)module->unloader;
+        if(module->fields != NULL)
+        {
+            for(j = 0; module->fields[j].name != NULL; j++)
+            {
+                field = module->fields[j];
+                fieldname = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, field.name)));
+                v = field.fieldvalfn(state);
+                nn_vm_stackpush(state, v);
+                nn_tableval_set(themodule->deftable, fieldname, v);
+                nn_vm_stackpop(state);
+            }
+        }
+        if(module->functions != NULL)
+        {
+            for(j = 0; module->functions[j].name != NULL; j++)
+            {
+                func = module->functions[j];
+                funcname = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, func.name)));
+                funcrealvalue = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_object_makefuncnative(state, func.function, func.name, NULL)));
+                nn_vm_stackpush(state, funcrealvalue);
+                nn_tableval_set(themodule->deftable, funcname, funcrealvalue);
+                nn_vm_stackpop(state);
+            }
+        }
+        if(module->classes != NULL)
+        {
+            for(j = 0; module->classes[j].name != NULL; j++)
+            {
+                klassreg = module->classes[j];
+                classname = (NNObjString*)nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, klassreg.name));
+                klass = (NNObjClass*)nn_gcmem_protect(state, (NNObject*)nn_object_makeclass(state, classname, state->classprimobject));
+                if(klassreg.functions != NULL)
+                {
+                    for(k = 0; klassreg.functions[k].name != NULL; k++)
+                    {
+                        func = klassreg.functions[k];
+                        funcname = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, func.name)));
+                        native = (NNObjFuncNative*)nn_gcmem_protect(state, (NNObject*)nn_object_makefuncnative(state, func.function, func.name, NULL));
+                        if(func.isstatic)
+                        {
+                            native->type = NEON_FUNCTYPE_STATIC;
+                        }
+                        else if(strlen(func.name) > 0 && func.name[0] == '_')
+                        {
+                            native->type = NEON_FUNCTYPE_PRIVATE;
+                        }
+                        nn_tableval_set(klass->instmethods, funcname, nn_value_fromobject(native));
+                    }
+                }
+                if(klassreg.fields != NULL)
+                {
+                    for(k = 0; klassreg.fields[k].name != NULL; k++)
+                    {
+                        field = klassreg.fields[k];
+                        fieldname = nn_value_fromobject(nn_gcmem_protect(state, (NNObject*)nn_string_copycstr(state, field.name)));
+                        v = field.fieldvalfn(state);
+                        nn_vm_stackpush(state, v);
+                        tabdest = klass->instproperties;
+                        if(field.isstatic)
+                        {
+                            tabdest = klass->staticproperties;
+                        }
+                        nn_tableval_set(tabdest, fieldname, v);
+                        nn_vm_stackpop(state);
+                    }
+                }
+                nn_tableval_set(themodule->deftable, nn_value_fromobject(classname), nn_value_fromobject(klass));
+            }
+        }
+        if(dlw != NULL)
+        {
+            themodule->handle = dlw;
+        }
+        nn_import_addnativemodule(state, themodule, themodule->name->sbuf->data);
+        nn_gcmem_clearprotect(state);
+        return true;
+    }
+    else
+    {
+        nn_state_warn(state, "Error loading module: %s\n", importname);
+    }
+    return false;
+}
+
+void nn_import_addnativemodule(NNState* state, NNObjModule* module, const char* as)
+{
+    NNValue name;
+    if(as != NULL)
+    {
+        module->name = nn_string_copycstr(state, as);
+    }
+    name = nn_value_fromobject(nn_string_copyobjstr(state, module->name));
+    nn_vm_stackpush(state, name);
+    nn_vm_stackpush(state, nn_value_fromobject(module));
+    nn_tableval_set(state->openedmodules, name, nn_value_fromobject(module));
+    nn_vm_stackpopn(state, 2);
+}
+
+void nn_import_loadbuiltinmodules(NNState* state)
+{
+    int i;
+    for(i = 0; g_builtinmodules[i] != NULL; i++)
+    {
+        nn_import_loadnativemodule(state, g_builtinmodules[i], NULL, "<__native__>", NULL);
+    }
+}
+
+void nn_import_closemodule(void* hnd)
+{
+    (void)hnd;
+}
+
+bool nn_util_fsfileexists(NNState* state, const char* filepath)
+{
+    (void)state;
+    #if !defined(NEON_PLAT_ISWINDOWS)
+        return access(filepath, F_OK) == 0;
+    #else
+        struct stat sb;
+        if(stat(filepath, &sb) == -1)
+        {
+            return false;
+        }
+        return true;
+    #endif
+}
+
+bool nn_util_fsfileistype(NNState* state, const char* filepath, int typ)
+{
+    int tmp;
+    struct stat st;
+    (void)state;
+    (void)filepath;
+    if(stat(filepath, &st) == -1)
+    {
+        return false;
+    }
+    tmp = (st.st_mode & S_IFMT);
     return (tmp == typ);
 }
 
-bool nn_util_fsfileisfile(NNState* state, const char* filepath)
+bool nn_util_fsfileisfile(NNState* state, const char* filepath)
+{
+    return nn_util_fsfileistype(state, filepath, S_IFREG);
+}
+
+bool nn_util_fsfileisdirectory(NNState* state, const char* filepath)
+{
+    return nn_util_fsfileistype(state, filepath, S_IFDIR);
+}
+
+NNObjModule* nn_import_loadmodulescript(NNState* state, NNObjModule* intomodule, NNObjString* modulename)
+{
+    int argc;
+    size_t fsz;
+    char* source;
+    char* physpath;
+    NNBlob blob;
+    NNValue retv;
+    NNValue callable;
+    NNProperty* field;
+    NNObjArray* args;
+    NNObjString* os;
+    NNObjModule* module;
+    NNObjFuncClosure* closure;
+    NNObjFuncScript* function;
+    (void)os;
+    (void)argc;
+    (void)intomodule;
+    field = nn_tableval_getfieldbyostr(state->openedmodules, modulename);
+    if(field != NULL)
+    {
+        return nn_value_asmodule(field->value);
+    }
+    physpath = nn_import_resolvepath(state, modulename->sbuf->data, intomodule->physicalpath->sbuf->data, NULL, false);
+    if(physpath == NULL)
+    {
+        nn_exceptions_throw(state, "module not found: '%s'\n", modulename->sbuf->data);
+        return NULL;
+    }
+    fprintf(stderr, "loading module from '%s'\n", physpath);
+    source = nn_util_filereadfile(state, physpath, &fsz, false, 0);
+    if(source == NULL)
+    {
+        nn_exceptions_throw(state, "could not read import file %s", physpath);
+        return NULL;
+    }
+    nn_blob_init(state, &blob);
+    module = nn_module_make(state, modulename->sbuf->data, physpath, true);
+    nn_memory_free(physpath);
+    function = nn_astparser_compilesource(state, module, source, &blob, true, false);
+    nn_memory_free(source);
+    closure = nn_object_makefuncclosure(state, function);
+    callable = nn_value_fromobject(closure);
+    args = nn_object_makearray(state);
+    argc = nn_nestcall_prepare(state, callable, nn_value_makenull(), args);
+    if(!nn_nestcall_callfunction(state, callable, nn_value_makenull(), args, &retv))
+    {
+        /* the module threw, which is propagated already. */
+        nn_blob_destroy(&blob);
+        return NULL;
+    }
+    nn_blob_destroy(&blob);
+    return module;
+}
+
+char* nn_import_resolvepath(NNState* state, char* modulename, const char* currentfile, char* rootfile, bool isrelative)
+{
+    size_t i;
+    size_t mlen;
+    size_t splen;
+    char* path1;
+    char* path2;
+    char* retme;
+    const char* cstrpath;
+    struct stat stroot;
+    struct stat stmod;
+    NNObjString* pitem;
+    StringBuffer* pathbuf;
+    (void)rootfile;
+    (void)isrelative;
+    (void)stroot;
+    (void)stmod;
+    pathbuf = NULL;
+    mlen = strlen(modulename);
+    splen = state->importpath->listcount;
+    for(i=0; i<splen; i++)
+    {
+        pitem = nn_value_asstring(state->importpath->listitems[i]);
+        if(pathbuf == NULL)
+        {
+            pathbuf = dyn_strbuf_makebasicempty(pitem->sbuf->length + mlen + 5, false);
+        }
+        else
+        {
+            dyn_strbuf_reset(pathbuf);
+        }
+        dyn_strbuf_appendstrn(pathbuf, pitem->sbuf->data, pitem->sbuf->length);
+        if(dyn_strbuf_containschar(pathbuf, '@'))
+        {
+            dyn_strbuf_charreplace(pathbuf, '@', modulename, mlen);
+        }
+        else
+        {
+            dyn_strbuf_appendstr(pathbuf, "/");
+            dyn_strbuf_appendstr(pathbuf, modulename);
+            dyn_strbuf_appendstr(pathbuf, NEON_CONFIG_FILEEXT);
+        }
+        cstrpath = pathbuf->data; 
+        fprintf(stderr, "import: trying '%s' ... ", cstrpath);
+        if(nn_util_fsfileexists(state, cstrpath))
+        {
+            fprintf(stderr, "found!\n");
+            /* stop a core library from importing itself */
+            #if 0
+            if(stat(currentfile, &stroot) == -1)
+            {
+                fprintf(stderr, "resolvepath: failed to stat current file '%s'\n", currentfile);
+                return NULL;
+            }
+            if(stat(cstrpath, &stmod) == -1)
+            {
+                fprintf(stderr, "resolvepath: failed to stat module file '%s'\n", cstrpath);
+                return NULL;
+            }
+            if(stroot.st_ino == stmod.st_ino)
+            {
+                fprintf(stderr, "resolvepath: refusing to import itself\n");
+                return NULL;
+            }
+            #endif
+            #if 0
+                path1 = osfn_realpath(cstrpath, NULL);
+                path2 = osfn_realpath(currentfile, NULL);
+            #else
+                path1 = strdup(cstrpath);
+                path2 = strdup(currentfile);
+            #endif
+            
+            if(path1 != NULL && path2 != NULL)
+            {
+                if(memcmp(path1, path2, (int)strlen(path2)) == 0)
+                {
+                    nn_memory_free(path1);
+                    nn_memory_free(path2);
+                    fprintf(stderr, "resolvepath: refusing to import itself\n");
+                    return NULL;
+                }
+                nn_memory_free(path2);
+                dyn_strbuf_destroy(pathbuf);
+                pathbuf = NULL;
+                retme = nn_util_strdup(path1);
+                nn_memory_free(path1);
+                return retme;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "does not exist\n");
+        }
+    }
+    if(pathbuf != NULL)
+    {
+        dyn_strbuf_destroy(pathbuf);
+    }
+    return NULL;
+}
+
+char* nn_util_fsgetbasename(NNState* state, char* path)
+{
+    (void)state;
+    return osfn_basename(path);
+}
+
+
+NNValue nn_objfndict_length(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makenumber(nn_value_asdict(args->thisval)->count);
+}
+
+NNValue nn_objfndict_add(NNState* state, NNArguments* args)
+{
+    NNObjDict* dict;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 2);
+    dict = nn_value_asdict(args->thisval);
+    if(nn_dict_getentry(dict, args->args[0]) != NULL)
+    {
+        NEON_RETURNERROR("duplicate key %s at add()", nn_value_tostring(state, args->args[0])->sbuf->data);
+    }
+    nn_dict_addentry(dict, args->args[0], args->args[1]);
+    return nn_value_makenull();
+}
+
+NNValue nn_objfndict_set(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 2);
+    nn_dict_setentry(nn_value_asdict(args->thisval), args->args[0], args->args[1]);
+    return nn_value_makenull();
+}
+
+NNValue nn_objfndict_clear(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    nn_dict_clear(nn_value_asdict(args->thisval));
+    return nn_value_makenull();
+}
+
+NNValue nn_objfndict_clone(NNState* state, NNArguments* args)
+{
+    NNObjDict* newdict;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    newdict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_dict_copy(nn_value_asdict(args->thisval)));
+    return nn_value_fromobject(newdict);
+}
+
+#if NEON_CONFIG_BENCHSTATS == 1
+/*
+* describes how well the keys of the dictionary are spread over its index (not over a NNHashValTable):
+* the number of slots, and the average and longest probe sequence of a lookup.
+*/
+NNValue nn_objfndict_probestats(NNState* state, NNArguments* args)
+{
+    size_t i;
+    size_t length;
+    size_t total;
+    size_t longest;
+    NNObjDict* dict;
+    NNObjDict* stats;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    dict = nn_value_asdict(args->thisval);
+    total = 0;
+    longest = 0;
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(dict->entries[i].live)
+        {
+            length = nn_dict_probelength(dict, i);
+            total += length;
+            if(length > longest)
+            {
+                longest = length;
+            }
+        }
+    }
+    stats = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    nn_dict_addentrycstr(stats, "count", nn_value_makenumber(dict->count));
+    nn_dict_addentrycstr(stats, "slots", nn_value_makenumber(dict->indexcapacity));
+    nn_dict_addentrycstr(stats, "average", nn_value_makenumber((dict->count > 0) ? ((double)total / dict->count) : 0));
+    nn_dict_addentrycstr(stats, "max", nn_value_makenumber(longest));
+    return nn_value_fromobject(stats);
+}
+#endif
+
+NNValue nn_objfndict_compact(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjDict* dict;
+    NNObjDict* newdict;
+    NNDictEntry* entry;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    dict = nn_value_asdict(args->thisval);
+    newdict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        entry = &dict->entries[i];
+        if(entry->live && !nn_value_compare(state, entry->value.value, nn_value_makenull()))
+        {
+            nn_dict_addentry(newdict, entry->key, entry->value.value);
+        }
+    }
+    return nn_value_fromobject(newdict);
+}
+
+NNValue nn_objfndict_contains(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    return nn_value_makebool(nn_dict_getentry(nn_value_asdict(args->thisval), args->args[0]) != NULL);
+}
+
+NNValue nn_objfndict_extend(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjDict* dict;
+    NNObjDict* dictcpy;
+    NNDictEntry* entry;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isdict);
+    dict = nn_value_asdict(args->thisval);
+    dictcpy = nn_value_asdict(args->args[0]);
+    for(i = 0; i < dictcpy->entrycount; i++)
+    {
+        entry = &dictcpy->entries[i];
+        if(entry->live)
+        {
+            nn_dict_setentrywithtype(dict, entry->key, entry->value.value, entry->value.type);
+        }
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfndict_get(NNState* state, NNArguments* args)
+{
+    NNObjDict* dict;
+    NNProperty* field;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    dict = nn_value_asdict(args->thisval);
+    field = nn_dict_getentry(dict, args->args[0]);
+    if(field == NULL)
+    {
+        if(args->count == 1)
+        {
+            return nn_value_makenull();
+        }
+        else
+        {
+            return args->args[1];
+        }
+    }
+    return field->value;
+}
+
+NNValue nn_objfndict_keys(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjDict* dict;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    dict = nn_value_asdict(args->thisval);
+    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(dict->entries[i].live)
+        {
+            nn_array_push(list, dict->entries[i].key);
+        }
+    }
+    return nn_value_fromobject(list);
+}
+
+NNValue nn_objfndict_values(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjDict* dict;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    dict = nn_value_asdict(args->thisval);
+    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(dict->entries[i].live)
+        {
+            nn_array_push(list, dict->entries[i].value.value);
+        }
+    }
+    return nn_value_fromobject(list);
+}
+
+NNValue nn_objfndict_remove(NNState* state, NNArguments* args)
+{
+    NNValue value;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    if(nn_dict_removeentry(nn_value_asdict(args->thisval), args->args[0], &value))
+    {
+        return value;
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfndict_isempty(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makebool(nn_value_asdict(args->thisval)->count == 0);
+}
+
+NNValue nn_objfndict_findkey(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    return nn_dict_findkey(nn_value_asdict(args->thisval), args->args[0]);
+}
+
+NNValue nn_objfndict_tolist(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjArray* list;
+    NNObjDict* dict;
+    NNObjArray* namelist;
+    NNObjArray* valuelist;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    dict = nn_value_asdict(args->thisval);
+    namelist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    valuelist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(dict->entries[i].live)
+        {
+            nn_array_push(namelist, dict->entries[i].key);
+            nn_array_push(valuelist, dict->entries[i].value.value);
+        }
+    }
+    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    nn_array_push(list, nn_value_fromobject(namelist));
+    nn_array_push(list, nn_value_fromobject(valuelist));
+    return nn_value_fromobject(list);
+}
+
+NNValue nn_objfndict_iter(NNState* state, NNArguments* args)
+{
+    NNValue result;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check,  args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    if(nn_dict_get(nn_value_asdict(args->thisval), args->args[0], &result))
+    {
+        return result;
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfndict_itern(NNState* state, NNArguments* args)
+{
+    int64_t ix;
+    NNObjDict* dict;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    dict = nn_value_asdict(args->thisval);
+    if(nn_value_isnull(args->args[0]))
+    {
+        if(dict->count == 0)
+        {
+            return nn_value_makebool(false);
+        }
+        return dict->entries[nn_dict_nextentry(dict, 0)].key;
+    }
+    /* the previous key leads straight to its entry, so iterating does not rescan the dictionary. */
+    ix = nn_dict_findentry(dict, args->args[0], nn_value_hashvalue(args->args[0]), NULL);
+    if(ix >= 0)
+    {
+        ix = nn_dict_nextentry(dict, ix + 1);
+        if(ix >= 0)
+        {
+            return dict->entries[ix].key;
+        }
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfndict_each(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int arity;
+    NNValue callable;
+    NNValue unused;
+    NNObjDict* dict;
+    NNObjArray* nestargs;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    dict = nn_value_asdict(args->thisval);
+    callable = args->args[0];
+    nestargs = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    /* the callback may modify the dictionary, so entries are re-read on every step. */
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(!dict->entries[i].live)
+        {
+            continue;
+        }
+        if(arity > 0)
+        {
+            nestargs->varray->listitems[0] = dict->entries[i].value.value;
+            if(arity > 1)
+            {
+                nestargs->varray->listitems[1] = dict->entries[i].key;
+            }
+        }
+        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &unused);
+    }
+    /* pop the argument list */
+    nn_vm_stackpop(state);
+    return nn_value_makenull();
+}
+
+NNValue nn_objfndict_filter(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int arity;
+    NNValue key;
+    NNValue value;
+    NNValue callable;
+    NNValue result;
+    NNObjDict* dict;
+    NNObjArray* nestargs;
+    NNObjDict* resultdict;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    dict = nn_value_asdict(args->thisval);
+    callable = args->args[0];
+    nestargs = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    resultdict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(!dict->entries[i].live)
+        {
+            continue;
+        }
+        key = dict->entries[i].key;
+        value = dict->entries[i].value.value;
+        if(arity > 0)
+        {
+            nestargs->varray->listitems[0] = value;
+            if(arity > 1)
+            {
+                nestargs->varray->listitems[1] = key;
+            }
+        }
+        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
+        if(!nn_value_isfalse(result))
+        {
+            nn_dict_addentry(resultdict, key, value);
+        }
+    }
+    /* pop the call list */
+    nn_vm_stackpop(state);
+    return nn_value_fromobject(resultdict);
+}
+
+NNValue nn_objfndict_some(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int arity;
+    NNValue result;
+    NNValue callable;
+    NNObjDict* dict;
+    NNObjArray* nestargs;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    dict = nn_value_asdict(args->thisval);
+    callable = args->args[0];
+    nestargs = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(!dict->entries[i].live)
+        {
+            continue;
+        }
+        if(arity > 0)
+        {
+            nestargs->varray->listitems[0] = dict->entries[i].value.value;
+            if(arity > 1)
+            {
+                nestargs->varray->listitems[1] = dict->entries[i].key;
+            }
+        }
+        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
+        if(!nn_value_isfalse(result))
+        {
+            /* pop the call list */
+            nn_vm_stackpop(state);
+            return nn_value_makebool(true);
+        }
+    }
+    /* pop the call list */
+    nn_vm_stackpop(state);
+    return nn_value_makebool(false);
+}
+
+NNValue nn_objfndict_every(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int arity;
+    NNValue callable;  
+    NNValue result;
+    NNObjDict* dict;
+    NNObjArray* nestargs;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    dict = nn_value_asdict(args->thisval);
+    callable = args->args[0];
+    nestargs = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(!dict->entries[i].live)
+        {
+            continue;
+        }
+        if(arity > 0)
+        {
+            nestargs->varray->listitems[0] = dict->entries[i].value.value;
+            if(arity > 1)
+            {
+                nestargs->varray->listitems[1] = dict->entries[i].key;
+            }
+        }
+        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
+        if(nn_value_isfalse(result))
+        {
+            /* pop the call list */
+            nn_vm_stackpop(state);
+            return nn_value_makebool(false);
+        }
+    }
+    /* pop the call list */
+    nn_vm_stackpop(state);
+    return nn_value_makebool(true);
+}
+
+NNValue nn_objfndict_reduce(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int arity;
+    int64_t startindex;
+    NNValue callable;
+    NNValue accumulator;
+    NNObjDict* dict;
+    NNObjArray* nestargs;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    dict = nn_value_asdict(args->thisval);
+    callable = args->args[0];
+    startindex = 0;
+    accumulator = nn_value_makenull();
+    if(args->count == 2)
+    {
+        accumulator = args->args[1];
+    }
+    if(nn_value_isnull(accumulator) && dict->count > 0)
+    {
+        startindex = nn_dict_nextentry(dict, 0);
+        accumulator = dict->entries[startindex].value.value;
+        startindex++;
+    }
+    nestargs = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    for(i = startindex; i < dict->entrycount; i++)
+    {
+        /* only call map for non-empty values in a list. */
+        if(dict->entries[i].live && !nn_value_isnull(dict->entries[i].key))
+        {
+            if(arity > 0)
+            {
+                nestargs->varray->listitems[0] = accumulator;
+                if(arity > 1)
+                {
+                    nestargs->varray->listitems[1] = dict->entries[i].value.value;
+                    if(arity > 2)
+                    {
+                        nestargs->varray->listitems[2] = dict->entries[i].key;
+                        if(arity > 4)
+                        {
+                            nestargs->varray->listitems[3] = args->thisval;
+                        }
+                    }
+                }
+            }
+            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &accumulator);
+        }
+    }
+    /* pop the call list */
+    nn_vm_stackpop(state);
+    return accumulator;
+}
+
+
+
+#define FILE_ERROR(type, message) \
+    NEON_RETURNERROR(#type " -> %s", message, file->path->sbuf->data);
+
+#define RETURN_STATUS(status) \
+    if((status) == 0) \
+    { \
+        return nn_value_makebool(true); \
+    } \
+    else \
+    { \
+        FILE_ERROR(File, strerror(errno)); \
+    }
+
+#define DENY_STD() \
+    if(file->isstd) \
+    NEON_RETURNERROR("method not supported for std files");
+
+int nn_fileobject_close(NNObjFile* file)
+{
+    int result;
+    if(file->handle != NULL && !file->isstd)
+    {
+        fflush(file->handle);
+        result = fclose(file->handle);
+        file->handle = NULL;
+        file->isopen = false;
+        file->number = -1;
+        file->istty = false;
+        return result;
+    }
+    return -1;
+}
+
+bool nn_fileobject_open(NNObjFile* file)
+{
+    if(file->handle != NULL)
+    {
+        return true;
+    }
+    if(file->handle == NULL && !file->isstd && !file->ispipe)
+    {
+        file->handle = fopen(file->path->sbuf->data, file->mode->sbuf->data);
+        if(file->handle != NULL)
+        {
+            /* a larger buffer than stdio's default means fewer read()s when reading line by line. */
+            setvbuf(file->handle, NULL, _IOFBF, NEON_CONFIG_FILEBUFSIZE);
+            file->isopen = true;
+            file->number = fileno(file->handle);
+            file->istty = osfn_isatty(file->number);
+            return true;
+        }
+        else
+        {
+            file->number = -1;
+            file->istty = false;
+        }
+        return false;
+    }
+    return false;
+}
+
+NNValue nn_objfnfile_constructor(NNState* state, NNArguments* args)
+{
+    FILE* hnd;
+    const char* path;
+    const char* mode;
+    NNObjString* opath;
+    NNObjFile* file;
+    (void)hnd;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    opath = nn_value_asstring(args->args[0]);
+    if(opath->sbuf->length == 0)
+    {
+        NEON_RETURNERROR("file path cannot be empty");
+    }
+    mode = "r";
+    if(args->count == 2)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isstring);
+        mode = nn_value_asstring(args->args[1])->sbuf->data;
+    }
+    path = opath->sbuf->data;
+    file = (NNObjFile*)nn_gcmem_protect(state, (NNObject*)nn_object_makefile(state, NULL, false, path, mode));
+    nn_fileobject_open(file);
+    return nn_value_fromobject(file);
+}
+
+NNValue nn_objfnfile_exists(NNState* state, NNArguments* args)
+{
+    NNObjString* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    file = nn_value_asstring(args->args[0]);
+    return nn_value_makebool(nn_util_fsfileexists(state, file->sbuf->data));
+}
+
+NNValue nn_objfnfile_isfile(NNState* state, NNArguments* args)
+{
+    NNObjString* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    file = nn_value_asstring(args->args[0]);
+    return nn_value_makebool(nn_util_fsfileisfile(state, file->sbuf->data));
+}
+
+NNValue nn_objfnfile_isdirectory(NNState* state, NNArguments* args)
+{
+    NNObjString* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    file = nn_value_asstring(args->args[0]);
+    return nn_value_makebool(nn_util_fsfileisdirectory(state, file->sbuf->data));
+}
+
+
+NNValue nn_objfnfile_readstatic(NNState* state, NNArguments* args)
+{
+    char* buf;
+    size_t thismuch;
+    size_t actualsz;
+    NNObjString* filepath;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    thismuch = -1;
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    if(args->count > 1)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+        thismuch = (size_t)nn_value_asnumber(args->args[1]);
+    }
+    filepath = nn_value_asstring(args->args[0]);
+    buf = nn_util_filereadfile(state, filepath->sbuf->data, &actualsz, true, thismuch);
+    if(buf == NULL)
+    {
+        return nn_exceptions_throwclass(state, state->exceptions.ioerror, "%s: %s", filepath->sbuf->data, strerror(errno));
+    }
+    return nn_value_fromobject(nn_string_takelen(state, buf, actualsz));
+}
+
+
+NNValue nn_objfnfile_writestatic(NNState* state, NNArguments* args)
+{
+    bool appending;
+    size_t rt;
+    FILE* fh;
+    const char* mode;
+    NNObjString* filepath;
+    NNObjString* data;
+    NNArgCheck check;
+    appending = false;
+    mode = "wb";
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isstring);
+    if(args->count > 2)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 2, nn_value_isbool);
+        appending = nn_value_asbool(args->args[2]);
+    }
+    if(appending)
+    {
+        mode = "ab";
+    }
+    filepath = nn_value_asstring(args->args[0]);
+    data = nn_value_asstring(args->args[1]);
+    fh = fopen(filepath->sbuf->data, mode);
+    if(fh == NULL)
+    {
+        return nn_exceptions_throwclass(state, state->exceptions.ioerror, strerror(errno));
+    }
+    rt = fwrite(data->sbuf->data, sizeof(char), data->sbuf->length, fh);
+    fclose(fh);
+    return nn_value_makenumber(rt);
+}
+
+
+NNValue nn_objfnfile_statstatic(NNState* state, NNArguments* args)
+{
+    NNObjString* file;
+    NNArgCheck check;
+    NNObjDict* dict;
+    struct stat st;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    dict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    file = nn_value_asstring(args->args[0]);
+    if(osfn_lstat(file->sbuf->data, &st) == 0)
+    {
+        nn_util_statfilldictphysfile(dict, &st);
+        return nn_value_fromobject(dict);
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnfile_close(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    nn_fileobject_close(nn_value_asfile(args->thisval));
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnfile_open(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    nn_fileobject_open(nn_value_asfile(args->thisval));
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnfile_isopen(NNState* state, NNArguments* args)
+{
+    NNObjFile* file;
+    (void)state;
+    file = nn_value_asfile(args->thisval);
+    return nn_value_makebool(file->isstd || file->isopen);
+}
+
+NNValue nn_objfnfile_isclosed(NNState* state, NNArguments* args)
+{
+    NNObjFile* file;
+    (void)state;
+    file = nn_value_asfile(args->thisval);
+    return nn_value_makebool(!file->isstd && !file->isopen);
+}
+
+/*
+* file.read(bytes [, count]): reads up to count (by default, bytes.length) bytes directly into
+* a Bytes (or any typed array), and returns how many bytes were read; 0 at the end of the file.
+*/
+NNValue nn_file_readintobytes(NNState* state, NNArguments* args)
+{
+    size_t count;
+    size_t capacity;
+    NNObjFile* file;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    file = nn_value_asfile(args->thisval);
+    ta = nn_value_astypedarray(args->args[0]);
+    capacity = ta->length * nn_typedarray_elemsize(ta->kind);
+    count = capacity;
+    if(args->count == 2)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+        if(nn_value_asnumber(args->args[1]) < 0)
+        {
+            FILE_ERROR(Read, "negative read count");
+        }
+        count = (size_t)nn_value_asnumber(args->args[1]);
+        if(count > capacity)
+        {
+            count = capacity;
+        }
+    }
+    if(!file->isstd && !file->isopen)
+    {
+        nn_fileobject_open(file);
+    }
+    if(file->handle == NULL)
+    {
+        FILE_ERROR(Read, "could not read from file");
+    }
+    return nn_value_makenumber(fread(ta->data, sizeof(uint8_t), count, file->handle));
+}
+
+NNValue nn_objfnfile_readmethod(NNState* state, NNArguments* args)
+{
+    size_t readhowmuch;
+    NNIOResult res;
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 2);
+    if((args->count > 0) && nn_value_istypedarray(args->args[0]))
+    {
+        return nn_file_readintobytes(state, args);
+    }
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    readhowmuch = -1;
+    if(args->count == 1)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+        readhowmuch = (size_t)nn_value_asnumber(args->args[0]);
+    }
+    file = nn_value_asfile(args->thisval);
+    if(!nn_file_read(file, readhowmuch, &res))
+    {
+        FILE_ERROR(NotFound, strerror(errno));
+    }
+    return nn_value_fromobject(nn_string_takebuffer(state, res.data, res.length, res.length + 1));
+}
+
+
+/*
+* mmap() returns the content of the file as Bytes that are backed by a private mapping of the
+* file, so that reading even large files takes no time up front, and is served from the page
+* cache. writes to the Bytes only change the process' copy of the pages, never the file.
+* the mapping lasts until the Bytes, and any views of it, are collected.
+* without mmap, the file is read into regular Bytes.
+*/
+NNValue nn_objfnfile_mmap(NNState* state, NNArguments* args)
+{
+    size_t size;
+    void* map;
+    struct stat stats;
+    NNObjFile* file;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    file = nn_value_asfile(args->thisval);
+    if(file->isstd)
+    {
+        FILE_ERROR(Unsupported, "cannot map a standard stream");
+    }
+    if(!file->isopen)
+    {
+        nn_fileobject_open(file);
+    }
+    if(file->handle == NULL)
+    {
+        FILE_ERROR(NotFound, strerror(errno));
+    }
+    if(fstat(fileno(file->handle), &stats) != 0)
+    {
+        FILE_ERROR(Read, strerror(errno));
+    }
+    size = (size_t)stats.st_size;
+    map = NULL;
+    #if defined(NEON_PLAT_HAVEMMAP)
+        if(size > 0)
+        {
+            map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file->handle), 0);
+            if(map == MAP_FAILED)
+            {
+                FILE_ERROR(Read, strerror(errno));
+            }
+            #if defined(MADV_SEQUENTIAL)
+                madvise(map, size, MADV_SEQUENTIAL);
+            #endif
+        }
+    #endif
+    if(map == NULL)
+    {
+        ta = (NNObjTypedArray*)nn_gcmem_protect(state, (NNObject*)nn_object_maketypedarray(state, NEON_TYPEDARRAY_BYTES, size));
+        rewind(file->handle);
+        ta->length = fread(ta->data, sizeof(uint8_t), size, file->handle);
+        return nn_value_fromobject(ta);
+    }
+    ta = (NNObjTypedArray*)nn_object_allocobject(state, sizeof(NNObjTypedArray), NEON_OBJTYPE_TYPEDARRAY);
+    ta->kind = NEON_TYPEDARRAY_BYTES;
+    ta->length = size;
+    ta->parent = NULL;
+    ta->data = (uint8_t*)map;
+    ta->mapsize = size;
+    return nn_value_fromobject(ta);
+}
+
+/* opens $file if needed, and flushes whatever is buffered for it, so its descriptor can be used directly. */
+bool nn_file_prepareraw(NNState* state, NNObjFile* file)
+{
+    if(file->isstd)
+    {
+        nn_printer_flush(state->stdoutprinter);
+    }
+    else if(!file->isopen)
+    {
+        nn_fileobject_open(file);
+    }
+    if(file->handle == NULL)
+    {
+        return false;
+    }
+    fflush(file->handle);
+    return true;
+}
+
+/*
+* copies the rest of $src, from its current position, to $outfd, and moves $src past the copied data.
+* sources that cannot seek, such as pipes, may have data waiting in stdio's buffer already,
+* so they are copied through stdio instead.
+*/
+int64_t nn_file_copyout(NNObjFile* src, int outfd)
+{
+    long pos;
+    int64_t rt;
+    int64_t total;
+    int64_t done;
+    int64_t wr;
+    char* buf;
+    pos = ftell(src->handle);
+    if(pos >= 0)
+    {
+        total = nn_util_copyfd(fileno(src->handle), pos, outfd);
+        if(total >= 0)
+        {
+            fseek(src->handle, pos + total, SEEK_SET);
+        }
+        return total;
+    }
+    total = 0;
+    buf = (char*)nn_memory_malloc(NEON_CONFIG_FILEBUFSIZE);
+    while((rt = fread(buf, sizeof(char), NEON_CONFIG_FILEBUFSIZE, src->handle)) > 0)
+    {
+        done = 0;
+        while(done < rt)
+        {
+            wr = write(outfd, buf + done, rt - done);
+            if(wr < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+                nn_memory_free(buf);
+                return -1;
+            }
+            done += wr;
+        }
+        total += rt;
+    }
+    nn_memory_free(buf);
+    return total;
+}
+
+/* opens $path for writing, creating or truncating it, for the copy functions. */
+int nn_file_opencopydest(const char* path, int mode)
+{
+    int flags;
+    flags = O_WRONLY | O_CREAT | O_TRUNC;
+    #if defined(O_BINARY)
+        flags |= O_BINARY;
+    #endif
+    return open(path, flags, mode);
+}
+
+/*
+* copyTo(dest) copies the rest of this file to $dest, a File or a path (which is created or
+* truncated), and returns the number of bytes copied. the data does not pass through the heap.
+*/
+NNValue nn_objfnfile_copyto(NNState* state, NNArguments* args)
+{
+    int outfd;
+    int64_t copied;
+    NNObjFile* file;
+    NNObjFile* dest;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    file = nn_value_asfile(args->thisval);
+    if(!nn_file_prepareraw(state, file))
+    {
+        FILE_ERROR(NotFound, strerror(errno));
+    }
+    if(nn_value_isfile(args->args[0]))
+    {
+        dest = nn_value_asfile(args->args[0]);
+        if(!nn_file_prepareraw(state, dest))
+        {
+            return nn_exceptions_throw(state, "File.copyTo: cannot open %s: %s", dest->path->sbuf->data, strerror(errno));
+        }
+        copied = nn_file_copyout(file, fileno(dest->handle));
+        /* stdio must learn about the new position */
+        fseek(dest->handle, 0, SEEK_CUR);
+    }
+    else
+    {
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+        outfd = nn_file_opencopydest(nn_value_asstring(args->args[0])->sbuf->data, 0666);
+        if(outfd < 0)
+        {
+            return nn_exceptions_throw(state, "File.copyTo: cannot open %s: %s", nn_value_asstring(args->args[0])->sbuf->data, strerror(errno));
+        }
+        copied = nn_file_copyout(file, outfd);
+        close(outfd);
+    }
+    if(copied < 0)
+    {
+        FILE_ERROR(Write, strerror(errno));
+    }
+    return nn_value_makenumber(copied);
+}
+
+/*
+* appendFrom(source) copies $source, a File (from its current position) or a path, to the
+* current position of this file, and returns the number of bytes copied.
+*/
+NNValue nn_objfnfile_appendfrom(NNState* state, NNArguments* args)
+{
+    int infd;
+    int64_t copied;
+    NNObjFile* file;
+    NNObjFile* src;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    file = nn_value_asfile(args->thisval);
+    if(!nn_file_prepareraw(state, file))
+    {
+        FILE_ERROR(NotFound, strerror(errno));
+    }
+    if(nn_value_isfile(args->args[0]))
+    {
+        src = nn_value_asfile(args->args[0]);
+        if(!nn_file_prepareraw(state, src))
+        {
+            return nn_exceptions_throw(state, "File.appendFrom: cannot open %s: %s", src->path->sbuf->data, strerror(errno));
+        }
+        copied = nn_file_copyout(src, fileno(file->handle));
+    }
+    else
+    {
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+        infd = open(nn_value_asstring(args->args[0])->sbuf->data, O_RDONLY);
+        if(infd < 0)
+        {
+            return nn_exceptions_throw(state, "File.appendFrom: cannot open %s: %s", nn_value_asstring(args->args[0])->sbuf->data, strerror(errno));
+        }
+        copied = nn_util_copyfd(infd, 0, fileno(file->handle));
+        close(infd);
+    }
+    fseek(file->handle, 0, SEEK_CUR);
+    if(copied < 0)
+    {
+        FILE_ERROR(Write, strerror(errno));
+    }
+    return nn_value_makenumber(copied);
+}
+
+/*
+* writeAll(array) writes all strings (and typed arrays) in $array, in order, with as few
+* system calls as possible, and returns the number of bytes written.
+*/
+NNValue nn_objfnfile_writeall(NNState* state, NNArguments* args)
+{
+    size_t i;
+    size_t total;
+    size_t count;
+    NNValue item;
+    NNObjFile* file;
+    NNValArray* list;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isarray);
+    file = nn_value_asfile(args->thisval);
+    list = nn_value_asarray(args->args[0])->varray;
+    count = list->listcount;
+    for(i = 0; i < count; i++)
+    {
+        if(!nn_value_isstring(list->listitems[i]) && !nn_value_istypedarray(list->listitems[i]))
+        {
+            return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "writeAll() expects an array of strings, but element %ld is a %s", (long)i, nn_value_typename(list->listitems[i]));
+        }
+    }
+    if(!file->isstd && (strchr(file->mode->sbuf->data, 'r') != NULL) && (strchr(file->mode->sbuf->data, '+') == NULL))
+    {
+        FILE_ERROR(Unsupported, "cannot write into non-writable file");
+    }
+    if(!nn_file_prepareraw(state, file))
+    {
+        FILE_ERROR(Write, strerror(errno));
+    }
+    total = 0;
+    #if defined(NEON_PLAT_HAVEWRITEV)
+    {
+        bool ok;
+        struct iovec* iov;
+        iov = (struct iovec*)nn_memory_malloc(sizeof(struct iovec) * (count + 1));
+        for(i = 0; i < count; i++)
+        {
+            item = list->listitems[i];
+            if(nn_value_isstring(item))
+            {
+                iov[i].iov_base = nn_value_asstring(item)->sbuf->data;
+                iov[i].iov_len = nn_value_asstring(item)->sbuf->length;
+            }
+            else
+            {
+                ta = nn_value_astypedarray(item);
+                iov[i].iov_base = ta->data;
+                iov[i].iov_len = ta->length * nn_typedarray_elemsize(ta->kind);
+            }
+            total += iov[i].iov_len;
+        }
+        ok = nn_util_writevall(fileno(file->handle), iov, count);
+        nn_memory_free(iov);
+        fseek(file->handle, 0, SEEK_CUR);
+        if(!ok)
+        {
+            FILE_ERROR(Write, strerror(errno));
+        }
+    }
+    #else
+    {
+        for(i = 0; i < count; i++)
+        {
+            item = list->listitems[i];
+            if(nn_value_isstring(item))
+            {
+                total += fwrite(nn_value_asstring(item)->sbuf->data, sizeof(char), nn_value_asstring(item)->sbuf->length, file->handle);
+            }
+            else
+            {
+                ta = nn_value_astypedarray(item);
+                total += fwrite(ta->data, nn_typedarray_elemsize(ta->kind), ta->length, file->handle) * nn_typedarray_elemsize(ta->kind);
+            }
+        }
+        fflush(file->handle);
+    }
+    #endif
+    return nn_value_makenumber(total);
+}
+
+NNValue nn_objfnfile_readline(NNState* state, NNArguments* args)
+{
+    bool chomp;
+    size_t len;
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    chomp = true;
+    if(args->count == 1)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isbool);
+        chomp = nn_value_asbool(args->args[0]);
+    }
+    file = nn_value_asfile(args->thisval);
+    if(!nn_file_readline(state, file, chomp, &len))
+    {
+        return nn_value_makenull();
+    }
+    return nn_value_fromobject(nn_string_copylen(state, file->linebuf, len));
+}
+
+/*
+* lines(), lines(batchsize) and lines(batchsize, chomp) return an Iterator over the lines of
+* the file. with a batchsize other than 0, each element is an array of up to that many lines,
+* which saves a trip through the vm for every single line.
+*/
+NNValue nn_objfnfile_lines(NNState* state, NNArguments* args)
+{
+    NNObjIterator* iter;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 2);
+    iter = (NNObjIterator*)nn_gcmem_protect(state, (NNObject*)nn_object_makeiterator(state, NEON_ITERKIND_FILE, args->thisval));
+    if(args->count > 0)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+        if(nn_value_asnumber(args->args[0]) < 0)
+        {
+            return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "lines() expects a batch size of at least 0");
+        }
+        iter->limit = (int64_t)nn_value_asnumber(args->args[0]);
+    }
+    if(args->count > 1)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isbool);
+        iter->chomp = nn_value_asbool(args->args[1]);
+    }
+    return nn_value_fromobject(iter);
+}
+
+NNValue nn_objfnfile_iter(NNState* state, NNArguments* args)
+{
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    file = nn_value_asfile(args->thisval);
+    if(file->iterline == NULL)
+    {
+        return nn_value_makenull();
+    }
+    return nn_value_fromobject(file->iterline);
+}
+
+/* foreach(line in file) reads the file line by line, without line terminators; the keys are line numbers. */
+NNValue nn_objfnfile_itern(NNState* state, NNArguments* args)
+{
+    size_t len;
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    file = nn_value_asfile(args->thisval);
+    if(!nn_file_readline(state, file, true, &len))
+    {
+        file->iterline = NULL;
+        return nn_value_makebool(false);
+    }
+    file->iterline = nn_string_copylen(state, file->linebuf, len);
+    if(nn_value_isnull(args->args[0]))
+    {
+        return nn_value_makenumber(0);
+    }
+    return nn_value_makenumber(nn_value_asnumber(args->args[0]) + 1);
+}
+
+NNValue nn_objfnfile_get(NNState* state, NNArguments* args)
+{
+    int ch;
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    file = nn_value_asfile(args->thisval);
+    ch = fgetc(file->handle);
+    if(ch == EOF)
+    {
+        return nn_value_makenull();
+    }
+    return nn_value_makenumber(ch);
+}
+
+NNValue nn_objfnfile_gets(NNState* state, NNArguments* args)
+{
+    long end;
+    long length;
+    long currentpos;
+    size_t bytesread;
+    char* buffer;
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    length = -1;
+    if(args->count == 1)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+        length = (size_t)nn_value_asnumber(args->args[0]);
+    }
+    file = nn_value_asfile(args->thisval);
+    if(!file->isstd)
+    {
+        if(!nn_util_fsfileexists(state, file->path->sbuf->data))
+        {
+            FILE_ERROR(NotFound, "no such file or directory");
+        }
+        else if(strstr(file->mode->sbuf->data, "w") != NULL && strstr(file->mode->sbuf->data, "+") == NULL)
+        {
+            FILE_ERROR(Unsupported, "cannot read file in write mode");
+        }
+        if(!file->isopen)
+        {
+            FILE_ERROR(Read, "file not open");
+        }
+        else if(file->handle == NULL)
+        {
+            FILE_ERROR(Read, "could not read file");
+        }
+        if(length == -1)
+        {
+            currentpos = ftell(file->handle);
+            fseek(file->handle, 0L, SEEK_END);
+            end = ftell(file->handle);
+            fseek(file->handle, currentpos, SEEK_SET);
+            length = end - currentpos;
+        }
+    }
+    else
+    {
+        if(fileno(stdout) == file->number || fileno(stderr) == file->number)
+        {
+            FILE_ERROR(Unsupported, "cannot read from output file");
+        }
+        nn_printer_flush(state->stdoutprinter);
+        /*
+        // for non-file objects such as stdin
+        // minimum read bytes should be 1
+        */
+        if(length == -1)
+        {
+            length = 1;
+        }
+    }
+    buffer = (char*)nn_memory_malloc(sizeof(char) * (length + 1));
+    if(buffer == NULL && length != 0)
+    {
+        FILE_ERROR(Buffer, "not enough memory to read file");
+    }
+    bytesread = fread(buffer, sizeof(char), length, file->handle);
+    if(bytesread == 0 && length != 0)
+    {
+        FILE_ERROR(Read, "could not read file contents");
+    }
+    if(buffer != NULL)
+    {
+        buffer[bytesread] = '\0';
+    }
+    return nn_value_fromobject(nn_string_takelen(state, buffer, bytesread));
+}
+
+NNValue nn_objfnfile_write(NNState* state, NNArguments* args)
+{
+    size_t count;
+    int length;
+    unsigned char* data;
+    NNObjFile* file;
+    NNObjString* string;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    file = nn_value_asfile(args->thisval);
+    /* typed arrays (such as Bytes) are written as they are in memory. */
+    if(nn_value_istypedarray(args->args[0]))
+    {
+        data = nn_value_astypedarray(args->args[0])->data;
+        length = nn_value_astypedarray(args->args[0])->length * nn_typedarray_elemsize(nn_value_astypedarray(args->args[0])->kind);
+    }
+    else
+    {
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+        string = nn_value_asstring(args->args[0]);
+        data = (unsigned char*)string->sbuf->data;
+        length = string->sbuf->length;
+    }
+    if(!file->isstd)
+    {
+        if(strstr(file->mode->sbuf->data, "r") != NULL && strstr(file->mode->sbuf->data, "+") == NULL)
+        {
+            FILE_ERROR(Unsupported, "cannot write into non-writable file");
+        }
+        else if(length == 0)
+        {
+            FILE_ERROR(Write, "cannot write empty buffer to file");
+        }
+        else if(file->handle == NULL || !file->isopen)
+        {
+            nn_fileobject_open(file);
+        }
+        /* reopening fails for pipes, for files that cannot be created, or are gone. */
+        if(file->handle == NULL)
+        {
+            FILE_ERROR(Write, "could not write to file");
+        }
+    }
+    else
+    {
+        if(fileno(stdin) == file->number)
+        {
+            FILE_ERROR(Unsupported, "cannot write to input file");
+        }
+    }
+    if(file->isstd)
+    {
+        nn_printer_flush(state->stdoutprinter);
+    }
+    count = fwrite(data, sizeof(unsigned char), length, file->handle);
+    fflush(file->handle);
+    if(count > (size_t)0)
+    {
+        return nn_value_makebool(true);
+    }
+    return nn_value_makebool(false);
+}
+
+NNValue nn_objfnfile_puts(NNState* state, NNArguments* args)
+{
+    size_t count;
+    int length;
+    unsigned char* data;
+    NNObjFile* file;
+    NNObjString* string;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    file = nn_value_asfile(args->thisval);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    string = nn_value_asstring(args->args[0]);
+    data = (unsigned char*)string->sbuf->data;
+    length = string->sbuf->length;
+    if(!file->isstd)
+    {
+        if(strstr(file->mode->sbuf->data, "r") != NULL && strstr(file->mode->sbuf->data, "+") == NULL)
+        {
+            FILE_ERROR(Unsupported, "cannot write into non-writable file");
+        }
+        else if(length == 0)
+        {
+            FILE_ERROR(Write, "cannot write empty buffer to file");
+        }
+        else if(!file->isopen)
+        {
+            FILE_ERROR(Write, "file not open");
+        }
+        else if(file->handle == NULL)
+        {
+            FILE_ERROR(Write, "could not write to file");
+        }
+    }
+    else
+    {
+        if(fileno(stdin) == file->number)
+        {
+            FILE_ERROR(Unsupported, "cannot write to input file");
+        }
+    }
+    if(file->isstd)
+    {
+        nn_printer_flush(state->stdoutprinter);
+    }
+    count = fwrite(data, sizeof(unsigned char), length, file->handle);
+    if(count > (size_t)0 || length == 0)
+    {
+        return nn_value_makebool(true);
+    }
+    return nn_value_makebool(false);
+}
+
+NNValue nn_objfnfile_printf(NNState* state, NNArguments* args)
+{
+    NNObjFile* file;
+    NNFormatInfo nfi;
+    NNPrinter pr;
+    NNObjString* ofmt;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    file = nn_value_asfile(args->thisval);
+    NEON_ARGS_CHECKMINARG(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    ofmt = nn_value_asstring(args->args[0]);
+    if(file->handle == NULL)
+    {
+        FILE_ERROR(Write, "file not open");
+    }
+    if(file->isstd)
+    {
+        nn_printer_flush(state->stdoutprinter);
+    }
+    nn_printer_makestackio(state, &pr, file->handle, false);
+    nn_strformat_init(state, &nfi, &pr, nn_string_getcstr(ofmt), nn_string_getlength(ofmt));
+    if(!nn_strformat_format(&nfi, args->count, 1, args->args))
+    {
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnfile_number(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makenumber(nn_value_asfile(args->thisval)->number);
+}
+
+NNValue nn_objfnfile_istty(NNState* state, NNArguments* args)
+{
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    file = nn_value_asfile(args->thisval);
+    return nn_value_makebool(file->istty);
+}
+
+NNValue nn_objfnfile_flush(NNState* state, NNArguments* args)
+{
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    file = nn_value_asfile(args->thisval);
+    if(!file->isopen)
+    {
+        FILE_ERROR(Unsupported, "I/O operation on closed file");
+    }
+    if(file->isstd)
+    {
+        nn_printer_flush(state->stdoutprinter);
+    }
+    #if defined(NEON_PLAT_ISLINUX)
+    if(fileno(stdin) == file->number)
+    {
+        while((getchar()) != '\n')
+        {
+        }
+    }
+    else
+    {
+        fflush(file->handle);
+    }
+    #else
+    fflush(file->handle);
+    #endif
+    return nn_value_makenull();
+}
+
+void nn_util_statfilldictphysfile(NNObjDict* dict, struct stat* st)
+{
+    #if !defined(NEON_PLAT_ISWINDOWS)
+    nn_dict_addentrycstr(dict, "isreadable", nn_value_makebool(((st->st_mode & S_IRUSR) != 0)));
+    nn_dict_addentrycstr(dict, "iswritable", nn_value_makebool(((st->st_mode & S_IWUSR) != 0)));
+    nn_dict_addentrycstr(dict, "isexecutable", nn_value_makebool(((st->st_mode & S_IXUSR) != 0)));
+    nn_dict_addentrycstr(dict, "issymbolic", nn_value_makebool((S_ISLNK(st->st_mode) != 0)));
+    #else
+    nn_dict_addentrycstr(dict, "isreadable", nn_value_makebool(((st->st_mode & S_IREAD) != 0)));
+    nn_dict_addentrycstr(dict, "iswritable", nn_value_makebool(((st->st_mode & S_IWRITE) != 0)));
+    nn_dict_addentrycstr(dict, "isexecutable", nn_value_makebool(((st->st_mode & S_IEXEC) != 0)));
+    nn_dict_addentrycstr(dict, "issymbolic", nn_value_makebool(false));
+    #endif
+    nn_dict_addentrycstr(dict, "size", nn_value_makenumber(st->st_size));
+    nn_dict_addentrycstr(dict, "mode", nn_value_makenumber(st->st_mode));
+    nn_dict_addentrycstr(dict, "dev", nn_value_makenumber(st->st_dev));
+    nn_dict_addentrycstr(dict, "ino", nn_value_makenumber(st->st_ino));
+    nn_dict_addentrycstr(dict, "nlink", nn_value_makenumber(st->st_nlink));
+    nn_dict_addentrycstr(dict, "uid", nn_value_makenumber(st->st_uid));
+    nn_dict_addentrycstr(dict, "gid", nn_value_makenumber(st->st_gid));
+    nn_dict_addentrycstr(dict, "mtime", nn_value_makenumber(st->st_mtime));
+    nn_dict_addentrycstr(dict, "atime", nn_value_makenumber(st->st_atime));
+    nn_dict_addentrycstr(dict, "ctime", nn_value_makenumber(st->st_ctime));
+    nn_dict_addentrycstr(dict, "blocks", nn_value_makenumber(0));
+    nn_dict_addentrycstr(dict, "blksize", nn_value_makenumber(0));
+}
+
+NNValue nn_objfnfile_statmethod(NNState* state, NNArguments* args)
+{
+    struct stat stats;
+    NNObjFile* file;
+    NNObjDict* dict;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    file = nn_value_asfile(args->thisval);
+    dict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    if(!file->isstd)
+    {
+        if(nn_util_fsfileexists(state, file->path->sbuf->data))
+        {
+            if(osfn_lstat(file->path->sbuf->data, &stats) == 0)
+            {
+                nn_util_statfilldictphysfile(dict, &stats);
+            }
+        }
+        else
+        {
+            NEON_RETURNERROR("cannot get stats for non-existing file");
+        }
+    }
+    else
+    {
+        if(fileno(stdin) == file->number)
+        {
+            nn_dict_addentrycstr(dict, "isreadable", nn_value_makebool(true));
+            nn_dict_addentrycstr(dict, "iswritable", nn_value_makebool(false));
+        }
+        else
+        {
+            nn_dict_addentrycstr(dict, "isreadable", nn_value_makebool(false));
+            nn_dict_addentrycstr(dict, "iswritable", nn_value_makebool(true));
+        }
+        nn_dict_addentrycstr(dict, "isexecutable", nn_value_makebool(false));
+        nn_dict_addentrycstr(dict, "size", nn_value_makenumber(1));
+    }
+    return nn_value_fromobject(dict);
+}
+
+NNValue nn_objfnfile_path(NNState* state, NNArguments* args)
+{
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    file = nn_value_asfile(args->thisval);
+    DENY_STD();
+    return nn_value_fromobject(file->path);
+}
+
+NNValue nn_objfnfile_mode(NNState* state, NNArguments* args)
+{
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    file = nn_value_asfile(args->thisval);
+    return nn_value_fromobject(file->mode);
+}
+
+NNValue nn_objfnfile_name(NNState* state, NNArguments* args)
+{
+    char* name;
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    file = nn_value_asfile(args->thisval);
+    if(!file->isstd)
+    {
+        name = nn_util_fsgetbasename(state, file->path->sbuf->data);
+        return nn_value_fromobject(nn_string_copycstr(state, name));
+    }
+    else if(file->istty)
+    {
+        /*name = ttyname(file->number);*/
+        name = nn_util_strdup("<tty>");
+        if(name)
+        {
+            return nn_value_fromobject(nn_string_copycstr(state, name));
+        }
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnfile_seek(NNState* state, NNArguments* args)
+{
+    long position;
+    int seektype;
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+    file = nn_value_asfile(args->thisval);
+    DENY_STD();
+    position = (long)nn_value_asnumber(args->args[0]);
+    seektype = nn_value_asnumber(args->args[1]);
+    RETURN_STATUS(fseek(file->handle, position, seektype));
+}
+
+NNValue nn_objfnfile_tell(NNState* state, NNArguments* args)
+{
+    NNObjFile* file;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    file = nn_value_asfile(args->thisval);
+    DENY_STD();
+    return nn_value_makenumber(ftell(file->handle));
+}
+
+#undef FILE_ERROR
+#undef RETURN_STATUS
+#undef DENY_STD
+
+NNObjArray* nn_array_makefilled(NNState* state, size_t cnt, NNValue filler)
+{
+    size_t i;
+    NNObjArray* list;
+    list = (NNObjArray*)nn_object_allocobject(state, sizeof(NNObjArray), NEON_OBJTYPE_ARRAY);
+    list->varray = nn_vallist_make(state);
+    if(cnt > 0)
+    {
+        for(i=0; i<cnt; i++)
+        {
+            nn_vallist_push(list->varray, filler);
+        }
+    }
+    return list;
+}
+
+NNObjArray* nn_array_make(NNState* state)
+{
+    return nn_array_makefilled(state, 0, nn_value_makenull());
+}
+
+void nn_array_push(NNObjArray* list, NNValue value)
+{
+    NNState* state;
+    (void)state;
+    state = ((NNObject*)list)->pstate;
+    /*nn_vm_stackpush(state, value);*/
+    nn_vallist_push(list->varray, value);
+    /*nn_vm_stackpop(state); */
+}
+
+bool nn_array_get(NNObjArray* list, size_t idx, NNValue* vdest)
+{
+    size_t vc;
+    vc = nn_vallist_count(list->varray);
+    if((vc > 0) && (idx < vc))
+    {
+        *vdest = nn_vallist_get(list->varray, idx);
+        return true;
+    }
+    return false;
+}
+
+NNObjArray* nn_array_copy(NNObjArray* list, long start, long length)
+{
+    size_t i;
+    NNState* state;
+    NNObjArray* newlist;
+    state = ((NNObject*)list)->pstate;
+    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    if(start == -1)
+    {
+        start = 0;
+    }
+    if(length == -1)
+    {
+        length = list->varray->listcount - start;
+    }
+    for(i = start; i < (size_t)(start + length); i++)
+    {
+        nn_array_push(newlist, list->varray->listitems[i]);
+    }
+    return newlist;
+}
+
+NNValue nn_objfnarray_length(NNState* state, NNArguments* args)
+{
+    NNObjArray* selfarr;
+    (void)state;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    selfarr = nn_value_asarray(args->thisval);
+    return nn_value_makenumber(selfarr->varray->listcount);
+}
+
+NNValue nn_objfnarray_append(NNState* state, NNArguments* args)
+{
+    size_t i;
+    (void)state;
+    for(i = 0; i < args->count; i++)
+    {
+        nn_array_push(nn_value_asarray(args->thisval), args->args[i]);
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnarray_clear(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    nn_vallist_setempty(nn_value_asarray(args->thisval)->varray);
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnarray_clone(NNState* state, NNArguments* args)
+{
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    list = nn_value_asarray(args->thisval);
+    return nn_value_fromobject(nn_array_copy(list, 0, list->varray->listcount));
+}
+
+NNValue nn_objfnarray_count(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int count;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    list = nn_value_asarray(args->thisval);
+    count = 0;
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        if(nn_value_compare(state, list->varray->listitems[i], args->args[0]))
+        {
+            count++;
+        }
+    }
+    return nn_value_makenumber(count);
+}
+
+NNValue nn_objfnarray_extend(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjArray* list;
+    NNObjArray* list2;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isarray);
+    list = nn_value_asarray(args->thisval);
+    list2 = nn_value_asarray(args->args[0]);
+    for(i = 0; i < list2->varray->listcount; i++)
+    {
+        nn_array_push(list, list2->varray->listitems[i]);
+    }
+    return nn_value_makenull();
+}
+
+/*
+* searches a numeric or string array for $needle of the same kind, starting at $from, without
+* dispatching on the type of each element. stores the index or -1 in $dest; returns false
+* if neither applies, and the caller has to compare element by element.
+*/
+bool nn_array_findbykind(NNObjArray* list, NNValue needle, size_t from, int64_t* dest)
+{
+    size_t i;
+    double num;
+    NNValArray* va;
+    NNObjString* str;
+    NNObjString* elem;
+    va = list->varray;
+    *dest = -1;
+    if((va->listkind == NEON_ELEMKIND_NUMBER) && nn_value_isnumber(needle))
+    {
+        num = nn_value_asnumber(needle);
+        for(i = from; i < va->listcount; i++)
+        {
+            if(nn_value_asnumber(va->listitems[i]) == num)
+            {
+                *dest = i;
+                break;
+            }
+        }
+        return true;
+    }
+    if((va->listkind == NEON_ELEMKIND_STRING) && nn_value_isstring(needle))
+    {
+        str = nn_value_asstring(needle);
+        for(i = from; i < va->listcount; i++)
+        {
+            elem = nn_value_asstring(va->listitems[i]);
+            if((elem == str) || ((elem->sbuf->length == str->sbuf->length) && (memcmp(elem->sbuf->data, str->sbuf->data, str->sbuf->length) == 0)))
+            {
+                *dest = i;
+                break;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+NNValue nn_objfnarray_indexof(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int64_t found;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    list = nn_value_asarray(args->thisval);
+    i = 0;
+    if(args->count == 2)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+        i = nn_value_asnumber(args->args[1]);
+    }
+    if(nn_array_findbykind(list, args->args[0], i, &found))
+    {
+        return nn_value_makenumber(found);
+    }
+    for(; i < list->varray->listcount; i++)
+    {
+        if(nn_value_compare(state, list->varray->listitems[i], args->args[0]))
+        {
+            return nn_value_makenumber(i);
+        }
+    }
+    return nn_value_makenumber(-1);
+}
+
+NNValue nn_objfnarray_insert(NNState* state, NNArguments* args)
+{
+    int index;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 2);
+    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+    list = nn_value_asarray(args->thisval);
+    index = (int)nn_value_asnumber(args->args[1]);
+    nn_vallist_insert(list->varray, args->args[0], index);
+    return nn_value_makenull();
+}
+
+
+NNValue nn_objfnarray_pop(NNState* state, NNArguments* args)
+{
+    NNValue value;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    list = nn_value_asarray(args->thisval);
+    if(list->varray->listcount > 0)
+    {
+        value = list->varray->listitems[list->varray->listcount - 1];
+        list->varray->listcount--;
+        return value;
+    }
+    return nn_value_makenull();
+}
+
+/*
+* shift() removes and returns the first element, shift(n) removes the first n elements
+* and returns them as an array. both are O(1) per element, see nn_vallist_shift.
+*/
+NNValue nn_objfnarray_shift(NNState* state, NNArguments* args)
+{
+    size_t i;
+    size_t count;
+    NNValue value;
+    NNObjArray* list;
+    NNObjArray* newlist;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    list = nn_value_asarray(args->thisval);
+    if(args->count == 0)
+    {
+        if(nn_vallist_shift(list->varray, &value))
+        {
+            return value;
+        }
+        return nn_value_makenull();
+    }
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    count = nn_value_asnumber(args->args[0]);
+    if(count > list->varray->listcount)
+    {
+        count = list->varray->listcount;
+    }
+    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < count; i++)
+    {
+        nn_array_push(newlist, list->varray->listitems[0]);
+        nn_vallist_shift(list->varray, NULL);
+    }
+    return nn_value_fromobject(newlist);
+}
+
+/* unshift(values...) prepends the arguments in order, and returns the new length. */
+NNValue nn_objfnarray_unshift(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjArray* list;
+    (void)state;
+    list = nn_value_asarray(args->thisval);
+    for(i = args->count; i > 0; i--)
+    {
+        nn_vallist_unshift(list->varray, args->args[i - 1]);
+    }
+    return nn_value_makenumber(list->varray->listcount);
+}
+
+NNValue nn_objfnarray_removeat(NNState* state, NNArguments* args)
+{
+    size_t index;
+    NNValue value;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    list = nn_value_asarray(args->thisval);
+    index = nn_value_asnumber(args->args[0]);
+    if(((int)index < 0) || index >= list->varray->listcount)
+    {
+        NEON_RETURNERROR("list index %d out of range at remove_at()", index);
+    }
+    value = list->varray->listitems[index];
+    nn_vallist_removeat(list->varray, index);
+    return value;
+}
+
+NNValue nn_objfnarray_remove(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int64_t index;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    list = nn_value_asarray(args->thisval);
+    if(!nn_array_findbykind(list, args->args[0], 0, &index))
+    {
+        for(i = 0; i < list->varray->listcount; i++)
+        {
+            if(nn_value_compare(state, list->varray->listitems[i], args->args[0]))
+            {
+                index = i;
+                break;
+            }
+        }
+    }
+    if(index != -1)
+    {
+        nn_vallist_removeat(list->varray, index);
+    }
+    return nn_value_makenull();
+}
+
+/*
+* removeAll(values...) removes every occurrence of each of the values, in one pass over
+* the array, and returns how many elements were removed.
+*/
+NNValue nn_objfnarray_removeall(NNState* state, NNArguments* args)
+{
+    size_t i;
+    size_t kept;
+    size_t removed;
+    NNValArray* va;
+    NNObjDict* remove;
+    va = nn_value_asarray(args->thisval)->varray;
+    remove = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    for(i = 0; i < args->count; i++)
+    {
+        nn_dict_setentry(remove, args->args[i], nn_value_makenull());
+    }
+    kept = 0;
+    for(i = 0; i < va->listcount; i++)
+    {
+        if(nn_dict_getentry(remove, va->listitems[i]) == NULL)
+        {
+            va->listitems[kept] = va->listitems[i];
+            kept++;
+        }
+    }
+    removed = va->listcount - kept;
+    va->listcount = kept;
+    return nn_value_makenumber(removed);
+}
+
+NNValue nn_objfnarray_reverse(NNState* state, NNArguments* args)
+{
+    int fromtop;
+    NNObjArray* list;
+    NNObjArray* nlist;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    list = nn_value_asarray(args->thisval);
+    nlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    /* in-place reversal:*/
+    /*
+    int start = 0;
+    int end = list->varray->listcount - 1;
+    while (start < end)
+    {
+        NNValue temp = list->varray->listitems[start];
+        list->varray->listitems[start] = list->varray->listitems[end];
+        list->varray->listitems[end] = temp;
+        start++;
+        end--;
+    }
+    */
+    for(fromtop = list->varray->listcount - 1; fromtop >= 0; fromtop--)
+    {
+        nn_array_push(nlist, list->varray->listitems[fromtop]);
+    }
+    return nn_value_fromobject(nlist);
+}
+
+/*
+* returns a sorted copy of list. callable may be null (default ordering), a function taking
+* one argument, which is called once per element to compute the keys to sort by, or a
+* comparator taking two elements, returning a negative number, zero, or a positive number.
+* returns NULL if the callback threw; the exception is propagated already.
+*/
+NNObjArray* nn_array_sortedcopy(NNState* state, NNObjArray* list, NNValue callable)
+{
+    size_t i;
+    size_t count;
+    int arity;
+    NNValue key;
+    NNObjArray* copy;
+    NNObjArray* keys;
+    NNObjArray* nestargs;
+    count = list->varray->listcount;
+    copy = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < count; i++)
+    {
+        nn_array_push(copy, list->varray->listitems[i]);
+    }
+    if(nn_value_isnull(callable))
+    {
+        nn_sort_values(state, copy->varray->listitems, NULL, count, callable, nn_value_makenull());
+        return copy;
+    }
+    nestargs = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    arity = nn_nestcall_prepare(state, callable, nn_value_fromobject(list), nestargs);
+    if(arity != 1)
+    {
+        if(!nn_sort_values(state, copy->varray->listitems, NULL, count, callable, nn_value_fromobject(list)))
+        {
+            return NULL;
+        }
+        return copy;
+    }
+    keys = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < count; i++)
+    {
+        nestargs->varray->listitems[0] = copy->varray->listitems[i];
+        if(!nn_nestcall_callfunction(state, callable, nn_value_fromobject(list), nestargs, &key))
+        {
+            return NULL;
+        }
+        nn_array_push(keys, key);
+    }
+    nn_sort_values(state, keys->varray->listitems, copy->varray->listitems, count, nn_value_makenull(), nn_value_makenull());
+    return copy;
+}
+
+NNValue nn_objfnarray_sort(NNState* state, NNArguments* args)
+{
+    size_t count;
+    NNObjArray* list;
+    NNObjArray* sorted;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    list = nn_value_asarray(args->thisval);
+    if(args->count == 0)
+    {
+        /* the default ordering never calls into scripts, so the items can be sorted in place. */
+        nn_sort_values(state, list->varray->listitems, NULL, list->varray->listcount, nn_value_makenull(), nn_value_makenull());
+        return nn_value_makenull();
+    }
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    /* sorted on a copy, in case the callback modifies the array. */
+    sorted = nn_array_sortedcopy(state, list, args->args[0]);
+    if(sorted == NULL)
+    {
+        return nn_value_makenull();
+    }
+    count = sorted->varray->listcount;
+    nn_vallist_ensurecapacity(list->varray, count, nn_value_makenull(), false);
+    memcpy(list->varray->listitems, sorted->varray->listitems, sizeof(NNValue) * count);
+    list->varray->listcount = count;
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnarray_sorted(NNState* state, NNArguments* args)
+{
+    NNValue callable;
+    NNObjArray* sorted;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    callable = nn_value_makenull();
+    if(args->count == 1)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+        callable = args->args[0];
+    }
+    sorted = nn_array_sortedcopy(state, nn_value_asarray(args->thisval), callable);
+    if(sorted == NULL)
+    {
+        return nn_value_makenull();
+    }
+    return nn_value_fromobject(sorted);
+}
+
+NNValue nn_objfnarray_contains(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int64_t found;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    list = nn_value_asarray(args->thisval);
+    if(nn_array_findbykind(list, args->args[0], 0, &found))
+    {
+        return nn_value_makebool(found != -1);
+    }
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        if(nn_value_compare(state, args->args[0], list->varray->listitems[i]))
+        {
+            return nn_value_makebool(true);
+        }
+    }
+    return nn_value_makebool(false);
+}
+
+NNValue nn_objfnarray_delete(NNState* state, NNArguments* args)
+{
+    size_t i;
+    size_t idxupper;
+    size_t idxlower;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    idxlower = nn_value_asnumber(args->args[0]);
+    idxupper = idxlower;
+    if(args->count == 2)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+        idxupper = nn_value_asnumber(args->args[1]);
+    }
+    list = nn_value_asarray(args->thisval);
+    if(((int)idxlower < 0) || idxlower >= list->varray->listcount)
+    {
+        NEON_RETURNERROR("list index %d out of range at delete()", idxlower);
+    }
+    else if(idxupper < idxlower || idxupper >= list->varray->listcount)
+    {
+        NEON_RETURNERROR("invalid upper limit %d at delete()", idxupper);
+    }
+    for(i = 0; i < list->varray->listcount - idxupper; i++)
+    {
+        list->varray->listitems[idxlower + i] = list->varray->listitems[i + idxupper + 1];
+    }
+    list->varray->listcount -= idxupper - idxlower + 1;
+    return nn_value_makenumber((double)idxupper - (double)idxlower + 1);
+}
+
+NNValue nn_objfnarray_first(NNState* state, NNArguments* args)
+{
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    list = nn_value_asarray(args->thisval);
+    if(list->varray->listcount > 0)
+    {
+        return list->varray->listitems[0];
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnarray_last(NNState* state, NNArguments* args)
+{
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    list = nn_value_asarray(args->thisval);
+    if(list->varray->listcount > 0)
+    {
+        return list->varray->listitems[list->varray->listcount - 1];
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnarray_isempty(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makebool(nn_value_asarray(args->thisval)->varray->listcount == 0);
+}
+
+
+NNValue nn_objfnarray_take(NNState* state, NNArguments* args)
+{
+    size_t count;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    list = nn_value_asarray(args->thisval);
+    count = nn_value_asnumber(args->args[0]);
+    if((int)count < 0)
+    {
+        count = list->varray->listcount + count;
+    }
+    if(list->varray->listcount < count)
+    {
+        return nn_value_fromobject(nn_array_copy(list, 0, list->varray->listcount));
+    }
+    return nn_value_fromobject(nn_array_copy(list, 0, count));
+}
+
+NNValue nn_objfnarray_get(NNState* state, NNArguments* args)
+{
+    size_t index;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    list = nn_value_asarray(args->thisval);
+    index = nn_value_asnumber(args->args[0]);
+    if((int)index < 0 || index >= list->varray->listcount)
+    {
+        return nn_value_makenull();
+    }
+    return list->varray->listitems[index];
+}
+
+NNValue nn_objfnarray_compact(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjArray* list;
+    NNObjArray* newlist;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    list = nn_value_asarray(args->thisval);
+    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        if(!nn_value_isnull(list->varray->listitems[i]))
+        {
+            nn_array_push(newlist, list->varray->listitems[i]);
+        }
+    }
+    return nn_value_fromobject(newlist);
+}
+
+
+NNValue nn_objfnarray_unique(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjDict* seen;
+    NNObjArray* list;
+    NNObjArray* newlist;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    list = nn_value_asarray(args->thisval);
+    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    seen = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        if(nn_dict_setentry(seen, list->varray->listitems[i], nn_value_makenull()))
+        {
+            nn_array_push(newlist, list->varray->listitems[i]);
+        }
+    }
+    return nn_value_fromobject(newlist);
+}
+
+/*
+* implements difference() and intersect(): keeps the elements of this array whose presence
+* in the argument (an array or a set) equals $keepfound. the argument is indexed once, so
+* either costs O(n + m).
+*/
+NNValue nn_array_filterby(NNState* state, NNArguments* args, bool keepfound)
+{
+    size_t i;
+    NNValue item;
+    NNObjSet* other;
+    NNObjDict* seen;
+    NNObjArray* list;
+    NNObjArray* newlist;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    other = nn_set_fromvalue(state, args->args[0]);
+    if(other == NULL)
+    {
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() expects a set or an array, %s given", args->name, nn_value_typename(args->args[0]));
+    }
+    list = nn_value_asarray(args->thisval);
+    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    seen = NULL;
+    if(keepfound)
+    {
+        /* an intersection holds each common element once. */
+        seen = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    }
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        item = list->varray->listitems[i];
+        if(nn_set_has(other, item) != keepfound)
+        {
+            continue;
+        }
+        if((seen == NULL) || nn_dict_setentry(seen, item, nn_value_makenull()))
+        {
+            nn_array_push(newlist, item);
+        }
+    }
+    return nn_value_fromobject(newlist);
+}
+
+NNValue nn_objfnarray_difference(NNState* state, NNArguments* args)
+{
+    return nn_array_filterby(state, args, false);
+}
+
+NNValue nn_objfnarray_intersect(NNState* state, NNArguments* args)
+{
+    return nn_array_filterby(state, args, true);
+}
+
+/*
+* implements groupBy(fn) and countBy(fn): fn(value, index) returns the key of each element.
+* groupBy maps every key to the array of its elements, countBy to their number.
+*/
+NNValue nn_array_groupby(NNState* state, NNArguments* args, bool count)
+{
+    size_t i;
+    size_t arity;
+    NNValue key;
+    NNValue callable;
+    NNProperty* field;
+    NNObjDict* groups;
+    NNObjArray* list;
+    NNObjArray* group;
+    NNObjArray* nestargs;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    list = nn_value_asarray(args->thisval);
+    callable = args->args[0];
+    groups = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    nestargs = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        if(arity > 0)
+        {
+            nestargs->varray->listitems[0] = list->varray->listitems[i];
+            if(arity > 1)
+            {
+                nestargs->varray->listitems[1] = nn_value_makenumber(i);
+            }
+        }
+        if(!nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &key))
+        {
+            return nn_value_makenull();
+        }
+        field = nn_dict_getentry(groups, key);
+        if(count)
+        {
+            if(field == NULL)
+            {
+                nn_dict_setentry(groups, key, nn_value_makenumber(1));
+            }
+            else
+            {
+                field->value = nn_value_makenumber(nn_value_asnumber(field->value) + 1);
+            }
+            continue;
+        }
+        if(field == NULL)
+        {
+            group = nn_object_makearray(state);
+            nn_dict_setentry(groups, key, nn_value_fromobject(group));
+        }
+        else
+        {
+            group = nn_value_asarray(field->value);
+        }
+        nn_array_push(group, list->varray->listitems[i]);
+    }
+    return nn_value_fromobject(groups);
+}
+
+NNValue nn_objfnarray_groupby(NNState* state, NNArguments* args)
+{
+    return nn_array_groupby(state, args, false);
+}
+
+NNValue nn_objfnarray_countby(NNState* state, NNArguments* args)
+{
+    return nn_array_groupby(state, args, true);
+}
+
+NNValue nn_objfnarray_zip(NNState* state, NNArguments* args)
+{
+    size_t i;
+    size_t j;
+    NNObjArray* list;
+    NNObjArray* newlist;
+    NNObjArray* alist;
+    NNObjArray** arglist;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    list = nn_value_asarray(args->thisval);
+    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < args->count; i++)
+    {
+        NEON_ARGS_CHECKTYPE(&check, i, nn_value_isarray);
+    }
+    arglist = (NNObjArray**)nn_gcmem_allocate(state, sizeof(NNObjArray*), args->count);
+    for(i = 0; i < args->count; i++)
+    {
+        arglist[i] = nn_value_asarray(args->args[i]);
+    }
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        /* no need to protect the row: it is reachable from newlist before anything else is allocated. */
+        alist = nn_object_makearray(state);
+        /* item of main list*/
+        nn_array_push(alist, list->varray->listitems[i]);
+        for(j = 0; j < args->count; j++)
+        {
+            if(i < arglist[j]->varray->listcount)
+            {
+                nn_array_push(alist, arglist[j]->varray->listitems[i]);
+            }
+            else
+            {
+                nn_array_push(alist, nn_value_makenull());
+            }
+        }
+        nn_array_push(newlist, nn_value_fromobject(alist));
+    }
+    nn_gcmem_release(state, arglist, sizeof(NNObjArray*) * args->count);
+    return nn_value_fromobject(newlist);
+}
+
+
+NNValue nn_objfnarray_zipfrom(NNState* state, NNArguments* args)
+{
+    size_t i;
+    size_t j;
+    NNObjArray* list;
+    NNObjArray* newlist;
+    NNObjArray* alist;
+    NNObjArray* arglist;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isarray);
+    list = nn_value_asarray(args->thisval);
+    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    arglist = nn_value_asarray(args->args[0]);
+    for(i = 0; i < arglist->varray->listcount; i++)
+    {
+        if(!nn_value_isarray(arglist->varray->listitems[i]))
+        {
+            NEON_RETURNERROR("invalid list in zip entries");
+        }
+    }
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        alist = nn_object_makearray(state);
+        nn_array_push(alist, list->varray->listitems[i]);
+        for(j = 0; j < arglist->varray->listcount; j++)
+        {
+            if(i < nn_value_asarray(arglist->varray->listitems[j])->varray->listcount)
+            {
+                nn_array_push(alist, nn_value_asarray(arglist->varray->listitems[j])->varray->listitems[i]);
+            }
+            else
+            {
+                nn_array_push(alist, nn_value_makenull());
+            }
+        }
+        nn_array_push(newlist, nn_value_fromobject(alist));
+    }
+    return nn_value_fromobject(newlist);
+}
+
+NNValue nn_objfnarray_todict(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjDict* dict;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    dict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    list = nn_value_asarray(args->thisval);
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        nn_dict_setentry(dict, nn_value_makenumber(i), list->varray->listitems[i]);
+    }
+    return nn_value_fromobject(dict);
+}
+
+NNValue nn_objfnarray_iter(NNState* state, NNArguments* args)
+{
+    size_t index;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    list = nn_value_asarray(args->thisval);
+    index = nn_value_asnumber(args->args[0]);
+    if(((int)index > -1) && index < list->varray->listcount)
+    {
+        return list->varray->listitems[index];
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnarray_itern(NNState* state, NNArguments* args)
+{
+    size_t index;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    list = nn_value_asarray(args->thisval);
+    if(nn_value_isnull(args->args[0]))
+    {
+        if(list->varray->listcount == 0)
+        {
+            return nn_value_makebool(false);
+        }
+        return nn_value_makenumber(0);
+    }
+    if(!nn_value_isnumber(args->args[0]))
+    {
+        NEON_RETURNERROR("lists are numerically indexed");
+    }
+    index = nn_value_asnumber(args->args[0]);
+    if(index < list->varray->listcount - 1)
+    {
+        return nn_value_makenumber((double)index + 1);
+    }
+    return nn_value_makenull();
+}
+
+const char* nn_typedarray_kindname(int kind)
+{
+    switch(kind)
+    {
+        case NEON_TYPEDARRAY_FLOAT64:
+            return "Float64Array";
+        case NEON_TYPEDARRAY_INT32:
+            return "Int32Array";
+        case NEON_TYPEDARRAY_UINT32:
+            return "Uint32Array";
+        case NEON_TYPEDARRAY_UINT8:
+            return "Uint8Array";
+        default:
+            break;
+    }
+    return "Bytes";
+}
+
+size_t nn_typedarray_elemsize(int kind)
+{
+    switch(kind)
+    {
+        case NEON_TYPEDARRAY_FLOAT64:
+            return sizeof(double);
+        case NEON_TYPEDARRAY_INT32:
+            return sizeof(int32_t);
+        case NEON_TYPEDARRAY_UINT32:
+            return sizeof(uint32_t);
+        default:
+            break;
+    }
+    return sizeof(uint8_t);
+}
+
+/* creates a typed array of length elements, all 0. */
+NNObjTypedArray* nn_object_maketypedarray(NNState* state, int kind, size_t length)
+{
+    NNObjTypedArray* ta;
+    ta = (NNObjTypedArray*)nn_object_allocobject(state, sizeof(NNObjTypedArray), NEON_OBJTYPE_TYPEDARRAY);
+    ta->kind = kind;
+    ta->length = length;
+    ta->parent = NULL;
+    ta->mapsize = 0;
+    ta->data = (uint8_t*)nn_memory_calloc(length + 1, nn_typedarray_elemsize(kind));
+    return ta;
+}
+
+/* creates a view of length elements of ta, starting at start, that shares its storage. */
+NNObjTypedArray* nn_typedarray_makeview(NNState* state, NNObjTypedArray* ta, size_t start, size_t length)
+{
+    NNObjTypedArray* view;
+    view = (NNObjTypedArray*)nn_object_allocobject(state, sizeof(NNObjTypedArray), NEON_OBJTYPE_TYPEDARRAY);
+    view->kind = ta->kind;
+    view->length = length;
+    view->data = ta->data + (start * nn_typedarray_elemsize(ta->kind));
+    view->mapsize = 0;
+    view->parent = ta;
+    if(ta->parent != NULL)
+    {
+        view->parent = ta->parent;
+    }
+    return view;
+}
+
+/* resolves a relative index as javascript does: negative values count from the end, and the result is clamped to [0, length]. */
+size_t nn_typedarray_relindex(NNValue val, size_t length, size_t defval)
+{
+    double d;
+    if(!nn_value_isnumber(val))
+    {
+        return defval;
+    }
+    d = trunc(nn_value_asnumber(val));
+    if(d < 0)
+    {
+        d += (double)length;
+        return (d < 0) ? 0 : (size_t)d;
+    }
+    return (d > (double)length) ? length : (size_t)d;
+}
+
+/*
+* Float64Array(length), Float64Array(array) or Float64Array(typedarray), and likewise for the other kinds.
+* Bytes can also be made from a string, whose bytes are copied as they are.
+*/
+NNValue nn_typedarray_construct(NNState* state, NNArguments* args, int kind)
+{
+    size_t i;
+    double d;
+    NNValue arg;
+    NNObjArray* list;
+    NNObjTypedArray* src;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    if(args->count == 0)
+    {
+        return nn_value_fromobject(nn_object_maketypedarray(state, kind, 0));
+    }
+    arg = args->args[0];
+    if(nn_value_isnumber(arg))
+    {
+        d = nn_value_asnumber(arg);
+        if((d < 0) || (d != trunc(d)))
+        {
+            return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "invalid %s length %g", nn_typedarray_kindname(kind), d);
+        }
+        return nn_value_fromobject(nn_object_maketypedarray(state, kind, (size_t)d));
+    }
+    if(nn_value_isarray(arg))
+    {
+        list = nn_value_asarray(arg);
+        for(i = 0; i < list->varray->listcount; i++)
+        {
+            if(!nn_value_isnumber(list->varray->listitems[i]))
+            {
+                return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "cannot convert array to %s: element %ld is a %s", nn_typedarray_kindname(kind), (long)i, nn_value_typename(list->varray->listitems[i]));
+            }
+        }
+        ta = nn_object_maketypedarray(state, kind, list->varray->listcount);
+        for(i = 0; i < list->varray->listcount; i++)
+        {
+            nn_typedarray_set(ta, i, nn_value_asnumber(list->varray->listitems[i]));
+        }
+        return nn_value_fromobject(ta);
+    }
+    if((kind == NEON_TYPEDARRAY_BYTES) && nn_value_isstring(arg))
+    {
+        ta = nn_object_maketypedarray(state, kind, nn_value_asstring(arg)->sbuf->length);
+        memcpy(ta->data, nn_value_asstring(arg)->sbuf->data, ta->length);
+        return nn_value_fromobject(ta);
+    }
+    if(nn_value_istypedarray(arg))
+    {
+        src = nn_value_astypedarray(arg);
+        ta = nn_object_maketypedarray(state, kind, src->length);
+        if(src->kind == kind)
+        {
+            memcpy(ta->data, src->data, src->length * nn_typedarray_elemsize(kind));
+        }
+        else
+        {
+            for(i = 0; i < src->length; i++)
+            {
+                nn_typedarray_set(ta, i, nn_typedarray_get(src, i));
+            }
+        }
+        return nn_value_fromobject(ta);
+    }
+    return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "cannot create %s from %s", nn_typedarray_kindname(kind), nn_value_typename(arg));
+}
+
+NNValue nn_objfntypedarray_constructorfloat64(NNState* state, NNArguments* args)
+{
+    return nn_typedarray_construct(state, args, NEON_TYPEDARRAY_FLOAT64);
+}
+
+NNValue nn_objfntypedarray_constructorint32(NNState* state, NNArguments* args)
+{
+    return nn_typedarray_construct(state, args, NEON_TYPEDARRAY_INT32);
+}
+
+NNValue nn_objfntypedarray_constructoruint32(NNState* state, NNArguments* args)
+{
+    return nn_typedarray_construct(state, args, NEON_TYPEDARRAY_UINT32);
+}
+
+NNValue nn_objfntypedarray_constructoruint8(NNState* state, NNArguments* args)
+{
+    return nn_typedarray_construct(state, args, NEON_TYPEDARRAY_UINT8);
+}
+
+NNValue nn_objfntypedarray_constructorbytes(NNState* state, NNArguments* args)
+{
+    return nn_typedarray_construct(state, args, NEON_TYPEDARRAY_BYTES);
+}
+
+NNValue nn_objfntypedarray_length(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makenumber(nn_value_astypedarray(args->thisval)->length);
+}
+
+/* fill(value [, start [, end]]): returns the array itself. */
+NNValue nn_objfntypedarray_fill(NNState* state, NNArguments* args)
+{
+    size_t i;
+    size_t end;
+    size_t start;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 3);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    ta = nn_value_astypedarray(args->thisval);
+    start = 0;
+    end = ta->length;
+    if(args->count > 1)
+    {
+        start = nn_typedarray_relindex(args->args[1], ta->length, 0);
+    }
+    if(args->count > 2)
+    {
+        end = nn_typedarray_relindex(args->args[2], ta->length, ta->length);
+    }
+    if(start < end)
+    {
+        nn_typedarray_set(ta, start, nn_value_asnumber(args->args[0]));
+        if(nn_typedarray_elemsize(ta->kind) == 1)
+        {
+            memset(ta->data + start + 1, ta->data[start], end - start - 1);
+        }
+        else
+        {
+            for(i = start + 1; i < end; i++)
+            {
+                nn_typedarray_set(ta, i, nn_value_asnumber(args->args[0]));
+            }
+        }
+    }
+    return args->thisval;
+}
+
+/* copyWithin(target, start [, end]): copies the elements [start, end) to target; returns the array itself. */
+NNValue nn_objfntypedarray_copywithin(NNState* state, NNArguments* args)
+{
+    size_t end;
+    size_t start;
+    size_t target;
+    size_t count;
+    size_t elemsize;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 2, 3);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+    ta = nn_value_astypedarray(args->thisval);
+    target = nn_typedarray_relindex(args->args[0], ta->length, 0);
+    start = nn_typedarray_relindex(args->args[1], ta->length, 0);
+    end = ta->length;
+    if(args->count > 2)
+    {
+        end = nn_typedarray_relindex(args->args[2], ta->length, ta->length);
+    }
+    if(start < end)
+    {
+        count = end - start;
+        if(count > (ta->length - target))
+        {
+            count = ta->length - target;
+        }
+        elemsize = nn_typedarray_elemsize(ta->kind);
+        memmove(ta->data + (target * elemsize), ta->data + (start * elemsize), count * elemsize);
+    }
+    return args->thisval;
+}
+
+/* subarray([start [, end]]): a view of the elements [start, end) that shares storage with this array. */
+NNValue nn_objfntypedarray_subarray(NNState* state, NNArguments* args)
+{
+    size_t end;
+    size_t start;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 2);
+    ta = nn_value_astypedarray(args->thisval);
+    start = 0;
+    end = ta->length;
+    if(args->count > 0)
+    {
+        start = nn_typedarray_relindex(args->args[0], ta->length, 0);
+    }
+    if(args->count > 1)
+    {
+        end = nn_typedarray_relindex(args->args[1], ta->length, ta->length);
+    }
+    if(end < start)
+    {
+        end = start;
+    }
+    return nn_value_fromobject(nn_typedarray_makeview(state, ta, start, end - start));
+}
+
+/* slice([start [, end]]): like subarray, but copies the elements. */
+NNValue nn_objfntypedarray_slice(NNState* state, NNArguments* args)
+{
+    size_t end;
+    size_t start;
+    size_t elemsize;
+    NNObjTypedArray* ta;
+    NNObjTypedArray* copy;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 2);
+    ta = nn_value_astypedarray(args->thisval);
+    start = 0;
+    end = ta->length;
+    if(args->count > 0)
+    {
+        start = nn_typedarray_relindex(args->args[0], ta->length, 0);
+    }
+    if(args->count > 1)
+    {
+        end = nn_typedarray_relindex(args->args[1], ta->length, ta->length);
+    }
+    if(end < start)
+    {
+        end = start;
+    }
+    elemsize = nn_typedarray_elemsize(ta->kind);
+    copy = nn_object_maketypedarray(state, ta->kind, end - start);
+    memcpy(copy->data, ta->data + (start * elemsize), (end - start) * elemsize);
+    return nn_value_fromobject(copy);
+}
+
+NNValue nn_objfntypedarray_toarray(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjArray* list;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    ta = nn_value_astypedarray(args->thisval);
+    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    nn_vallist_ensurecapacity(list->varray, ta->length, nn_value_makenull(), false);
+    for(i = 0; i < ta->length; i++)
+    {
+        list->varray->listitems[i] = nn_value_makenumber(nn_typedarray_get(ta, i));
+    }
+    list->varray->listcount = ta->length;
+    if(ta->length > 0)
+    {
+        list->varray->listkind = NEON_ELEMKIND_NUMBER;
+    }
+    return nn_value_fromobject(list);
+}
+
+NNValue nn_objfntypedarray_iter(NNState* state, NNArguments* args)
+{
+    long index;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    ta = nn_value_astypedarray(args->thisval);
+    index = nn_value_asnumber(args->args[0]);
+    if((index >= 0) && (index < (long)ta->length))
+    {
+        return nn_value_makenumber(nn_typedarray_get(ta, index));
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfntypedarray_itern(NNState* state, NNArguments* args)
+{
+    size_t index;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    ta = nn_value_astypedarray(args->thisval);
+    if(nn_value_isnull(args->args[0]))
+    {
+        if(ta->length == 0)
+        {
+            return nn_value_makebool(false);
+        }
+        return nn_value_makenumber(0);
+    }
+    if(!nn_value_isnumber(args->args[0]))
+    {
+        NEON_RETURNERROR("typed arrays are numerically indexed");
+    }
+    index = nn_value_asnumber(args->args[0]);
+    if((index + 1) < ta->length)
+    {
+        return nn_value_makenumber((double)index + 1);
+    }
+    return nn_value_makenull();
+}
+
+static NNBytesAccessor g_bytesaccessors[] =
+{
+    {"readUint8", "writeUint8", 1, false, false, true},
+    {"readInt8", "writeInt8", 1, true, false, true},
+    {"readUint16LE", "writeUint16LE", 2, false, false, true},
+    {"readUint16BE", "writeUint16BE", 2, false, false, false},
+    {"readInt16LE", "writeInt16LE", 2, true, false, true},
+    {"readInt16BE", "writeInt16BE", 2, true, false, false},
+    {"readUint32LE", "writeUint32LE", 4, false, false, true},
+    {"readUint32BE", "writeUint32BE", 4, false, false, false},
+    {"readInt32LE", "writeInt32LE", 4, true, false, true},
+    {"readInt32BE", "writeInt32BE", 4, true, false, false},
+    {"readFloat32LE", "writeFloat32LE", 4, true, true, true},
+    {"readFloat32BE", "writeFloat32BE", 4, true, true, false},
+    {"readFloat64LE", "writeFloat64LE", 8, true, true, true},
+    {"readFloat64BE", "writeFloat64BE", 8, true, true, false},
+    {NULL, NULL, 0, false, false, false},
+};
+
+/*
+* checks that size bytes can be accessed at the offset given as argument 0, and returns it, or -1 after throwing.
+* like an out of range index of a typed array, a bad offset throws an Exception that scripts can catch.
+*/
+long nn_bytes_checkoffset(NNState* state, NNArguments* args, NNObjTypedArray* ta, int size)
+{
+    double offset;
+    offset = nn_value_asnumber(args->args[0]);
+    if((offset < 0) || (offset != trunc(offset)) || ((offset + size) > (double)ta->length))
+    {
+        nn_exceptions_throw(state, "%s: offset %g out of range of Bytes of length %ld", args->name, offset, (long)ta->length);
+        return -1;
+    }
+    return (long)offset;
+}
+
+/* readUint32LE(offset) and friends; the accessor in userptr says what to read. */
+NNValue nn_objfnbytes_readnumber(NNState* state, NNArguments* args)
+{
+    int i;
+    int shift;
+    long offset;
+    uint8_t* p;
+    uint64_t raw;
+    uint32_t raw32;
+    float f32;
+    double f64;
+    NNObjTypedArray* ta;
+    NNBytesAccessor* acc;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    acc = (NNBytesAccessor*)args->userptr;
+    ta = nn_value_astypedarray(args->thisval);
+    offset = nn_bytes_checkoffset(state, args, ta, acc->size);
+    if(offset < 0)
+    {
+        return nn_value_makenull();
+    }
+    p = ta->data + offset;
+    raw = 0;
+    for(i = 0; i < acc->size; i++)
+    {
+        if(acc->littleendian)
+        {
+            raw = (raw << 8) | p[acc->size - 1 - i];
+        }
+        else
+        {
+            raw = (raw << 8) | p[i];
+        }
+    }
+    if(acc->isfloat)
+    {
+        if(acc->size == 4)
+        {
+            raw32 = (uint32_t)raw;
+            memcpy(&f32, &raw32, sizeof(float));
+            return nn_value_makenumber(f32);
+        }
+        memcpy(&f64, &raw, sizeof(double));
+        return nn_value_makenumber(f64);
+    }
+    if(acc->issigned)
+    {
+        shift = 64 - (8 * acc->size);
+        return nn_value_makenumber((double)((int64_t)(raw << shift) >> shift));
+    }
+    return nn_value_makenumber((double)raw);
+}
+
+/* writeUint32LE(offset, value) and friends; returns the offset after the written value. */
+NNValue nn_objfnbytes_writenumber(NNState* state, NNArguments* args)
+{
+    int i;
+    long offset;
+    uint8_t* p;
+    uint64_t raw;
+    uint32_t raw32;
+    float f32;
+    double f64;
+    NNObjTypedArray* ta;
+    NNBytesAccessor* acc;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+    acc = (NNBytesAccessor*)args->userptr;
+    ta = nn_value_astypedarray(args->thisval);
+    offset = nn_bytes_checkoffset(state, args, ta, acc->size);
+    if(offset < 0)
+    {
+        return nn_value_makenull();
+    }
+    f64 = nn_value_asnumber(args->args[1]);
+    if(acc->isfloat)
+    {
+        if(acc->size == 4)
+        {
+            f32 = (float)f64;
+            memcpy(&raw32, &f32, sizeof(float));
+            raw = raw32;
+        }
+        else
+        {
+            memcpy(&raw, &f64, sizeof(double));
+        }
+    }
+    else
+    {
+        raw = nn_util_numbertouint32(f64);
+    }
+    p = ta->data + offset;
+    for(i = 0; i < acc->size; i++)
+    {
+        if(acc->littleendian)
+        {
+            p[i] = (uint8_t)(raw >> (8 * i));
+        }
+        else
+        {
+            p[acc->size - 1 - i] = (uint8_t)(raw >> (8 * i));
+        }
+    }
+    return nn_value_makenumber(offset + acc->size);
+}
+
+/* toString([start [, end]]): the bytes as a string, copied as they are. */
+NNValue nn_objfnbytes_tostring(NNState* state, NNArguments* args)
+{
+    size_t end;
+    size_t start;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 2);
+    ta = nn_value_astypedarray(args->thisval);
+    start = 0;
+    end = ta->length;
+    if(args->count > 0)
+    {
+        start = nn_typedarray_relindex(args->args[0], ta->length, 0);
+    }
+    if(args->count > 1)
+    {
+        end = nn_typedarray_relindex(args->args[1], ta->length, ta->length);
+    }
+    if(end < start)
+    {
+        end = start;
+    }
+    return nn_value_fromobject(nn_string_copylen(state, (const char*)ta->data + start, end - start));
+}
+
+NNValue nn_objfnbytes_tohex(NNState* state, NNArguments* args)
+{
+    size_t i;
+    char* buf;
+    NNObjTypedArray* ta;
+    NNArgCheck check;
+    static const char* hexdigits = "0123456789abcdef";
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    ta = nn_value_astypedarray(args->thisval);
+    buf = (char*)nn_memory_malloc((ta->length * 2) + 1);
+    for(i = 0; i < ta->length; i++)
+    {
+        buf[(i * 2)] = hexdigits[ta->data[i] >> 4];
+        buf[(i * 2) + 1] = hexdigits[ta->data[i] & 15];
+    }
+    buf[ta->length * 2] = 0;
+    return nn_value_fromobject(nn_string_takelen(state, buf, ta->length * 2));
+}
+
+bool nn_set_add(NNObjSet* set, NNValue value)
+{
+    return nn_dict_setentry(set->items, value, nn_value_makenull());
+}
+
+bool nn_set_has(NNObjSet* set, NNValue value)
+{
+    return nn_dict_getentry(set->items, value) != NULL;
+}
+
+/*
+* adds every member of $src, which must be an array or a set.
+* returns false if $src holds null, which cannot be a member (see nn_objfnset_add); nothing is added then.
+*/
+bool nn_set_addall(NNObjSet* set, NNValue src)
+{
+    size_t i;
+    NNObjArray* list;
+    NNObjDict* items;
+    if(nn_value_isarray(src))
+    {
+        list = nn_value_asarray(src);
+        for(i = 0; i < list->varray->listcount; i++)
+        {
+            if(nn_value_isnull(list->varray->listitems[i]))
+            {
+                return false;
+            }
+        }
+        for(i = 0; i < list->varray->listcount; i++)
+        {
+            nn_set_add(set, list->varray->listitems[i]);
+        }
+        return true;
+    }
+    items = nn_value_asset(src)->items;
+    for(i = 0; i < items->entrycount; i++)
+    {
+        if(items->entries[i].live)
+        {
+            nn_set_add(set, items->entries[i].key);
+        }
+    }
+    return true;
+}
+
+/*
+* returns $val if it is a set, or a new set made from the array $val; NULL for anything else.
+* the new set is only looked up in, and never seen by scripts, so null may be a member of it.
+*/
+NNObjSet* nn_set_fromvalue(NNState* state, NNValue val)
 {
-    return nn_util_fsfileistype(state, filepath, S_IFREG);
+    size_t i;
+    NNObjSet* set;
+    NNObjArray* list;
+    if(nn_value_isset(val))
+    {
+        return nn_value_asset(val);
+    }
+    if(!nn_value_isarray(val))
+    {
+        return NULL;
+    }
+    set = (NNObjSet*)nn_gcmem_protect(state, (NNObject*)nn_object_makeset(state));
+    list = nn_value_asarray(val);
+    for(i = 0; i < list->varray->listcount; i++)
+    {
+        nn_set_add(set, list->varray->listitems[i]);
+    }
+    return set;
 }
 
-bool nn_util_fsfileisdirectory(NNState* state, const char* filepath)
+NNValue nn_objfnset_constructor(NNState* state, NNArguments* args)
 {
-    return nn_util_fsfileistype(state, filepath, S_IFDIR);
+    NNObjSet* set;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    set = (NNObjSet*)nn_gcmem_protect(state, (NNObject*)nn_object_makeset(state));
+    if(args->count == 1)
+    {
+        if(!nn_value_isarray(args->args[0]) && !nn_value_isset(args->args[0]))
+        {
+            return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "cannot create Set from %s", nn_value_typename(args->args[0]));
+        }
+        if(!nn_set_addall(set, args->args[0]))
+        {
+            return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "cannot add null to a Set");
+        }
+    }
+    return nn_value_fromobject(set);
 }
 
-NNObjModule* nn_import_loadmodulescript(NNState* state, NNObjModule* intomodule, NNObjString* modulename)
+NNValue nn_objfnset_length(NNState* state, NNArguments* args)
 {
-    int argc;
-    size_t fsz;
-    char* source;
-    char* physpath;
-    NNBlob blob;
-    NNValue retv;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makenumber(nn_value_asset(args->thisval)->items->count);
+}
+
+NNValue nn_objfnset_add(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    for(i = 0; i < args->count; i++)
+    {
+        /* null is what @itern starts from, so it cannot be a member. */
+        if(nn_value_isnull(args->args[i]))
+        {
+            return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "cannot add null to a Set");
+        }
+        nn_set_add(nn_value_asset(args->thisval), args->args[i]);
+    }
+    return args->thisval;
+}
+
+NNValue nn_objfnset_remove(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    return nn_value_makebool(nn_dict_removeentry(nn_value_asset(args->thisval)->items, args->args[0], NULL));
+}
+
+NNValue nn_objfnset_has(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    return nn_value_makebool(nn_set_has(nn_value_asset(args->thisval), args->args[0]));
+}
+
+NNValue nn_objfnset_isempty(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makebool(nn_value_asset(args->thisval)->items->count == 0);
+}
+
+NNValue nn_objfnset_clear(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    nn_dict_clear(nn_value_asset(args->thisval)->items);
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnset_clone(NNState* state, NNArguments* args)
+{
+    NNObjSet* set;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    set = (NNObjSet*)nn_gcmem_protect(state, (NNObject*)nn_object_makeset(state));
+    set->items = nn_dict_copy(nn_value_asset(args->thisval)->items);
+    return nn_value_fromobject(set);
+}
+
+NNValue nn_objfnset_toarray(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjDict* items;
+    NNObjArray* list;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    items = nn_value_asset(args->thisval)->items;
+    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < items->entrycount; i++)
+    {
+        if(items->entries[i].live)
+        {
+            nn_array_push(list, items->entries[i].key);
+        }
+    }
+    return nn_value_fromobject(list);
+}
+
+NNValue nn_objfnset_union(NNState* state, NNArguments* args)
+{
+    NNObjSet* set;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    if(!nn_value_isarray(args->args[0]) && !nn_value_isset(args->args[0]))
+    {
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() expects a set or an array, %s given", args->name, nn_value_typename(args->args[0]));
+    }
+    set = (NNObjSet*)nn_gcmem_protect(state, (NNObject*)nn_object_makeset(state));
+    set->items = nn_dict_copy(nn_value_asset(args->thisval)->items);
+    if(!nn_set_addall(set, args->args[0]))
+    {
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "cannot add null to a Set");
+    }
+    return nn_value_fromobject(set);
+}
+
+/* implements intersection() and difference(): keeps the members of this set whose presence in the argument equals $keepfound. */
+NNValue nn_set_filterby(NNState* state, NNArguments* args, bool keepfound)
+{
+    size_t i;
+    NNValue member;
+    NNObjSet* set;
+    NNObjSet* other;
+    NNObjDict* items;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    other = nn_set_fromvalue(state, args->args[0]);
+    if(other == NULL)
+    {
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() expects a set or an array, %s given", args->name, nn_value_typename(args->args[0]));
+    }
+    items = nn_value_asset(args->thisval)->items;
+    set = (NNObjSet*)nn_gcmem_protect(state, (NNObject*)nn_object_makeset(state));
+    for(i = 0; i < items->entrycount; i++)
+    {
+        member = items->entries[i].key;
+        if(items->entries[i].live && (nn_set_has(other, member) == keepfound))
+        {
+            nn_set_add(set, member);
+        }
+    }
+    return nn_value_fromobject(set);
+}
+
+NNValue nn_objfnset_intersection(NNState* state, NNArguments* args)
+{
+    return nn_set_filterby(state, args, true);
+}
+
+NNValue nn_objfnset_difference(NNState* state, NNArguments* args)
+{
+    return nn_set_filterby(state, args, false);
+}
+
+NNValue nn_objfnset_issubset(NNState* state, NNArguments* args)
+{
+    size_t i;
+    NNObjSet* other;
+    NNObjDict* items;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    other = nn_set_fromvalue(state, args->args[0]);
+    if(other == NULL)
+    {
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() expects a set or an array, %s given", args->name, nn_value_typename(args->args[0]));
+    }
+    items = nn_value_asset(args->thisval)->items;
+    for(i = 0; i < items->entrycount; i++)
+    {
+        if(items->entries[i].live && !nn_set_has(other, items->entries[i].key))
+        {
+            return nn_value_makebool(false);
+        }
+    }
+    return nn_value_makebool(true);
+}
+
+NNValue nn_objfnset_each(NNState* state, NNArguments* args)
+{
+    size_t i;
+    int arity;
     NNValue callable;
-    NNProperty* field;
-    NNObjArray* args;
-    NNObjString* os;
-    NNObjModule* module;
-    NNObjFuncClosure* closure;
-    NNObjFuncScript* function;
-    (void)os;
-    (void)argc;
-    (void)intomodule;
-    field = nn_tableval_getfieldbyostr(state->openedmodules, modulename);
-    if(field != NULL)
+    NNValue unused;
+    NNObjDict* items;
+    NNObjArray* nestargs;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    items = nn_value_asset(args->thisval)->items;
+    callable = args->args[0];
+    nestargs = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    for(i = 0; i < items->entrycount; i++)
+    {
+        if(!items->entries[i].live)
+        {
+            continue;
+        }
+        if(arity > 0)
+        {
+            nestargs->varray->listitems[0] = items->entries[i].key;
+        }
+        if(!nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &unused))
+        {
+            return nn_value_makenull();
+        }
+    }
+    /* pop the argument list */
+    nn_vm_stackpop(state);
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnset_iter(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    /* members are their own keys. */
+    return args->args[0];
+}
+
+NNValue nn_objfnset_itern(NNState* state, NNArguments* args)
+{
+    int64_t ix;
+    NNObjDict* items;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    items = nn_value_asset(args->thisval)->items;
+    if(nn_value_isnull(args->args[0]))
+    {
+        if(items->count == 0)
+        {
+            return nn_value_makebool(false);
+        }
+        return items->entries[nn_dict_nextentry(items, 0)].key;
+    }
+    ix = nn_dict_findentry(items, args->args[0], nn_value_hashvalue(args->args[0]), NULL);
+    if(ix >= 0)
+    {
+        ix = nn_dict_nextentry(items, ix + 1);
+        if(ix >= 0)
+        {
+            return items->entries[ix].key;
+        }
+    }
+    return nn_value_makenull();
+}
+
+const char* nn_iterator_kindname(NNIterKind kind)
+{
+    switch(kind)
+    {
+        case NEON_ITERKIND_ARRAY:
+            return "array";
+        case NEON_ITERKIND_RANGE:
+            return "range";
+        case NEON_ITERKIND_DICT:
+            return "dict";
+        case NEON_ITERKIND_FILE:
+            return "file";
+        case NEON_ITERKIND_JSONLINES:
+            return "jsonlines";
+        case NEON_ITERKIND_CSV:
+            return "csv";
+        case NEON_ITERKIND_WALK:
+            return "walk";
+        case NEON_ITERKIND_MAP:
+            return "map";
+        case NEON_ITERKIND_FILTER:
+            return "filter";
+        case NEON_ITERKIND_TAKE:
+            return "take";
+        case NEON_ITERKIND_SKIP:
+            return "skip";
+        case NEON_ITERKIND_ZIP:
+            return "zip";
+        case NEON_ITERKIND_ENUMERATE:
+            return "enumerate";
+        case NEON_ITERKIND_CHUNK:
+            return "chunk";
+    }
+    return "unknown";
+}
+
+/*
+* returns an iterator over $value, which may be an array, range, dict, file, or an iterator,
+* which is returned as-is. returns NULL for anything else.
+*/
+NNObjIterator* nn_iterator_fromvalue(NNState* state, NNValue value)
+{
+    NNObjRange* range;
+    NNObjIterator* iter;
+    if(nn_value_isiterator(value))
+    {
+        return nn_value_asiterator(value);
+    }
+    if(nn_value_isarray(value))
+    {
+        return nn_object_makeiterator(state, NEON_ITERKIND_ARRAY, value);
+    }
+    if(nn_value_isdict(value))
+    {
+        return nn_object_makeiterator(state, NEON_ITERKIND_DICT, value);
+    }
+    if(nn_value_isfile(value))
+    {
+        return nn_object_makeiterator(state, NEON_ITERKIND_FILE, value);
+    }
+    if(nn_value_isrange(value))
+    {
+        range = nn_value_asrange(value);
+        iter = nn_object_makeiterator(state, NEON_ITERKIND_RANGE, value);
+        iter->limit = range->range;
+        iter->rangestart = range->lower;
+        iter->rangestep = (range->lower > range->upper) ? -1 : 1;
+        return iter;
+    }
+    return NULL;
+}
+
+/* creates a stage that pulls from the iterator $source. */
+NNObjIterator* nn_iterator_makestage(NNState* state, NNIterKind kind, NNValue source, NNValue callable)
+{
+    NNObjIterator* iter;
+    iter = nn_object_makeiterator(state, kind, source);
+    iter->callable = callable;
+    if(!nn_value_isnull(callable))
+    {
+        /* gc fix */
+        nn_vm_stackpush(state, nn_value_fromobject(iter));
+        iter->nestargs = nn_object_makearray(state);
+        iter->arity = nn_nestcall_prepare(state, callable, nn_value_fromobject(iter), iter->nestargs);
+        nn_vm_stackpop(state);
+    }
+    return iter;
+}
+
+/*
+* calls the callable of a map or filter stage with $value and its index, and stores the result
+* in $dest. returns false, and marks the stage failed, if the callable threw.
+* $value is kept in $current for the duration of the call, so that it stays reachable.
+*/
+bool nn_iterator_callstage(NNState* state, NNObjIterator* iter, NNValue value, NNValue* dest)
+{
+    iter->current = value;
+    if(iter->arity > 0)
+    {
+        iter->nestargs->varray->listitems[0] = value;
+        if(iter->arity > 1)
+        {
+            iter->nestargs->varray->listitems[1] = nn_value_makenumber(iter->position);
+        }
+    }
+    if(!nn_nestcall_callfunction(state, iter->callable, nn_value_fromobject(iter), iter->nestargs, dest))
     {
-        return nn_value_asmodule(field->value);
+        iter->failed = true;
+        return false;
     }
-    physpath = nn_import_resolvepath(state, modulename->sbuf->data, intomodule->physicalpath->sbuf->data, NULL, false);
-    if(physpath == NULL)
+    iter->position++;
+    return true;
+}
+
+NNValue nn_iterator_makepair(NNState* state, NNValue first, NNValue second)
+{
+    NNObjArray* pair;
+    pair = nn_object_makearray(state);
+    nn_array_push(pair, first);
+    nn_array_push(pair, second);
+    return nn_value_fromobject(pair);
+}
+
+/*
+* reads the next line of a file source. with a $limit, reads up to that many lines at once,
+* and returns them as an array.
+*/
+bool nn_iterator_nextline(NNState* state, NNObjIterator* iter, NNValue* dest)
+{
+    size_t len;
+    NNObjFile* file;
+    NNObjArray* batch;
+    file = nn_value_asfile(iter->source);
+    if(iter->limit == 0)
     {
-        nn_exceptions_throw(state, "module not found: '%s'\n", modulename->sbuf->data);
-        return NULL;
+        if(!nn_file_readline(state, file, iter->chomp, &len))
+        {
+            return false;
+        }
+        *dest = nn_value_fromobject(nn_string_copylen(state, file->linebuf, len));
+        return true;
     }
-    fprintf(stderr, "loading module from '%s'\n", physpath);
-    source = nn_util_filereadfile(state, physpath, &fsz, false, 0);
-    if(source == NULL)
+    batch = nn_object_makearray(state);
+    iter->current = nn_value_fromobject(batch);
+    while(((int64_t)batch->varray->listcount < iter->limit) && nn_file_readline(state, file, iter->chomp, &len))
     {
-        nn_exceptions_throw(state, "could not read import file %s", physpath);
-        return NULL;
+        nn_array_push(batch, nn_value_fromobject(nn_string_copylen(state, file->linebuf, len)));
     }
-    nn_blob_init(state, &blob);
-    module = nn_module_make(state, modulename->sbuf->data, physpath, true);
-    nn_memory_free(physpath);
-    function = nn_astparser_compilesource(state, module, source, &blob, true, false);
-    nn_memory_free(source);
-    closure = nn_object_makefuncclosure(state, function);
-    callable = nn_value_fromobject(closure);
-    args = nn_object_makearray(state);
-    argc = nn_nestcall_prepare(state, callable, nn_value_makenull(), args);
-    if(!nn_nestcall_callfunction(state, callable, nn_value_makenull(), args, &retv))
+    if(batch->varray->listcount == 0)
     {
-        nn_blob_destroy(&blob);
-        nn_exceptions_throw(state, "failed to call compiled import closure");
-        return NULL;
+        return false;
     }
-    nn_blob_destroy(&blob);
-    return module;
+    *dest = nn_value_fromobject(batch);
+    return true;
 }
 
-char* nn_import_resolvepath(NNState* state, char* modulename, const char* currentfile, char* rootfile, bool isrelative)
+/* parses the next non-blank line of an NDJSON file source. $position counts the lines read so far. */
+bool nn_iterator_nextjson(NNState* state, NNObjIterator* iter, NNValue* dest)
 {
+    bool ok;
     size_t i;
-    size_t mlen;
-    size_t splen;
-    char* path1;
-    char* path2;
-    char* retme;
-    const char* cstrpath;
-    struct stat stroot;
-    struct stat stmod;
-    NNObjString* pitem;
-    StringBuffer* pathbuf;
-    (void)rootfile;
-    (void)isrelative;
-    (void)stroot;
-    (void)stmod;
-    pathbuf = NULL;
-    mlen = strlen(modulename);
-    splen = state->importpath->listcount;
-    for(i=0; i<splen; i++)
+    size_t len;
+    NNObjFile* file;
+    NNObjArray* stack;
+    NNJSONParser jp;
+    file = nn_value_asfile(iter->source);
+    stack = nn_value_asarray(iter->other);
+    while(true)
     {
-        pitem = nn_value_asstring(state->importpath->listitems[i]);
-        if(pathbuf == NULL)
-        {
-            pathbuf = dyn_strbuf_makebasicempty(pitem->sbuf->length + mlen + 5, false);
-        }
-        else
+        if(!nn_file_readline(state, file, true, &len))
         {
-            dyn_strbuf_reset(pathbuf);
+            return false;
         }
-        dyn_strbuf_appendstrn(pathbuf, pitem->sbuf->data, pitem->sbuf->length);
-        if(dyn_strbuf_containschar(pathbuf, '@'))
+        iter->position++;
+        for(i = 0; (i < len) && isspace((unsigned char)file->linebuf[i]); i++)
         {
-            dyn_strbuf_charreplace(pathbuf, '@', modulename, mlen);
         }
-        else
+        if(i < len)
         {
-            dyn_strbuf_appendstr(pathbuf, "/");
-            dyn_strbuf_appendstr(pathbuf, modulename);
-            dyn_strbuf_appendstr(pathbuf, NEON_CONFIG_FILEEXT);
+            break;
         }
-        cstrpath = pathbuf->data; 
-        fprintf(stderr, "import: trying '%s' ... ", cstrpath);
-        if(nn_util_fsfileexists(state, cstrpath))
-        {
-            fprintf(stderr, "found!\n");
-            /* stop a core library from importing itself */
-            #if 0
-            if(stat(currentfile, &stroot) == -1)
+    }
+    nn_json_initparser(state, &jp, file->linebuf, len, stack);
+    ok = nn_json_parse(&jp);
+    nn_json_destroyparser(&jp);
+    if(!ok)
+    {
+        stack->varray->listcount = 0;
+        nn_exceptions_throw(state, "JSON.lines: %s on line %ld", jp.error, (long)iter->position);
+        return false;
+    }
+    *dest = stack->varray->listitems[0];
+    stack->varray->listcount = 0;
+    return true;
+}
+
+/*
+* pulls the next element of $iter into $dest, and returns false once $iter is exhausted.
+* the element is also stored in $current, which keeps it reachable until the next pull.
+* a stage whose callable threw ends the iteration, with $failed set on every stage after it;
+* callers must then return without touching the vm stack, where the handler expects the exception.
+*/
+bool nn_iterator_next(NNState* state, NNObjIterator* iter, NNValue* dest)
+{
+    bool ok;
+    int64_t ix;
+    NNValue res;
+    NNValue value;
+    NNValue second;
+    NNValArray* list;
+    NNObjDict* dict;
+    NNObjArray* chunk;
+    NNObjIterator* upstream;
+    if(iter->finished)
+    {
+        return false;
+    }
+    ok = false;
+    upstream = NULL;
+    if(iter->kind >= NEON_ITERKIND_MAP)
+    {
+        upstream = nn_value_asiterator(iter->source);
+    }
+    switch(iter->kind)
+    {
+        case NEON_ITERKIND_ARRAY:
             {
-                fprintf(stderr, "resolvepath: failed to stat current file '%s'\n", currentfile);
-                return NULL;
+                list = nn_value_asarray(iter->source)->varray;
+                if((size_t)iter->position < list->listcount)
+                {
+                    *dest = list->listitems[iter->position];
+                    iter->position++;
+                    ok = true;
+                }
             }
-            if(stat(cstrpath, &stmod) == -1)
+            break;
+        case NEON_ITERKIND_RANGE:
             {
-                fprintf(stderr, "resolvepath: failed to stat module file '%s'\n", cstrpath);
-                return NULL;
+                if(iter->position < iter->limit)
+                {
+                    *dest = nn_value_makenumber(iter->rangestart + (iter->position * iter->rangestep));
+                    iter->position++;
+                    ok = true;
+                }
             }
-            if(stroot.st_ino == stmod.st_ino)
+            break;
+        case NEON_ITERKIND_DICT:
             {
-                fprintf(stderr, "resolvepath: refusing to import itself\n");
-                return NULL;
+                dict = nn_value_asdict(iter->source);
+                ix = nn_dict_nextentry(dict, iter->position);
+                if(ix >= 0)
+                {
+                    iter->position = ix + 1;
+                    *dest = nn_iterator_makepair(state, dict->entries[ix].key, dict->entries[ix].value.value);
+                    ok = true;
+                }
             }
-            #endif
-            #if 0
-                path1 = osfn_realpath(cstrpath, NULL);
-                path2 = osfn_realpath(currentfile, NULL);
-            #else
-                path1 = strdup(cstrpath);
-                path2 = strdup(currentfile);
-            #endif
-            
-            if(path1 != NULL && path2 != NULL)
+            break;
+        case NEON_ITERKIND_FILE:
             {
-                if(memcmp(path1, path2, (int)strlen(path2)) == 0)
+                ok = nn_iterator_nextline(state, iter, dest);
+            }
+            break;
+        case NEON_ITERKIND_JSONLINES:
+            {
+                ok = nn_iterator_nextjson(state, iter, dest);
+            }
+            break;
+        case NEON_ITERKIND_CSV:
+            {
+                ok = nn_iterator_nextcsv(state, iter, dest);
+            }
+            break;
+        case NEON_ITERKIND_WALK:
+            {
+                ok = nn_iterator_nextwalk(state, iter, dest);
+            }
+            break;
+        case NEON_ITERKIND_MAP:
+            {
+                if(nn_iterator_next(state, upstream, &value))
                 {
-                    nn_memory_free(path1);
-                    nn_memory_free(path2);
-                    fprintf(stderr, "resolvepath: refusing to import itself\n");
-                    return NULL;
+                    ok = nn_iterator_callstage(state, iter, value, dest);
                 }
-                nn_memory_free(path2);
-                dyn_strbuf_destroy(pathbuf);
-                pathbuf = NULL;
-                retme = nn_util_strdup(path1);
-                nn_memory_free(path1);
-                return retme;
             }
-        }
-        else
-        {
-            fprintf(stderr, "does not exist\n");
-        }
-    }
-    if(pathbuf != NULL)
-    {
-        dyn_strbuf_destroy(pathbuf);
+            break;
+        case NEON_ITERKIND_FILTER:
+            {
+                while(nn_iterator_next(state, upstream, &value))
+                {
+                    if(!nn_iterator_callstage(state, iter, value, &res))
+                    {
+                        break;
+                    }
+                    if(!nn_value_isfalse(res))
+                    {
+                        *dest = value;
+                        ok = true;
+                        break;
+                    }
+                }
+            }
+            break;
+        case NEON_ITERKIND_TAKE:
+            {
+                /* never pull more than needed, so that take() can stop an infinite or expensive source. */
+                if((iter->position < iter->limit) && nn_iterator_next(state, upstream, dest))
+                {
+                    iter->position++;
+                    ok = true;
+                }
+            }
+            break;
+        case NEON_ITERKIND_SKIP:
+            {
+                while(iter->position < iter->limit)
+                {
+                    if(!nn_iterator_next(state, upstream, &value))
+                    {
+                        break;
+                    }
+                    iter->position++;
+                }
+                ok = nn_iterator_next(state, upstream, dest);
+            }
+            break;
+        case NEON_ITERKIND_ZIP:
+            {
+                if(nn_iterator_next(state, upstream, &value) && nn_iterator_next(state, nn_value_asiterator(iter->other), &second))
+                {
+                    *dest = nn_iterator_makepair(state, value, second);
+                    ok = true;
+                }
+                iter->failed = nn_value_asiterator(iter->other)->failed;
+            }
+            break;
+        case NEON_ITERKIND_ENUMERATE:
+            {
+                if(nn_iterator_next(state, upstream, &value))
+                {
+                    *dest = nn_iterator_makepair(state, nn_value_makenumber(iter->position), value);
+                    iter->position++;
+                    ok = true;
+                }
+            }
+            break;
+        case NEON_ITERKIND_CHUNK:
+            {
+                chunk = nn_object_makearray(state);
+                iter->current = nn_value_fromobject(chunk);
+                while((int64_t)chunk->varray->listcount < iter->limit)
+                {
+                    if(!nn_iterator_next(state, upstream, &value))
+                    {
+                        break;
+                    }
+                    nn_array_push(chunk, value);
+                }
+                if(chunk->varray->listcount > 0)
+                {
+                    *dest = nn_value_fromobject(chunk);
+                    ok = true;
+                }
+            }
+            break;
     }
-    return NULL;
-}
-
-char* nn_util_fsgetbasename(NNState* state, char* path)
-{
-    (void)state;
-    return osfn_basename(path);
-}
-
-
-NNValue nn_objfndict_length(NNState* state, NNArguments* args)
-{
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    return nn_value_makenumber(nn_value_asdict(args->thisval)->names->listcount);
-}
-
-NNValue nn_objfndict_add(NNState* state, NNArguments* args)
-{
-    NNValue tempvalue;
-    NNObjDict* dict;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 2);
-    dict = nn_value_asdict(args->thisval);
-    if(nn_tableval_get(dict->htab, args->args[0], &tempvalue))
+    if((upstream != NULL) && upstream->failed)
     {
-        NEON_RETURNERROR("duplicate key %s at add()", nn_value_tostring(state, args->args[0])->sbuf->data);
+        iter->failed = true;
     }
-    nn_dict_addentry(dict, args->args[0], args->args[1]);
-    return nn_value_makenull();
-}
-
-NNValue nn_objfndict_set(NNState* state, NNArguments* args)
-{
-    NNValue value;
-    NNObjDict* dict;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 2);
-    dict = nn_value_asdict(args->thisval);
-    if(!nn_tableval_get(dict->htab, args->args[0], &value))
+    if(iter->failed)
     {
-        nn_dict_addentry(dict, args->args[0], args->args[1]);
+        ok = false;
     }
-    else
+    if(!ok)
     {
-        nn_dict_setentry(dict, args->args[0], args->args[1]);
+        iter->finished = true;
+        iter->current = nn_value_makenull();
+        return false;
     }
-    return nn_value_makenull();
+    iter->current = *dest;
+    return true;
 }
 
-NNValue nn_objfndict_clear(NNState* state, NNArguments* args)
+NNValue nn_objfniterator_constructor(NNState* state, NNArguments* args)
 {
-    NNObjDict* dict;
+    NNObjIterator* iter;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    dict = nn_value_asdict(args->thisval);
-    nn_vallist_destroy(dict->names);
-    nn_tableval_destroy(dict->htab);
-    return nn_value_makenull();
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    iter = nn_iterator_fromvalue(state, args->args[0]);
+    if(iter == NULL)
+    {
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "cannot create Iterator from %s", nn_value_typename(args->args[0]));
+    }
+    return nn_value_fromobject(iter);
 }
 
-NNValue nn_objfndict_clone(NNState* state, NNArguments* args)
+/* implements Array.iter(), Dict.iter() and Range.iter(). */
+NNValue nn_objfniterator_iterthis(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjDict* dict;
-    NNObjDict* newdict;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    dict = nn_value_asdict(args->thisval);
-    newdict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
-    nn_tableval_addall(dict->htab, newdict->htab);
-    for(i = 0; i < dict->names->listcount; i++)
-    {
-        nn_vallist_push(newdict->names, dict->names->listitems[i]);
-    }
-    return nn_value_fromobject(newdict);
+    return nn_value_fromobject(nn_iterator_fromvalue(state, args->thisval));
 }
 
-NNValue nn_objfndict_compact(NNState* state, NNArguments* args)
+NNValue nn_objfniterator_map(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjDict* dict;
-    NNObjDict* newdict;
-    NNValue tmpvalue;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    dict = nn_value_asdict(args->thisval);
-    newdict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
-    tmpvalue = nn_value_makenull();
-    for(i = 0; i < dict->names->listcount; i++)
-    {
-        nn_tableval_get(dict->htab, dict->names->listitems[i], &tmpvalue);
-        if(!nn_value_compare(state, tmpvalue, nn_value_makenull()))
-        {
-            nn_dict_addentry(newdict, dict->names->listitems[i], tmpvalue);
-        }
-    }
-    return nn_value_fromobject(newdict);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    return nn_value_fromobject(nn_iterator_makestage(state, NEON_ITERKIND_MAP, args->thisval, args->args[0]));
 }
 
-NNValue nn_objfndict_contains(NNState* state, NNArguments* args)
+NNValue nn_objfniterator_filter(NNState* state, NNArguments* args)
 {
-    NNValue value;
-    NNObjDict* dict;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    dict = nn_value_asdict(args->thisval);
-    return nn_value_makebool(nn_tableval_get(dict->htab, args->args[0], &value));
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    return nn_value_fromobject(nn_iterator_makestage(state, NEON_ITERKIND_FILTER, args->thisval, args->args[0]));
 }
 
-NNValue nn_objfndict_extend(NNState* state, NNArguments* args)
+/* implements take(), skip() and chunk(), which all take a count. */
+NNValue nn_iterator_makecounted(NNState* state, NNArguments* args, NNIterKind kind, int64_t mincount)
 {
-    size_t i;
-    NNValue tmp;
-    NNObjDict* dict;
-    NNObjDict* dictcpy;
+    int64_t count;
+    NNObjIterator* iter;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isdict);
-    dict = nn_value_asdict(args->thisval);
-    dictcpy = nn_value_asdict(args->args[0]);
-    for(i = 0; i < dictcpy->names->listcount; i++)
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    count = (int64_t)nn_value_asnumber(args->args[0]);
+    if(count < mincount)
     {
-        if(!nn_tableval_get(dict->htab, dictcpy->names->listitems[i], &tmp))
-        {
-            nn_vallist_push(dict->names, dictcpy->names->listitems[i]);
-        }
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() expects a count of at least %d", args->name, (int)mincount);
     }
-    nn_tableval_addall(dictcpy->htab, dict->htab);
-    return nn_value_makenull();
+    iter = nn_iterator_makestage(state, kind, args->thisval, nn_value_makenull());
+    iter->limit = count;
+    return nn_value_fromobject(iter);
 }
 
-NNValue nn_objfndict_get(NNState* state, NNArguments* args)
+NNValue nn_objfniterator_take(NNState* state, NNArguments* args)
 {
-    NNObjDict* dict;
-    NNProperty* field;
+    return nn_iterator_makecounted(state, args, NEON_ITERKIND_TAKE, 0);
+}
+
+NNValue nn_objfniterator_skip(NNState* state, NNArguments* args)
+{
+    return nn_iterator_makecounted(state, args, NEON_ITERKIND_SKIP, 0);
+}
+
+NNValue nn_objfniterator_chunk(NNState* state, NNArguments* args)
+{
+    return nn_iterator_makecounted(state, args, NEON_ITERKIND_CHUNK, 1);
+}
+
+NNValue nn_objfniterator_zip(NNState* state, NNArguments* args)
+{
+    NNObjIterator* iter;
+    NNObjIterator* other;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    dict = nn_value_asdict(args->thisval);
-    field = nn_dict_getentry(dict, args->args[0]);
-    if(field == NULL)
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    other = nn_iterator_fromvalue(state, args->args[0]);
+    if(other == NULL)
     {
-        if(args->count == 1)
-        {
-            return nn_value_makenull();
-        }
-        else
-        {
-            return args->args[1];
-        }
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "cannot zip with %s", nn_value_typename(args->args[0]));
     }
-    return field->value;
+    nn_gcmem_protect(state, (NNObject*)other);
+    iter = nn_iterator_makestage(state, NEON_ITERKIND_ZIP, args->thisval, nn_value_makenull());
+    iter->other = nn_value_fromobject(other);
+    return nn_value_fromobject(iter);
 }
 
-NNValue nn_objfndict_keys(NNState* state, NNArguments* args)
+NNValue nn_objfniterator_enumerate(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjDict* dict;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_fromobject(nn_iterator_makestage(state, NEON_ITERKIND_ENUMERATE, args->thisval, nn_value_makenull()));
+}
+
+NNValue nn_objfniterator_collect(NNState* state, NNArguments* args)
+{
+    NNValue value;
     NNObjArray* list;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    dict = nn_value_asdict(args->thisval);
     list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    for(i = 0; i < dict->names->listcount; i++)
+    while(nn_iterator_next(state, nn_value_asiterator(args->thisval), &value))
+    {
+        nn_array_push(list, value);
+    }
+    if(nn_value_asiterator(args->thisval)->failed)
     {
-        nn_array_push(list, dict->names->listitems[i]);
+        return nn_value_makenull();
     }
     return nn_value_fromobject(list);
 }
 
-NNValue nn_objfndict_values(NNState* state, NNArguments* args)
+NNValue nn_objfniterator_count(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjDict* dict;
-    NNObjArray* list;
-    NNProperty* field;
+    size_t count;
+    NNValue value;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    dict = nn_value_asdict(args->thisval);
-    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    for(i = 0; i < dict->names->listcount; i++)
+    count = 0;
+    while(nn_iterator_next(state, nn_value_asiterator(args->thisval), &value))
     {
-        field = nn_dict_getentry(dict, dict->names->listitems[i]);
-        nn_array_push(list, field->value);
+        count++;
     }
-    return nn_value_fromobject(list);
+    if(nn_value_asiterator(args->thisval)->failed)
+    {
+        return nn_value_makenull();
+    }
+    return nn_value_makenumber(count);
 }
 
-NNValue nn_objfndict_remove(NNState* state, NNArguments* args)
+NNValue nn_objfniterator_each(NNState* state, NNArguments* args)
 {
     size_t i;
-    int index;
+    int arity;
     NNValue value;
-    NNObjDict* dict;
+    NNValue callable;
+    NNValue unused;
+    NNObjArray* nestargs;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    dict = nn_value_asdict(args->thisval);
-    if(nn_tableval_get(dict->htab, args->args[0], &value))
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    callable = args->args[0];
+    nestargs = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    i = 0;
+    while(nn_iterator_next(state, nn_value_asiterator(args->thisval), &value))
     {
-        nn_tableval_delete(dict->htab, args->args[0]);
-        index = -1;
-        for(i = 0; i < dict->names->listcount; i++)
+        if(arity > 0)
         {
-            if(nn_value_compare(state, dict->names->listitems[i], args->args[0]))
+            nestargs->varray->listitems[0] = value;
+            if(arity > 1)
             {
-                index = i;
-                break;
+                nestargs->varray->listitems[1] = nn_value_makenumber(i);
             }
         }
-        for(i = index; i < dict->names->listcount; i++)
+        if(!nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &unused))
         {
-            dict->names->listitems[i] = dict->names->listitems[i + 1];
+            return nn_value_makenull();
         }
-        dict->names->listcount--;
-        return value;
+        i++;
     }
+    if(nn_value_asiterator(args->thisval)->failed)
+    {
+        return nn_value_makenull();
+    }
+    nn_vm_stackpop(state);
     return nn_value_makenull();
 }
 
-NNValue nn_objfndict_isempty(NNState* state, NNArguments* args)
+/*
+* reduce(fn) and reduce(fn, initial), with fn(accumulator, value, index).
+* without an initial value, the first element is used.
+*/
+NNValue nn_objfniterator_reduce(NNState* state, NNArguments* args)
 {
+    size_t i;
+    size_t accslot;
+    int arity;
+    NNValue value;
+    NNValue callable;
+    NNValue accumulator;
+    NNObjIterator* iter;
+    NNObjArray* nestargs;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    return nn_value_makebool(nn_value_asdict(args->thisval)->names->listcount == 0);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    iter = nn_value_asiterator(args->thisval);
+    callable = args->args[0];
+    i = 0;
+    accumulator = nn_value_makenull();
+    if(args->count == 2)
+    {
+        accumulator = args->args[1];
+    }
+    else if(nn_iterator_next(state, iter, &value))
+    {
+        accumulator = value;
+        i++;
+    }
+    if(iter->failed)
+    {
+        return nn_value_makenull();
+    }
+    /* the accumulator lives in a stack slot of its own, since pulling from iter may run the gc. */
+    nn_vm_stackpush(state, accumulator);
+    accslot = state->vmstate.stackidx - 1;
+    nestargs = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    while(nn_iterator_next(state, iter, &value))
+    {
+        if(arity > 0)
+        {
+            nestargs->varray->listitems[0] = accumulator;
+            if(arity > 1)
+            {
+                nestargs->varray->listitems[1] = value;
+                if(arity > 2)
+                {
+                    nestargs->varray->listitems[2] = nn_value_makenumber(i);
+                }
+            }
+        }
+        if(!nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &accumulator))
+        {
+            return nn_value_makenull();
+        }
+        state->vmstate.stackvalues[accslot] = accumulator;
+        i++;
+    }
+    if(iter->failed)
+    {
+        return nn_value_makenull();
+    }
+    nn_vm_stackpop(state);
+    nn_vm_stackpop(state);
+    return accumulator;
 }
 
-NNValue nn_objfndict_findkey(NNState* state, NNArguments* args)
+NNValue nn_objfniterator_iter(NNState* state, NNArguments* args)
 {
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    return nn_tableval_findkey(nn_value_asdict(args->thisval)->htab, args->args[0]);
+    return nn_value_asiterator(args->thisval)->current;
 }
 
-NNValue nn_objfndict_tolist(NNState* state, NNArguments* args)
+/* the key of each element is its position; the element itself is kept in $current for @iter. */
+NNValue nn_objfniterator_itern(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjArray* list;
-    NNObjDict* dict;
-    NNObjArray* namelist;
-    NNObjArray* valuelist;
+    NNValue value;
+    NNObjIterator* iter;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    dict = nn_value_asdict(args->thisval);
-    namelist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    valuelist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    for(i = 0; i < dict->names->listcount; i++)
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    iter = nn_value_asiterator(args->thisval);
+    if(!nn_iterator_next(state, iter, &value))
     {
-        nn_array_push(namelist, dict->names->listitems[i]);
-        NNValue value;
-        if(nn_tableval_get(dict->htab, dict->names->listitems[i], &value))
-        {
-            nn_array_push(valuelist, value);
-        }
-        else
-        {
-            /* theoretically impossible */
-            nn_array_push(valuelist, nn_value_makenull());
-        }
+        return nn_value_makebool(false);
     }
-    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    nn_array_push(list, nn_value_fromobject(namelist));
-    nn_array_push(list, nn_value_fromobject(valuelist));
-    return nn_value_fromobject(list);
+    if(nn_value_isnull(args->args[0]))
+    {
+        return nn_value_makenumber(0);
+    }
+    return nn_value_makenumber(nn_value_asnumber(args->args[0]) + 1);
 }
 
-NNValue nn_objfndict_iter(NNState* state, NNArguments* args)
+NNValue nn_objfnarray_each(NNState* state, NNArguments* args)
 {
-    NNValue result;
-    NNObjDict* dict;
+    size_t i;
+    size_t arity;
+    NNValue callable;
+    NNValue unused;
+    NNObjArray* list;
+    NNObjArray* nestargs;
     NNArgCheck check;
-    nn_argcheck_init(state, &check,  args);
+    nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    dict = nn_value_asdict(args->thisval);
-    if(nn_tableval_get(dict->htab, args->args[0], &result))
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    list = nn_value_asarray(args->thisval);
+    callable = args->args[0];
+    nestargs = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    for(i = 0; i < list->varray->listcount; i++)
     {
-        return result;
+        if(arity > 0)
+        {
+            nestargs->varray->listitems[0] = list->varray->listitems[i];
+            if(arity > 1)
+            {
+                nestargs->varray->listitems[1] = nn_value_makenumber(i);
+            }
+        }
+        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &unused);
     }
+    nn_vm_stackpop(state);
     return nn_value_makenull();
 }
 
-NNValue nn_objfndict_itern(NNState* state, NNArguments* args)
+
+NNValue nn_objfnarray_map(NNState* state, NNArguments* args)
 {
     size_t i;
-    NNObjDict* dict;
+    size_t arity;
+    NNValue res;
+    NNValue callable;
+    NNObjArray* list;
+    NNObjArray* nestargs;
+    NNObjArray* resultlist;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    dict = nn_value_asdict(args->thisval);
-    if(nn_value_isnull(args->args[0]))
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
+    list = nn_value_asarray(args->thisval);
+    callable = args->args[0];
+    nestargs = nn_object_makearray(state);
+    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
+    resultlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < list->varray->listcount; i++)
     {
-        if(dict->names->listcount == 0)
+        if(!nn_value_isnull(list->varray->listitems[i]))
         {
-            return nn_value_makebool(false);
+            if(arity > 0)
+            {
+                nestargs->varray->listitems[0] = list->varray->listitems[i];
+                if(arity > 1)
+                {
+                    nestargs->varray->listitems[1] = nn_value_makenumber(i);
+                }
+            }
+            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &res);
+            nn_array_push(resultlist, res);
         }
-        return dict->names->listitems[0];
-    }
-    for(i = 0; i < dict->names->listcount; i++)
-    {
-        if(nn_value_compare(state, args->args[0], dict->names->listitems[i]) && (i + 1) < dict->names->listcount)
+        else
         {
-            return dict->names->listitems[i + 1];
+            nn_array_push(resultlist, nn_value_makenull());
         }
     }
-    return nn_value_makenull();
+    return nn_value_fromobject(resultlist);
 }
 
-NNValue nn_objfndict_each(NNState* state, NNArguments* args)
+
+NNValue nn_objfnarray_filter(NNState* state, NNArguments* args)
 {
     size_t i;
-    int arity;
-    NNValue value;
+    size_t arity;
     NNValue callable;
-    NNValue unused;
-    NNObjDict* dict;
+    NNValue result;
+    NNObjArray* list;
     NNObjArray* nestargs;
+    NNObjArray* resultlist;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
     NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    dict = nn_value_asdict(args->thisval);
+    list = nn_value_asarray(args->thisval);
     callable = args->args[0];
     nestargs = nn_object_makearray(state);
     nn_vm_stackpush(state, nn_value_fromobject(nestargs));
     arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    value = nn_value_makenull();
-    for(i = 0; i < dict->names->listcount; i++)
+    resultlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i = 0; i < list->varray->listcount; i++)
     {
-        if(arity > 0)
+        if(!nn_value_isnull(list->varray->listitems[i]))
         {
-            nn_tableval_get(dict->htab, dict->names->listitems[i], &value);
-            nestargs->varray->listitems[0] = value;
-            if(arity > 1)
+            if(arity > 0)
+            {
+                nestargs->varray->listitems[0] = list->varray->listitems[i];
+                if(arity > 1)
+                {
+                    nestargs->varray->listitems[1] = nn_value_makenumber(i);
+                }
+            }
+            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
+            if(!nn_value_isfalse(result))
             {
-                nestargs->varray->listitems[1] = dict->names->listitems[i];
+                nn_array_push(resultlist, list->varray->listitems[i]);
             }
         }
-        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &unused);
     }
-    /* pop the argument list */
     nn_vm_stackpop(state);
-    return nn_value_makenull();
+    return nn_value_fromobject(resultlist);
 }
 
-NNValue nn_objfndict_filter(NNState* state, NNArguments* args)
+NNValue nn_objfnarray_some(NNState* state, NNArguments* args)
 {
     size_t i;
-    int arity;
-    NNValue value;
+    size_t arity;
     NNValue callable;
     NNValue result;
-    NNObjDict* dict;
+    NNObjArray* list;
     NNObjArray* nestargs;
-    NNObjDict* resultdict;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
     NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    dict = nn_value_asdict(args->thisval);
+    list = nn_value_asarray(args->thisval);
     callable = args->args[0];
     nestargs = nn_object_makearray(state);
     nn_vm_stackpush(state, nn_value_fromobject(nestargs));
     arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    resultdict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
-    value = nn_value_makenull();
-    for(i = 0; i < dict->names->listcount; i++)
+    for(i = 0; i < list->varray->listcount; i++)
     {
-        nn_tableval_get(dict->htab, dict->names->listitems[i], &value);
-        if(arity > 0)
+        if(!nn_value_isnull(list->varray->listitems[i]))
         {
-            nestargs->varray->listitems[0] = value;
-            if(arity > 1)
+            if(arity > 0)
+            {
+                nestargs->varray->listitems[0] = list->varray->listitems[i];
+                if(arity > 1)
+                {
+                    nestargs->varray->listitems[1] = nn_value_makenumber(i);
+                }
+            }
+            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
+            if(!nn_value_isfalse(result))
             {
-                nestargs->varray->listitems[1] = dict->names->listitems[i];
+                nn_vm_stackpop(state);
+                return nn_value_makebool(true);
             }
         }
-        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
-        if(!nn_value_isfalse(result))
-        {
-            nn_dict_addentry(resultdict, dict->names->listitems[i], value);
-        }
     }
-    /* pop the call list */
     nn_vm_stackpop(state);
-    return nn_value_fromobject(resultdict);
+    return nn_value_makebool(false);
 }
 
-NNValue nn_objfndict_some(NNState* state, NNArguments* args)
+
+NNValue nn_objfnarray_every(NNState* state, NNArguments* args)
 {
     size_t i;
-    int arity;
+    size_t arity;
     NNValue result;
-    NNValue value;
     NNValue callable;
-    NNObjDict* dict;
+    NNObjArray* list;
     NNObjArray* nestargs;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
     NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    dict = nn_value_asdict(args->thisval);
+    list = nn_value_asarray(args->thisval);
     callable = args->args[0];
     nestargs = nn_object_makearray(state);
     nn_vm_stackpush(state, nn_value_fromobject(nestargs));
     arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    value = nn_value_makenull();
-    for(i = 0; i < dict->names->listcount; i++)
+    for(i = 0; i < list->varray->listcount; i++)
     {
-        if(arity > 0)
+        if(!nn_value_isnull(list->varray->listitems[i]))
         {
-            nn_tableval_get(dict->htab, dict->names->listitems[i], &value);
-            nestargs->varray->listitems[0] = value;
-            if(arity > 1)
+            if(arity > 0)
             {
-                nestargs->varray->listitems[1] = dict->names->listitems[i];
+                nestargs->varray->listitems[0] = list->varray->listitems[i];
+                if(arity > 1)
+                {
+                    nestargs->varray->listitems[1] = nn_value_makenumber(i);
+                }
+            }
+            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
+            if(nn_value_isfalse(result))
+            {
+                nn_vm_stackpop(state);
+                return nn_value_makebool(false);
             }
-        }
-        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
-        if(!nn_value_isfalse(result))
-        {
-            /* pop the call list */
-            nn_vm_stackpop(state);
-            return nn_value_makebool(true);
         }
     }
-    /* pop the call list */
     nn_vm_stackpop(state);
-    return nn_value_makebool(false);
+    return nn_value_makebool(true);
 }
 
-NNValue nn_objfndict_every(NNState* state, NNArguments* args)
+NNValue nn_objfnarray_reduce(NNState* state, NNArguments* args)
 {
     size_t i;
-    int arity;
-    NNValue value;
-    NNValue callable;  
-    NNValue result;
-    NNObjDict* dict;
+    size_t arity;
+    size_t startindex;
+    NNValue callable;
+    NNValue accumulator;
+    NNObjArray* list;
     NNObjArray* nestargs;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
     NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    dict = nn_value_asdict(args->thisval);
+    list = nn_value_asarray(args->thisval);
     callable = args->args[0];
+    startindex = 0;
+    accumulator = nn_value_makenull();
+    if(args->count == 2)
+    {
+        accumulator = args->args[1];
+    }
+    if(nn_value_isnull(accumulator) && list->varray->listcount > 0)
+    {
+        accumulator = list->varray->listitems[0];
+        startindex = 1;
+    }
     nestargs = nn_object_makearray(state);
     nn_vm_stackpush(state, nn_value_fromobject(nestargs));
     arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    value = nn_value_makenull();
-    for(i = 0; i < dict->names->listcount; i++)
+    for(i = startindex; i < list->varray->listcount; i++)
     {
-        if(arity > 0)
+        if(!nn_value_isnull(list->varray->listitems[i]) && !nn_value_isnull(list->varray->listitems[i]))
         {
-            nn_tableval_get(dict->htab, dict->names->listitems[i], &value);
-            nestargs->varray->listitems[0] = value;
-            if(arity > 1)
+            if(arity > 0)
             {
-                nestargs->varray->listitems[1] = dict->names->listitems[i];
+                nestargs->varray->listitems[0] = accumulator;
+                if(arity > 1)
+                {
+                    nestargs->varray->listitems[1] = list->varray->listitems[i];
+                    if(arity > 2)
+                    {
+                        nestargs->varray->listitems[2] = nn_value_makenumber(i);
+                        if(arity > 4)
+                        {
+                            nestargs->varray->listitems[3] = args->thisval;
+                        }
+                    }
+                }
             }
+            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &accumulator);
         }
-        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
-        if(nn_value_isfalse(result))
+    }
+    nn_vm_stackpop(state);
+    return accumulator;
+}
+
+NNValue nn_objfnrange_lower(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makenumber(nn_value_asrange(args->thisval)->lower);
+}
+
+NNValue nn_objfnrange_upper(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makenumber(nn_value_asrange(args->thisval)->upper);
+}
+
+NNValue nn_objfnrange_range(NNState* state, NNArguments* args)
+{
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    return nn_value_makenumber(nn_value_asrange(args->thisval)->range);
+}
+
+NNValue nn_objfnrange_iter(NNState* state, NNArguments* args)
+{
+    int val;
+    int index;
+    NNObjRange* range;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    range = nn_value_asrange(args->thisval);
+    index = nn_value_asnumber(args->args[0]);
+    if(index >= 0 && index < range->range)
+    {
+        if(index == 0)
         {
-            /* pop the call list */
-            nn_vm_stackpop(state);
-            return nn_value_makebool(false);
+            return nn_value_makenumber(range->lower);
+        }
+        if(range->lower > range->upper)
+        {
+            val = --range->lower;
+        }
+        else
+        {
+            val = ++range->lower;
+        }
+        return nn_value_makenumber(val);
+    }
+    return nn_value_makenull();
+}
+
+NNValue nn_objfnrange_itern(NNState* state, NNArguments* args)
+{
+    int index;
+    NNObjRange* range;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    range = nn_value_asrange(args->thisval);
+    if(nn_value_isnull(args->args[0]))
+    {
+        if(range->range == 0)
+        {
+            return nn_value_makenull();
         }
+        return nn_value_makenumber(0);
     }
-    /* pop the call list */
-    nn_vm_stackpop(state);
-    return nn_value_makebool(true);
+    if(!nn_value_isnumber(args->args[0]))
+    {
+        NEON_RETURNERROR("ranges are numerically indexed");
+    }
+    index = (int)nn_value_asnumber(args->args[0]) + 1;
+    if(index < range->range)
+    {
+        return nn_value_makenumber(index);
+    }
+    return nn_value_makenull();
 }
 
-NNValue nn_objfndict_reduce(NNState* state, NNArguments* args)
+NNValue nn_objfnrange_loop(NNState* state, NNArguments* args)
 {
-    size_t i;
+    int i;
     int arity;
-    int startindex;
-    NNValue value;
     NNValue callable;
-    NNValue accumulator;
-    NNObjDict* dict;
+    NNValue unused;
+    NNObjRange* range;
     NNObjArray* nestargs;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
     NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    dict = nn_value_asdict(args->thisval);
+    range = nn_value_asrange(args->thisval);
     callable = args->args[0];
-    startindex = 0;
-    accumulator = nn_value_makenull();
-    if(args->count == 2)
-    {
-        accumulator = args->args[1];
-    }
-    if(nn_value_isnull(accumulator) && dict->names->listcount > 0)
-    {
-        nn_tableval_get(dict->htab, dict->names->listitems[0], &accumulator);
-        startindex = 1;
-    }
     nestargs = nn_object_makearray(state);
     nn_vm_stackpush(state, nn_value_fromobject(nestargs));
     arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    value = nn_value_makenull();
-    for(i = startindex; i < dict->names->listcount; i++)
+    for(i = 0; i < range->range; i++)
     {
-        /* only call map for non-empty values in a list. */
-        if(!nn_value_isnull(dict->names->listitems[i]) && !nn_value_isnull(dict->names->listitems[i]))
+        if(arity > 0)
         {
-            if(arity > 0)
+            nestargs->varray->listitems[0] = nn_value_makenumber(i);
+            if(arity > 1)
             {
-                nestargs->varray->listitems[0] = accumulator;
-                if(arity > 1)
-                {
-                    nn_tableval_get(dict->htab, dict->names->listitems[i], &value);
-                    nestargs->varray->listitems[1] = value;
-                    if(arity > 2)
-                    {
-                        nestargs->varray->listitems[2] = dict->names->listitems[i];
-                        if(arity > 4)
-                        {
-                            nestargs->varray->listitems[3] = args->thisval;
-                        }
-                    }
-                }
+                nestargs->varray->listitems[1] = nn_value_makenumber(i);
             }
-            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &accumulator);
         }
+        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &unused);
     }
-    /* pop the call list */
     nn_vm_stackpop(state);
-    return accumulator;
+    return nn_value_makenull();
 }
 
-
-
-#define FILE_ERROR(type, message) \
-    NEON_RETURNERROR(#type " -> %s", message, file->path->sbuf->data);
-
-#define RETURN_STATUS(status) \
-    if((status) == 0) \
-    { \
-        return nn_value_makebool(true); \
-    } \
-    else \
-    { \
-        FILE_ERROR(File, strerror(errno)); \
-    }
-
-#define DENY_STD() \
-    if(file->isstd) \
-    NEON_RETURNERROR("method not supported for std files");
-
-int nn_fileobject_close(NNObjFile* file)
+NNValue nn_objfnrange_expand(NNState* state, NNArguments* args)
 {
-    int result;
-    if(file->handle != NULL && !file->isstd)
+    int i;
+    NNValue val;
+    NNObjRange* range;
+    NNObjArray* oa;
+    range = nn_value_asrange(args->thisval);
+    oa = nn_object_makearray(state);
+    for(i = 0; i < range->range; i++)
     {
-        fflush(file->handle);
-        result = fclose(file->handle);
-        file->handle = NULL;
-        file->isopen = false;
-        file->number = -1;
-        file->istty = false;
-        return result;
+        val = nn_value_makenumber(i);
+        nn_array_push(oa, val);
     }
-    return -1;
+    return nn_value_fromobject(oa);
 }
 
-bool nn_fileobject_open(NNObjFile* file)
+NNValue nn_objfnrange_constructor(NNState* state, NNArguments* args)
 {
-    if(file->handle != NULL)
-    {
-        return true;
-    }
-    if(file->handle == NULL && !file->isstd)
-    {
-        file->handle = fopen(file->path->sbuf->data, file->mode->sbuf->data);
-        if(file->handle != NULL)
-        {
-            file->isopen = true;
-            file->number = fileno(file->handle);
-            file->istty = osfn_isatty(file->number);
-            return true;
-        }
-        else
-        {
-            file->number = -1;
-            file->istty = false;
-        }
-        return false;
-    }
-    return false;
+    int a;
+    int b;
+    NNObjRange* orng;
+    a = nn_value_asnumber(args->args[0]);
+    b = nn_value_asnumber(args->args[1]);
+    orng = nn_object_makerange(state, a, b);
+    return nn_value_fromobject(orng);
 }
 
-NNValue nn_objfnfile_constructor(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_utf8numbytes(NNState* state, NNArguments* args)
 {
-    FILE* hnd;
-    const char* path;
-    const char* mode;
-    NNObjString* opath;
-    NNObjFile* file;
-    (void)hnd;
+    int incode;
+    int res;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    opath = nn_value_asstring(args->args[0]);
-    if(opath->sbuf->length == 0)
-    {
-        NEON_RETURNERROR("file path cannot be empty");
-    }
-    mode = "r";
-    if(args->count == 2)
-    {
-        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isstring);
-        mode = nn_value_asstring(args->args[1])->sbuf->data;
-    }
-    path = opath->sbuf->data;
-    file = (NNObjFile*)nn_gcmem_protect(state, (NNObject*)nn_object_makefile(state, NULL, false, path, mode));
-    nn_fileobject_open(file);
-    return nn_value_fromobject(file);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    incode = nn_value_asnumber(args->args[0]);
+    res = nn_util_utf8numbytes(incode);
+    return nn_value_makenumber(res);
 }
 
-NNValue nn_objfnfile_exists(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_utf8decode(NNState* state, NNArguments* args)
 {
-    NNObjString* file;
+    int res;
+    NNObjString* instr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
     NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    file = nn_value_asstring(args->args[0]);
-    return nn_value_makebool(nn_util_fsfileexists(state, file->sbuf->data));
+    instr = nn_value_asstring(args->args[0]);
+    res = nn_util_utf8decode((const uint8_t*)instr->sbuf->data, instr->sbuf->length);
+    return nn_value_makenumber(res);
 }
 
-NNValue nn_objfnfile_isfile(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_utf8encode(NNState* state, NNArguments* args)
 {
-    NNObjString* file;
+    int incode;
+    size_t len;
+    NNObjString* res;
+    char* buf;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    file = nn_value_asstring(args->args[0]);
-    return nn_value_makebool(nn_util_fsfileisfile(state, file->sbuf->data));
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    incode = nn_value_asnumber(args->args[0]);
+    buf = nn_util_utf8encode(incode, &len);
+    res = nn_string_takelen(state, buf, len);
+    return nn_value_fromobject(res);
 }
 
-NNValue nn_objfnfile_isdirectory(NNState* state, NNArguments* args)
+NNValue nn_util_stringutf8chars(NNState* state, NNArguments* args, bool onlycodepoint)
 {
-    NNObjString* file;
+    int cp;
+    bool havemax;
+    size_t counter;
+    size_t maxamount;
+    const char* cstr;
+    NNObjArray* res;
+    NNObjString* os;
+    NNObjString* instr;
+    utf8iterator_t iter;
+    havemax = false;
+    instr = nn_value_asstring(args->thisval);
+    if(args->count > 0)
+    {
+        havemax = true;
+        maxamount = nn_value_asnumber(args->args[0]);
+    }
+    res = nn_array_make(state);
+    counter = 0;
+    if(nn_string_isascii(instr))
+    {
+        /* every byte is a codepoint; no need to decode anything. */
+        for(counter = 0; counter < instr->sbuf->length; counter++)
+        {
+            if(havemax && ((counter + 1) == maxamount))
+            {
+                break;
+            }
+            cp = (uint8_t)instr->sbuf->data[counter];
+            if(onlycodepoint)
+            {
+                nn_array_push(res, nn_value_makenumber(cp));
+            }
+            else
+            {
+                nn_array_push(res, nn_value_fromobject(nn_string_copylen(state, instr->sbuf->data + counter, 1)));
+            }
+        }
+        return nn_value_fromobject(res);
+    }
+    nn_utf8iter_init(&iter, instr->sbuf->data, instr->sbuf->length);
+    while(nn_utf8iter_next(&iter))
+    {
+        cp = iter.codepoint;
+        cstr = nn_utf8iter_getchar(&iter);
+        counter++;
+        if(havemax)
+        {
+            if(counter == maxamount)
+            {
+                goto finalize;
+            }
+        }
+        if(onlycodepoint)
+        {
+            nn_array_push(res, nn_value_makenumber(cp));
+        }
+        else
+        {
+            os = nn_string_copylen(state, cstr, iter.charsize);
+            nn_array_push(res, nn_value_fromobject(os));
+        }
+    }
+    finalize:
+    return nn_value_fromobject(res);
+}
+
+NNValue nn_objfnstring_utf8length(NNState* state, NNArguments* args)
+{
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    file = nn_value_asstring(args->args[0]);
-    return nn_value_makebool(nn_util_fsfileisdirectory(state, file->sbuf->data));
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    selfstr = nn_value_asstring(args->thisval);
+    return nn_value_makenumber(nn_string_utf8length(selfstr));
 }
 
-
-NNValue nn_objfnfile_readstatic(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_utf8at(NNState* state, NNArguments* args)
 {
-    char* buf;
-    size_t thismuch;
-    size_t actualsz;
-    NNObjString* filepath;
+    int64_t idx;
+    int64_t cplen;
+    int64_t bstart;
+    int64_t bend;
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    thismuch = -1;
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    if(args->count > 1)
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    selfstr = nn_value_asstring(args->thisval);
+    idx = nn_value_asnumber(args->args[0]);
+    cplen = nn_string_utf8length(selfstr);
+    if(idx < 0)
     {
-        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
-        thismuch = (size_t)nn_value_asnumber(args->args[1]);
+        idx = cplen + idx;
     }
-    filepath = nn_value_asstring(args->args[0]);
-    buf = nn_util_filereadfile(state, filepath->sbuf->data, &actualsz, true, thismuch);
-    if(buf == NULL)
+    if((idx < 0) || (idx >= cplen))
     {
-        return nn_exceptions_throwclass(state, state->exceptions.ioerror, "%s: %s", filepath->sbuf->data, strerror(errno));
+        return nn_value_makenull();
     }
-    return nn_value_fromobject(nn_string_takelen(state, buf, actualsz));
+    bstart = nn_string_utf8offset(selfstr, idx);
+    bend = nn_string_utf8offset(selfstr, idx + 1);
+    return nn_value_fromobject(nn_string_copylen(state, selfstr->sbuf->data + bstart, bend - bstart));
 }
 
-
-NNValue nn_objfnfile_writestatic(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_utf8substring(NNState* state, NNArguments* args)
 {
-    bool appending;
-    size_t rt;
-    FILE* fh;
-    const char* mode;
-    NNObjString* filepath;
-    NNObjString* data;
+    int64_t start;
+    int64_t end;
+    int64_t cplen;
+    int64_t bstart;
+    int64_t bend;
+    NNObjString* selfstr;
     NNArgCheck check;
-    appending = false;
-    mode = "wb";
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isstring);
-    if(args->count > 2)
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    selfstr = nn_value_asstring(args->thisval);
+    cplen = nn_string_utf8length(selfstr);
+    start = nn_value_asnumber(args->args[0]);
+    end = cplen;
+    if(args->count > 1)
     {
-        NEON_ARGS_CHECKTYPE(&check, 2, nn_value_isbool);
-        appending = nn_value_asbool(args->args[2]);
+        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+        end = nn_value_asnumber(args->args[1]);
     }
-    if(appending)
+    if(start < 0)
     {
-        mode = "ab";
+        start = 0;
     }
-    filepath = nn_value_asstring(args->args[0]);
-    data = nn_value_asstring(args->args[1]);
-    fh = fopen(filepath->sbuf->data, mode);
-    if(fh == NULL)
+    if(end > cplen)
     {
-        return nn_exceptions_throwclass(state, state->exceptions.ioerror, strerror(errno));
+        end = cplen;
     }
-    rt = fwrite(data->sbuf->data, sizeof(char), data->sbuf->length, fh);
-    fclose(fh);
-    return nn_value_makenumber(rt);
-}
-
-
-NNValue nn_objfnfile_statstatic(NNState* state, NNArguments* args)
-{
-    NNObjString* file;
-    NNArgCheck check;
-    NNObjDict* dict;
-    struct stat st;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    dict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
-    file = nn_value_asstring(args->args[0]);
-    if(osfn_lstat(file->sbuf->data, &st) == 0)
+    if(end < start)
     {
-        nn_util_statfilldictphysfile(dict, &st);
-        return nn_value_fromobject(dict);
+        end = start;
     }
-    return nn_value_makenull();
-}
-
-NNValue nn_objfnfile_close(NNState* state, NNArguments* args)
-{
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    nn_fileobject_close(nn_value_asfile(args->thisval));
-    return nn_value_makenull();
+    if(start > cplen)
+    {
+        start = end = cplen;
+    }
+    bstart = nn_string_utf8offset(selfstr, start);
+    bend = nn_string_utf8offset(selfstr, end);
+    return nn_value_fromobject(nn_string_makeslice(state, selfstr, bstart, bend - bstart));
 }
 
-NNValue nn_objfnfile_open(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_utf8chars(NNState* state, NNArguments* args)
 {
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    nn_fileobject_open(nn_value_asfile(args->thisval));
-    return nn_value_makenull();
+    return nn_util_stringutf8chars(state, args, false);
 }
 
-NNValue nn_objfnfile_isopen(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_utf8codepoints(NNState* state, NNArguments* args)
 {
-    NNObjFile* file;
-    (void)state;
-    file = nn_value_asfile(args->thisval);
-    return nn_value_makebool(file->isstd || file->isopen);
+    return nn_util_stringutf8chars(state, args, true);
 }
 
-NNValue nn_objfnfile_isclosed(NNState* state, NNArguments* args)
-{
-    NNObjFile* file;
-    (void)state;
-    file = nn_value_asfile(args->thisval);
-    return nn_value_makebool(!file->isstd && !file->isopen);
-}
 
-NNValue nn_objfnfile_readmethod(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_fromcharcode(NNState* state, NNArguments* args)
 {
-    size_t readhowmuch;
-    NNIOResult res;
-    NNObjFile* file;
+    char ch;
+    NNObjString* os;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
-    readhowmuch = -1;
-    if(args->count == 1)
-    {
-        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-        readhowmuch = (size_t)nn_value_asnumber(args->args[0]);
-    }
-    file = nn_value_asfile(args->thisval);
-    if(!nn_file_read(file, readhowmuch, &res))
-    {
-        FILE_ERROR(NotFound, strerror(errno));
-    }
-    return nn_value_fromobject(nn_string_takelen(state, res.data, res.length));
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    ch = nn_value_asnumber(args->args[0]);
+    os = nn_string_copylen(state, &ch, 1);
+    return nn_value_fromobject(os);
 }
 
-
-NNValue nn_objfnfile_readline(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_constructor(NNState* state, NNArguments* args)
 {
-    long rdline;
-    size_t linelen;
-    char* strline;
-    NNObjFile* file;
+    NNObjString* os;
     NNArgCheck check;
-    NNObjString* nos;
+    (void)args;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
-    file = nn_value_asfile(args->thisval);
-    linelen = 0;
-    strline = NULL;
-    rdline = nn_util_filegetlinehandle(&strline, &linelen, file->handle);
-    if(rdline == -1)
-    {
-        return nn_value_makenull();
-    }
-    nos = nn_string_takelen(state, strline, rdline);
-    return nn_value_fromobject(nos);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    os = nn_string_copylen(state, "", 0);
+    return nn_value_fromobject(os);
 }
 
-NNValue nn_objfnfile_get(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_length(NNState* state, NNArguments* args)
 {
-    int ch;
-    NNObjFile* file;
     NNArgCheck check;
+    NNObjString* selfstr;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    file = nn_value_asfile(args->thisval);
-    ch = fgetc(file->handle);
-    if(ch == EOF)
-    {
-        return nn_value_makenull();
-    }
-    return nn_value_makenumber(ch);
+    selfstr = nn_value_asstring(args->thisval);
+    return nn_value_makenumber(selfstr->sbuf->length);
 }
 
-NNValue nn_objfnfile_gets(NNState* state, NNArguments* args)
+NNValue nn_string_fromrange(NNState* state, const char* buf, int len)
 {
-    long end;
-    long length;
-    long currentpos;
-    size_t bytesread;
-    char* buffer;
-    NNObjFile* file;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
-    length = -1;
-    if(args->count == 1)
+    NNObjString* str;
+    if(len <= 0)
     {
-        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-        length = (size_t)nn_value_asnumber(args->args[0]);
+        return nn_value_fromobject(nn_string_copylen(state, "", 0));
     }
-    file = nn_value_asfile(args->thisval);
-    if(!file->isstd)
+    str = nn_string_copylen(state, "", 0);
+    dyn_strbuf_appendstrn(str->sbuf, buf, len);
+    return nn_value_fromobject(str);
+}
+
+NNObjString* nn_string_substring(NNState* state, NNObjString* selfstr, size_t start, size_t end, bool likejs)
+{
+    size_t len;
+    size_t tmp;
+    size_t maxlen;
+    (void)likejs;
+    maxlen = selfstr->sbuf->length;
+    len = maxlen;
+    if(end > maxlen)
     {
-        if(!nn_util_fsfileexists(state, file->path->sbuf->data))
-        {
-            FILE_ERROR(NotFound, "no such file or directory");
-        }
-        else if(strstr(file->mode->sbuf->data, "w") != NULL && strstr(file->mode->sbuf->data, "+") == NULL)
-        {
-            FILE_ERROR(Unsupported, "cannot read file in write mode");
-        }
-        if(!file->isopen)
-        {
-            FILE_ERROR(Read, "file not open");
-        }
-        else if(file->handle == NULL)
-        {
-            FILE_ERROR(Read, "could not read file");
-        }
-        if(length == -1)
-        {
-            currentpos = ftell(file->handle);
-            fseek(file->handle, 0L, SEEK_END);
-            end = ftell(file->handle);
-            fseek(file->handle, currentpos, SEEK_SET);
-            length = end - currentpos;
-        }
+        tmp = start;
+        start = end;
+        end = tmp;
+        len = maxlen;
     }
-    else
+    if(end < start)
     {
-        if(fileno(stdout) == file->number || fileno(stderr) == file->number)
-        {
-            FILE_ERROR(Unsupported, "cannot read from output file");
-        }
-        /*
-        // for non-file objects such as stdin
-        // minimum read bytes should be 1
-        */
-        if(length == -1)
-        {
-            length = 1;
-        }
+        tmp = end;
+        end = start;
+        start = tmp;
+        len = end;
     }
-    buffer = (char*)nn_memory_malloc(sizeof(char) * (length + 1));
-    if(buffer == NULL && length != 0)
+    len = (end - start);
+    if(start > maxlen)
     {
-        FILE_ERROR(Buffer, "not enough memory to read file");
+        start = maxlen;
     }
-    bytesread = fread(buffer, sizeof(char), length, file->handle);
-    if(bytesread == 0 && length != 0)
+    if(len > (maxlen - start))
     {
-        FILE_ERROR(Read, "could not read file contents");
+        len = (maxlen - start);
     }
-    if(buffer != NULL)
+    return nn_string_makeslice(state, selfstr, start, len);
+}
+
+NNValue nn_objfnstring_substring(NNState* state, NNArguments* args)
+{
+    size_t end;
+    size_t start;
+    size_t maxlen;
+    NNObjString* nos;
+    NNObjString* selfstr;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    selfstr = nn_value_asstring(args->thisval);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    maxlen = selfstr->sbuf->length;
+    end = maxlen;
+    start = nn_value_asnumber(args->args[0]);
+    if(args->count > 1)
     {
-        buffer[bytesread] = '\0';
+        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
+        end = nn_value_asnumber(args->args[1]);
     }
-    return nn_value_fromobject(nn_string_takelen(state, buffer, bytesread));
+    nos = nn_string_substring(state, selfstr, start, end, true);
+    return nn_value_fromobject(nos);
 }
 
-NNValue nn_objfnfile_write(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_charcodeat(NNState* state, NNArguments* args)
 {
-    size_t count;
-    int length;
-    unsigned char* data;
-    NNObjFile* file;
-    NNObjString* string;
+    int ch;
+    int idx;
+    int selflen;
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    file = nn_value_asfile(args->thisval);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    string = nn_value_asstring(args->args[0]);
-    data = (unsigned char*)string->sbuf->data;
-    length = string->sbuf->length;
-    if(!file->isstd)
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    selfstr = nn_value_asstring(args->thisval);
+    idx = nn_value_asnumber(args->args[0]);
+    selflen = (int)selfstr->sbuf->length;
+    if((idx < 0) || (idx >= selflen))
     {
-        if(strstr(file->mode->sbuf->data, "r") != NULL && strstr(file->mode->sbuf->data, "+") == NULL)
-        {
-            FILE_ERROR(Unsupported, "cannot write into non-writable file");
-        }
-        else if(length == 0)
-        {
-            FILE_ERROR(Write, "cannot write empty buffer to file");
-        }
-        else if(file->handle == NULL || !file->isopen)
-        {
-            nn_fileobject_open(file);
-        }
-        else if(file->handle == NULL)
-        {
-            FILE_ERROR(Write, "could not write to file");
-        }
+        ch = -1;
     }
     else
     {
-        if(fileno(stdin) == file->number)
-        {
-            FILE_ERROR(Unsupported, "cannot write to input file");
-        }
-    }
-    count = fwrite(data, sizeof(unsigned char), length, file->handle);
-    fflush(file->handle);
-    if(count > (size_t)0)
-    {
-        return nn_value_makebool(true);
+        ch = selfstr->sbuf->data[idx];
     }
-    return nn_value_makebool(false);
+    return nn_value_makenumber(ch);
 }
 
-NNValue nn_objfnfile_puts(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_charat(NNState* state, NNArguments* args)
 {
-    size_t count;
-    int length;
-    unsigned char* data;
-    NNObjFile* file;
-    NNObjString* string;
+    char ch;
+    int idx;
+    int selflen;
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    file = nn_value_asfile(args->thisval);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    string = nn_value_asstring(args->args[0]);
-    data = (unsigned char*)string->sbuf->data;
-    length = string->sbuf->length;
-    if(!file->isstd)
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    selfstr = nn_value_asstring(args->thisval);
+    idx = nn_value_asnumber(args->args[0]);
+    selflen = (int)selfstr->sbuf->length;
+    if((idx < 0) || (idx >= selflen))
     {
-        if(strstr(file->mode->sbuf->data, "r") != NULL && strstr(file->mode->sbuf->data, "+") == NULL)
-        {
-            FILE_ERROR(Unsupported, "cannot write into non-writable file");
-        }
-        else if(length == 0)
-        {
-            FILE_ERROR(Write, "cannot write empty buffer to file");
-        }
-        else if(!file->isopen)
-        {
-            FILE_ERROR(Write, "file not open");
-        }
-        else if(file->handle == NULL)
-        {
-            FILE_ERROR(Write, "could not write to file");
-        }
+        return nn_value_fromobject(nn_string_copylen(state, "", 0));
     }
     else
     {
-        if(fileno(stdin) == file->number)
-        {
-            FILE_ERROR(Unsupported, "cannot write to input file");
-        }
-    }
-    count = fwrite(data, sizeof(unsigned char), length, file->handle);
-    if(count > (size_t)0 || length == 0)
-    {
-        return nn_value_makebool(true);
+        ch = selfstr->sbuf->data[idx];
     }
-    return nn_value_makebool(false);
+    return nn_value_fromobject(nn_string_copylen(state, &ch, 1));
 }
 
-NNValue nn_objfnfile_printf(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_upper(NNState* state, NNArguments* args)
 {
-    NNObjFile* file;
-    NNFormatInfo nfi;
-    NNPrinter pr;
-    NNObjString* ofmt;
+    size_t slen;
+    char* string;
+    NNObjString* str;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    file = nn_value_asfile(args->thisval);
-    NEON_ARGS_CHECKMINARG(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    ofmt = nn_value_asstring(args->args[0]);
-    nn_printer_makestackio(state, &pr, file->handle, false);
-    nn_strformat_init(state, &nfi, &pr, nn_string_getcstr(ofmt), nn_string_getlength(ofmt));
-    if(!nn_strformat_format(&nfi, args->count, 1, args->args))
-    {
-    }
-    return nn_value_makenull();
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    str = nn_value_asstring(args->thisval);
+    slen = str->sbuf->length;
+    string = nn_util_strtoupper(str->sbuf->data, slen);
+    return nn_value_fromobject(nn_string_copylen(state, string, slen));
 }
 
-NNValue nn_objfnfile_number(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_lower(NNState* state, NNArguments* args)
 {
+    size_t slen;
+    char* string;
+    NNObjString* str;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    return nn_value_makenumber(nn_value_asfile(args->thisval)->number);
+    str = nn_value_asstring(args->thisval);
+    slen = str->sbuf->length;
+    string = nn_util_strtolower(str->sbuf->data, slen);
+    return nn_value_fromobject(nn_string_copylen(state, string, slen));
 }
 
-NNValue nn_objfnfile_istty(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_isalpha(NNState* state, NNArguments* args)
 {
-    NNObjFile* file;
+    size_t i;
     NNArgCheck check;
+    NNObjString* selfstr;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    file = nn_value_asfile(args->thisval);
-    return nn_value_makebool(file->istty);
+    selfstr = nn_value_asstring(args->thisval);
+    for(i = 0; i < selfstr->sbuf->length; i++)
+    {
+        if(!isalpha((unsigned char)selfstr->sbuf->data[i]))
+        {
+            return nn_value_makebool(false);
+        }
+    }
+    return nn_value_makebool(selfstr->sbuf->length != 0);
 }
 
-NNValue nn_objfnfile_flush(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_isalnum(NNState* state, NNArguments* args)
 {
-    NNObjFile* file;
+    size_t i;
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    file = nn_value_asfile(args->thisval);
-    if(!file->isopen)
-    {
-        FILE_ERROR(Unsupported, "I/O operation on closed file");
-    }
-    #if defined(NEON_PLAT_ISLINUX)
-    if(fileno(stdin) == file->number)
+    selfstr = nn_value_asstring(args->thisval);
+    for(i = 0; i < selfstr->sbuf->length; i++)
     {
-        while((getchar()) != '\n')
+        if(!isalnum((unsigned char)selfstr->sbuf->data[i]))
         {
+            return nn_value_makebool(false);
         }
     }
-    else
-    {
-        fflush(file->handle);
-    }
-    #else
-    fflush(file->handle);
-    #endif
-    return nn_value_makenull();
-}
-
-void nn_util_statfilldictphysfile(NNObjDict* dict, struct stat* st)
-{
-    #if !defined(NEON_PLAT_ISWINDOWS)
-    nn_dict_addentrycstr(dict, "isreadable", nn_value_makebool(((st->st_mode & S_IRUSR) != 0)));
-    nn_dict_addentrycstr(dict, "iswritable", nn_value_makebool(((st->st_mode & S_IWUSR) != 0)));
-    nn_dict_addentrycstr(dict, "isexecutable", nn_value_makebool(((st->st_mode & S_IXUSR) != 0)));
-    nn_dict_addentrycstr(dict, "issymbolic", nn_value_makebool((S_ISLNK(st->st_mode) != 0)));
-    #else
-    nn_dict_addentrycstr(dict, "isreadable", nn_value_makebool(((st->st_mode & S_IREAD) != 0)));
-    nn_dict_addentrycstr(dict, "iswritable", nn_value_makebool(((st->st_mode & S_IWRITE) != 0)));
-    nn_dict_addentrycstr(dict, "isexecutable", nn_value_makebool(((st->st_mode & S_IEXEC) != 0)));
-    nn_dict_addentrycstr(dict, "issymbolic", nn_value_makebool(false));
-    #endif
-    nn_dict_addentrycstr(dict, "size", nn_value_makenumber(st->st_size));
-    nn_dict_addentrycstr(dict, "mode", nn_value_makenumber(st->st_mode));
-    nn_dict_addentrycstr(dict, "dev", nn_value_makenumber(st->st_dev));
-    nn_dict_addentrycstr(dict, "ino", nn_value_makenumber(st->st_ino));
-    nn_dict_addentrycstr(dict, "nlink", nn_value_makenumber(st->st_nlink));
-    nn_dict_addentrycstr(dict, "uid", nn_value_makenumber(st->st_uid));
-    nn_dict_addentrycstr(dict, "gid", nn_value_makenumber(st->st_gid));
-    nn_dict_addentrycstr(dict, "mtime", nn_value_makenumber(st->st_mtime));
-    nn_dict_addentrycstr(dict, "atime", nn_value_makenumber(st->st_atime));
-    nn_dict_addentrycstr(dict, "ctime", nn_value_makenumber(st->st_ctime));
-    nn_dict_addentrycstr(dict, "blocks", nn_value_makenumber(0));
-    nn_dict_addentrycstr(dict, "blksize", nn_value_makenumber(0));
+    return nn_value_makebool(selfstr->sbuf->length != 0);
 }
 
-NNValue nn_objfnfile_statmethod(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_isfloat(NNState* state, NNArguments* args)
 {
-    struct stat stats;
-    NNObjFile* file;
-    NNObjDict* dict;
+    double f;
+    const char* p;
+    NNObjString* selfstr;
     NNArgCheck check;
+    (void)f;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    file = nn_value_asfile(args->thisval);
-    dict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
-    if(!file->isstd)
+    selfstr = nn_value_asstring(args->thisval);
+    errno = 0;
+    if(selfstr->sbuf->length ==0)
     {
-        if(nn_util_fsfileexists(state, file->path->sbuf->data))
-        {
-            if(osfn_lstat(file->path->sbuf->data, &stats) == 0)
-            {
-                nn_util_statfilldictphysfile(dict, &stats);
-            }
-        }
-        else
-        {
-            NEON_RETURNERROR("cannot get stats for non-existing file");
-        }
+        return nn_value_makebool(false);
+    }
+    f = nn_util_strtod(selfstr->sbuf->data, selfstr->sbuf->length, &p);
+    if(errno)
+    {
+        return nn_value_makebool(false);
     }
     else
     {
-        if(fileno(stdin) == file->number)
-        {
-            nn_dict_addentrycstr(dict, "isreadable", nn_value_makebool(true));
-            nn_dict_addentrycstr(dict, "iswritable", nn_value_makebool(false));
-        }
-        else
+        if(*p == 0)
         {
-            nn_dict_addentrycstr(dict, "isreadable", nn_value_makebool(false));
-            nn_dict_addentrycstr(dict, "iswritable", nn_value_makebool(true));
+            return nn_value_makebool(true);
         }
-        nn_dict_addentrycstr(dict, "isexecutable", nn_value_makebool(false));
-        nn_dict_addentrycstr(dict, "size", nn_value_makenumber(1));
     }
-    return nn_value_fromobject(dict);
+    return nn_value_makebool(false);
 }
 
-NNValue nn_objfnfile_path(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_isnumber(NNState* state, NNArguments* args)
 {
-    NNObjFile* file;
+    size_t i;
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    file = nn_value_asfile(args->thisval);
-    DENY_STD();
-    return nn_value_fromobject(file->path);
+    selfstr = nn_value_asstring(args->thisval);
+    for(i = 0; i < selfstr->sbuf->length; i++)
+    {
+        if(!isdigit((unsigned char)selfstr->sbuf->data[i]))
+        {
+            return nn_value_makebool(false);
+        }
+    }
+    return nn_value_makebool(selfstr->sbuf->length != 0);
 }
 
-NNValue nn_objfnfile_mode(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_islower(NNState* state, NNArguments* args)
 {
-    NNObjFile* file;
+    size_t i;
+    bool alphafound;
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    file = nn_value_asfile(args->thisval);
-    return nn_value_fromobject(file->mode);
+    selfstr = nn_value_asstring(args->thisval);
+    alphafound = false;
+    for(i = 0; i < selfstr->sbuf->length; i++)
+    {
+        if(!alphafound && !isdigit(selfstr->sbuf->data[0]))
+        {
+            alphafound = true;
+        }
+        if(isupper(selfstr->sbuf->data[0]))
+        {
+            return nn_value_makebool(false);
+        }
+    }
+    return nn_value_makebool(alphafound);
 }
 
-NNValue nn_objfnfile_name(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_isupper(NNState* state, NNArguments* args)
 {
-    char* name;
-    NNObjFile* file;
+    size_t i;
+    bool alphafound;
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    file = nn_value_asfile(args->thisval);
-    if(!file->isstd)
-    {
-        name = nn_util_fsgetbasename(state, file->path->sbuf->data);
-        return nn_value_fromobject(nn_string_copycstr(state, name));
-    }
-    else if(file->istty)
+    selfstr = nn_value_asstring(args->thisval);
+    alphafound = false;
+    for(i = 0; i < selfstr->sbuf->length; i++)
     {
-        /*name = ttyname(file->number);*/
-        name = nn_util_strdup("<tty>");
-        if(name)
+        if(!alphafound && !isdigit(selfstr->sbuf->data[0]))
         {
-            return nn_value_fromobject(nn_string_copycstr(state, name));
+            alphafound = true;
+        }
+        if(islower(selfstr->sbuf->data[0]))
+        {
+            return nn_value_makebool(false);
         }
     }
-    return nn_value_makenull();
+    return nn_value_makebool(alphafound);
 }
 
-NNValue nn_objfnfile_seek(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_isspace(NNState* state, NNArguments* args)
 {
-    long position;
-    int seektype;
-    NNObjFile* file;
+    size_t i;
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 2);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
-    file = nn_value_asfile(args->thisval);
-    DENY_STD();
-    position = (long)nn_value_asnumber(args->args[0]);
-    seektype = nn_value_asnumber(args->args[1]);
-    RETURN_STATUS(fseek(file->handle, position, seektype));
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    selfstr = nn_value_asstring(args->thisval);
+    for(i = 0; i < selfstr->sbuf->length; i++)
+    {
+        if(!isspace((unsigned char)selfstr->sbuf->data[i]))
+        {
+            return nn_value_makebool(false);
+        }
+    }
+    return nn_value_makebool(selfstr->sbuf->length != 0);
 }
 
-NNValue nn_objfnfile_tell(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_trim(NNState* state, NNArguments* args)
 {
-    NNObjFile* file;
+    char trimmer;
+    char* end;
+    char* string;
+    NNObjString* selfstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    file = nn_value_asfile(args->thisval);
-    DENY_STD();
-    return nn_value_makenumber(ftell(file->handle));
-}
-
-#undef FILE_ERROR
-#undef RETURN_STATUS
-#undef DENY_STD
-
-NNObjArray* nn_array_makefilled(NNState* state, size_t cnt, NNValue filler)
-{
-    size_t i;
-    NNObjArray* list;
-    list = (NNObjArray*)nn_object_allocobject(state, sizeof(NNObjArray), NEON_OBJTYPE_ARRAY);
-    list->varray = nn_vallist_make(state);
-    if(cnt > 0)
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    trimmer = '\0';
+    if(args->count == 1)
     {
-        for(i=0; i<cnt; i++)
+        trimmer = (char)nn_value_asstring(args->args[0])->sbuf->data[0];
+    }
+    selfstr = nn_value_asstring(args->thisval);
+    string = selfstr->sbuf->data;
+    end = NULL;
+    /* Trim leading space*/
+    if(trimmer == '\0')
+    {
+        while(isspace((unsigned char)*string))
         {
-            nn_vallist_push(list->varray, filler);
+            string++;
         }
     }
-    return list;
-}
-
-NNObjArray* nn_array_make(NNState* state)
-{
-    return nn_array_makefilled(state, 0, nn_value_makenull());
-}
-
-void nn_array_push(NNObjArray* list, NNValue value)
-{
-    NNState* state;
-    (void)state;
-    state = ((NNObject*)list)->pstate;
-    /*nn_vm_stackpush(state, value);*/
-    nn_vallist_push(list->varray, value);
-    /*nn_vm_stackpop(state); */
+    else
+    {
+        while(trimmer == *string)
+        {
+            string++;
+        }
+    }
+    /* All spaces? */
+    if(*string == 0)
+    {
+        return nn_value_fromobject(nn_string_copylen(state, "", 0));
+    }
+    /* Trim trailing space */
+    end = string + strlen(string) - 1;
+    if(trimmer == '\0')
+    {
+        while(end > string && isspace((unsigned char)*end))
+        {
+            end--;
+        }
+    }
+    else
+    {
+        while(end > string && trimmer == *end)
+        {
+            end--;
+        }
+    }
+    end[1] = '\0';
+    return nn_value_fromobject(nn_string_copycstr(state, string));
 }
 
-bool nn_array_get(NNObjArray* list, size_t idx, NNValue* vdest)
+NNValue nn_objfnstring_ltrim(NNState* state, NNArguments* args)
 {
-    size_t vc;
-    vc = nn_vallist_count(list->varray);
-    if((vc > 0) && (idx < vc))
+    char* end;
+    char* string;
+    char trimmer;
+    NNObjString* selfstr;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    trimmer = '\0';
+    if(args->count == 1)
     {
-        *vdest = nn_vallist_get(list->varray, idx);
-        return true;
+        trimmer = (char)nn_value_asstring(args->args[0])->sbuf->data[0];
     }
-    return false;
+    selfstr = nn_value_asstring(args->thisval);
+    string = selfstr->sbuf->data;
+    end = NULL;
+    /* Trim leading space */
+    if(trimmer == '\0')
+    {
+        while(isspace((unsigned char)*string))
+        {
+            string++;
+        }
+    }
+    else
+    {
+        while(trimmer == *string)
+        {
+            string++;
+        }
+    }
+    /* All spaces? */
+    if(*string == 0)
+    {
+        return nn_value_fromobject(nn_string_copylen(state, "", 0));
+    }
+    end = string + strlen(string) - 1;
+    end[1] = '\0';
+    return nn_value_fromobject(nn_string_copycstr(state, string));
 }
 
-NNObjArray* nn_array_copy(NNObjArray* list, long start, long length)
+NNValue nn_objfnstring_rtrim(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNState* state;
-    NNObjArray* newlist;
-    state = ((NNObject*)list)->pstate;
-    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    if(start == -1)
+    char* end;
+    char* string;
+    char trimmer;
+    NNObjString* selfstr;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    trimmer = '\0';
+    if(args->count == 1)
     {
-        start = 0;
+        trimmer = (char)nn_value_asstring(args->args[0])->sbuf->data[0];
     }
-    if(length == -1)
+    selfstr = nn_value_asstring(args->thisval);
+    string = selfstr->sbuf->data;
+    end = NULL;
+    /* All spaces? */
+    if(*string == 0)
     {
-        length = list->varray->listcount - start;
+        return nn_value_fromobject(nn_string_copylen(state, "", 0));
     }
-    for(i = start; i < (size_t)(start + length); i++)
+    end = string + strlen(string) - 1;
+    if(trimmer == '\0')
     {
-        nn_array_push(newlist, list->varray->listitems[i]);
+        while(end > string && isspace((unsigned char)*end))
+        {
+            end--;
+        }
     }
-    return newlist;
-}
-
-NNValue nn_objfnarray_length(NNState* state, NNArguments* args)
-{
-    NNObjArray* selfarr;
-    (void)state;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    selfarr = nn_value_asarray(args->thisval);
-    return nn_value_makenumber(selfarr->varray->listcount);
-}
-
-NNValue nn_objfnarray_append(NNState* state, NNArguments* args)
-{
-    size_t i;
-    (void)state;
-    for(i = 0; i < args->count; i++)
+    else
     {
-        nn_array_push(nn_value_asarray(args->thisval), args->args[i]);
+        while(end > string && trimmer == *end)
+        {
+            end--;
+        }
     }
-    return nn_value_makenull();
+    /* Write new null terminator character */
+    end[1] = '\0';
+    return nn_value_fromobject(nn_string_copycstr(state, string));
 }
 
-NNValue nn_objfnarray_clear(NNState* state, NNArguments* args)
-{
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    nn_vallist_destroy(nn_value_asarray(args->thisval)->varray);
-    return nn_value_makenull();
-}
 
-NNValue nn_objfnarray_clone(NNState* state, NNArguments* args)
+NNValue nn_objfnarray_constructor(NNState* state, NNArguments* args)
 {
-    NNObjArray* list;
+    int cnt;
+    NNValue filler;
+    NNObjArray* arr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    list = nn_value_asarray(args->thisval);
-    return nn_value_fromobject(nn_array_copy(list, 0, list->varray->listcount));
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    filler = nn_value_makenull();
+    if(args->count > 1)
+    {
+        filler = args->args[1];
+    }
+    cnt = nn_value_asnumber(args->args[0]);
+    arr = nn_array_makefilled(state, cnt, filler);
+    return nn_value_fromobject(arr);
 }
 
-NNValue nn_objfnarray_count(NNState* state, NNArguments* args)
+NNValue nn_objfnarray_join(NNState* state, NNArguments* args)
 {
     size_t i;
-    int count;
-    NNObjArray* list;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    list = nn_value_asarray(args->thisval);
-    count = 0;
-    for(i = 0; i < list->varray->listcount; i++)
+    size_t count;
+    NNPrinter pr;
+    NNValue vjoinee;
+    NNObjArray* selfarr;
+    NNObjString* joinee;
+    NNObjString* item;
+    NNValue* list;
+    selfarr = nn_value_asarray(args->thisval);
+    joinee = NULL;
+    if(args->count > 0)
     {
-        if(nn_value_compare(state, list->varray->listitems[i], args->args[0]))
+        vjoinee = args->args[0];
+        if(nn_value_isstring(vjoinee))
         {
-            count++;
+            joinee = nn_value_asstring(vjoinee);
+        }
+        else
+        {
+            joinee = nn_value_tostring(state, vjoinee);
         }
     }
-    return nn_value_makenumber(count);
-}
-
-NNValue nn_objfnarray_extend(NNState* state, NNArguments* args)
-{
-    size_t i;
-    NNObjArray* list;
-    NNObjArray* list2;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isarray);
-    list = nn_value_asarray(args->thisval);
-    list2 = nn_value_asarray(args->args[0]);
-    for(i = 0; i < list2->varray->listcount; i++)
+    list = selfarr->varray->listitems;
+    count = selfarr->varray->listcount;
+    if(count == 0)
     {
-        nn_array_push(list, list2->varray->listitems[i]);
+        return nn_value_fromobject(nn_string_copycstr(state, ""));
     }
-    return nn_value_makenull();
+    nn_printer_makestackstring(state, &pr);
+    for(i = 0; i < count; i++)
+    {
+        if(selfarr->varray->listkind == NEON_ELEMKIND_STRING)
+        {
+            item = nn_value_asstring(list[i]);
+            nn_printer_writestringl(&pr, item->sbuf->data, item->sbuf->length);
+        }
+        else
+        {
+            nn_printer_printvalue(&pr, list[i], false, true);
+        }
+        if((joinee != NULL) && ((i+1) < count))
+        {
+            nn_printer_writestringl(&pr, joinee->sbuf->data, joinee->sbuf->length);
+        }
+    }
+    return nn_value_fromobject(nn_printer_takestring(&pr));
 }
 
-NNValue nn_objfnarray_indexof(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_indexof(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjArray* list;
+    int startindex;
+    char* result;
+    char* haystack;
+    NNObjString* string;
+    NNObjString* needle;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    list = nn_value_asarray(args->thisval);
-    i = 0;
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    string = nn_value_asstring(args->thisval);
+    needle = nn_value_asstring(args->args[0]);
+    startindex = 0;
     if(args->count == 2)
     {
         NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
-        i = nn_value_asnumber(args->args[1]);
+        startindex = nn_value_asnumber(args->args[1]);
     }
-    for(; i < list->varray->listcount; i++)
+    if(string->sbuf->length > 0 && needle->sbuf->length > 0)
     {
-        if(nn_value_compare(state, list->varray->listitems[i], args->args[0]))
+        haystack = string->sbuf->data;
+        result = strstr(haystack + startindex, needle->sbuf->data);
+        if(result != NULL)
         {
-            return nn_value_makenumber(i);
+            return nn_value_makenumber((int)(result - haystack));
         }
     }
     return nn_value_makenumber(-1);
 }
 
-NNValue nn_objfnarray_insert(NNState* state, NNArguments* args)
-{
-    int index;
-    NNObjArray* list;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 2);
-    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
-    list = nn_value_asarray(args->thisval);
-    index = (int)nn_value_asnumber(args->args[1]);
-    nn_vallist_insert(list->varray, args->args[0], index);
-    return nn_value_makenull();
-}
-
-
-NNValue nn_objfnarray_pop(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_startswith(NNState* state, NNArguments* args)
 {
-    NNValue value;
-    NNObjArray* list;
+    NNObjString* substr;
+    NNObjString* string;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    list = nn_value_asarray(args->thisval);
-    if(list->varray->listcount > 0)
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    string = nn_value_asstring(args->thisval);
+    substr = nn_value_asstring(args->args[0]);
+    if(string->sbuf->length == 0 || substr->sbuf->length == 0 || substr->sbuf->length > string->sbuf->length)
     {
-        value = list->varray->listitems[list->varray->listcount - 1];
-        list->varray->listcount--;
-        return value;
+        return nn_value_makebool(false);
     }
-    return nn_value_makenull();
+    return nn_value_makebool(memcmp(substr->sbuf->data, string->sbuf->data, substr->sbuf->length) == 0);
 }
 
-NNValue nn_objfnarray_shift(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_endswith(NNState* state, NNArguments* args)
 {
-    size_t i;
-    size_t j;
-    size_t count;
-    NNObjArray* list;
-    NNObjArray* newlist;
+    int difference;
+    NNObjString* substr;
+    NNObjString* string;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
-    count = 1;
-    if(args->count == 1)
-    {
-        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-        count = nn_value_asnumber(args->args[0]);
-    }
-    list = nn_value_asarray(args->thisval);
-    if(count >= list->varray->listcount || list->varray->listcount == 1)
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    string = nn_value_asstring(args->thisval);
+    substr = nn_value_asstring(args->args[0]);
+    if(string->sbuf->length == 0 || substr->sbuf->length == 0 || substr->sbuf->length > string->sbuf->length)
     {
-        list->varray->listcount = 0;
-        return nn_value_makenull();
+        return nn_value_makebool(false);
     }
-    else if(count > 0)
-    {
-        newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-        for(i = 0; i < count; i++)
-        {
-            nn_array_push(newlist, list->varray->listitems[0]);
-            for(j = 0; j < list->varray->listcount; j++)
-            {
-                list->varray->listitems[j] = list->varray->listitems[j + 1];
-            }
-            list->varray->listcount -= 1;
-        }
-        if(count == 1)
-        {
-            return newlist->varray->listitems[0];
-        }
-        else
-        {
-            return nn_value_fromobject(newlist);
-        }
+    difference = string->sbuf->length - substr->sbuf->length;
+    return nn_value_makebool(memcmp(substr->sbuf->data, string->sbuf->data + difference, substr->sbuf->length) == 0);
+}
+
+
+/*
+    //  Returns 0 on success, or -1 on invalid or unsupported regex, or -2 on not enough tokens given to parse regex.
+    REMIMU_INLINE int mrx_regex_parse(
+        //  Regex pattern to parse. Must be null-terminated.
+        const char * pattern,       
+        //  Output buffer of tokencount regex tokens
+        RegexToken * tokens,
+        //  Maximum allowed number of tokens to write
+        int16_t * tokencount,
+        // Optional bitflags.
+        int32_t flags
+        
+    )
+    
+    // Returns match length, or -1 on no match, or -2 on out of memory, or -3 ifthe regex is invalid.
+    REMIMU_INLINE int64_t mrx_regex_match(
+        // Parsed regex to match against text.
+        const RegexToken * tokens,
+        // Text to match against tokens.
+        const char * text,
+        // index value to match at.
+        size_t starti,
+        // Number of allowed capture info output slots.
+        uint16_t capslots,
+        // Capture position info output buffer.
+        int64_t* cappos,
+        // Capture length info output buffer.
+        int64_t* capspan
+    ) 
+    
+*/
+
+NNObjRegex* nn_regex_compile(NNState* state, NNObjString* pattern, int engine)
+{
+    int prc;
+    NNObjRegex* re;
+    re = (NNObjRegex*)nn_object_allocobject(state, sizeof(NNObjRegex), NEON_OBJTYPE_REGEX);
+    re->pattern = pattern;
+    re->engine = engine;
+    re->tokens = NULL;
+    re->pctx = NULL;
+    re->program = NULL;
+    if(engine == NEON_REGEX_ENGINELINEAR)
+    {
+        re->program = (NNRxProgram*)nn_memory_malloc(sizeof(NNRxProgram));
+        if(!nn_rxvm_compile(re->program, pattern->sbuf->data, pattern->sbuf->length))
+        {
+            nn_exceptions_throwclass(state, state->exceptions.regexerror, re->program->errorbuf);
+            return NULL;
+        }
+        re->program->matchcaps = (int64_t*)nn_memory_malloc(sizeof(int64_t) * 2 * re->program->capcount);
+        return re;
+    }
+    re->tokens = (RegexToken*)nn_memory_calloc(NEON_CONFIG_REGEXMAXTOKENS + 1, sizeof(RegexToken));
+    re->pctx = mrx_init(&re->ctx, re->tokens, NEON_CONFIG_REGEXMAXTOKENS);
+    prc = mrx_regex_parse(re->pctx, pattern->sbuf->data, 0);
+    if(prc != 0)
+    {
+        nn_exceptions_throwclass(state, state->exceptions.regexerror, re->pctx->errorbuf);
+        return NULL;
     }
-    return nn_value_makenull();
+    return re;
 }
 
-NNValue nn_objfnarray_removeat(NNState* state, NNArguments* args)
+void nn_regex_destroy(NNState* state, NNObjRegex* re)
 {
-    size_t i;
-    size_t index;
-    NNValue value;
-    NNObjArray* list;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    list = nn_value_asarray(args->thisval);
-    index = nn_value_asnumber(args->args[0]);
-    if(((int)index < 0) || index >= list->varray->listcount)
+    if(re->pctx != NULL)
     {
-        NEON_RETURNERROR("list index %d out of range at remove_at()", index);
+        mrx_destroy(re->pctx);
     }
-    value = list->varray->listitems[index];
-    for(i = index; i < list->varray->listcount - 1; i++)
+    nn_memory_free(re->tokens);
+    if(re->program != NULL)
     {
-        list->varray->listitems[i] = list->varray->listitems[i + 1];
+        nn_memory_free(re->program->matchcaps);
+        nn_rxvm_destroy(re->program);
+        nn_memory_free(re->program);
     }
-    list->varray->listcount--;
-    return value;
+    nn_gcmem_release(state, re, sizeof(NNObjRegex));
 }
 
-NNValue nn_objfnarray_remove(NNState* state, NNArguments* args)
+/*
+* returns the parsed regex for pattern, parsing it only if it is not among the
+* NEON_CONFIG_REGEXCACHESIZE most recently used patterns.
+*/
+NNObjRegex* nn_regex_cacheget(NNState* state, NNObjString* pattern)
 {
     size_t i;
-    size_t index;
-    NNObjArray* list;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    list = nn_value_asarray(args->thisval);
-    index = -1;
-    for(i = 0; i < list->varray->listcount; i++)
-    {
-        if(nn_value_compare(state, list->varray->listitems[i], args->args[0]))
+    size_t victim;
+    NNObjRegex* re;
+    NNObjRegex* item;
+    victim = 0;
+    state->regexcache.clock++;
+    for(i = 0; i < NEON_CONFIG_REGEXCACHESIZE; i++)
+    {
+        item = state->regexcache.items[i];
+        if(item == NULL)
+        {
+            victim = i;
+            state->regexcache.lastused[i] = 0;
+            continue;
+        }
+        if((item->pattern == pattern) || ((item->pattern->hash == pattern->hash) && nn_value_compobject(state, nn_value_fromobject(item->pattern), nn_value_fromobject(pattern))))
         {
-            index = i;
-            break;
+            state->regexcache.lastused[i] = state->regexcache.clock;
+            return item;
         }
-    }
-    if((int)index != -1)
-    {
-        for(i = index; i < list->varray->listcount; i++)
+        if(state->regexcache.lastused[i] < state->regexcache.lastused[victim])
         {
-            list->varray->listitems[i] = list->varray->listitems[i + 1];
+            victim = i;
         }
-        list->varray->listcount--;
     }
-    return nn_value_makenull();
+    re = nn_regex_compile(state, pattern, NEON_REGEX_ENGINEBACKTRACK);
+    if(re != NULL)
+    {
+        state->regexcache.items[victim] = re;
+        state->regexcache.lastused[victim] = state->regexcache.clock;
+    }
+    return re;
 }
 
-NNValue nn_objfnarray_reverse(NNState* state, NNArguments* args)
+/*
+* runs the linear engine of re on string. the lazy DFA rules out strings without a match
+* cheaply; otherwise the pike VM finds the match and its groups, which are stored in
+* capstarts and caplengths (unset groups get a length of 0).
+* returns the length of the match and stores its position in mstart, or returns -1.
+*/
+int64_t nn_regex_execlinear(NNObjRegex* re, NNObjString* string, size_t from, bool anchored, int64_t capslots, int64_t* capstarts, int64_t* caplengths, size_t* mstart)
 {
-    int fromtop;
-    NNObjArray* list;
-    NNObjArray* nlist;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    list = nn_value_asarray(args->thisval);
-    nlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    /* in-place reversal:*/
-    /*
-    int start = 0;
-    int end = list->varray->listcount - 1;
-    while (start < end)
+    int64_t i;
+    int64_t* caps;
+    NNRxProgram* prog;
+    prog = re->program;
+    if(from > string->sbuf->length)
     {
-        NNValue temp = list->varray->listitems[start];
-        list->varray->listitems[start] = list->varray->listitems[end];
-        list->varray->listitems[end] = temp;
-        start++;
-        end--;
+        return -1;
     }
-    */
-    for(fromtop = list->varray->listcount - 1; fromtop >= 0; fromtop--)
+    if(nn_rxvm_dfaexists(prog, string->sbuf->data, string->sbuf->length, from, anchored) == 0)
     {
-        nn_array_push(nlist, list->varray->listitems[fromtop]);
+        return -1;
     }
-    return nn_value_fromobject(nlist);
+    caps = prog->matchcaps;
+    if(!nn_rxvm_exec(prog, string->sbuf->data, string->sbuf->length, from, anchored, caps))
+    {
+        return -1;
+    }
+    /* slot 0 is the whole match; the groups, numbered from 0 as with mrx, start at slot 1. */
+    for(i = 0; (i < capslots) && (i < (prog->capcount - 1)); i++)
+    {
+        capstarts[i] = caps[2 * (i + 1)];
+        caplengths[i] = 0;
+        if((caps[2 * (i + 1)] >= 0) && (caps[(2 * (i + 1)) + 1] >= caps[2 * (i + 1)]))
+        {
+            caplengths[i] = caps[(2 * (i + 1)) + 1] - caps[2 * (i + 1)];
+        }
+    }
+    *mstart = caps[0];
+    return caps[1] - caps[0];
 }
 
-NNValue nn_objfnarray_sort(NNState* state, NNArguments* args)
+/*
+* matches re at position starti of string. returns the length of the match, or -1.
+*/
+int64_t nn_regex_matchat(NNObjRegex* re, NNObjString* string, size_t starti, int64_t capslots, int64_t* capstarts, int64_t* caplengths)
 {
-    NNObjArray* list;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    list = nn_value_asarray(args->thisval);
-    nn_value_sortvalues(state, list->varray->listitems, list->varray->listcount);
-    return nn_value_makenull();
+    size_t mstart;
+    if(re->engine == NEON_REGEX_ENGINELINEAR)
+    {
+        return nn_regex_execlinear(re, string, starti, true, capslots, capstarts, caplengths, &mstart);
+    }
+    return mrx_regex_match(re->pctx, string->sbuf->data, starti, capslots, capstarts, caplengths);
 }
 
-NNValue nn_objfnarray_contains(NNState* state, NNArguments* args)
+/*
+* finds the first match of re at or after position from.
+* returns the length of the match and stores its position in mstart, or returns -1.
+*/
+int64_t nn_regex_search(NNObjRegex* re, NNObjString* string, size_t from, size_t* mstart)
 {
     size_t i;
-    NNObjArray* list;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    list = nn_value_asarray(args->thisval);
-    for(i = 0; i < list->varray->listcount; i++)
+    int64_t mlen;
+    int64_t capstart;
+    int64_t caplength;
+    if(re->engine == NEON_REGEX_ENGINELINEAR)
     {
-        if(nn_value_compare(state, args->args[0], list->varray->listitems[i]))
+        return nn_regex_execlinear(re, string, from, false, 0, &capstart, &caplength, mstart);
+    }
+    for(i = from; i <= string->sbuf->length; i++)
+    {
+        mlen = nn_regex_matchat(re, string, i, 0, &capstart, &caplength);
+        if(mlen >= 0)
         {
-            return nn_value_makebool(true);
+            *mstart = i;
+            return mlen;
         }
     }
-    return nn_value_makebool(false);
+    return -1;
 }
 
-NNValue nn_objfnarray_delete(NNState* state, NNArguments* args)
+/*
+* both engines return the length of the match, not the number of groups, so every capture
+* slot is looked at; unset groups keep a length of 0 (or get -1), and are left out.
+*/
+NNValue nn_regex_matchvalue(NNState* state, NNObjRegex* re, NNObjString* string, bool capture)
 {
-    size_t i;
-    size_t idxupper;
-    size_t idxlower;
-    NNObjArray* list;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    idxlower = nn_value_asnumber(args->args[0]);
-    idxupper = idxlower;
-    if(args->count == 2)
+    int64_t i;
+    int64_t mtstart;
+    int64_t mtlength;
+    int64_t actualmaxcaptures;
+    int64_t mlen;
+    int64_t capstarts[NEON_CONFIG_REGEXMAXCAPTURES + 1] = {0};
+    int64_t caplengths[NEON_CONFIG_REGEXMAXCAPTURES + 1] = {0};
+    const char* strstart;
+    NNObjString* rstr;
+    NNObjArray* oa;
+    NNObjDict* dm;
+    actualmaxcaptures = 0;
+    if(capture)
     {
-        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
-        idxupper = nn_value_asnumber(args->args[1]);
+        actualmaxcaptures = NEON_CONFIG_REGEXMAXCAPTURES;
     }
-    list = nn_value_asarray(args->thisval);
-    if(((int)idxlower < 0) || idxlower >= list->varray->listcount)
+    mlen = nn_regex_matchat(re, string, 0, actualmaxcaptures, capstarts, caplengths);
+    if(mlen < 0)
     {
-        NEON_RETURNERROR("list index %d out of range at delete()", idxlower);
+        if(capture)
+        {
+            return nn_value_makenull();
+        }
+        return nn_value_makebool(false);
     }
-    else if(idxupper < idxlower || idxupper >= list->varray->listcount)
+    if(!capture)
     {
-        NEON_RETURNERROR("invalid upper limit %d at delete()", idxupper);
+        return nn_value_makebool(true);
     }
-    for(i = 0; i < list->varray->listcount - idxupper; i++)
+    if((re->engine == NEON_REGEX_ENGINELINEAR) && ((re->program->capcount - 1) < actualmaxcaptures))
     {
-        list->varray->listitems[idxlower + i] = list->varray->listitems[i + idxupper + 1];
+        actualmaxcaptures = re->program->capcount - 1;
     }
-    list->varray->listcount -= idxupper - idxlower + 1;
-    return nn_value_makenumber((double)idxupper - (double)idxlower + 1);
+    oa = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    for(i=0; i<actualmaxcaptures; i++)
+    {
+        mtstart = capstarts[i];
+        mtlength = caplengths[i];
+        if(mtlength > 0)
+        {
+            strstart = &string->sbuf->data[mtstart];
+            rstr = nn_string_copylen(state, strstart, mtlength);
+            dm = nn_object_makedict(state);
+            nn_array_push(oa, nn_value_fromobject(dm));
+            nn_dict_addentrycstr(dm, "string", nn_value_fromobject(rstr));
+            nn_dict_addentrycstr(dm, "start", nn_value_makenumber(mtstart));
+            nn_dict_addentrycstr(dm, "length", nn_value_makenumber(mtlength));
+        }
+    }
+    return nn_value_fromobject(oa);
 }
 
-NNValue nn_objfnarray_first(NNState* state, NNArguments* args)
+NNValue nn_util_stringregexmatch(NNState* state, NNObjString* string, NNObjString* pattern, bool capture)
 {
-    NNObjArray* list;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    list = nn_value_asarray(args->thisval);
-    if(list->varray->listcount > 0)
+    NNObjRegex* re;
+    re = nn_regex_cacheget(state, pattern);
+    if(re == NULL)
     {
-        return list->varray->listitems[0];
+        return nn_value_makenull();
     }
-    return nn_value_makenull();
+    return nn_regex_matchvalue(state, re, string, capture);
 }
 
-NNValue nn_objfnarray_last(NNState* state, NNArguments* args)
+/*
+* Regex(pattern [, engine]): engine is "backtrack" (the default) or "linear".
+* the linear engine guarantees matching time proportional to the length of the input.
+*/
+NNValue nn_objfnregex_constructor(NNState* state, NNArguments* args)
 {
-    NNObjArray* list;
+    int engine;
+    NNObjString* name;
+    NNObjRegex* re;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    list = nn_value_asarray(args->thisval);
-    if(list->varray->listcount > 0)
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    engine = NEON_REGEX_ENGINEBACKTRACK;
+    if(args->count == 2)
     {
-        return list->varray->listitems[list->varray->listcount - 1];
+        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isstring);
+        name = nn_value_asstring(args->args[1]);
+        if(strcmp(name->sbuf->data, "linear") == 0)
+        {
+            engine = NEON_REGEX_ENGINELINEAR;
+        }
+        else if(strcmp(name->sbuf->data, "backtrack") != 0)
+        {
+            return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "unknown regex engine '%s'", name->sbuf->data);
+        }
     }
-    return nn_value_makenull();
+    re = nn_regex_compile(state, nn_value_asstring(args->args[0]), engine);
+    if(re == NULL)
+    {
+        return nn_value_makenull();
+    }
+    return nn_value_fromobject(re);
 }
 
-NNValue nn_objfnarray_isempty(NNState* state, NNArguments* args)
+NNValue nn_objfnregex_pattern(NNState* state, NNArguments* args)
 {
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
-    return nn_value_makebool(nn_value_asarray(args->thisval)->varray->listcount == 0);
+    return nn_value_fromobject(nn_value_asregex(args->thisval)->pattern);
 }
 
-
-NNValue nn_objfnarray_take(NNState* state, NNArguments* args)
+NNValue nn_objfnregex_engine(NNState* state, NNArguments* args)
 {
-    size_t count;
-    NNObjArray* list;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    list = nn_value_asarray(args->thisval);
-    count = nn_value_asnumber(args->args[0]);
-    if((int)count < 0)
-    {
-        count = list->varray->listcount + count;
-    }
-    if(list->varray->listcount < count)
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    if(nn_value_asregex(args->thisval)->engine == NEON_REGEX_ENGINELINEAR)
     {
-        return nn_value_fromobject(nn_array_copy(list, 0, list->varray->listcount));
+        return nn_value_fromobject(nn_string_copycstr(state, "linear"));
     }
-    return nn_value_fromobject(nn_array_copy(list, 0, count));
+    return nn_value_fromobject(nn_string_copycstr(state, "backtrack"));
 }
 
-NNValue nn_objfnarray_get(NNState* state, NNArguments* args)
+NNValue nn_objfnregex_test(NNState* state, NNArguments* args)
 {
-    size_t index;
-    NNObjArray* list;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    list = nn_value_asarray(args->thisval);
-    index = nn_value_asnumber(args->args[0]);
-    if((int)index < 0 || index >= list->varray->listcount)
-    {
-        return nn_value_makenull();
-    }
-    return list->varray->listitems[index];
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    return nn_regex_matchvalue(state, nn_value_asregex(args->thisval), nn_value_asstring(args->args[0]), false);
 }
 
-NNValue nn_objfnarray_compact(NNState* state, NNArguments* args)
+NNValue nn_objfnregex_match(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjArray* list;
-    NNObjArray* newlist;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    list = nn_value_asarray(args->thisval);
-    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    for(i = 0; i < list->varray->listcount; i++)
-    {
-        if(!nn_value_compare(state, list->varray->listitems[i], nn_value_makenull()))
-        {
-            nn_array_push(newlist, list->varray->listitems[i]);
-        }
-    }
-    return nn_value_fromobject(newlist);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    return nn_regex_matchvalue(state, nn_value_asregex(args->thisval), nn_value_asstring(args->args[0]), true);
 }
 
-
-NNValue nn_objfnarray_unique(NNState* state, NNArguments* args)
+/*
+* findAll, replace and split scan the string left to right.
+* empty matches are skipped, so that patterns like "a*" do not match between every character.
+*/
+NNValue nn_objfnregex_findall(NNState* state, NNArguments* args)
 {
-    size_t i;
-    size_t j;
-    bool found;
+    size_t pos;
+    size_t mstart;
+    int64_t mlen;
+    NNObjRegex* re;
+    NNObjString* string;
     NNObjArray* list;
-    NNObjArray* newlist;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    list = nn_value_asarray(args->thisval);
-    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    for(i = 0; i < list->varray->listcount; i++)
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    re = nn_value_asregex(args->thisval);
+    string = nn_value_asstring(args->args[0]);
+    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    pos = 0;
+    while(pos < string->sbuf->length)
     {
-        found = false;
-        for(j = 0; j < newlist->varray->listcount; j++)
+        mlen = nn_regex_search(re, string, pos, &mstart);
+        if(mlen < 0)
         {
-            if(nn_value_compare(state, newlist->varray->listitems[j], list->varray->listitems[i]))
-            {
-                found = true;
-                continue;
-            }
+            break;
         }
-        if(!found)
+        if(mlen == 0)
         {
-            nn_array_push(newlist, list->varray->listitems[i]);
+            pos = mstart + 1;
+            continue;
         }
+        nn_array_push(list, nn_value_fromobject(nn_string_copylen(state, string->sbuf->data + mstart, mlen)));
+        pos = mstart + mlen;
     }
-    return nn_value_fromobject(newlist);
+    return nn_value_fromobject(list);
 }
 
-NNValue nn_objfnarray_zip(NNState* state, NNArguments* args)
+NNValue nn_objfnregex_replace(NNState* state, NNArguments* args)
 {
-    size_t i;
-    size_t j;
-    NNObjArray* list;
-    NNObjArray* newlist;
-    NNObjArray* alist;
-    NNObjArray** arglist;
+    size_t pos;
+    size_t last;
+    size_t mstart;
+    int64_t mlen;
+    StringBuffer* result;
+    NNObjRegex* re;
+    NNObjString* string;
+    NNObjString* repsubstr;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    list = nn_value_asarray(args->thisval);
-    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    arglist = (NNObjArray**)nn_gcmem_allocate(state, sizeof(NNObjArray*), args->count);
-    for(i = 0; i < args->count; i++)
-    {
-        NEON_ARGS_CHECKTYPE(&check, i, nn_value_isarray);
-        arglist[i] = nn_value_asarray(args->args[i]);
-    }
-    for(i = 0; i < list->varray->listcount; i++)
+    NEON_ARGS_CHECKCOUNT(&check, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isstring);
+    re = nn_value_asregex(args->thisval);
+    string = nn_value_asstring(args->args[0]);
+    repsubstr = nn_value_asstring(args->args[1]);
+    result = dyn_strbuf_makebasicempty(0, false);
+    pos = 0;
+    last = 0;
+    while(pos < string->sbuf->length)
     {
-        alist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-        /* item of main list*/
-        nn_array_push(alist, list->varray->listitems[i]);
-        for(j = 0; j < args->count; j++)
+        mlen = nn_regex_search(re, string, pos, &mstart);
+        if(mlen < 0)
         {
-            if(i < arglist[j]->varray->listcount)
-            {
-                nn_array_push(alist, arglist[j]->varray->listitems[i]);
-            }
-            else
-            {
-                nn_array_push(alist, nn_value_makenull());
-            }
+            break;
         }
-        nn_array_push(newlist, nn_value_fromobject(alist));
+        if(mlen == 0)
+        {
+            pos = mstart + 1;
+            continue;
+        }
+        dyn_strbuf_appendstrn(result, string->sbuf->data + last, mstart - last);
+        dyn_strbuf_appendstrn(result, repsubstr->sbuf->data, repsubstr->sbuf->length);
+        pos = mstart + mlen;
+        last = pos;
     }
-    return nn_value_fromobject(newlist);
+    dyn_strbuf_appendstrn(result, string->sbuf->data + last, string->sbuf->length - last);
+    return nn_value_fromobject(nn_string_makefromstrbuf(state, result, nn_util_hashstring(state, result->data, result->length)));
 }
 
-
-NNValue nn_objfnarray_zipfrom(NNState* state, NNArguments* args)
+NNValue nn_objfnregex_split(NNState* state, NNArguments* args)
 {
-    size_t i;
-    size_t j;
+    size_t pos;
+    size_t last;
+    size_t mstart;
+    int64_t mlen;
+    NNObjRegex* re;
+    NNObjString* string;
     NNObjArray* list;
-    NNObjArray* newlist;
-    NNObjArray* alist;
-    NNObjArray* arglist;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isarray);
-    list = nn_value_asarray(args->thisval);
-    newlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    arglist = nn_value_asarray(args->args[0]);
-    for(i = 0; i < arglist->varray->listcount; i++)
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    re = nn_value_asregex(args->thisval);
+    string = nn_value_asstring(args->args[0]);
+    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    pos = 0;
+    last = 0;
+    while(pos < string->sbuf->length)
     {
-        if(!nn_value_isarray(arglist->varray->listitems[i]))
+        mlen = nn_regex_search(re, string, pos, &mstart);
+        if(mlen < 0)
         {
-            NEON_RETURNERROR("invalid list in zip entries");
+            break;
         }
-    }
-    for(i = 0; i < list->varray->listcount; i++)
-    {
-        alist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-        nn_array_push(alist, list->varray->listitems[i]);
-        for(j = 0; j < arglist->varray->listcount; j++)
+        if(mlen == 0)
         {
-            if(i < nn_value_asarray(arglist->varray->listitems[j])->varray->listcount)
-            {
-                nn_array_push(alist, nn_value_asarray(arglist->varray->listitems[j])->varray->listitems[i]);
-            }
-            else
-            {
-                nn_array_push(alist, nn_value_makenull());
-            }
+            pos = mstart + 1;
+            continue;
         }
-        nn_array_push(newlist, nn_value_fromobject(alist));
+        nn_array_push(list, nn_value_fromobject(nn_string_makeslice(state, string, last, mstart - last)));
+        pos = mstart + mlen;
+        last = pos;
     }
-    return nn_value_fromobject(newlist);
+    nn_array_push(list, nn_value_fromobject(nn_string_makeslice(state, string, last, string->sbuf->length - last)));
+    return nn_value_fromobject(list);
 }
 
-NNValue nn_objfnarray_todict(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_matchcapture(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjDict* dict;
-    NNObjArray* list;
+    NNObjString* pattern;
+    NNObjString* string;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    dict = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
-    list = nn_value_asarray(args->thisval);
-    for(i = 0; i < list->varray->listcount; i++)
-    {
-        nn_dict_setentry(dict, nn_value_makenumber(i), list->varray->listitems[i]);
-    }
-    return nn_value_fromobject(dict);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    string = nn_value_asstring(args->thisval);
+    pattern = nn_value_asstring(args->args[0]);
+    return nn_util_stringregexmatch(state, string, pattern, true);
 }
 
-NNValue nn_objfnarray_iter(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_matchonly(NNState* state, NNArguments* args)
 {
-    size_t index;
-    NNObjArray* list;
+    NNObjString* pattern;
+    NNObjString* string;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    list = nn_value_asarray(args->thisval);
-    index = nn_value_asnumber(args->args[0]);
-    if(((int)index > -1) && index < list->varray->listcount)
-    {
-        return list->varray->listitems[index];
-    }
-    return nn_value_makenull();
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    string = nn_value_asstring(args->thisval);
+    pattern = nn_value_asstring(args->args[0]);
+    return nn_util_stringregexmatch(state, string, pattern, false);
 }
 
-NNValue nn_objfnarray_itern(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_count(NNState* state, NNArguments* args)
 {
-    size_t index;
-    NNObjArray* list;
+    int count;
+    const char* tmp;
+    NNObjString* substr;
+    NNObjString* string;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    list = nn_value_asarray(args->thisval);
-    if(nn_value_isnull(args->args[0]))
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    string = nn_value_asstring(args->thisval);
+    substr = nn_value_asstring(args->args[0]);
+    if(substr->sbuf->length == 0 || string->sbuf->length == 0)
     {
-        if(list->varray->listcount == 0)
-        {
-            return nn_value_makebool(false);
-        }
         return nn_value_makenumber(0);
     }
-    if(!nn_value_isnumber(args->args[0]))
+    count = 0;
+    tmp = string->sbuf->data;
+    while((tmp = nn_util_utf8strstr(tmp, substr->sbuf->data)))
     {
-        NEON_RETURNERROR("lists are numerically indexed");
+        count++;
+        tmp++;
     }
-    index = nn_value_asnumber(args->args[0]);
-    if(index < list->varray->listcount - 1)
+    return nn_value_makenumber(count);
+}
+
+NNValue nn_objfnstring_tonumber(NNState* state, NNArguments* args)
+{
+    NNObjString* selfstr;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    selfstr = nn_value_asstring(args->thisval);
+    return nn_value_makenumber(nn_util_strtod(selfstr->sbuf->data, selfstr->sbuf->length, NULL));
+}
+
+NNValue nn_objfnstring_isascii(NNState* state, NNArguments* args)
+{
+    NNObjString* string;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    if(args->count == 1)
     {
-        return nn_value_makenumber((double)index + 1);
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isbool);
     }
-    return nn_value_makenull();
+    string = nn_value_asstring(args->thisval);
+    return nn_value_makebool(nn_string_isascii(string));
 }
 
-NNValue nn_objfnarray_each(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_tolist(NNState* state, NNArguments* args)
 {
     size_t i;
-    size_t arity;
-    NNValue callable;
-    NNValue unused;
+    size_t end;
+    size_t start;
+    size_t length;
     NNObjArray* list;
-    NNObjArray* nestargs;
+    NNObjString* string;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    list = nn_value_asarray(args->thisval);
-    callable = args->args[0];
-    nestargs = nn_object_makearray(state);
-    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
-    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    for(i = 0; i < list->varray->listcount; i++)
+    NEON_ARGS_CHECKCOUNT(&check, 0);
+    string = nn_value_asstring(args->thisval);
+    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    length = string->sbuf->length;
+    if(length > 0)
     {
-        if(arity > 0)
+        for(i = 0; i < length; i++)
         {
-            nestargs->varray->listitems[0] = list->varray->listitems[i];
-            if(arity > 1)
-            {
-                nestargs->varray->listitems[1] = nn_value_makenumber(i);
-            }
+            start = i;
+            end = i + 1;
+            nn_array_push(list, nn_value_fromobject(nn_string_copylen(state, string->sbuf->data + start, (int)(end - start))));
         }
-        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &unused);
     }
-    nn_vm_stackpop(state);
-    return nn_value_makenull();
+    return nn_value_fromobject(list);
 }
 
-
-NNValue nn_objfnarray_map(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_lpad(NNState* state, NNArguments* args)
 {
     size_t i;
-    size_t arity;
-    NNValue res;
-    NNValue callable;
-    NNObjArray* list;
-    NNObjArray* nestargs;
-    NNObjArray* resultlist;
+    size_t width;
+    size_t fillsize;
+    size_t finalsize;
+    size_t finalutf8size;
+    char fillchar;
+    char* str;
+    char* fill;
+    NNObjString* ofillstr;
+    NNObjString* result;
+    NNObjString* string;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    list = nn_value_asarray(args->thisval);
-    callable = args->args[0];
-    nestargs = nn_object_makearray(state);
-    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    resultlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    for(i = 0; i < list->varray->listcount; i++)
-    {
-        if(!nn_value_isnull(list->varray->listitems[i]))
-        {
-            if(arity > 0)
-            {
-                nestargs->varray->listitems[0] = list->varray->listitems[i];
-                if(arity > 1)
-                {
-                    nestargs->varray->listitems[1] = nn_value_makenumber(i);
-                }
-            }
-            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &res);
-            nn_array_push(resultlist, res);
-        }
-        else
-        {
-            nn_array_push(resultlist, nn_value_makenull());
-        }
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    string = nn_value_asstring(args->thisval);
+    width = nn_value_asnumber(args->args[0]);
+    fillchar = ' ';
+    if(args->count == 2)
+    {
+        ofillstr = nn_value_asstring(args->args[1]);
+        fillchar = ofillstr->sbuf->data[0];
     }
-    return nn_value_fromobject(resultlist);
+    if(width <= string->sbuf->length)
+    {
+        return args->thisval;
+    }
+    fillsize = width - string->sbuf->length;
+    fill = (char*)nn_memory_malloc(sizeof(char) * ((size_t)fillsize + 1));
+    finalsize = string->sbuf->length + fillsize;
+    finalutf8size = string->sbuf->length + fillsize;
+    for(i = 0; i < fillsize; i++)
+    {
+        fill[i] = fillchar;
+    }
+    str = (char*)nn_memory_malloc(sizeof(char) * ((size_t)finalsize + 1));
+    memcpy(str, fill, fillsize);
+    memcpy(str + fillsize, string->sbuf->data, string->sbuf->length);
+    str[finalsize] = '\0';
+    nn_memory_free(fill);
+    result = nn_string_takelen(state, str, finalsize);
+    result->sbuf->length = finalutf8size;
+    result->sbuf->length = finalsize;
+    return nn_value_fromobject(result);
 }
 
-
-NNValue nn_objfnarray_filter(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_rpad(NNState* state, NNArguments* args)
 {
     size_t i;
-    size_t arity;
-    NNValue callable;
-    NNValue result;
-    NNObjArray* list;
-    NNObjArray* nestargs;
-    NNObjArray* resultlist;
+    size_t width;
+    size_t fillsize;
+    size_t finalsize;
+    size_t finalutf8size;
+    char fillchar;
+    char* str;
+    char* fill;
+    NNObjString* ofillstr;
+    NNObjString* string;
+    NNObjString* result;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    list = nn_value_asarray(args->thisval);
-    callable = args->args[0];
-    nestargs = nn_object_makearray(state);
-    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
-    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    resultlist = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    for(i = 0; i < list->varray->listcount; i++)
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+    string = nn_value_asstring(args->thisval);
+    width = nn_value_asnumber(args->args[0]);
+    fillchar = ' ';
+    if(args->count == 2)
     {
-        if(!nn_value_isnull(list->varray->listitems[i]))
-        {
-            if(arity > 0)
-            {
-                nestargs->varray->listitems[0] = list->varray->listitems[i];
-                if(arity > 1)
-                {
-                    nestargs->varray->listitems[1] = nn_value_makenumber(i);
-                }
-            }
-            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
-            if(!nn_value_isfalse(result))
-            {
-                nn_array_push(resultlist, list->varray->listitems[i]);
-            }
-        }
+        ofillstr = nn_value_asstring(args->args[1]);
+        fillchar = ofillstr->sbuf->data[0];
     }
-    nn_vm_stackpop(state);
-    return nn_value_fromobject(resultlist);
+    if(width <= string->sbuf->length)
+    {
+        return args->thisval;
+    }
+    fillsize = width - string->sbuf->length;
+    fill = (char*)nn_memory_malloc(sizeof(char) * ((size_t)fillsize + 1));
+    finalsize = string->sbuf->length + fillsize;
+    finalutf8size = string->sbuf->length + fillsize;
+    for(i = 0; i < fillsize; i++)
+    {
+        fill[i] = fillchar;
+    }
+    str = (char*)nn_memory_malloc(sizeof(char) * ((size_t)finalsize + 1));
+    memcpy(str, string->sbuf->data, string->sbuf->length);
+    memcpy(str + string->sbuf->length, fill, fillsize);
+    str[finalsize] = '\0';
+    nn_memory_free(fill);
+    result = nn_string_takelen(state, str, finalsize);
+    result->sbuf->length = finalutf8size;
+    result->sbuf->length = finalsize;
+    return nn_value_fromobject(result);
 }
 
-NNValue nn_objfnarray_some(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_split(NNState* state, NNArguments* args)
 {
     size_t i;
-    size_t arity;
-    NNValue callable;
-    NNValue result;
+    size_t end;
+    size_t start;
+    size_t length;
     NNObjArray* list;
-    NNObjArray* nestargs;
+    NNObjString* string;
+    NNObjString* delimeter;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    list = nn_value_asarray(args->thisval);
-    callable = args->args[0];
-    nestargs = nn_object_makearray(state);
-    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
-    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    for(i = 0; i < list->varray->listcount; i++)
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    string = nn_value_asstring(args->thisval);
+    delimeter = nn_value_asstring(args->args[0]);
+    /* empty string matches empty string to empty list */
+    if(((string->sbuf->length == 0) && (delimeter->sbuf->length == 0)) || (string->sbuf->length == 0) || (delimeter->sbuf->length == 0))
     {
-        if(!nn_value_isnull(list->varray->listitems[i]))
+        return nn_value_fromobject(nn_object_makearray(state));
+    }
+    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    if(delimeter->sbuf->length > 0)
+    {
+        start = 0;
+        for(i = 0; i <= string->sbuf->length; i++)
         {
-            if(arity > 0)
-            {
-                nestargs->varray->listitems[0] = list->varray->listitems[i];
-                if(arity > 1)
-                {
-                    nestargs->varray->listitems[1] = nn_value_makenumber(i);
-                }
-            }
-            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
-            if(!nn_value_isfalse(result))
+            /* match found. */
+            if(memcmp(string->sbuf->data + i, delimeter->sbuf->data, delimeter->sbuf->length) == 0 || i == string->sbuf->length)
             {
-                nn_vm_stackpop(state);
-                return nn_value_makebool(true);
+                nn_array_push(list, nn_value_fromobject(nn_string_makeslice(state, string, start, i - start)));
+                i += delimeter->sbuf->length - 1;
+                start = i + 1;
             }
         }
     }
-    nn_vm_stackpop(state);
-    return nn_value_makebool(false);
-}
-
-
-NNValue nn_objfnarray_every(NNState* state, NNArguments* args)
-{
-    size_t i;
-    size_t arity;
-    NNValue result;
-    NNValue callable;
-    NNObjArray* list;
-    NNObjArray* nestargs;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    list = nn_value_asarray(args->thisval);
-    callable = args->args[0];
-    nestargs = nn_object_makearray(state);
-    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
-    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    for(i = 0; i < list->varray->listcount; i++)
+    else
     {
-        if(!nn_value_isnull(list->varray->listitems[i]))
+        length = string->sbuf->length;
+        for(i = 0; i < length; i++)
         {
-            if(arity > 0)
-            {
-                nestargs->varray->listitems[0] = list->varray->listitems[i];
-                if(arity > 1)
-                {
-                    nestargs->varray->listitems[1] = nn_value_makenumber(i);
-                }
-            }
-            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &result);
-            if(nn_value_isfalse(result))
-            {
-                nn_vm_stackpop(state);
-                return nn_value_makebool(false);
-            }
+            start = i;
+            end = i + 1;
+            nn_array_push(list, nn_value_fromobject(nn_string_copylen(state, string->sbuf->data + start, (int)(end - start))));
         }
     }
-    nn_vm_stackpop(state);
-    return nn_value_makebool(true);
+    return nn_value_fromobject(list);
 }
 
-NNValue nn_objfnarray_reduce(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_replace(NNState* state, NNArguments* args)
 {
     size_t i;
-    size_t arity;
-    size_t startindex;
-    NNValue callable;
-    NNValue accumulator;
-    NNObjArray* list;
-    NNObjArray* nestargs;
+    size_t totallength;
+    StringBuffer* result;
+    NNObjString* substr;
+    NNObjString* string;
+    NNObjString* repsubstr;
     NNArgCheck check;
+    (void)totallength;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    list = nn_value_asarray(args->thisval);
-    callable = args->args[0];
-    startindex = 0;
-    accumulator = nn_value_makenull();
-    if(args->count == 2)
-    {
-        accumulator = args->args[1];
-    }
-    if(nn_value_isnull(accumulator) && list->varray->listcount > 0)
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 2, 3);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
+    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isstring);
+    string = nn_value_asstring(args->thisval);
+    substr = nn_value_asstring(args->args[0]);
+    repsubstr = nn_value_asstring(args->args[1]);
+    if((string->sbuf->length == 0 && substr->sbuf->length == 0) || string->sbuf->length == 0 || substr->sbuf->length == 0)
     {
-        accumulator = list->varray->listitems[0];
-        startindex = 1;
+        return nn_value_fromobject(nn_string_copylen(state, string->sbuf->data, string->sbuf->length));
     }
-    nestargs = nn_object_makearray(state);
-    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
-    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    for(i = startindex; i < list->varray->listcount; i++)
+    result = dyn_strbuf_makebasicempty(0, false);
+    totallength = 0;
+    for(i = 0; i < string->sbuf->length; i++)
     {
-        if(!nn_value_isnull(list->varray->listitems[i]) && !nn_value_isnull(list->varray->listitems[i]))
+        if(memcmp(string->sbuf->data + i, substr->sbuf->data, substr->sbuf->length) == 0)
         {
-            if(arity > 0)
-            {
-                nestargs->varray->listitems[0] = accumulator;
-                if(arity > 1)
-                {
-                    nestargs->varray->listitems[1] = list->varray->listitems[i];
-                    if(arity > 2)
-                    {
-                        nestargs->varray->listitems[2] = nn_value_makenumber(i);
-                        if(arity > 4)
-                        {
-                            nestargs->varray->listitems[3] = args->thisval;
-                        }
-                    }
-                }
+            if(substr->sbuf->length > 0)
+            {
+                dyn_strbuf_appendstrn(result, repsubstr->sbuf->data, repsubstr->sbuf->length);
             }
-            nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &accumulator);
+            i += substr->sbuf->length - 1;
+            totallength += repsubstr->sbuf->length;
+        }
+        else
+        {
+            dyn_strbuf_appendchar(result, string->sbuf->data[i]);
+            totallength++;
         }
     }
-    nn_vm_stackpop(state);
-    return accumulator;
-}
-
-NNValue nn_objfnrange_lower(NNState* state, NNArguments* args)
-{
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    return nn_value_makenumber(nn_value_asrange(args->thisval)->lower);
-}
-
-NNValue nn_objfnrange_upper(NNState* state, NNArguments* args)
-{
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    return nn_value_makenumber(nn_value_asrange(args->thisval)->upper);
-}
-
-NNValue nn_objfnrange_range(NNState* state, NNArguments* args)
-{
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    return nn_value_makenumber(nn_value_asrange(args->thisval)->range);
+    return nn_value_fromobject(nn_string_makefromstrbuf(state, result, nn_util_hashstring(state, result->data, result->length)));
 }
 
-NNValue nn_objfnrange_iter(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_iter(NNState* state, NNArguments* args)
 {
-    int val;
-    int index;
-    NNObjRange* range;
+    size_t index;
+    size_t length;
+    NNObjString* string;
+    NNObjString* result;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
     NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    range = nn_value_asrange(args->thisval);
+    string = nn_value_asstring(args->thisval);
+    length = string->sbuf->length;
     index = nn_value_asnumber(args->args[0]);
-    if(index >= 0 && index < range->range)
+    if(((int)index > -1) && (index < length))
     {
-        if(index == 0)
-        {
-            return nn_value_makenumber(range->lower);
-        }
-        if(range->lower > range->upper)
-        {
-            val = --range->lower;
-        }
-        else
-        {
-            val = ++range->lower;
-        }
-        return nn_value_makenumber(val);
+        result = nn_string_copylen(state, &string->sbuf->data[index], 1);
+        return nn_value_fromobject(result);
     }
     return nn_value_makenull();
 }
 
-NNValue nn_objfnrange_itern(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_itern(NNState* state, NNArguments* args)
 {
-    int index;
-    NNObjRange* range;
+    size_t index;
+    size_t length;
+    NNObjString* string;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
-    range = nn_value_asrange(args->thisval);
+    string = nn_value_asstring(args->thisval);
+    length = string->sbuf->length;
     if(nn_value_isnull(args->args[0]))
     {
-        if(range->range == 0)
+        if(length == 0)
         {
-            return nn_value_makenull();
+            return nn_value_makebool(false);
         }
         return nn_value_makenumber(0);
     }
     if(!nn_value_isnumber(args->args[0]))
     {
-        NEON_RETURNERROR("ranges are numerically indexed");
+        NEON_RETURNERROR("strings are numerically indexed");
     }
-    index = (int)nn_value_asnumber(args->args[0]) + 1;
-    if(index < range->range)
+    index = nn_value_asnumber(args->args[0]);
+    if(index < length - 1)
     {
-        return nn_value_makenumber(index);
+        return nn_value_makenumber((double)index + 1);
     }
     return nn_value_makenull();
 }
 
-NNValue nn_objfnrange_loop(NNState* state, NNArguments* args)
+NNValue nn_objfnstring_each(NNState* state, NNArguments* args)
 {
-    int i;
-    int arity;
+    size_t i;
+    size_t arity;
     NNValue callable;
     NNValue unused;
-    NNObjRange* range;
+    NNObjString* string;
     NNObjArray* nestargs;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 1);
     NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    range = nn_value_asrange(args->thisval);
+    string = nn_value_asstring(args->thisval);
     callable = args->args[0];
     nestargs = nn_object_makearray(state);
     nn_vm_stackpush(state, nn_value_fromobject(nestargs));
     arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    for(i = 0; i < range->range; i++)
+    for(i = 0; i < string->sbuf->length; i++)
     {
         if(arity > 0)
         {
-            nestargs->varray->listitems[0] = nn_value_makenumber(i);
+            nestargs->varray->listitems[0] = nn_value_fromobject(nn_string_copylen(state, string->sbuf->data + i, 1));
             if(arity > 1)
             {
                 nestargs->varray->listitems[1] = nn_value_makenumber(i);
@@ -12332,1626 +20394,2607 @@ NNValue nn_objfnrange_loop(NNState* state, NNArguments* args)
         }
         nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &unused);
     }
+    /* pop the argument list */
     nn_vm_stackpop(state);
     return nn_value_makenull();
 }
 
-NNValue nn_objfnrange_expand(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_dumpself(NNState* state, NNArguments* args)
 {
-    int i;
-    NNValue val;
-    NNObjRange* range;
-    NNObjArray* oa;
-    range = nn_value_asrange(args->thisval);
-    oa = nn_object_makearray(state);
-    for(i = 0; i < range->range; i++)
-    {
-        val = nn_value_makenumber(i);
-        nn_array_push(oa, val);
-    }
-    return nn_value_fromobject(oa);
+    NNValue v;
+    NNPrinter pr;
+    NNObjString* os;
+    v = args->thisval;
+    nn_printer_makestackstring(state, &pr);
+    nn_printer_printvalue(&pr, v, true, false);
+    os = nn_printer_takestring(&pr);
+    return nn_value_fromobject(os);
 }
 
-NNValue nn_objfnrange_constructor(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_tostring(NNState* state, NNArguments* args)
 {
-    int a;
-    int b;
-    NNObjRange* orng;
-    a = nn_value_asnumber(args->args[0]);
-    b = nn_value_asnumber(args->args[1]);
-    orng = nn_object_makerange(state, a, b);
-    return nn_value_fromobject(orng);
+    NNValue v;
+    NNPrinter pr;
+    NNObjString* os;
+    v = args->thisval;
+    nn_printer_makestackstring(state, &pr);
+    nn_printer_printvalue(&pr, v, false, true);
+    os = nn_printer_takestring(&pr);
+    return nn_value_fromobject(os);
 }
 
-NNValue nn_objfnstring_utf8numbytes(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_typename(NNState* state, NNArguments* args)
 {
-    int incode;
-    int res;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    incode = nn_value_asnumber(args->args[0]);
-    res = nn_util_utf8numbytes(incode);
-    return nn_value_makenumber(res);
+    NNValue v;
+    NNObjString* os;
+    v = args->args[0];
+    os = nn_string_copycstr(state, nn_value_typename(v));
+    return nn_value_fromobject(os);
 }
 
-NNValue nn_objfnstring_utf8decode(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_getselfclass(NNState* state, NNArguments* args)
 {
-    int res;
-    NNObjString* instr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    instr = nn_value_asstring(args->args[0]);
-    res = nn_util_utf8decode((const uint8_t*)instr->sbuf->data, instr->sbuf->length);
-    return nn_value_makenumber(res);
+    (void)state;
+    return args->thisval;
 }
 
-NNValue nn_objfnstring_utf8encode(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_isstring(NNState* state, NNArguments* args)
 {
-    int incode;
-    size_t len;
-    NNObjString* res;
-    char* buf;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    incode = nn_value_asnumber(args->args[0]);
-    buf = nn_util_utf8encode(incode, &len);
-    res = nn_string_takelen(state, buf, len);
-    return nn_value_fromobject(res);
+    NNValue v;
+    (void)state;
+    v = args->thisval;
+    return nn_value_makebool(nn_value_isstring(v));
 }
 
-NNValue nn_util_stringutf8chars(NNState* state, NNArguments* args, bool onlycodepoint)
+NNValue nn_objfnobject_isarray(NNState* state, NNArguments* args)
 {
-    int cp;
-    bool havemax;
-    size_t counter;
-    size_t maxamount;
-    const char* cstr;
-    NNObjArray* res;
-    NNObjString* os;
-    NNObjString* instr;
-    utf8iterator_t iter;
-    havemax = false;
-    instr = nn_value_asstring(args->thisval);
-    if(args->count > 0)
-    {
-        havemax = true;
-        maxamount = nn_value_asnumber(args->args[0]);
-    }
-    res = nn_array_make(state);
-    nn_utf8iter_init(&iter, instr->sbuf->data, instr->sbuf->length);
-    counter = 0;
-    while(nn_utf8iter_next(&iter))
+    NNValue v;
+    (void)state;
+    v = args->thisval;
+    return nn_value_makebool(nn_value_isarray(v));
+}
+
+NNValue nn_objfnobject_isa(NNState* state, NNArguments* args)
+{
+    NNValue v;
+    NNValue otherclval;
+    NNObjClass* oclass;
+    NNObjClass* selfclass;
+    (void)state;
+    v = args->thisval;
+    otherclval = args->args[0];
+    if(nn_value_isclass(otherclval))
     {
-        cp = iter.codepoint;
-        cstr = nn_utf8iter_getchar(&iter);
-        counter++;
-        if(havemax)
-        {
-            if(counter == maxamount)
-            {
-                goto finalize;
-            }
-        }
-        if(onlycodepoint)
-        {
-            nn_array_push(res, nn_value_makenumber(cp));
-        }
-        else
+        oclass = nn_value_asclass(otherclval);
+        selfclass = nn_value_getclassfor(state, v);
+        if(selfclass != NULL)
         {
-            os = nn_string_copylen(state, cstr, iter.charsize);
-            nn_array_push(res, nn_value_fromobject(os));
+            return nn_value_makebool(nn_util_isinstanceof(selfclass, oclass));
         }
     }
-    finalize:
-    return nn_value_fromobject(res);
+    return nn_value_makebool(false);
+}
+
+NNValue nn_objfnobject_iscallable(NNState* state, NNArguments* args)
+{
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return (nn_value_makebool(
+        nn_value_isclass(selfval) ||
+        nn_value_isfuncscript(selfval) ||
+        nn_value_isfuncclosure(selfval) ||
+        nn_value_isfuncbound(selfval) ||
+        nn_value_isfuncnative(selfval)
+    ));
 }
 
-NNValue nn_objfnstring_utf8chars(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_isbool(NNState* state, NNArguments* args)
 {
-    return nn_util_stringutf8chars(state, args, false);
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return nn_value_makebool(nn_value_isbool(selfval));
 }
 
-NNValue nn_objfnstring_utf8codepoints(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_isnumber(NNState* state, NNArguments* args)
 {
-    return nn_util_stringutf8chars(state, args, true);
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return nn_value_makebool(nn_value_isnumber(selfval));
 }
 
+NNValue nn_objfnobject_isint(NNState* state, NNArguments* args)
+{
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return nn_value_makebool(nn_value_isnumber(selfval) && (((int)nn_value_asnumber(selfval)) == nn_value_asnumber(selfval)));
+}
 
-NNValue nn_objfnstring_fromcharcode(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_isdict(NNState* state, NNArguments* args)
 {
-    char ch;
-    NNObjString* os;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    ch = nn_value_asnumber(args->args[0]);
-    os = nn_string_copylen(state, &ch, 1);
-    return nn_value_fromobject(os);
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return nn_value_makebool(nn_value_isdict(selfval));
 }
 
-NNValue nn_objfnstring_constructor(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_isobject(NNState* state, NNArguments* args)
 {
-    NNObjString* os;
-    NNArgCheck check;
-    (void)args;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    os = nn_string_copylen(state, "", 0);
-    return nn_value_fromobject(os);
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return nn_value_makebool(nn_value_isobject(selfval));
 }
 
-NNValue nn_objfnstring_length(NNState* state, NNArguments* args)
+NNValue nn_objfnobject_isfunction(NNState* state, NNArguments* args)
 {
-    NNArgCheck check;
-    NNObjString* selfstr;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    selfstr = nn_value_asstring(args->thisval);
-    return nn_value_makenumber(selfstr->sbuf->length);
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return nn_value_makebool(
+        nn_value_isfuncscript(selfval) ||
+        nn_value_isfuncclosure(selfval) ||
+        nn_value_isfuncbound(selfval) ||
+        nn_value_isfuncnative(selfval)
+    );
 }
 
-NNValue nn_string_fromrange(NNState* state, const char* buf, int len)
+NNValue nn_objfnobject_isiterable(NNState* state, NNArguments* args)
 {
-    NNObjString* str;
-    if(len <= 0)
+    bool isiterable;
+    NNValue dummy;
+    NNObjClass* klass;
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    isiterable = nn_value_isarray(selfval) || nn_value_isdict(selfval) || nn_value_isstring(selfval);
+    if(!isiterable && nn_value_isinstance(selfval))
     {
-        return nn_value_fromobject(nn_string_copylen(state, "", 0));
+        klass = nn_value_asinstance(selfval)->klass;
+        isiterable = nn_tableval_get(klass->instmethods, nn_value_fromobject(nn_string_intern(state, "@iter")), &dummy)
+            && nn_tableval_get(klass->instmethods, nn_value_fromobject(nn_string_intern(state, "@itern")), &dummy);
     }
-    str = nn_string_copylen(state, "", 0);
-    dyn_strbuf_appendstrn(str->sbuf, buf, len);
-    return nn_value_fromobject(str);
+    return nn_value_makebool(isiterable);
 }
 
-NNObjString* nn_string_substring(NNState* state, NNObjString* selfstr, size_t start, size_t end, bool likejs)
+NNValue nn_objfnobject_isclass(NNState* state, NNArguments* args)
 {
-    size_t asz;
-    size_t len;
-    size_t tmp;
-    size_t maxlen;
-    char* raw;
-    (void)likejs;
-    maxlen = selfstr->sbuf->length;
-    len = maxlen;
-    if(end > maxlen)
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return nn_value_makebool(nn_value_isclass(selfval));
+}
+
+NNValue nn_objfnobject_isfile(NNState* state, NNArguments* args)
+{
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return nn_value_makebool(nn_value_isfile(selfval));
+}
+
+NNValue nn_objfnobject_isinstance(NNState* state, NNArguments* args)
+{
+    NNValue selfval;
+    (void)state;
+    selfval = args->thisval;
+    return nn_value_makebool(nn_value_isinstance(selfval));
+}
+
+
+NNValue nn_objfnclass_getselfname(NNState* state, NNArguments* args)
+{
+    NNValue selfval;
+    NNObjClass* klass;
+    (void)state;
+    selfval = args->thisval;
+    klass = nn_value_asclass(selfval);
+    return nn_value_fromobject(klass->name);
+}
+
+NNObjString* nn_util_numbertobinstring(NNState* state, long n)
+{
+    int i;
+    int rem;
+    int count;
+    int length;
+    long j;
+    /* assume maximum of 1024 bits */
+    char str[1024];
+    char newstr[1027];
+    count = 0;
+    j = n;
+    if(j == 0)
     {
-        tmp = start;
-        start = end;
-        end = tmp;
-        len = maxlen;
+        str[count++] = '0';
     }
-    if(end < start)
+    while(j != 0)
     {
-        tmp = end;
-        end = start;
-        start = tmp;
-        len = end;
+        rem = abs((int)(j % 2));
+        j /= 2;
+        if(rem == 1)
+        {
+            str[count] = '1';
+        }
+        else
+        {
+            str[count] = '0';
+        }
+        count++;
     }
-    len = (end - start);
-    if(len > maxlen)
+    /* assume maximum of 1024 bits + 0b (indicator) + sign (-). */
+    length = 0;
+    if(n < 0)
     {
-        len = maxlen;
+        newstr[length++] = '-';
+    }
+    newstr[length++] = '0';
+    newstr[length++] = 'b';
+    for(i = count - 1; i >= 0; i--)
+    {
+        newstr[length++] = str[i];
     }
-    asz = ((end + 1) * sizeof(char));
-    raw = (char*)nn_memory_malloc(sizeof(char) * asz);
-    memset(raw, 0, asz);
-    memcpy(raw, selfstr->sbuf->data + start, len);
-    return nn_string_takelen(state, raw, len);
+    newstr[length++] = 0;
+    return nn_string_copylen(state, newstr, length);
+    /*
+    //  // To store the binary number
+    //  int64_t number = 0;
+    //  int cnt = 0;
+    //  while (n != 0) {
+    //    int64_t rem = n % 2;
+    //    int64_t c = (int64_t) pow(10, cnt);
+    //    number += rem * c;
+    //    n /= 2;
+    //
+    //    // Count used to store exponent value
+    //    cnt++;
+    //  }
+    //
+    //  char str[67]; // assume maximum of 64 bits + 2 binary indicators (0b)
+    //  int length = sprintf(str, "0b%lld", number);
+    //
+    //  return nn_string_copylen(state, str, length);
+    */
 }
 
-NNValue nn_objfnstring_substring(NNState* state, NNArguments* args)
+NNObjString* nn_util_numbertooctstring(NNState* state, int64_t n, bool numeric)
 {
-    size_t end;
-    size_t start;
-    size_t maxlen;
-    NNObjString* nos;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    selfstr = nn_value_asstring(args->thisval);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    maxlen = selfstr->sbuf->length;
-    end = maxlen;
-    start = nn_value_asnumber(args->args[0]);
-    if(args->count > 1)
-    {
-        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
-        end = nn_value_asnumber(args->args[1]);
-    }
-    nos = nn_string_substring(state, selfstr, start, end, true);
-    return nn_value_fromobject(nos);
+    int length;
+    /* assume maximum of 64 bits + 2 octal indicators (0c) */
+    char str[66];
+    length = sprintf(str, numeric ? "0c%lo" : "%lo", n);
+    return nn_string_copylen(state, str, length);
 }
 
-NNValue nn_objfnstring_charcodeat(NNState* state, NNArguments* args)
+NNObjString* nn_util_numbertohexstring(NNState* state, int64_t n, bool numeric)
 {
-    int ch;
-    int idx;
-    int selflen;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    selfstr = nn_value_asstring(args->thisval);
-    idx = nn_value_asnumber(args->args[0]);
-    selflen = (int)selfstr->sbuf->length;
-    if((idx < 0) || (idx >= selflen))
+    int length;
+    /* assume maximum of 64 bits + 2 hex indicators (0x) */
+    char str[66];
+    length = sprintf(str, numeric ? "0x%lx" : "%lx", n);
+    return nn_string_copylen(state, str, length);
+}
+
+NNValue nn_objfnnumber_tobinstring(NNState* state, NNArguments* args)
+{
+    return nn_value_fromobject(nn_util_numbertobinstring(state, nn_value_asnumber(args->thisval)));
+}
+
+NNValue nn_objfnnumber_tooctstring(NNState* state, NNArguments* args)
+{
+    return nn_value_fromobject(nn_util_numbertooctstring(state, nn_value_asnumber(args->thisval), false));
+}
+
+NNValue nn_objfnnumber_constructor(NNState* state, NNArguments* args)
+{
+    NNValue val;
+    NNValue rtval;
+    NNObjString* os;
+    if(args->count == 0)
     {
-        ch = -1;
+        return nn_value_makenumber(0);
     }
-    else
+    val = args->args[0];
+    if(nn_value_isnumber(val))
     {
-        ch = selfstr->sbuf->data[idx];
+        return val;
     }
-    return nn_value_makenumber(ch);
-}
-
-NNValue nn_objfnstring_charat(NNState* state, NNArguments* args)
-{
-    char ch;
-    int idx;
-    int selflen;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    selfstr = nn_value_asstring(args->thisval);
-    idx = nn_value_asnumber(args->args[0]);
-    selflen = (int)selfstr->sbuf->length;
-    if((idx < 0) || (idx >= selflen))
+    if(nn_value_isnull(val))
     {
-        return nn_value_fromobject(nn_string_copylen(state, "", 0));
+        return nn_value_makenumber(0);
     }
-    else
+    if(!nn_value_isstring(val))
     {
-        ch = selfstr->sbuf->data[idx];
+        NEON_RETURNERROR("Number() expects no arguments, or number, or string");
     }
-    return nn_value_fromobject(nn_string_copylen(state, &ch, 1));
+    NNAstToken tok;
+    NNAstLexer lex;
+    os = nn_value_asstring(val);
+    nn_astlex_init(&lex, state, os->sbuf->data);
+    tok = nn_astlex_scannumber(&lex);
+    rtval = nn_astparser_compilestrnumber(tok.type, tok.start, tok.length);
+    return rtval;
 }
 
-NNValue nn_objfnstring_upper(NNState* state, NNArguments* args)
+NNValue nn_objfnnumber_tohexstring(NNState* state, NNArguments* args)
 {
-    size_t slen;
-    char* string;
-    NNObjString* str;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    str = nn_value_asstring(args->thisval);
-    slen = str->sbuf->length;
-    string = nn_util_strtoupper(str->sbuf->data, slen);
-    return nn_value_fromobject(nn_string_copylen(state, string, slen));
+    return nn_value_fromobject(nn_util_numbertohexstring(state, nn_value_asnumber(args->thisval), false));
 }
 
-NNValue nn_objfnstring_lower(NNState* state, NNArguments* args)
+NNValue nn_objfnmath_abs(NNState* state, NNArguments* args)
 {
-    size_t slen;
-    char* string;
-    NNObjString* str;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    str = nn_value_asstring(args->thisval);
-    slen = str->sbuf->length;
-    string = nn_util_strtolower(str->sbuf->data, slen);
-    return nn_value_fromobject(nn_string_copylen(state, string, slen));
+    (void)state;
+    return nn_value_makenumber(fabs(nn_value_asnumber(args->args[0])));
 }
 
-NNValue nn_objfnstring_isalpha(NNState* state, NNArguments* args)
+NNValue nn_objfnmath_round(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNArgCheck check;
-    NNObjString* selfstr;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    selfstr = nn_value_asstring(args->thisval);
-    for(i = 0; i < selfstr->sbuf->length; i++)
-    {
-        if(!isalpha((unsigned char)selfstr->sbuf->data[i]))
-        {
-            return nn_value_makebool(false);
-        }
-    }
-    return nn_value_makebool(selfstr->sbuf->length != 0);
+    (void)state;
+    return nn_value_makenumber(round(nn_value_asnumber(args->args[0])));
 }
 
-NNValue nn_objfnstring_isalnum(NNState* state, NNArguments* args)
+NNValue nn_objfnmath_sqrt(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    selfstr = nn_value_asstring(args->thisval);
-    for(i = 0; i < selfstr->sbuf->length; i++)
-    {
-        if(!isalnum((unsigned char)selfstr->sbuf->data[i]))
-        {
-            return nn_value_makebool(false);
-        }
-    }
-    return nn_value_makebool(selfstr->sbuf->length != 0);
+    (void)state;
+    return nn_value_makenumber(sqrt(nn_value_asnumber(args->args[0])));
 }
 
-NNValue nn_objfnstring_isfloat(NNState* state, NNArguments* args)
+NNValue nn_objfnmath_ceil(NNState* state, NNArguments* args)
 {
-    double f;
-    char* p;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    (void)f;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    selfstr = nn_value_asstring(args->thisval);
-    errno = 0;
-    if(selfstr->sbuf->length ==0)
-    {
-        return nn_value_makebool(false);
-    }
-    f = strtod(selfstr->sbuf->data, &p);
-    if(errno)
-    {
-        return nn_value_makebool(false);
-    }
-    else
-    {
-        if(*p == 0)
-        {
-            return nn_value_makebool(true);
-        }
-    }
-    return nn_value_makebool(false);
+    (void)state;
+    return nn_value_makenumber(ceil(nn_value_asnumber(args->args[0])));
 }
 
-NNValue nn_objfnstring_isnumber(NNState* state, NNArguments* args)
+NNValue nn_objfnmath_floor(NNState* state, NNArguments* args)
 {
-    size_t i;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    selfstr = nn_value_asstring(args->thisval);
-    for(i = 0; i < selfstr->sbuf->length; i++)
-    {
-        if(!isdigit((unsigned char)selfstr->sbuf->data[i]))
-        {
-            return nn_value_makebool(false);
-        }
-    }
-    return nn_value_makebool(selfstr->sbuf->length != 0);
+    (void)state;
+    return nn_value_makenumber(floor(nn_value_asnumber(args->args[0])));
 }
 
-NNValue nn_objfnstring_islower(NNState* state, NNArguments* args)
+NNValue nn_objfnmath_min(NNState* state, NNArguments* args)
 {
-    size_t i;
-    bool alphafound;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    selfstr = nn_value_asstring(args->thisval);
-    alphafound = false;
-    for(i = 0; i < selfstr->sbuf->length; i++)
+    double b;
+    double x;
+    double y;
+    (void)state;
+    x = nn_value_asnumber(args->args[0]);
+    y = nn_value_asnumber(args->args[1]);
+    b = (x < y) ? x : y;
+    return nn_value_makenumber(b);
+}
+
+NNValue nn_objfnprocess_exedirectory(NNState* state, NNArguments* args)
+{
+    (void)args;
+    return nn_value_fromobject(state->processinfo->cliexedirectory);
+}
+
+NNValue nn_objfnprocess_exit(NNState* state, NNArguments* args)
+{
+    int rc;
+    rc = 0;
+    if(args->count > 0)
     {
-        if(!alphafound && !isdigit(selfstr->sbuf->data[0]))
-        {
-            alphafound = true;
-        }
-        if(isupper(selfstr->sbuf->data[0]))
-        {
-            return nn_value_makebool(false);
-        }
+        rc = nn_value_asnumber(args->args[0]);
     }
-    return nn_value_makebool(alphafound);
+    nn_printer_flush(state->stdoutprinter);
+    exit(rc);
+    return nn_value_makenull();
 }
 
-NNValue nn_objfnstring_isupper(NNState* state, NNArguments* args)
+NNValue nn_objfnprocess_kill(NNState* state, NNArguments* args)
 {
-    size_t i;
-    bool alphafound;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    selfstr = nn_value_asstring(args->thisval);
-    alphafound = false;
-    for(i = 0; i < selfstr->sbuf->length; i++)
+    int pid;
+    int code;
+    (void)state;
+    pid = nn_value_asnumber(args->args[0]);
+    code = nn_value_asnumber(args->args[1]);
+    osfn_kill(pid, code);
+    return nn_value_makenull();
+}
+
+/* reads the option $key of Process.spawn(), which says where one of the standard streams goes. */
+bool nn_spawn_getstream(NNState* state, NNArguments* args, NNObjDict* dict, const char* key, NNSpawnStream* st)
+{
+    NNValue val;
+    const char* name;
+    if(!nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, key)), &val) || nn_value_isnull(val))
     {
-        if(!alphafound && !isdigit(selfstr->sbuf->data[0]))
+        return true;
+    }
+    if(nn_value_isfile(val))
+    {
+        st->mode = NEON_SPAWNMODE_FILE;
+        st->file = nn_value_asfile(val);
+        return true;
+    }
+    if(nn_value_isstring(val))
+    {
+        name = nn_value_asstring(val)->sbuf->data;
+        if(strcmp(name, "pipe") == 0)
         {
-            alphafound = true;
+            st->mode = NEON_SPAWNMODE_PIPE;
+            return true;
         }
-        if(islower(selfstr->sbuf->data[0]))
+        if(strcmp(name, "inherit") == 0)
         {
-            return nn_value_makebool(false);
+            st->mode = NEON_SPAWNMODE_INHERIT;
+            return true;
         }
-    }
-    return nn_value_makebool(alphafound);
-}
-
-NNValue nn_objfnstring_isspace(NNState* state, NNArguments* args)
-{
-    size_t i;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    selfstr = nn_value_asstring(args->thisval);
-    for(i = 0; i < selfstr->sbuf->length; i++)
-    {
-        if(!isspace((unsigned char)selfstr->sbuf->data[i]))
+        if(strcmp(name, "null") == 0)
+        {
+            st->mode = NEON_SPAWNMODE_NULL;
+            return true;
+        }
+        if((strcmp(name, "stdout") == 0) && (strcmp(key, "stderr") == 0))
         {
-            return nn_value_makebool(false);
+            st->mode = NEON_SPAWNMODE_STDOUT;
+            return true;
         }
     }
-    return nn_value_makebool(selfstr->sbuf->length != 0);
+    nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): %s must be \"pipe\", \"inherit\", \"null\" or a File", args->name, key);
+    return false;
 }
 
-NNValue nn_objfnstring_trim(NNState* state, NNArguments* args)
+/*
+* reads the options of Process.spawn() and Process.run() from the dict at $args[$argi], if any:
+*   stdin, stdout, stderr: "pipe", "inherit" (the streams of this process), "null", or a File.
+*                          stderr may also be "stdout", to go wherever stdout goes.
+*                          spawn() pipes stdin and stdout, and run() stdout and stderr, by default.
+*   env:                   a dict of variables to set for the program; null values unset them.
+*   clearEnv:              whether the program gets only the variables in env.
+*   input:                 run() only; a string or Bytes to write to the stdin of the program.
+*/
+bool nn_spawn_getoptions(NNState* state, NNArguments* args, size_t argi, NNSpawnOptions* opts, bool forrun)
 {
-    char trimmer;
-    char* end;
-    char* string;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
-    trimmer = '\0';
-    if(args->count == 1)
+    int i;
+    NNValue val;
+    NNObjDict* dict;
+    NNObjTypedArray* ta;
+    memset(opts, 0, sizeof(NNSpawnOptions));
+    for(i = 0; i < 3; i++)
     {
-        trimmer = (char)nn_value_asstring(args->args[0])->sbuf->data[0];
+        opts->streams[i].mode = NEON_SPAWNMODE_PIPE;
+        opts->streams[i].parentfd = -1;
+        opts->streams[i].childfd = -1;
     }
-    selfstr = nn_value_asstring(args->thisval);
-    string = selfstr->sbuf->data;
-    end = NULL;
-    /* Trim leading space*/
-    if(trimmer == '\0')
+    opts->streams[forrun ? 0 : 2].mode = NEON_SPAWNMODE_INHERIT;
+    if((args->count <= argi) || nn_value_isnull(args->args[argi]))
     {
-        while(isspace((unsigned char)*string))
-        {
-            string++;
-        }
+        return true;
     }
-    else
+    if(!nn_value_isdict(args->args[argi]))
     {
-        while(trimmer == *string)
+        nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() expects options as a dict, %s given", args->name, nn_value_typename(args->args[argi]));
+        return false;
+    }
+    dict = nn_value_asdict(args->args[argi]);
+    if(forrun && nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "input")), &val) && !nn_value_isnull(val))
+    {
+        if(nn_value_istypedarray(val))
         {
-            string++;
+            ta = nn_value_astypedarray(val);
+            opts->input = (const char*)ta->data;
+            opts->inputlen = ta->length * nn_typedarray_elemsize(ta->kind);
+        }
+        else if(nn_value_isstring(val))
+        {
+            opts->input = nn_value_asstring(val)->sbuf->data;
+            opts->inputlen = nn_value_asstring(val)->sbuf->length;
         }
+        else
+        {
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): input must be a string or Bytes", args->name);
+            return false;
+        }
+        opts->streams[0].mode = NEON_SPAWNMODE_PIPE;
     }
-    /* All spaces? */
-    if(*string == 0)
+    if(!nn_spawn_getstream(state, args, dict, "stdin", &opts->streams[0]) || !nn_spawn_getstream(state, args, dict, "stdout", &opts->streams[1]) || !nn_spawn_getstream(state, args, dict, "stderr", &opts->streams[2]))
     {
-        return nn_value_fromobject(nn_string_copylen(state, "", 0));
+        return false;
     }
-    /* Trim trailing space */
-    end = string + strlen(string) - 1;
-    if(trimmer == '\0')
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "env")), &val) && !nn_value_isnull(val))
     {
-        while(end > string && isspace((unsigned char)*end))
+        if(!nn_value_isdict(val))
         {
-            end--;
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): env must be a dict", args->name);
+            return false;
         }
+        opts->env = nn_value_asdict(val);
     }
-    else
+    if(nn_dict_get(dict, nn_value_fromobject(nn_string_intern(state, "clearEnv")), &val))
     {
-        while(end > string && trimmer == *end)
-        {
-            end--;
-        }
+        opts->clearenv = !nn_value_isfalse(val);
     }
-    end[1] = '\0';
-    return nn_value_fromobject(nn_string_copycstr(state, string));
+    return true;
 }
 
-NNValue nn_objfnstring_ltrim(NNState* state, NNArguments* args)
+/* returns the strings of $argv as a NULL-terminated array, pointing into the strings themselves. */
+char** nn_spawn_makeargv(NNState* state, NNArguments* args, NNObjArray* argv)
 {
-    char* end;
-    char* string;
-    char trimmer;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
-    trimmer = '\0';
-    if(args->count == 1)
+    size_t i;
+    char** res;
+    if(argv->varray->listcount == 0)
     {
-        trimmer = (char)nn_value_asstring(args->args[0])->sbuf->data[0];
+        nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): argv must not be empty", args->name);
+        return NULL;
     }
-    selfstr = nn_value_asstring(args->thisval);
-    string = selfstr->sbuf->data;
-    end = NULL;
-    /* Trim leading space */
-    if(trimmer == '\0')
+    for(i = 0; i < argv->varray->listcount; i++)
     {
-        while(isspace((unsigned char)*string))
+        if(!nn_value_isstring(argv->varray->listitems[i]))
         {
-            string++;
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s(): argv must only contain strings, but argv[%d] is %s", args->name, (int)i, nn_value_typename(argv->varray->listitems[i]));
+            return NULL;
         }
     }
-    else
+    res = (char**)nn_memory_malloc(sizeof(char*) * (argv->varray->listcount + 1));
+    for(i = 0; i < argv->varray->listcount; i++)
     {
-        while(trimmer == *string)
-        {
-            string++;
-        }
+        res[i] = nn_value_asstring(argv->varray->listitems[i])->sbuf->data;
     }
-    /* All spaces? */
-    if(*string == 0)
+    res[i] = NULL;
+    return res;
+}
+
+/* whether the variable $entry ("NAME=value") is given in $env, which then replaces it. */
+bool nn_spawn_envoverrides(NNObjDict* env, const char* entry)
+{
+    size_t i;
+    size_t len;
+    const char* eq;
+    NNObjString* key;
+    eq = strchr(entry, '=');
+    len = (eq == NULL) ? strlen(entry) : (size_t)(eq - entry);
+    for(i = 0; i < env->entrycount; i++)
     {
-        return nn_value_fromobject(nn_string_copylen(state, "", 0));
+        if(env->entries[i].live && nn_value_isstring(env->entries[i].key))
+        {
+            key = nn_value_asstring(env->entries[i].key);
+            if(((size_t)key->sbuf->length == len) && (memcmp(key->sbuf->data, entry, len) == 0))
+            {
+                return true;
+            }
+        }
     }
-    end = string + strlen(string) - 1;
-    end[1] = '\0';
-    return nn_value_fromobject(nn_string_copycstr(state, string));
+    return false;
 }
 
-NNValue nn_objfnstring_rtrim(NNState* state, NNArguments* args)
+/*
+* returns the environment for the program: the one of this process, with the changes in $opts.
+* without any, that is environ itself, which must not be freed; see nn_spawn_freeenv.
+*/
+char** nn_spawn_makeenv(NNState* state, NNSpawnOptions* opts)
 {
-    char* end;
-    char* string;
-    char trimmer;
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
-    trimmer = '\0';
-    if(args->count == 1)
+    size_t i;
+    size_t count;
+    size_t klen;
+    size_t vlen;
+    char* item;
+    char** res;
+    char** src;
+    NNObjString* key;
+    NNObjString* value;
+    NNObjDict* env;
+    src = NULL;
+    #if defined(NEON_PLAT_HAVESPAWN)
+        src = environ;
+    #endif
+    if((opts->env == NULL) && !opts->clearenv)
     {
-        trimmer = (char)nn_value_asstring(args->args[0])->sbuf->data[0];
+        return src;
     }
-    selfstr = nn_value_asstring(args->thisval);
-    string = selfstr->sbuf->data;
-    end = NULL;
-    /* All spaces? */
-    if(*string == 0)
+    env = opts->env;
+    count = 0;
+    while((src != NULL) && (src[count] != NULL))
     {
-        return nn_value_fromobject(nn_string_copylen(state, "", 0));
+        count++;
     }
-    end = string + strlen(string) - 1;
-    if(trimmer == '\0')
+    res = (char**)nn_memory_malloc(sizeof(char*) * (count + ((env != NULL) ? env->count : 0) + 1));
+    count = 0;
+    for(i = 0; (src != NULL) && !opts->clearenv && (src[i] != NULL); i++)
     {
-        while(end > string && isspace((unsigned char)*end))
+        if((env == NULL) || !nn_spawn_envoverrides(env, src[i]))
         {
-            end--;
+            klen = strlen(src[i]);
+            res[count] = (char*)nn_memory_malloc(klen + 1);
+            memcpy(res[count], src[i], klen + 1);
+            count++;
         }
     }
-    else
+    for(i = 0; (env != NULL) && (i < env->entrycount); i++)
     {
-        while(end > string && trimmer == *end)
+        if(!env->entries[i].live || !nn_value_isstring(env->entries[i].key) || nn_value_isnull(env->entries[i].value.value))
         {
-            end--;
+            continue;
         }
+        key = nn_value_asstring(env->entries[i].key);
+        value = nn_value_tostring(state, env->entries[i].value.value);
+        klen = key->sbuf->length;
+        vlen = value->sbuf->length;
+        item = (char*)nn_memory_malloc(klen + vlen + 2);
+        memcpy(item, key->sbuf->data, klen);
+        item[klen] = '=';
+        memcpy(item + klen + 1, value->sbuf->data, vlen + 1);
+        res[count] = item;
+        count++;
     }
-    /* Write new null terminator character */
-    end[1] = '\0';
-    return nn_value_fromobject(nn_string_copycstr(state, string));
+    res[count] = NULL;
+    return res;
 }
 
-
-NNValue nn_objfnarray_constructor(NNState* state, NNArguments* args)
+void nn_spawn_freeenv(NNSpawnOptions* opts, char** envp)
 {
-    int cnt;
-    NNValue filler;
-    NNObjArray* arr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    filler = nn_value_makenull();
-    if(args->count > 1)
+    size_t i;
+    if(((opts->env == NULL) && !opts->clearenv) || (envp == NULL))
     {
-        filler = args->args[1];
+        return;
     }
-    cnt = nn_value_asnumber(args->args[0]);
-    arr = nn_array_makefilled(state, cnt, filler);
-    return nn_value_fromobject(arr);
+    for(i = 0; envp[i] != NULL; i++)
+    {
+        nn_memory_free(envp[i]);
+    }
+    nn_memory_free(envp);
 }
 
-NNValue nn_objfnarray_join(NNState* state, NNArguments* args)
+/*
+* makes a pipe whose ends are closed in programs that are started later. this could be pipe2(),
+* but that is not everywhere, and since there are no other threads, nothing can start in between.
+*/
+bool nn_spawn_makepipe(int* fds)
 {
-    size_t i;
-    size_t count;
-    NNPrinter pr;
-    NNValue vjoinee;
-    NNObjArray* selfarr;
-    NNObjString* joinee;
-    NNValue* list;
-    selfarr = nn_value_asarray(args->thisval);
-    joinee = NULL;
-    if(args->count > 0)
+    #if defined(NEON_PLAT_HAVESPAWN)
+        if(pipe(fds) != 0)
+        {
+            return false;
+        }
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+    #else
+        (void)fds;
+        errno = ENOSYS;
+        return false;
+    #endif
+}
+
+void nn_spawn_closepipes(NNSpawnOptions* opts)
+{
+    int i;
+    for(i = 0; i < 3; i++)
     {
-        vjoinee = args->args[0];
-        if(nn_value_isstring(vjoinee))
+        if(opts->streams[i].childfd >= 0)
         {
-            joinee = nn_value_asstring(vjoinee);
+            close(opts->streams[i].childfd);
+            opts->streams[i].childfd = -1;
         }
-        else
+        if(opts->streams[i].parentfd >= 0)
         {
-            joinee = nn_value_tostring(state, vjoinee);
+            close(opts->streams[i].parentfd);
+            opts->streams[i].parentfd = -1;
         }
     }
-    list = selfarr->varray->listitems;
-    count = selfarr->varray->listcount;
-    if(count == 0)
+}
+
+/*
+* starts $argv[0], looked up in PATH, with posix_spawnp(). unlike fork(), that does not copy the
+* memory of the interpreter; glibc has the child share it until it calls exec().
+* returns the pid, with the pipes of $opts open, or -1 with errno set.
+*/
+int nn_spawn_start(NNState* state, char** argv, char** envp, NNSpawnOptions* opts)
+{
+    #if defined(NEON_PLAT_HAVESPAWN)
+        int i;
+        int rc;
+        int fds[2];
+        pid_t pid;
+        NNSpawnStream* st;
+        posix_spawn_file_actions_t actions;
+        for(i = 0; i < 3; i++)
+        {
+            st = &opts->streams[i];
+            if(st->mode == NEON_SPAWNMODE_PIPE)
+            {
+                if(!nn_spawn_makepipe(fds))
+                {
+                    rc = errno;
+                    nn_spawn_closepipes(opts);
+                    errno = rc;
+                    return -1;
+                }
+                st->childfd = (i == 0) ? fds[0] : fds[1];
+                st->parentfd = (i == 0) ? fds[1] : fds[0];
+            }
+            else if((st->mode == NEON_SPAWNMODE_FILE) && !nn_file_prepareraw(state, st->file))
+            {
+                nn_spawn_closepipes(opts);
+                errno = EBADF;
+                return -1;
+            }
+        }
+        posix_spawn_file_actions_init(&actions);
+        for(i = 0; i < 3; i++)
+        {
+            st = &opts->streams[i];
+            switch(st->mode)
+            {
+                case NEON_SPAWNMODE_PIPE:
+                    posix_spawn_file_actions_adddup2(&actions, st->childfd, i);
+                    break;
+                case NEON_SPAWNMODE_NULL:
+                    posix_spawn_file_actions_addopen(&actions, i, "/dev/null", (i == 0) ? O_RDONLY : O_WRONLY, 0);
+                    break;
+                case NEON_SPAWNMODE_FILE:
+                    posix_spawn_file_actions_adddup2(&actions, fileno(st->file->handle), i);
+                    break;
+                case NEON_SPAWNMODE_STDOUT:
+                    posix_spawn_file_actions_adddup2(&actions, 1, 2);
+                    break;
+                case NEON_SPAWNMODE_INHERIT:
+                    break;
+            }
+        }
+        /* whatever was printed so far should come before what the program prints. */
+        nn_printer_flush(state->stdoutprinter);
+        fflush(stdout);
+        fflush(stderr);
+        rc = posix_spawnp(&pid, argv[0], &actions, NULL, argv, envp);
+        posix_spawn_file_actions_destroy(&actions);
+        for(i = 0; i < 3; i++)
+        {
+            if(opts->streams[i].childfd >= 0)
+            {
+                close(opts->streams[i].childfd);
+                opts->streams[i].childfd = -1;
+            }
+        }
+        if(rc != 0)
+        {
+            nn_spawn_closepipes(opts);
+            errno = rc;
+            return -1;
+        }
+        return pid;
+    #else
+        (void)state;
+        (void)argv;
+        (void)envp;
+        (void)opts;
+        errno = ENOSYS;
+        return -1;
+    #endif
+}
+
+/* the exit code in the wait status $status, or for programs killed by a signal, minus the signal. */
+int nn_spawn_exitcode(int status)
+{
+    #if defined(NEON_PLAT_HAVESPAWN)
+        if(WIFSIGNALED(status))
+        {
+            return -WTERMSIG(status);
+        }
+        return WEXITSTATUS(status);
+    #else
+        return status;
+    #endif
+}
+
+/*
+* waits for $pid to finish, or with $block false, only checks whether it has. returns 1 if it has,
+* with its exit code in $code, 0 if it is still running, and -1 on an error, with errno set.
+*/
+int nn_spawn_wait(int pid, bool block, int* code)
+{
+    #if defined(NEON_PLAT_HAVESPAWN)
+        int rc;
+        int status;
+        while(true)
+        {
+            rc = waitpid(pid, &status, block ? 0 : WNOHANG);
+            if((rc < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            break;
+        }
+        if(rc <= 0)
+        {
+            return rc;
+        }
+        *code = nn_spawn_exitcode(status);
+        return 1;
+    #else
+        (void)pid;
+        (void)block;
+        (void)code;
+        errno = ENOSYS;
+        return -1;
+    #endif
+}
+
+/* wraps the end of a pipe that this process keeps in a File. */
+NNObjFile* nn_spawn_makefile(NNState* state, int fd, int which, int pid)
+{
+    FILE* hnd;
+    NNObjFile* file;
+    char path[64];
+    static const char* names[] = {"stdin", "stdout", "stderr"};
+    hnd = fdopen(fd, (which == 0) ? "w" : "r");
+    if(hnd == NULL)
     {
-        return nn_value_fromobject(nn_string_copycstr(state, ""));
+        close(fd);
+        return NULL;
     }
-    nn_printer_makestackstring(state, &pr);
-    for(i = 0; i < count; i++)
+    setvbuf(hnd, NULL, _IOFBF, NEON_CONFIG_FILEBUFSIZE);
+    sprintf(path, "<%s of process %d>", names[which], pid);
+    file = nn_object_makefile(state, hnd, false, path, (which == 0) ? "w" : "r");
+    file->number = fd;
+    file->ispipe = true;
+    return file;
+}
+
+/* returns the Process that a method was called on, along with its pid, or throws. */
+NNObjInstance* nn_spawn_getchild(NNState* state, NNArguments* args, int* pid)
+{
+    NNProperty* field;
+    NNObjInstance* inst;
+    if(nn_value_isinstance(args->thisval))
     {
-        nn_printer_printvalue(&pr, list[i], false, true);
-        if((joinee != NULL) && ((i+1) < count))
+        inst = nn_value_asinstance(args->thisval);
+        field = nn_tableval_getfieldbycstr(inst->properties, "pid");
+        if((inst->klass == state->classprimprocess) && (field != NULL) && nn_value_isnumber(field->value))
         {
-            nn_printer_writestringl(&pr, joinee->sbuf->data, joinee->sbuf->length);
+            *pid = nn_value_asnumber(field->value);
+            return inst;
         }
     }
-    return nn_value_fromobject(nn_printer_takestring(&pr));
+    nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() can only be called on a Process returned by Process.spawn()", args->name);
+    return NULL;
 }
 
-NNValue nn_objfnstring_indexof(NNState* state, NNArguments* args)
+/*
+* spawn(argv, options) starts the program $argv[0], looked up in PATH, with the arguments in $argv,
+* and returns a Process with the properties pid, status (null until it is known), and stdin, stdout
+* and stderr, which are Files for the streams that are piped, and null for the others.
+* pipes are fully buffered: flush() sends what was written to stdin so far, and close() ends it.
+* see nn_spawn_getoptions for the options.
+*/
+NNValue nn_objfnprocess_spawn(NNState* state, NNArguments* args)
 {
-    int startindex;
-    char* result;
-    char* haystack;
-    NNObjString* string;
-    NNObjString* needle;
+    int i;
+    int pid;
+    char** argv;
+    char** envp;
+    NNValue val;
+    NNSpawnOptions opts;
+    NNObjFile* file;
+    NNObjInstance* inst;
     NNArgCheck check;
+    static const char* names[] = {"stdin", "stdout", "stderr"};
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    string = nn_value_asstring(args->thisval);
-    needle = nn_value_asstring(args->args[0]);
-    startindex = 0;
-    if(args->count == 2)
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isarray);
+    if(!nn_spawn_getoptions(state, args, 1, &opts, false))
     {
-        NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isnumber);
-        startindex = nn_value_asnumber(args->args[1]);
+        return nn_value_makenull();
     }
-    if(string->sbuf->length > 0 && needle->sbuf->length > 0)
+    argv = nn_spawn_makeargv(state, args, nn_value_asarray(args->args[0]));
+    if(argv == NULL)
     {
-        haystack = string->sbuf->data;
-        result = strstr(haystack + startindex, needle->sbuf->data);
-        if(result != NULL)
+        return nn_value_makenull();
+    }
+    envp = nn_spawn_makeenv(state, &opts);
+    pid = nn_spawn_start(state, argv, envp, &opts);
+    nn_spawn_freeenv(&opts, envp);
+    if(pid < 0)
+    {
+        nn_exceptions_throw(state, "spawn: cannot run '%s': %s", argv[0], strerror(errno));
+        nn_memory_free(argv);
+        return nn_value_makenull();
+    }
+    nn_memory_free(argv);
+    inst = (NNObjInstance*)nn_gcmem_protect(state, (NNObject*)nn_object_makeinstance(state, state->classprimprocess));
+    nn_instance_defproperty(inst, nn_string_intern(state, "pid"), nn_value_makenumber(pid));
+    nn_instance_defproperty(inst, nn_string_intern(state, "status"), nn_value_makenull());
+    for(i = 0; i < 3; i++)
+    {
+        val = nn_value_makenull();
+        if(opts.streams[i].parentfd >= 0)
         {
-            return nn_value_makenumber((int)(result - haystack));
+            file = nn_spawn_makefile(state, opts.streams[i].parentfd, i, pid);
+            if(file != NULL)
+            {
+                val = nn_value_fromobject(file);
+            }
         }
+        nn_instance_defproperty(inst, nn_string_intern(state, names[i]), val);
     }
-    return nn_value_makenumber(-1);
+    return nn_value_fromobject(inst);
 }
 
-NNValue nn_objfnstring_startswith(NNState* state, NNArguments* args)
+/*
+* wait() closes the stdin of the program, if it is piped, so that it does not wait for more
+* input, then waits for it to finish. returns its exit code, which is also stored in status;
+* if a signal killed it, that is minus the signal.
+*/
+NNValue nn_objfnprocess_wait(NNState* state, NNArguments* args)
 {
-    NNObjString* substr;
-    NNObjString* string;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    string = nn_value_asstring(args->thisval);
-    substr = nn_value_asstring(args->args[0]);
-    if(string->sbuf->length == 0 || substr->sbuf->length == 0 || substr->sbuf->length > string->sbuf->length)
+    int pid;
+    int code;
+    NNProperty* field;
+    NNObjInstance* inst;
+    inst = nn_spawn_getchild(state, args, &pid);
+    if(inst == NULL)
     {
-        return nn_value_makebool(false);
+        return nn_value_makenull();
     }
-    return nn_value_makebool(memcmp(substr->sbuf->data, string->sbuf->data, substr->sbuf->length) == 0);
+    field = nn_tableval_getfieldbycstr(inst->properties, "status");
+    if((field != NULL) && !nn_value_isnull(field->value))
+    {
+        return field->value;
+    }
+    field = nn_tableval_getfieldbycstr(inst->properties, "stdin");
+    if((field != NULL) && nn_value_isfile(field->value))
+    {
+        nn_fileobject_close(nn_value_asfile(field->value));
+    }
+    if(nn_spawn_wait(pid, true, &code) < 0)
+    {
+        return nn_exceptions_throw(state, "wait: cannot wait for process %d: %s", pid, strerror(errno));
+    }
+    nn_instance_defproperty(inst, nn_string_intern(state, "status"), nn_value_makenumber(code));
+    return nn_value_makenumber(code);
 }
 
-NNValue nn_objfnstring_endswith(NNState* state, NNArguments* args)
+/* poll() returns the exit code of the program if it has finished, and null otherwise, without waiting. */
+NNValue nn_objfnprocess_poll(NNState* state, NNArguments* args)
 {
-    int difference;
-    NNObjString* substr;
-    NNObjString* string;
+    int rc;
+    int pid;
+    int code;
+    NNProperty* field;
+    NNObjInstance* inst;
+    inst = nn_spawn_getchild(state, args, &pid);
+    if(inst == NULL)
+    {
+        return nn_value_makenull();
+    }
+    field = nn_tableval_getfieldbycstr(inst->properties, "status");
+    if((field != NULL) && !nn_value_isnull(field->value))
+    {
+        return field->value;
+    }
+    rc = nn_spawn_wait(pid, false, &code);
+    if(rc < 0)
+    {
+        return nn_exceptions_throw(state, "poll: cannot wait for process %d: %s", pid, strerror(errno));
+    }
+    if(rc == 0)
+    {
+        return nn_value_makenull();
+    }
+    nn_instance_defproperty(inst, nn_string_intern(state, "status"), nn_value_makenumber(code));
+    return nn_value_makenumber(code);
+}
+
+/*
+* kill(signal) sends $signal, SIGTERM by default, to the program. returns false once it is known
+* to have finished, since its pid may then belong to another process already.
+*/
+NNValue nn_objfnprocess_signal(NNState* state, NNArguments* args)
+{
+    int pid;
+    int sig;
+    NNProperty* field;
+    NNObjInstance* inst;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    string = nn_value_asstring(args->thisval);
-    substr = nn_value_asstring(args->args[0]);
-    if(string->sbuf->length == 0 || substr->sbuf->length == 0 || substr->sbuf->length > string->sbuf->length)
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
+    inst = nn_spawn_getchild(state, args, &pid);
+    if(inst == NULL)
+    {
+        return nn_value_makenull();
+    }
+    sig = SIGTERM;
+    if(args->count > 0)
+    {
+        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
+        sig = nn_value_asnumber(args->args[0]);
+    }
+    field = nn_tableval_getfieldbycstr(inst->properties, "status");
+    if((field != NULL) && !nn_value_isnull(field->value))
     {
         return nn_value_makebool(false);
     }
-    difference = string->sbuf->length - substr->sbuf->length;
-    return nn_value_makebool(memcmp(substr->sbuf->data, string->sbuf->data + difference, substr->sbuf->length) == 0);
+    return nn_value_makebool(osfn_kill(pid, sig) == 0);
 }
 
+/* makes sure $buf has room for at least NEON_CONFIG_RUNBUFSIZE / 4 more bytes. */
+void nn_spawn_reservebuffer(NNSpawnBuffer* buf)
+{
+    if((buf->capacity - buf->length) < (NEON_CONFIG_RUNBUFSIZE / 4))
+    {
+        buf->capacity = (buf->capacity == 0) ? NEON_CONFIG_RUNBUFSIZE : (buf->capacity * 2);
+        buf->data = (char*)nn_memory_realloc(buf->data, buf->capacity + 1);
+    }
+}
 
 /*
-    //  Returns 0 on success, or -1 on invalid or unsupported regex, or -2 on not enough tokens given to parse regex.
-    REMIMU_INLINE int mrx_regex_parse(
-        //  Regex pattern to parse. Must be null-terminated.
-        const char * pattern,       
-        //  Output buffer of tokencount regex tokens
-        RegexToken * tokens,
-        //  Maximum allowed number of tokens to write
-        int16_t * tokencount,
-        // Optional bitflags.
-        int32_t flags
-        
-    )
-    
-    // Returns match length, or -1 on no match, or -2 on out of memory, or -3 ifthe regex is invalid.
-    REMIMU_INLINE int64_t mrx_regex_match(
-        // Parsed regex to match against text.
-        const RegexToken * tokens,
-        // Text to match against tokens.
-        const char * text,
-        // index value to match at.
-        size_t starti,
-        // Number of allowed capture info output slots.
-        uint16_t capslots,
-        // Capture position info output buffer.
-        int64_t* cappos,
-        // Capture length info output buffer.
-        int64_t* capspan
-    ) 
-    
+* writes the input of $opts to the stdin pipe of a program while reading its stdout and stderr
+* pipes into $bufs, all at once with poll(), so that neither side can block on a full pipe.
+* closes the pipes as they finish. returns false on an error, with errno set.
 */
-
-NNValue nn_util_stringregexmatch(NNState* state, NNObjString* string, NNObjString* pattern, bool capture)
+bool nn_spawn_communicate(NNSpawnOptions* opts, NNSpawnBuffer* bufs)
 {
-    enum {
-        matchMaxTokens = 128*4,
-        matchMaxCaptures = 128,
-    };
-    int prc;
-    int64_t i;
-    int64_t mtstart;
-    int64_t mtlength;
-    int64_t actualmaxcaptures;
-    int64_t cpres;
-    int16_t restokens;
-    int64_t capstarts[matchMaxCaptures + 1] = {0};
-    int64_t caplengths[matchMaxCaptures + 1] = {0};
-    RegexToken tokens[matchMaxTokens + 1] = {};
-    RegexContext ctx; 
-    RegexContext* pctx;
-    
-    const char* strstart;
-    NNObjString* rstr;
-    NNObjArray* oa;
-    NNObjDict* dm;
-    restokens = matchMaxTokens;
-    actualmaxcaptures = 0;
-    pctx = mrx_init(&ctx, tokens, restokens);
-    if(capture)
-    {
-        actualmaxcaptures = matchMaxCaptures;
-    }
-    prc = mrx_regex_parse(pctx, pattern->sbuf->data, 0);
-    if(prc == 0)
-    {
-        cpres = mrx_regex_match(pctx, string->sbuf->data, 0, actualmaxcaptures, capstarts, caplengths);
-        if(cpres > 0)
+    #if defined(NEON_PLAT_HAVESPAWN)
+        int i;
+        int n;
+        int err;
+        int which[3];
+        size_t written;
+        ssize_t rt;
+        struct pollfd pfds[3];
+        void (*oldpipe)(int);
+        written = 0;
+        err = 0;
+        for(i = 0; i < 3; i++)
+        {
+            if(opts->streams[i].parentfd >= 0)
+            {
+                fcntl(opts->streams[i].parentfd, F_SETFL, fcntl(opts->streams[i].parentfd, F_GETFL) | O_NONBLOCK);
+            }
+        }
+        if((opts->streams[0].parentfd >= 0) && (opts->inputlen == 0))
+        {
+            close(opts->streams[0].parentfd);
+            opts->streams[0].parentfd = -1;
+        }
+        /* a program that exits without reading all of its input should not kill this process. */
+        oldpipe = signal(SIGPIPE, SIG_IGN);
+        while(true)
         {
-            if(capture)
+            n = 0;
+            for(i = 0; i < 3; i++)
             {
-                oa = nn_object_makearray(state);
-                for(i=0; i<cpres; i++)
+                if(opts->streams[i].parentfd >= 0)
                 {
-                    mtstart = capstarts[i];
-                    mtlength = caplengths[i];
-                    if(mtlength > 0)
-                    {
-                        strstart = &string->sbuf->data[mtstart];
-                        rstr = nn_string_copylen(state, strstart, mtlength);
-                        dm = nn_object_makedict(state);
-                        nn_dict_addentrycstr(dm, "string", nn_value_fromobject(rstr));
-                        nn_dict_addentrycstr(dm, "start", nn_value_makenumber(mtstart));
-                        nn_dict_addentrycstr(dm, "length", nn_value_makenumber(mtlength));                        
-                        nn_array_push(oa, nn_value_fromobject(dm));
-                    }
+                    pfds[n].fd = opts->streams[i].parentfd;
+                    pfds[n].events = (i == 0) ? POLLOUT : POLLIN;
+                    pfds[n].revents = 0;
+                    which[n] = i;
+                    n++;
                 }
-                return nn_value_fromobject(oa);
             }
-            else
+            if(n == 0)
             {
-                return nn_value_makebool(true);
+                break;
+            }
+            if(poll(pfds, n, -1) < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+                err = errno;
+                break;
+            }
+            for(i = 0; i < n; i++)
+            {
+                if(pfds[i].revents == 0)
+                {
+                    continue;
+                }
+                if(which[i] == 0)
+                {
+                    rt = write(pfds[i].fd, opts->input + written, opts->inputlen - written);
+                    if(rt > 0)
+                    {
+                        written += rt;
+                    }
+                    if(((rt < 0) && (errno != EAGAIN) && (errno != EINTR)) || (written == opts->inputlen))
+                    {
+                        /* EPIPE only means the program did not want the rest. */
+                        close(pfds[i].fd);
+                        opts->streams[0].parentfd = -1;
+                    }
+                    continue;
+                }
+                nn_spawn_reservebuffer(&bufs[which[i]]);
+                rt = read(pfds[i].fd, bufs[which[i]].data + bufs[which[i]].length, bufs[which[i]].capacity - bufs[which[i]].length);
+                if(rt > 0)
+                {
+                    bufs[which[i]].length += rt;
+                }
+                else if((rt == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+                {
+                    if(rt < 0)
+                    {
+                        err = errno;
+                    }
+                    close(pfds[i].fd);
+                    opts->streams[which[i]].parentfd = -1;
+                }
             }
         }
+        signal(SIGPIPE, oldpipe);
+        nn_spawn_closepipes(opts);
+        errno = err;
+        return (err == 0);
+    #else
+        (void)opts;
+        (void)bufs;
+        errno = ENOSYS;
+        return false;
+    #endif
+}
+
+/*
+* run(argv, options) runs a program like spawn() does, waits for it, and returns a dict of its
+* exit code as status, and its output as stdout and stderr, which are null where not captured.
+* output is read into buffers of NEON_CONFIG_RUNBUFSIZE, which become the strings without copying.
+* the options are those of spawn(), plus input; unless given, stdin is inherited.
+*/
+NNValue nn_objfnprocess_run(NNState* state, NNArguments* args)
+{
+    int i;
+    int pid;
+    int code;
+    bool ok;
+    char** argv;
+    char** envp;
+    NNValue val;
+    NNObjDict* res;
+    NNSpawnOptions opts;
+    NNSpawnBuffer bufs[3];
+    NNArgCheck check;
+    static const char* names[] = {"stdin", "stdout", "stderr"};
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isarray);
+    if(!nn_spawn_getoptions(state, args, 1, &opts, true))
+    {
+        return nn_value_makenull();
     }
-    else
+    argv = nn_spawn_makeargv(state, args, nn_value_asarray(args->args[0]));
+    if(argv == NULL)
     {
-        nn_exceptions_throwclass(state, state->exceptions.regexerror, pctx->errorbuf);
+        return nn_value_makenull();
     }
-    mrx_destroy(pctx);
-    if(capture)
+    envp = nn_spawn_makeenv(state, &opts);
+    pid = nn_spawn_start(state, argv, envp, &opts);
+    nn_spawn_freeenv(&opts, envp);
+    if(pid < 0)
     {
+        nn_exceptions_throw(state, "run: cannot run '%s': %s", argv[0], strerror(errno));
+        nn_memory_free(argv);
         return nn_value_makenull();
     }
-    return nn_value_makebool(false);
+    memset(bufs, 0, sizeof(bufs));
+    ok = nn_spawn_communicate(&opts, bufs);
+    if((nn_spawn_wait(pid, true, &code) < 0) || !ok)
+    {
+        nn_exceptions_throw(state, "run: cannot run '%s': %s", argv[0], strerror(errno));
+        nn_memory_free(argv);
+        nn_memory_free(bufs[1].data);
+        nn_memory_free(bufs[2].data);
+        return nn_value_makenull();
+    }
+    nn_memory_free(argv);
+    res = (NNObjDict*)nn_gcmem_protect(state, (NNObject*)nn_object_makedict(state));
+    nn_dict_setentry(res, nn_value_fromobject(nn_string_intern(state, "status")), nn_value_makenumber(code));
+    for(i = 1; i < 3; i++)
+    {
+        val = nn_value_makenull();
+        if(opts.streams[i].mode == NEON_SPAWNMODE_PIPE)
+        {
+            nn_spawn_reservebuffer(&bufs[i]);
+            bufs[i].data[bufs[i].length] = '\0';
+            val = nn_value_fromobject(nn_string_takebuffer(state, bufs[i].data, bufs[i].length, bufs[i].capacity + 1));
+        }
+        nn_dict_setentry(res, nn_value_fromobject(nn_string_intern(state, names[i])), val);
+    }
+    return nn_value_fromobject(res);
 }
 
-NNValue nn_objfnstring_matchcapture(NNState* state, NNArguments* args)
+void nn_json_initparser(NNState* state, NNJSONParser* jp, const char* source, size_t length, NNObjArray* stack)
 {
-    NNObjString* pattern;
-    NNObjString* string;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    string = nn_value_asstring(args->thisval);
-    pattern = nn_value_asstring(args->args[0]);
-    return nn_util_stringregexmatch(state, string, pattern, true);
+    size_t i;
+    jp->pstate = state;
+    jp->source = source;
+    jp->length = length;
+    jp->position = 0;
+    jp->error = NULL;
+    jp->errorpos = 0;
+    jp->stack = stack;
+    jp->strbuf = NULL;
+    jp->strcap = 0;
+    jp->callback = nn_value_makenull();
+    jp->nestargs = NULL;
+    jp->arity = 0;
+    jp->stopped = false;
+    jp->threw = false;
+    for(i = 0; i < NEON_JSONEVENT_COUNT; i++)
+    {
+        jp->events[i] = NULL;
+    }
+}
+
+void nn_json_destroyparser(NNJSONParser* jp)
+{
+    nn_memory_free(jp->strbuf);
+}
+
+bool nn_json_seterror(NNJSONParser* jp, const char* message)
+{
+    if(jp->error == NULL)
+    {
+        jp->error = message;
+        jp->errorpos = jp->position;
+    }
+    return false;
+}
+
+/*
+* throws an exception describing the error of $jp, along with where in the source it happened.
+* it is a plain Exception, like the errors of File, so that scripts can catch it.
+*/
+NNValue nn_json_throwerror(NNState* state, NNJSONParser* jp, const char* name)
+{
+    size_t i;
+    size_t line;
+    size_t column;
+    line = 1;
+    column = 1;
+    for(i = 0; (i < jp->errorpos) && (i < jp->length); i++)
+    {
+        column++;
+        if(jp->source[i] == '\n')
+        {
+            line++;
+            column = 1;
+        }
+    }
+    return nn_exceptions_throw(state, "%s: %s at line %ld, column %ld", name, jp->error, (long)line, (long)column);
 }
 
-NNValue nn_objfnstring_matchonly(NNState* state, NNArguments* args)
+NEON_FORCEINLINE void nn_json_skipspace(NNJSONParser* jp)
 {
-    NNObjString* pattern;
-    NNObjString* string;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    string = nn_value_asstring(args->thisval);
-    pattern = nn_value_asstring(args->args[0]);
-    return nn_util_stringregexmatch(state, string, pattern, false);
+    char c;
+    while(jp->position < jp->length)
+    {
+        c = jp->source[jp->position];
+        if((c != ' ') && (c != '\n') && (c != '\r') && (c != '\t'))
+        {
+            break;
+        }
+        jp->position++;
+    }
 }
 
-NNValue nn_objfnstring_count(NNState* state, NNArguments* args)
+/*
+* in streaming mode, passes $event and $value to the callback. returns false if the callback
+* returned false, which stops the parser.
+*/
+bool nn_json_emit(NNJSONParser* jp, NNObjString* event, NNValue value)
 {
-    int count;
-    const char* tmp;
-    NNObjString* substr;
-    NNObjString* string;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    string = nn_value_asstring(args->thisval);
-    substr = nn_value_asstring(args->args[0]);
-    if(substr->sbuf->length == 0 || string->sbuf->length == 0)
+    NNValue res;
+    if(jp->arity > 0)
     {
-        return nn_value_makenumber(0);
+        jp->nestargs->varray->listitems[0] = nn_value_fromobject(event);
+        if(jp->arity > 1)
+        {
+            jp->nestargs->varray->listitems[1] = value;
+        }
     }
-    count = 0;
-    tmp = string->sbuf->data;
-    while((tmp = nn_util_utf8strstr(tmp, substr->sbuf->data)))
+    if(!nn_nestcall_callfunction(jp->pstate, jp->callback, nn_value_makenull(), jp->nestargs, &res))
     {
-        count++;
-        tmp++;
+        /* the callback threw; the exception is already on its way. */
+        jp->stopped = true;
+        jp->threw = true;
+        return false;
     }
-    return nn_value_makenumber(count);
+    if(nn_value_isbool(res) && !nn_value_asbool(res))
+    {
+        jp->stopped = true;
+        return false;
+    }
+    return true;
 }
 
-NNValue nn_objfnstring_tonumber(NNState* state, NNArguments* args)
+/* stores a finished scalar: pushes it onto the stack, or reports it as $event. */
+bool nn_json_putvalue(NNJSONParser* jp, NNObjString* event, NNValue value)
 {
-    NNObjString* selfstr;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    selfstr = nn_value_asstring(args->thisval);
-    return nn_value_makenumber(strtod(selfstr->sbuf->data, NULL));
+    if(!nn_value_isnull(jp->callback))
+    {
+        return nn_json_emit(jp, event, value);
+    }
+    nn_array_push(jp->stack, value);
+    return true;
 }
 
-NNValue nn_objfnstring_isascii(NNState* state, NNArguments* args)
+void nn_json_appendchars(NNJSONParser* jp, size_t* len, const char* chars, size_t count)
 {
-    NNObjString* string;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
-    if(args->count == 1)
+    /* strbuf is still NULL if nothing was appended yet. */
+    if(count == 0)
     {
-        NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isbool);
+        return;
     }
-    string = nn_value_asstring(args->thisval);
-    return nn_value_fromobject(string);
+    if(*len + count > jp->strcap)
+    {
+        while(*len + count > jp->strcap)
+        {
+            jp->strcap = (jp->strcap == 0) ? 64 : (jp->strcap * 2);
+        }
+        jp->strbuf = (char*)nn_memory_realloc(jp->strbuf, jp->strcap);
+    }
+    memcpy(jp->strbuf + *len, chars, count);
+    *len += count;
 }
 
-NNValue nn_objfnstring_tolist(NNState* state, NNArguments* args)
+bool nn_json_readhex4(NNJSONParser* jp, uint32_t* dest)
 {
-    size_t i;
-    size_t end;
-    size_t start;
-    size_t length;
-    NNObjArray* list;
-    NNObjString* string;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 0);
-    string = nn_value_asstring(args->thisval);
-    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    length = string->sbuf->length;
-    if(length > 0)
+    int i;
+    char c;
+    uint32_t code;
+    if(jp->position + 4 > jp->length)
     {
-        for(i = 0; i < length; i++)
+        return nn_json_seterror(jp, "unterminated unicode escape");
+    }
+    code = 0;
+    for(i = 0; i < 4; i++)
+    {
+        c = jp->source[jp->position++];
+        code <<= 4;
+        if((c >= '0') && (c <= '9'))
         {
-            start = i;
-            end = i + 1;
-            nn_array_push(list, nn_value_fromobject(nn_string_copylen(state, string->sbuf->data + start, (int)(end - start))));
+            code |= (c - '0');
+        }
+        else if((c >= 'a') && (c <= 'f'))
+        {
+            code |= (c - 'a' + 10);
+        }
+        else if((c >= 'A') && (c <= 'F'))
+        {
+            code |= (c - 'A' + 10);
+        }
+        else
+        {
+            jp->position--;
+            return nn_json_seterror(jp, "invalid unicode escape");
         }
     }
-    return nn_value_fromobject(list);
+    *dest = code;
+    return true;
 }
 
-NNValue nn_objfnstring_lpad(NNState* state, NNArguments* args)
+/* appends the utf-8 encoding of the \u escape at the current position, which may be a surrogate pair. */
+bool nn_json_parseunicode(NNJSONParser* jp, size_t* len)
 {
-    size_t i;
-    size_t width;
-    size_t fillsize;
-    size_t finalsize;
-    size_t finalutf8size;
-    char fillchar;
-    char* str;
-    char* fill;
-    NNObjString* ofillstr;
-    NNObjString* result;
-    NNObjString* string;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    string = nn_value_asstring(args->thisval);
-    width = nn_value_asnumber(args->args[0]);
-    fillchar = ' ';
-    if(args->count == 2)
+    size_t n;
+    uint32_t code;
+    uint32_t low;
+    char chars[4];
+    if(!nn_json_readhex4(jp, &code))
     {
-        ofillstr = nn_value_asstring(args->args[1]);
-        fillchar = ofillstr->sbuf->data[0];
+        return false;
     }
-    if(width <= string->sbuf->length)
+    if((code >= 0xD800) && (code <= 0xDBFF))
     {
-        return args->thisval;
+        if((jp->position + 2 > jp->length) || (jp->source[jp->position] != '\\') || (jp->source[jp->position + 1] != 'u'))
+        {
+            return nn_json_seterror(jp, "unpaired surrogate in unicode escape");
+        }
+        jp->position += 2;
+        if(!nn_json_readhex4(jp, &low))
+        {
+            return false;
+        }
+        if((low < 0xDC00) || (low > 0xDFFF))
+        {
+            return nn_json_seterror(jp, "unpaired surrogate in unicode escape");
+        }
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
     }
-    fillsize = width - string->sbuf->length;
-    fill = (char*)nn_memory_malloc(sizeof(char) * ((size_t)fillsize + 1));
-    finalsize = string->sbuf->length + fillsize;
-    finalutf8size = string->sbuf->length + fillsize;
-    for(i = 0; i < fillsize; i++)
+    if(code <= 0x7F)
     {
-        fill[i] = fillchar;
+        chars[0] = (char)code;
+        n = 1;
     }
-    str = (char*)nn_memory_malloc(sizeof(char) * ((size_t)finalsize + 1));
-    memcpy(str, fill, fillsize);
-    memcpy(str + fillsize, string->sbuf->data, string->sbuf->length);
-    str[finalsize] = '\0';
-    nn_memory_free(fill);
-    result = nn_string_takelen(state, str, finalsize);
-    result->sbuf->length = finalutf8size;
-    result->sbuf->length = finalsize;
-    return nn_value_fromobject(result);
+    else if(code <= 0x7FF)
+    {
+        chars[0] = (char)(0xC0 | (code >> 6));
+        chars[1] = (char)(0x80 | (code & 0x3F));
+        n = 2;
+    }
+    else if(code <= 0xFFFF)
+    {
+        chars[0] = (char)(0xE0 | (code >> 12));
+        chars[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        chars[2] = (char)(0x80 | (code & 0x3F));
+        n = 3;
+    }
+    else
+    {
+        chars[0] = (char)(0xF0 | (code >> 18));
+        chars[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+        chars[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+        chars[3] = (char)(0x80 | (code & 0x3F));
+        n = 4;
+    }
+    nn_json_appendchars(jp, len, chars, n);
+    return true;
 }
 
-NNValue nn_objfnstring_rpad(NNState* state, NNArguments* args)
+/*
+* parses the string starting at the current position (which is the opening quote).
+* strings without escape sequences are interned straight from the source.
+*/
+bool nn_json_parsestring(NNJSONParser* jp, NNObjString** dest)
 {
-    size_t i;
-    size_t width;
-    size_t fillsize;
-    size_t finalsize;
-    size_t finalutf8size;
-    char fillchar;
-    char* str;
-    char* fill;
-    NNObjString* ofillstr;
-    NNObjString* string;
-    NNObjString* result;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    string = nn_value_asstring(args->thisval);
-    width = nn_value_asnumber(args->args[0]);
-    fillchar = ' ';
-    if(args->count == 2)
+    char c;
+    char esc;
+    size_t len;
+    size_t start;
+    bool escaped;
+    jp->position++;
+    start = jp->position;
+    escaped = false;
+    len = 0;
+    while(true)
     {
-        ofillstr = nn_value_asstring(args->args[1]);
-        fillchar = ofillstr->sbuf->data[0];
+        if(jp->position >= jp->length)
+        {
+            return nn_json_seterror(jp, "unterminated string");
+        }
+        c = jp->source[jp->position];
+        if(c == '"')
+        {
+            break;
+        }
+        if((unsigned char)c < 0x20)
+        {
+            return nn_json_seterror(jp, "control character in string");
+        }
+        if(c != '\\')
+        {
+            jp->position++;
+            continue;
+        }
+        /* from the first escape on, the string is assembled in strbuf. */
+        escaped = true;
+        nn_json_appendchars(jp, &len, jp->source + start, jp->position - start);
+        jp->position++;
+        if(jp->position >= jp->length)
+        {
+            return nn_json_seterror(jp, "unterminated string");
+        }
+        esc = jp->source[jp->position++];
+        switch(esc)
+        {
+            case '"':
+            case '\\':
+            case '/':
+                c = esc;
+                break;
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'u':
+                {
+                    if(!nn_json_parseunicode(jp, &len))
+                    {
+                        return false;
+                    }
+                    start = jp->position;
+                    continue;
+                }
+                break;
+            default:
+                jp->position--;
+                return nn_json_seterror(jp, "invalid escape sequence");
+        }
+        nn_json_appendchars(jp, &len, &c, 1);
+        start = jp->position;
     }
-    if(width <= string->sbuf->length)
+    if(escaped)
     {
-        return args->thisval;
+        nn_json_appendchars(jp, &len, jp->source + start, jp->position - start);
+        *dest = nn_string_copylen(jp->pstate, jp->strbuf, len);
     }
-    fillsize = width - string->sbuf->length;
-    fill = (char*)nn_memory_malloc(sizeof(char) * ((size_t)fillsize + 1));
-    finalsize = string->sbuf->length + fillsize;
-    finalutf8size = string->sbuf->length + fillsize;
-    for(i = 0; i < fillsize; i++)
+    else
     {
-        fill[i] = fillchar;
+        *dest = nn_string_copylen(jp->pstate, jp->source + start, jp->position - start);
     }
-    str = (char*)nn_memory_malloc(sizeof(char) * ((size_t)finalsize + 1));
-    memcpy(str, string->sbuf->data, string->sbuf->length);
-    memcpy(str + string->sbuf->length, fill, fillsize);
-    str[finalsize] = '\0';
-    nn_memory_free(fill);
-    result = nn_string_takelen(state, str, finalsize);
-    result->sbuf->length = finalutf8size;
-    result->sbuf->length = finalsize;
-    return nn_value_fromobject(result);
+    /* skip the closing quote */
+    jp->position++;
+    return true;
 }
 
-NNValue nn_objfnstring_split(NNState* state, NNArguments* args)
+/*
+* parses a number. integers of up to 15 digits are exact as doubles, and are computed
+* directly; anything else goes through nn_util_strtod.
+*/
+bool nn_json_parsenumber(NNJSONParser* jp, double* dest)
 {
-    size_t i;
-    size_t end;
+    char c;
+    int digits;
+    bool isneg;
+    bool isint;
     size_t start;
-    size_t length;
-    NNObjArray* list;
-    NNObjString* string;
-    NNObjString* delimeter;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 2);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    string = nn_value_asstring(args->thisval);
-    delimeter = nn_value_asstring(args->args[0]);
-    /* empty string matches empty string to empty list */
-    if(((string->sbuf->length == 0) && (delimeter->sbuf->length == 0)) || (string->sbuf->length == 0) || (delimeter->sbuf->length == 0))
+    double value;
+    start = jp->position;
+    isneg = false;
+    isint = true;
+    digits = 0;
+    value = 0;
+    if(jp->source[jp->position] == '-')
     {
-        return nn_value_fromobject(nn_object_makearray(state));
+        isneg = true;
+        jp->position++;
     }
-    list = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
-    if(delimeter->sbuf->length > 0)
+    if((jp->position >= jp->length) || !isdigit((unsigned char)jp->source[jp->position]))
     {
-        start = 0;
-        for(i = 0; i <= string->sbuf->length; i++)
-        {
-            /* match found. */
-            if(memcmp(string->sbuf->data + i, delimeter->sbuf->data, delimeter->sbuf->length) == 0 || i == string->sbuf->length)
-            {
-                nn_array_push(list, nn_value_fromobject(nn_string_copylen(state, string->sbuf->data + start, i - start)));
-                i += delimeter->sbuf->length - 1;
-                start = i + 1;
-            }
-        }
+        return nn_json_seterror(jp, "invalid number");
+    }
+    if(jp->source[jp->position] == '0')
+    {
+        jp->position++;
     }
     else
     {
-        length = string->sbuf->length;
-        for(i = 0; i < length; i++)
+        while((jp->position < jp->length) && isdigit((unsigned char)jp->source[jp->position]))
         {
-            start = i;
-            end = i + 1;
-            nn_array_push(list, nn_value_fromobject(nn_string_copylen(state, string->sbuf->data + start, (int)(end - start))));
+            value = (value * 10) + (jp->source[jp->position] - '0');
+            digits++;
+            jp->position++;
         }
     }
-    return nn_value_fromobject(list);
-}
-
-NNValue nn_objfnstring_replace(NNState* state, NNArguments* args)
-{
-    size_t i;
-    size_t totallength;
-    StringBuffer* result;
-    NNObjString* substr;
-    NNObjString* string;
-    NNObjString* repsubstr;
-    NNArgCheck check;
-    (void)totallength;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNTRANGE(&check, 2, 3);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isstring);
-    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_isstring);
-    string = nn_value_asstring(args->thisval);
-    substr = nn_value_asstring(args->args[0]);
-    repsubstr = nn_value_asstring(args->args[1]);
-    if((string->sbuf->length == 0 && substr->sbuf->length == 0) || string->sbuf->length == 0 || substr->sbuf->length == 0)
+    if((jp->position < jp->length) && (jp->source[jp->position] == '.'))
     {
-        return nn_value_fromobject(nn_string_copylen(state, string->sbuf->data, string->sbuf->length));
+        isint = false;
+        jp->position++;
+        if((jp->position >= jp->length) || !isdigit((unsigned char)jp->source[jp->position]))
+        {
+            return nn_json_seterror(jp, "invalid number");
+        }
+        while((jp->position < jp->length) && isdigit((unsigned char)jp->source[jp->position]))
+        {
+            jp->position++;
+        }
     }
-    result = dyn_strbuf_makebasicempty(0, false);
-    totallength = 0;
-    for(i = 0; i < string->sbuf->length; i++)
+    if(jp->position < jp->length)
     {
-        if(memcmp(string->sbuf->data + i, substr->sbuf->data, substr->sbuf->length) == 0)
+        c = jp->source[jp->position];
+        if((c == 'e') || (c == 'E'))
         {
-            if(substr->sbuf->length > 0)
+            isint = false;
+            jp->position++;
+            if((jp->position < jp->length) && ((jp->source[jp->position] == '+') || (jp->source[jp->position] == '-')))
             {
-                dyn_strbuf_appendstrn(result, repsubstr->sbuf->data, repsubstr->sbuf->length);
+                jp->position++;
+            }
+            if((jp->position >= jp->length) || !isdigit((unsigned char)jp->source[jp->position]))
+            {
+                return nn_json_seterror(jp, "invalid number");
+            }
+            while((jp->position < jp->length) && isdigit((unsigned char)jp->source[jp->position]))
+            {
+                jp->position++;
             }
-            i += substr->sbuf->length - 1;
-            totallength += repsubstr->sbuf->length;
-        }
-        else
-        {
-            dyn_strbuf_appendchar(result, string->sbuf->data[i]);
-            totallength++;
         }
     }
-    return nn_value_fromobject(nn_string_makefromstrbuf(state, result, nn_util_hashstring(result->data, result->length)));
+    if(isint && (digits <= 15))
+    {
+        *dest = isneg ? -value : value;
+        return true;
+    }
+    *dest = nn_util_strtod(jp->source + start, jp->position - start, NULL);
+    return true;
 }
 
-NNValue nn_objfnstring_iter(NNState* state, NNArguments* args)
+bool nn_json_parseliteral(NNJSONParser* jp, const char* literal, size_t len)
 {
-    size_t index;
-    size_t length;
-    NNObjString* string;
-    NNObjString* result;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    string = nn_value_asstring(args->thisval);
-    length = string->sbuf->length;
-    index = nn_value_asnumber(args->args[0]);
-    if(((int)index > -1) && (index < length))
+    if((jp->position + len > jp->length) || (memcmp(jp->source + jp->position, literal, len) != 0))
     {
-        result = nn_string_copylen(state, &string->sbuf->data[index], 1);
-        return nn_value_fromobject(result);
+        return nn_json_seterror(jp, "unexpected character");
     }
-    return nn_value_makenull();
+    jp->position += len;
+    return true;
 }
 
-NNValue nn_objfnstring_itern(NNState* state, NNArguments* args)
+/*
+* parses the elements of an array, leaving them on the stack until the closing bracket,
+* when the array is created with room for exactly that many.
+*/
+bool nn_json_parsearray(NNJSONParser* jp, int depth)
 {
-    size_t index;
-    size_t length;
-    NNObjString* string;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    string = nn_value_asstring(args->thisval);
-    length = string->sbuf->length;
-    if(nn_value_isnull(args->args[0]))
+    size_t i;
+    size_t base;
+    size_t count;
+    NNObjArray* arr;
+    NNValArray* stack;
+    jp->position++;
+    if(!nn_value_isnull(jp->callback) && !nn_json_emit(jp, jp->events[NEON_JSONEVENT_STARTARRAY], nn_value_makenull()))
     {
-        if(length == 0)
+        return false;
+    }
+    base = jp->stack->varray->listcount;
+    nn_json_skipspace(jp);
+    if((jp->position < jp->length) && (jp->source[jp->position] == ']'))
+    {
+        jp->position++;
+    }
+    else
+    {
+        while(true)
         {
-            return nn_value_makebool(false);
+            if(!nn_json_parsevalue(jp, depth + 1))
+            {
+                return false;
+            }
+            nn_json_skipspace(jp);
+            if(jp->position >= jp->length)
+            {
+                return nn_json_seterror(jp, "unterminated array");
+            }
+            if(jp->source[jp->position] == ']')
+            {
+                jp->position++;
+                break;
+            }
+            if(jp->source[jp->position] != ',')
+            {
+                return nn_json_seterror(jp, "expected ',' or ']'");
+            }
+            jp->position++;
         }
-        return nn_value_makenumber(0);
     }
-    if(!nn_value_isnumber(args->args[0]))
+    if(!nn_value_isnull(jp->callback))
     {
-        NEON_RETURNERROR("strings are numerically indexed");
+        return nn_json_emit(jp, jp->events[NEON_JSONEVENT_ENDARRAY], nn_value_makenull());
     }
-    index = nn_value_asnumber(args->args[0]);
-    if(index < length - 1)
+    arr = nn_object_makearray(jp->pstate);
+    stack = jp->stack->varray;
+    count = stack->listcount - base;
+    if(count > arr->varray->listcapacity)
     {
-        return nn_value_makenumber((double)index + 1);
+        nn_vallist_resize(arr->varray, count);
     }
-    return nn_value_makenull();
+    for(i = 0; i < count; i++)
+    {
+        nn_vallist_push(arr->varray, stack->listitems[base + i]);
+    }
+    stack->listcount = base;
+    nn_array_push(jp->stack, nn_value_fromobject(arr));
+    return true;
 }
 
-NNValue nn_objfnstring_each(NNState* state, NNArguments* args)
+/* like nn_json_parsearray, but keys and values are left on the stack in pairs. */
+bool nn_json_parseobject(NNJSONParser* jp, int depth)
 {
     size_t i;
-    size_t arity;
-    NNValue callable;
-    NNValue unused;
-    NNObjString* string;
-    NNObjArray* nestargs;
-    NNArgCheck check;
-    nn_argcheck_init(state, &check, args);
-    NEON_ARGS_CHECKCOUNT(&check, 1);
-    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_iscallable);
-    string = nn_value_asstring(args->thisval);
-    callable = args->args[0];
-    nestargs = nn_object_makearray(state);
-    nn_vm_stackpush(state, nn_value_fromobject(nestargs));
-    arity = nn_nestcall_prepare(state, callable, args->thisval, nestargs);
-    for(i = 0; i < string->sbuf->length; i++)
+    size_t base;
+    size_t count;
+    NNObjDict* dict;
+    NNObjString* key;
+    NNValArray* stack;
+    jp->position++;
+    if(!nn_value_isnull(jp->callback) && !nn_json_emit(jp, jp->events[NEON_JSONEVENT_STARTOBJECT], nn_value_makenull()))
     {
-        if(arity > 0)
+        return false;
+    }
+    base = jp->stack->varray->listcount;
+    nn_json_skipspace(jp);
+    if((jp->position < jp->length) && (jp->source[jp->position] == '}'))
+    {
+        jp->position++;
+    }
+    else
+    {
+        while(true)
         {
-            nestargs->varray->listitems[0] = nn_value_fromobject(nn_string_copylen(state, string->sbuf->data + i, 1));
-            if(arity > 1)
+            nn_json_skipspace(jp);
+            if((jp->position >= jp->length) || (jp->source[jp->position] != '"'))
             {
-                nestargs->varray->listitems[1] = nn_value_makenumber(i);
+                return nn_json_seterror(jp, "expected a string as key");
+            }
+            if(!nn_json_parsestring(jp, &key))
+            {
+                return false;
             }
+            if(!nn_json_putvalue(jp, jp->events[NEON_JSONEVENT_KEY], nn_value_fromobject(key)))
+            {
+                return false;
+            }
+            nn_json_skipspace(jp);
+            if((jp->position >= jp->length) || (jp->source[jp->position] != ':'))
+            {
+                return nn_json_seterror(jp, "expected ':'");
+            }
+            jp->position++;
+            if(!nn_json_parsevalue(jp, depth + 1))
+            {
+                return false;
+            }
+            nn_json_skipspace(jp);
+            if(jp->position >= jp->length)
+            {
+                return nn_json_seterror(jp, "unterminated object");
+            }
+            if(jp->source[jp->position] == '}')
+            {
+                jp->position++;
+                break;
+            }
+            if(jp->source[jp->position] != ',')
+            {
+                return nn_json_seterror(jp, "expected ',' or '}'");
+            }
+            jp->position++;
         }
-        nn_nestcall_callfunction(state, callable, args->thisval, nestargs, &unused);
     }
-    /* pop the argument list */
-    nn_vm_stackpop(state);
-    return nn_value_makenull();
-}
-
-NNValue nn_objfnobject_dumpself(NNState* state, NNArguments* args)
-{
-    NNValue v;
-    NNPrinter pr;
-    NNObjString* os;
-    v = args->thisval;
-    nn_printer_makestackstring(state, &pr);
-    nn_printer_printvalue(&pr, v, true, false);
-    os = nn_printer_takestring(&pr);
-    return nn_value_fromobject(os);
-}
-
-NNValue nn_objfnobject_tostring(NNState* state, NNArguments* args)
-{
-    NNValue v;
-    NNPrinter pr;
-    NNObjString* os;
-    v = args->thisval;
-    nn_printer_makestackstring(state, &pr);
-    nn_printer_printvalue(&pr, v, false, true);
-    os = nn_printer_takestring(&pr);
-    return nn_value_fromobject(os);
-}
-
-NNValue nn_objfnobject_typename(NNState* state, NNArguments* args)
-{
-    NNValue v;
-    NNObjString* os;
-    v = args->args[0];
-    os = nn_string_copycstr(state, nn_value_typename(v));
-    return nn_value_fromobject(os);
-}
-
-NNValue nn_objfnobject_getselfclass(NNState* state, NNArguments* args)
-{
-    (void)state;
-    return args->thisval;
-}
-
-NNValue nn_objfnobject_isstring(NNState* state, NNArguments* args)
-{
-    NNValue v;
-    (void)state;
-    v = args->thisval;
-    return nn_value_makebool(nn_value_isstring(v));
-}
-
-NNValue nn_objfnobject_isarray(NNState* state, NNArguments* args)
-{
-    NNValue v;
-    (void)state;
-    v = args->thisval;
-    return nn_value_makebool(nn_value_isarray(v));
-}
-
-NNValue nn_objfnobject_isa(NNState* state, NNArguments* args)
-{
-    NNValue v;
-    NNValue otherclval;
-    NNObjClass* oclass;
-    NNObjClass* selfclass;
-    (void)state;
-    v = args->thisval;
-    otherclval = args->args[0];
-    if(nn_value_isclass(otherclval))
+    if(!nn_value_isnull(jp->callback))
     {
-        oclass = nn_value_asclass(otherclval);
-        selfclass = nn_value_getclassfor(state, v);
-        if(selfclass != NULL)
-        {
-            return nn_value_makebool(nn_util_isinstanceof(selfclass, oclass));
-        }
+        return nn_json_emit(jp, jp->events[NEON_JSONEVENT_ENDOBJECT], nn_value_makenull());
+    }
+    dict = nn_object_makedict(jp->pstate);
+    stack = jp->stack->varray;
+    count = (stack->listcount - base) / 2;
+    if(count > 0)
+    {
+        nn_dict_rebuild(dict, count);
+    }
+    for(i = 0; i < count; i++)
+    {
+        nn_dict_setentry(dict, stack->listitems[base + (i * 2)], stack->listitems[base + (i * 2) + 1]);
     }
-    return nn_value_makebool(false);
-}
-
-NNValue nn_objfnobject_iscallable(NNState* state, NNArguments* args)
-{
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return (nn_value_makebool(
-        nn_value_isclass(selfval) ||
-        nn_value_isfuncscript(selfval) ||
-        nn_value_isfuncclosure(selfval) ||
-        nn_value_isfuncbound(selfval) ||
-        nn_value_isfuncnative(selfval)
-    ));
-}
-
-NNValue nn_objfnobject_isbool(NNState* state, NNArguments* args)
-{
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return nn_value_makebool(nn_value_isbool(selfval));
-}
-
-NNValue nn_objfnobject_isnumber(NNState* state, NNArguments* args)
-{
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return nn_value_makebool(nn_value_isnumber(selfval));
+    stack->listcount = base;
+    nn_array_push(jp->stack, nn_value_fromobject(dict));
+    return true;
 }
 
-NNValue nn_objfnobject_isint(NNState* state, NNArguments* args)
+bool nn_json_parsevalue(NNJSONParser* jp, int depth)
 {
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return nn_value_makebool(nn_value_isnumber(selfval) && (((int)nn_value_asnumber(selfval)) == nn_value_asnumber(selfval)));
+    char c;
+    double num;
+    NNObjString* str;
+    if(depth > NEON_CONFIG_JSONMAXDEPTH)
+    {
+        return nn_json_seterror(jp, "nesting too deep");
+    }
+    nn_json_skipspace(jp);
+    if(jp->position >= jp->length)
+    {
+        return nn_json_seterror(jp, "unexpected end of input");
+    }
+    c = jp->source[jp->position];
+    switch(c)
+    {
+        case '{':
+            return nn_json_parseobject(jp, depth);
+        case '[':
+            return nn_json_parsearray(jp, depth);
+        case '"':
+            {
+                if(!nn_json_parsestring(jp, &str))
+                {
+                    return false;
+                }
+                return nn_json_putvalue(jp, jp->events[NEON_JSONEVENT_VALUE], nn_value_fromobject(str));
+            }
+            break;
+        case 't':
+            {
+                if(!nn_json_parseliteral(jp, "true", 4))
+                {
+                    return false;
+                }
+                return nn_json_putvalue(jp, jp->events[NEON_JSONEVENT_VALUE], nn_value_makebool(true));
+            }
+            break;
+        case 'f':
+            {
+                if(!nn_json_parseliteral(jp, "false", 5))
+                {
+                    return false;
+                }
+                return nn_json_putvalue(jp, jp->events[NEON_JSONEVENT_VALUE], nn_value_makebool(false));
+            }
+            break;
+        case 'n':
+            {
+                if(!nn_json_parseliteral(jp, "null", 4))
+                {
+                    return false;
+                }
+                return nn_json_putvalue(jp, jp->events[NEON_JSONEVENT_VALUE], nn_value_makenull());
+            }
+            break;
+        default:
+            {
+                if((c == '-') || isdigit((unsigned char)c))
+                {
+                    if(!nn_json_parsenumber(jp, &num))
+                    {
+                        return false;
+                    }
+                    return nn_json_putvalue(jp, jp->events[NEON_JSONEVENT_VALUE], nn_value_makenumber(num));
+                }
+            }
+            break;
+    }
+    return nn_json_seterror(jp, "unexpected character");
 }
 
-NNValue nn_objfnobject_isdict(NNState* state, NNArguments* args)
+/*
+* parses a complete document, which must be followed by nothing but whitespace.
+* when building, the result is left on top of the stack.
+*/
+bool nn_json_parse(NNJSONParser* jp)
 {
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return nn_value_makebool(nn_value_isdict(selfval));
+    if(!nn_json_parsevalue(jp, 0))
+    {
+        return false;
+    }
+    nn_json_skipspace(jp);
+    if(jp->position < jp->length)
+    {
+        return nn_json_seterror(jp, "unexpected data after the end of the document");
+    }
+    return true;
 }
 
-NNValue nn_objfnobject_isobject(NNState* state, NNArguments* args)
+/* gets the text to parse from $value, which may be a string or a typed array such as Bytes. */
+bool nn_json_getsource(NNValue value, const char** srcdest, size_t* lendest)
 {
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return nn_value_makebool(nn_value_isobject(selfval));
+    NNObjString* os;
+    NNObjTypedArray* ta;
+    if(nn_value_isstring(value))
+    {
+        os = nn_value_asstring(value);
+        *srcdest = os->sbuf->data;
+        *lendest = os->sbuf->length;
+        return true;
+    }
+    if(nn_value_istypedarray(value))
+    {
+        ta = nn_value_astypedarray(value);
+        *srcdest = (const char*)ta->data;
+        *lendest = ta->length * nn_typedarray_elemsize(ta->kind);
+        return true;
+    }
+    return false;
 }
 
-NNValue nn_objfnobject_isfunction(NNState* state, NNArguments* args)
+NNValue nn_objfnjson_parse(NNState* state, NNArguments* args)
 {
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return nn_value_makebool(
-        nn_value_isfuncscript(selfval) ||
-        nn_value_isfuncclosure(selfval) ||
-        nn_value_isfuncbound(selfval) ||
-        nn_value_isfuncnative(selfval)
-    );
+    bool ok;
+    size_t length;
+    const char* source;
+    NNObjArray* stack;
+    NNJSONParser jp;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    if(!nn_json_getsource(args->args[0], &source, &length))
+    {
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "parse() expects a string or Bytes, %s given", nn_value_typename(args->args[0]));
+    }
+    /*
+    * protecting the stack also keeps the garbage collector from running, which could only
+    * trace the growing document over and over: nothing parsed so far is garbage.
+    */
+    stack = (NNObjArray*)nn_gcmem_protect(state, (NNObject*)nn_object_makearray(state));
+    nn_json_initparser(state, &jp, source, length, stack);
+    ok = nn_json_parse(&jp);
+    nn_json_destroyparser(&jp);
+    if(!ok)
+    {
+        return nn_json_throwerror(state, &jp, "JSON.parse");
+    }
+    return stack->varray->listitems[0];
 }
 
-NNValue nn_objfnobject_isiterable(NNState* state, NNArguments* args)
+/*
+* events(source, callback) parses $source without building anything, calling callback(event, value)
+* for each token instead. the events are "startObject", "endObject", "startArray", "endArray",
+* "key" (with the key as value) and "value" (with a string, number, bool or null).
+* returning false from the callback stops the parser, in which case events() returns false.
+*/
+NNValue nn_objfnjson_events(NNState* state, NNArguments* args)
 {
-    bool isiterable;
-    NNValue dummy;
-    NNObjClass* klass;
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    isiterable = nn_value_isarray(selfval) || nn_value_isdict(selfval) || nn_value_isstring(selfval);
-    if(!isiterable && nn_value_isinstance(selfval))
+    bool ok;
+    size_t i;
+    size_t length;
+    const char* source;
+    NNObjArray* stack;
+    NNJSONParser jp;
+    NNArgCheck check;
+    static const char* eventnames[] = { "startObject", "endObject", "startArray", "endArray", "key", "value" };
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 2);
+    NEON_ARGS_CHECKTYPE(&check, 1, nn_value_iscallable);
+    if(!nn_json_getsource(args->args[0], &source, &length))
     {
-        klass = nn_value_asinstance(selfval)->klass;
-        isiterable = nn_tableval_get(klass->instmethods, nn_value_fromobject(nn_string_intern(state, "@iter")), &dummy)
-            && nn_tableval_get(klass->instmethods, nn_value_fromobject(nn_string_intern(state, "@itern")), &dummy);
+        return nn_exceptions_throwclass(state, state->exceptions.argumenterror, "events() expects a string or Bytes, %s given", nn_value_typename(args->args[0]));
     }
-    return nn_value_makebool(isiterable);
+    stack = nn_object_makearray(state);
+    nn_vm_stackpush(state, nn_value_fromobject(stack));
+    nn_json_initparser(state, &jp, source, length, stack);
+    /* the event names and the argument list live on the stack, which keeps them reachable. */
+    for(i = 0; i < NEON_JSONEVENT_COUNT; i++)
+    {
+        jp.events[i] = nn_string_copycstr(state, eventnames[i]);
+        nn_array_push(stack, nn_value_fromobject(jp.events[i]));
+    }
+    jp.nestargs = nn_object_makearray(state);
+    nn_array_push(stack, nn_value_fromobject(jp.nestargs));
+    jp.callback = args->args[1];
+    jp.arity = nn_nestcall_prepare(state, jp.callback, nn_value_makenull(), jp.nestargs);
+    ok = nn_json_parse(&jp);
+    nn_json_destroyparser(&jp);
+    if(jp.threw)
+    {
+        /* the handler expects the exception on top of the stack, so leave it alone. */
+        return nn_value_makenull();
+    }
+    nn_vm_stackpop(state);
+    if(!ok && !jp.stopped)
+    {
+        return nn_json_throwerror(state, &jp, "JSON.events");
+    }
+    return nn_value_makebool(ok);
 }
 
-NNValue nn_objfnobject_isclass(NNState* state, NNArguments* args)
+/*
+* lines(file) returns an Iterator over a file of newline-delimited JSON documents (NDJSON),
+* parsing one line at a time. blank lines are skipped.
+*/
+NNValue nn_objfnjson_lines(NNState* state, NNArguments* args)
 {
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return nn_value_makebool(nn_value_isclass(selfval));
+    NNObjIterator* iter;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNT(&check, 1);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isfile);
+    iter = (NNObjIterator*)nn_gcmem_protect(state, (NNObject*)nn_object_makeiterator(state, NEON_ITERKIND_JSONLINES, args->args[0]));
+    /* the parser stack is reused for every line. */
+    iter->other = nn_value_fromobject(nn_object_makearray(state));
+    return nn_value_fromobject(iter);
 }
 
-NNValue nn_objfnobject_isfile(NNState* state, NNArguments* args)
+void nn_jsonwriter_init(NNState* state, NNJSONWriter* jw, FILE* handle)
 {
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return nn_value_makebool(nn_value_isfile(selfval));
+    jw->pstate = state;
+    jw->handle = handle;
+    jw->length = 0;
+    jw->capacity = NEON_CONFIG_JSONWRITEBUFSIZE;
+    jw->buf = (char*)nn_memory_malloc(jw->capacity);
+    jw->indent = NULL;
+    jw->indentlen = 0;
+    jw->sortkeys = false;
+    jw->depth = 0;
+    jw->error = NULL;
 }
 
-NNValue nn_objfnobject_isinstance(NNState* state, NNArguments* args)
+void nn_jsonwriter_destroy(NNJSONWriter* jw)
 {
-    NNValue selfval;
-    (void)state;
-    selfval = args->thisval;
-    return nn_value_makebool(nn_value_isinstance(selfval));
+    nn_memory_free(jw->buf);
 }
 
-
-NNValue nn_objfnclass_getselfname(NNState* state, NNArguments* args)
+/* writes out the buffer, if writing to a file. */
+void nn_jsonwriter_flush(NNJSONWriter* jw)
 {
-    NNValue selfval;
-    NNObjClass* klass;
-    (void)state;
-    selfval = args->thisval;
-    klass = nn_value_asclass(selfval);
-    return nn_value_fromobject(klass->name);
+    if((jw->handle != NULL) && (jw->length > 0))
+    {
+        fwrite(jw->buf, sizeof(char), jw->length, jw->handle);
+        jw->length = 0;
+    }
 }
 
-NNObjString* nn_util_numbertobinstring(NNState* state, long n)
+/*
+* makes room for $count more bytes. when writing to a file, the buffer is written out instead of
+* growing, unless a single piece is larger than the whole buffer.
+*/
+NEON_FORCEINLINE void nn_jsonwriter_reserve(NNJSONWriter* jw, size_t count)
 {
-    int i;
-    int rem;
-    int count;
-    int length;
-    long j;
-    /* assume maximum of 1024 bits */
-    char str[1024];
-    char newstr[1027];
-    count = 0;
-    j = n;
-    if(j == 0)
-    {
-        str[count++] = '0';
-    }
-    while(j != 0)
+    if(jw->length + count + 1 > jw->capacity)
     {
-        rem = abs((int)(j % 2));
-        j /= 2;
-        if(rem == 1)
-        {
-            str[count] = '1';
-        }
-        else
+        nn_jsonwriter_flush(jw);
+        while(jw->length + count + 1 > jw->capacity)
         {
-            str[count] = '0';
+            jw->capacity *= 2;
         }
-        count++;
-    }
-    /* assume maximum of 1024 bits + 0b (indicator) + sign (-). */
-    length = 0;
-    if(n < 0)
-    {
-        newstr[length++] = '-';
-    }
-    newstr[length++] = '0';
-    newstr[length++] = 'b';
-    for(i = count - 1; i >= 0; i--)
-    {
-        newstr[length++] = str[i];
+        jw->buf = (char*)nn_memory_realloc(jw->buf, jw->capacity);
     }
-    newstr[length++] = 0;
-    return nn_string_copylen(state, newstr, length);
-    /*
-    //  // To store the binary number
-    //  int64_t number = 0;
-    //  int cnt = 0;
-    //  while (n != 0) {
-    //    int64_t rem = n % 2;
-    //    int64_t c = (int64_t) pow(10, cnt);
-    //    number += rem * c;
-    //    n /= 2;
-    //
-    //    // Count used to store exponent value
-    //    cnt++;
-    //  }
-    //
-    //  char str[67]; // assume maximum of 64 bits + 2 binary indicators (0b)
-    //  int length = sprintf(str, "0b%lld", number);
-    //
-    //  return nn_string_copylen(state, str, length);
-    */
 }
 
-NNObjString* nn_util_numbertooctstring(NNState* state, int64_t n, bool numeric)
+NEON_FORCEINLINE void nn_jsonwriter_write(NNJSONWriter* jw, const char* str, size_t len)
+{
+    nn_jsonwriter_reserve(jw, len);
+    memcpy(jw->buf + jw->length, str, len);
+    jw->length += len;
+}
+
+NEON_FORCEINLINE void nn_jsonwriter_putc(NNJSONWriter* jw, char c)
+{
+    nn_jsonwriter_reserve(jw, 1);
+    jw->buf[jw->length++] = c;
+}
+
+bool nn_jsonwriter_seterror(NNJSONWriter* jw, const char* message)
 {
-    int length;
-    /* assume maximum of 64 bits + 2 octal indicators (0c) */
-    char str[66];
-    length = sprintf(str, numeric ? "0c%lo" : "%lo", n);
-    return nn_string_copylen(state, str, length);
+    if(jw->error == NULL)
+    {
+        jw->error = message;
+    }
+    return false;
 }
 
-NNObjString* nn_util_numbertohexstring(NNState* state, int64_t n, bool numeric)
+/* like in JavaScript, NaN and the infinities become null. */
+void nn_jsonwriter_writenumber(NNJSONWriter* jw, double num)
 {
-    int length;
-    /* assume maximum of 64 bits + 2 hex indicators (0x) */
-    char str[66];
-    length = sprintf(str, numeric ? "0x%lx" : "%lx", n);
-    return nn_string_copylen(state, str, length);
+    size_t len;
+    if(isnan(num) || isinf(num))
+    {
+        nn_jsonwriter_write(jw, "null", 4);
+        return;
+    }
+    nn_jsonwriter_reserve(jw, NEON_CONFIG_NUMBERBUFSIZE);
+    len = nn_util_formatnumber(num, jw->buf + jw->length);
+    jw->length += len;
 }
 
-NNValue nn_objfnnumber_tobinstring(NNState* state, NNArguments* args)
+/* returns the offset of the first byte of $str that must be escaped, or $len if there is none. */
+NEON_FORCEINLINE size_t nn_jsonwriter_findescape(const char* str, size_t len)
 {
-    return nn_value_fromobject(nn_util_numbertobinstring(state, nn_value_asnumber(args->thisval)));
+    size_t i;
+    unsigned char c;
+    i = 0;
+    #if defined(NEON_PLAT_HAVESSE2)
+    {
+        int mask;
+        __m128i chunk;
+        __m128i quote;
+        __m128i bslash;
+        __m128i ctrlmax;
+        quote = _mm_set1_epi8('"');
+        bslash = _mm_set1_epi8('\\');
+        ctrlmax = _mm_set1_epi8(0x1F);
+        for(; i + 16 <= len; i += 16)
+        {
+            chunk = _mm_loadu_si128((const __m128i*)(str + i));
+            /* bytes below 0x20: min(byte, 0x1F) == byte, taken as unsigned. */
+            mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, bslash)), _mm_cmpeq_epi8(_mm_min_epu8(chunk, ctrlmax), chunk)));
+            if(mask != 0)
+            {
+                return i + __builtin_ctz((unsigned int)mask);
+            }
+        }
+    }
+    #endif
+    for(; i < len; i++)
+    {
+        c = (unsigned char)str[i];
+        if((c == '"') || (c == '\\') || (c < 0x20))
+        {
+            return i;
+        }
+    }
+    return len;
 }
 
-NNValue nn_objfnnumber_tooctstring(NNState* state, NNArguments* args)
+/* writes $str as a JSON string. bytes from 0x80 up are utf-8, which JSON allows as-is. */
+void nn_jsonwriter_writestring(NNJSONWriter* jw, const char* str, size_t len)
 {
-    return nn_value_fromobject(nn_util_numbertooctstring(state, nn_value_asnumber(args->thisval), false));
+    size_t run;
+    unsigned char c;
+    char esc[8];
+    static const char* hexdigits = "0123456789abcdef";
+    nn_jsonwriter_putc(jw, '"');
+    while(len > 0)
+    {
+        run = nn_jsonwriter_findescape(str, len);
+        nn_jsonwriter_write(jw, str, run);
+        if(run == len)
+        {
+            break;
+        }
+        c = (unsigned char)str[run];
+        esc[0] = '\\';
+        esc[1] = 0;
+        switch(c)
+        {
+            case '"':
+                esc[1] = '"';
+                break;
+            case '\\':
+                esc[1] = '\\';
+                break;
+            case '\n':
+                esc[1] = 'n';
+                break;
+            case '\r':
+                esc[1] = 'r';
+                break;
+            case '\t':
+                esc[1] = 't';
+                break;
+            case '\b':
+                esc[1] = 'b';
+                break;
+            case '\f':
+                esc[1] = 'f';
+                break;
+        }
+        if(esc[1] != 0)
+        {
+            nn_jsonwriter_write(jw, esc, 2);
+        }
+        else
+        {
+            esc[1] = 'u';
+            esc[2] = '0';
+            esc[3] = '0';
+            esc[4] = hexdigits[c >> 4];
+            esc[5] = hexdigits[c & 0xF];
+            nn_jsonwriter_write(jw, esc, 6);
+        }
+        str += run + 1;
+        len -= run + 1;
+    }
+    nn_jsonwriter_putc(jw, '"');
 }
 
-NNValue nn_objfnnumber_constructor(NNState* state, NNArguments* args)
+/* when pretty-printing, starts a new line, indented by the current depth. */
+void nn_jsonwriter_newline(NNJSONWriter* jw)
 {
-    NNValue val;
-    NNValue rtval;
-    NNObjString* os;
-    if(args->count == 0)
+    int i;
+    if(jw->indent == NULL)
     {
-        return nn_value_makenumber(0);
+        return;
     }
-    val = args->args[0];
-    if(nn_value_isnumber(val))
+    nn_jsonwriter_putc(jw, '\n');
+    for(i = 0; i < jw->depth; i++)
     {
-        return val;
+        nn_jsonwriter_write(jw, jw->indent, jw->indentlen);
     }
-    if(nn_value_isnull(val))
+}
+
+/*
+* records $obj as being written, and fails if it is already being written further up,
+* which would make the output infinite.
+*/
+bool nn_jsonwriter_enter(NNJSONWriter* jw, NNObject* obj)
+{
+    int i;
+    if(jw->depth >= NEON_CONFIG_JSONMAXDEPTH)
     {
-        return nn_value_makenumber(0);
+        return nn_jsonwriter_seterror(jw, "nesting too deep");
     }
-    if(!nn_value_isstring(val))
+    for(i = 0; i < jw->depth; i++)
     {
-        NEON_RETURNERROR("Number() expects no arguments, or number, or string");
+        if(jw->path[i] == obj)
+        {
+            return nn_jsonwriter_seterror(jw, "cyclic structure");
+        }
     }
-    NNAstToken tok;
-    NNAstLexer lex;
-    os = nn_value_asstring(val);
-    nn_astlex_init(&lex, state, os->sbuf->data);
-    tok = nn_astlex_scannumber(&lex);
-    rtval = nn_astparser_compilestrnumber(tok.type, tok.start);
-    return rtval;
+    jw->path[jw->depth] = obj;
+    jw->depth++;
+    return true;
 }
 
-NNValue nn_objfnnumber_tohexstring(NNState* state, NNArguments* args)
+/* object keys must be strings; anything else is written as its string form. */
+void nn_jsonwriter_writekey(NNJSONWriter* jw, NNValue key)
 {
-    return nn_value_fromobject(nn_util_numbertohexstring(state, nn_value_asnumber(args->thisval), false));
+    NNObjString* os;
+    if(nn_value_isstring(key))
+    {
+        os = nn_value_asstring(key);
+    }
+    else
+    {
+        os = nn_value_tostring(jw->pstate, key);
+    }
+    nn_jsonwriter_writestring(jw, os->sbuf->data, os->sbuf->length);
+    nn_jsonwriter_putc(jw, ':');
+    if(jw->indent != NULL)
+    {
+        nn_jsonwriter_putc(jw, ' ');
+    }
 }
 
-NNValue nn_objfnmath_abs(NNState* state, NNArguments* args)
+/* orders string keys bytewise, ahead of any other keys, which keep their original order. */
+int nn_jsonwriter_comparemembers(const void* pa, const void* pb)
 {
-    (void)state;
-    return nn_value_makenumber(fabs(nn_value_asnumber(args->args[0])));
+    int rt;
+    size_t alen;
+    size_t blen;
+    NNObjString* astr;
+    NNObjString* bstr;
+    const NNJSONMember* a;
+    const NNJSONMember* b;
+    a = (const NNJSONMember*)pa;
+    b = (const NNJSONMember*)pb;
+    if(nn_value_isstring(a->key) && nn_value_isstring(b->key))
+    {
+        astr = nn_value_asstring(a->key);
+        bstr = nn_value_asstring(b->key);
+        alen = astr->sbuf->length;
+        blen = bstr->sbuf->length;
+        rt = memcmp(astr->sbuf->data, bstr->sbuf->data, (alen < blen) ? alen : blen);
+        if(rt != 0)
+        {
+            return rt;
+        }
+        if(alen != blen)
+        {
+            return (alen < blen) ? -1 : 1;
+        }
+    }
+    else if(nn_value_isstring(a->key) != nn_value_isstring(b->key))
+    {
+        return nn_value_isstring(a->key) ? -1 : 1;
+    }
+    return (a->order < b->order) ? -1 : 1;
 }
 
-NNValue nn_objfnmath_round(NNState* state, NNArguments* args)
+/* writes the $count members of an object, sorted by key if asked to. */
+bool nn_jsonwriter_writemembers(NNJSONWriter* jw, NNJSONMember* members, size_t count)
 {
-    (void)state;
-    return nn_value_makenumber(round(nn_value_asnumber(args->args[0])));
+    size_t i;
+    if(jw->sortkeys)
+    {
+        qsort(members, count, sizeof(NNJSONMember), nn_jsonwriter_comparemembers);
+    }
+    nn_jsonwriter_putc(jw, '{');
+    for(i = 0; i < count; i++)
+    {
+        if(i > 0)
+        {
+            nn_jsonwriter_putc(jw, ',');
+        }
+        nn_jsonwriter_newline(jw);
+        nn_jsonwriter_writekey(jw, members[i].key);
+        if(!nn_jsonwriter_writevalue(jw, members[i].value))
+        {
+            return false;
+        }
+    }
+    jw->depth--;
+    if(count > 0)
+    {
+        nn_jsonwriter_newline(jw);
+    }
+    nn_jsonwriter_putc(jw, '}');
+    return true;
 }
 
-NNValue nn_objfnmath_sqrt(NNState* state, NNArguments* args)
+bool nn_jsonwriter_writedict(NNJSONWriter* jw, NNObjDict* dict)
 {
-    (void)state;
-    return nn_value_makenumber(sqrt(nn_value_asnumber(args->args[0])));
+    bool ok;
+    size_t i;
+    size_t n;
+    NNJSONMember* members;
+    if(!nn_jsonwriter_enter(jw, (NNObject*)dict))
+    {
+        return false;
+    }
+    n = 0;
+    members = (NNJSONMember*)nn_memory_malloc(sizeof(NNJSONMember) * (dict->count + 1));
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(dict->entries[i].live)
+        {
+            members[n].key = dict->entries[i].key;
+            members[n].value = dict->entries[i].value.value;
+            members[n].order = n;
+            n++;
+        }
+    }
+    ok = nn_jsonwriter_writemembers(jw, members, n);
+    nn_memory_free(members);
+    return ok;
 }
 
-NNValue nn_objfnmath_ceil(NNState* state, NNArguments* args)
+/* instances are written as objects made of their properties. */
+bool nn_jsonwriter_writeinstance(NNJSONWriter* jw, NNObjInstance* instance)
 {
-    (void)state;
-    return nn_value_makenumber(ceil(nn_value_asnumber(args->args[0])));
+    bool ok;
+    int i;
+    size_t n;
+    NNHashValTable* table;
+    NNJSONMember* members;
+    if(!nn_jsonwriter_enter(jw, (NNObject*)instance))
+    {
+        return false;
+    }
+    table = instance->properties;
+    n = 0;
+    members = (NNJSONMember*)nn_memory_malloc(sizeof(NNJSONMember) * (table->count + 1));
+    for(i = 0; i < table->capacity; i++)
+    {
+        if(nn_tableval_slotisfull(table, i))
+        {
+            members[n].key = table->keys[i];
+            members[n].value = table->values[i].value;
+            members[n].order = n;
+            n++;
+        }
+    }
+    ok = nn_jsonwriter_writemembers(jw, members, n);
+    nn_memory_free(members);
+    return ok;
 }
 
-NNValue nn_objfnmath_floor(NNState* state, NNArguments* args)
+/* writes $count values as an array. */
+bool nn_jsonwriter_writeelements(NNJSONWriter* jw, NNObject* obj, NNValue* items, size_t count)
 {
-    (void)state;
-    return nn_value_makenumber(floor(nn_value_asnumber(args->args[0])));
+    size_t i;
+    if(!nn_jsonwriter_enter(jw, obj))
+    {
+        return false;
+    }
+    nn_jsonwriter_putc(jw, '[');
+    for(i = 0; i < count; i++)
+    {
+        if(i > 0)
+        {
+            nn_jsonwriter_putc(jw, ',');
+        }
+        nn_jsonwriter_newline(jw);
+        if(!nn_jsonwriter_writevalue(jw, items[i]))
+        {
+            return false;
+        }
+    }
+    jw->depth--;
+    if(count > 0)
+    {
+        nn_jsonwriter_newline(jw);
+    }
+    nn_jsonwriter_putc(jw, ']');
+    return true;
 }
 
-NNValue nn_objfnmath_min(NNState* state, NNArguments* args)
+bool nn_jsonwriter_writetypedarray(NNJSONWriter* jw, NNObjTypedArray* ta)
 {
-    double b;
-    double x;
-    double y;
-    (void)state;
-    x = nn_value_asnumber(args->args[0]);
-    y = nn_value_asnumber(args->args[1]);
-    b = (x < y) ? x : y;
-    return nn_value_makenumber(b);
+    size_t i;
+    if(!nn_jsonwriter_enter(jw, (NNObject*)ta))
+    {
+        return false;
+    }
+    nn_jsonwriter_putc(jw, '[');
+    for(i = 0; i < ta->length; i++)
+    {
+        if(i > 0)
+        {
+            nn_jsonwriter_putc(jw, ',');
+        }
+        nn_jsonwriter_newline(jw);
+        nn_jsonwriter_writenumber(jw, nn_typedarray_get(ta, i));
+    }
+    jw->depth--;
+    if(ta->length > 0)
+    {
+        nn_jsonwriter_newline(jw);
+    }
+    nn_jsonwriter_putc(jw, ']');
+    return true;
 }
 
-NNValue nn_objfnprocess_exedirectory(NNState* state, NNArguments* args)
+bool nn_jsonwriter_writeset(NNJSONWriter* jw, NNObjSet* set)
 {
-    (void)args;
-    return nn_value_fromobject(state->processinfo->cliexedirectory);
+    bool ok;
+    size_t i;
+    size_t n;
+    NNValue* items;
+    NNObjDict* dict;
+    dict = set->items;
+    n = 0;
+    items = (NNValue*)nn_memory_malloc(sizeof(NNValue) * (dict->count + 1));
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        if(dict->entries[i].live)
+        {
+            items[n++] = dict->entries[i].key;
+        }
+    }
+    ok = nn_jsonwriter_writeelements(jw, (NNObject*)set, items, n);
+    nn_memory_free(items);
+    return ok;
 }
 
-NNValue nn_objfnprocess_exit(NNState* state, NNArguments* args)
+/*
+* writes $value. arrays, sets and typed arrays become arrays; dicts and instances become objects.
+* values that JSON has no notation for, such as functions, are written as null.
+*/
+bool nn_jsonwriter_writevalue(NNJSONWriter* jw, NNValue value)
 {
-    int rc;
-    (void)state;
-    rc = 0;
-    if(args->count > 0)
+    NNObjString* os;
+    NNObjArray* arr;
+    if(nn_value_isnull(value))
+    {
+        nn_jsonwriter_write(jw, "null", 4);
+        return true;
+    }
+    if(nn_value_isbool(value))
+    {
+        if(nn_value_asbool(value))
+        {
+            nn_jsonwriter_write(jw, "true", 4);
+        }
+        else
+        {
+            nn_jsonwriter_write(jw, "false", 5);
+        }
+        return true;
+    }
+    if(nn_value_isnumber(value))
+    {
+        nn_jsonwriter_writenumber(jw, nn_value_asnumber(value));
+        return true;
+    }
+    if(!nn_value_isobject(value))
+    {
+        nn_jsonwriter_write(jw, "null", 4);
+        return true;
+    }
+    switch(nn_value_objtype(value))
+    {
+        case NEON_OBJTYPE_STRING:
+            {
+                os = nn_value_asstring(value);
+                nn_jsonwriter_writestring(jw, os->sbuf->data, os->sbuf->length);
+            }
+            return true;
+        case NEON_OBJTYPE_ARRAY:
+            {
+                arr = nn_value_asarray(value);
+                return nn_jsonwriter_writeelements(jw, (NNObject*)arr, arr->varray->listitems, arr->varray->listcount);
+            }
+            break;
+        case NEON_OBJTYPE_DICT:
+            return nn_jsonwriter_writedict(jw, nn_value_asdict(value));
+        case NEON_OBJTYPE_SET:
+            return nn_jsonwriter_writeset(jw, nn_value_asset(value));
+        case NEON_OBJTYPE_TYPEDARRAY:
+            return nn_jsonwriter_writetypedarray(jw, nn_value_astypedarray(value));
+        case NEON_OBJTYPE_INSTANCE:
+            return nn_jsonwriter_writeinstance(jw, nn_value_asinstance(value));
+        default:
+            break;
+    }
+    nn_jsonwriter_write(jw, "null", 4);
+    return true;
+}
+
+/*
+* applies the optional arguments of stringify() and write(), starting at $from:
+* the indentation (a number of spaces, or a string of up to 10 characters) and whether to sort keys.
+*/
+bool nn_jsonwriter_setoptions(NNState* state, NNJSONWriter* jw, NNArguments* args, size_t from, char* indentbuf)
+{
+    size_t n;
+    NNValue indent;
+    NNObjString* os;
+    if(args->count > from)
     {
-        rc = nn_value_asnumber(args->args[0]);
+        indent = args->args[from];
+        if(nn_value_isnumber(indent))
+        {
+            n = 0;
+            if(nn_value_asnumber(indent) > 0)
+            {
+                n = (nn_value_asnumber(indent) > 10) ? 10 : (size_t)nn_value_asnumber(indent);
+            }
+            memset(indentbuf, ' ', n);
+            jw->indentlen = n;
+            jw->indent = (n > 0) ? indentbuf : NULL;
+        }
+        else if(nn_value_isstring(indent))
+        {
+            os = nn_value_asstring(indent);
+            n = (os->sbuf->length > 10) ? 10 : os->sbuf->length;
+            memcpy(indentbuf, os->sbuf->data, n);
+            jw->indentlen = n;
+            jw->indent = (n > 0) ? indentbuf : NULL;
+        }
+        else if(!nn_value_isnull(indent))
+        {
+            nn_exceptions_throwclass(state, state->exceptions.argumenterror, "%s() expects the indentation as a number or a string, %s given", args->name, nn_value_typename(indent));
+            return false;
+        }
     }
-    exit(rc);
-    return nn_value_makenull();
+    if(args->count > from + 1)
+    {
+        jw->sortkeys = !nn_value_isfalse(args->args[from + 1]);
+    }
+    return true;
 }
 
-NNValue nn_objfnprocess_kill(NNState* state, NNArguments* args)
+/*
+* stringify(value), stringify(value, indent) and stringify(value, indent, sortkeys) return
+* $value as JSON. with an indent, the output is pretty-printed.
+*/
+NNValue nn_objfnjson_stringify(NNState* state, NNArguments* args)
 {
-    int pid;
-    int code;
-    (void)state;
-    pid = nn_value_asnumber(args->args[0]);
-    code = nn_value_asnumber(args->args[1]);
-    osfn_kill(pid, code);
-    return nn_value_makenull();
+    char indentbuf[16];
+    NNJSONWriter jw;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 1, 3);
+    nn_jsonwriter_init(state, &jw, NULL);
+    if(!nn_jsonwriter_setoptions(state, &jw, args, 1, indentbuf))
+    {
+        nn_jsonwriter_destroy(&jw);
+        return nn_value_makenull();
+    }
+    if(!nn_jsonwriter_writevalue(&jw, args->args[0]))
+    {
+        nn_jsonwriter_destroy(&jw);
+        return nn_exceptions_throw(state, "JSON.stringify: %s", jw.error);
+    }
+    jw.buf[jw.length] = 0;
+    /* the string takes over the buffer */
+    return nn_value_fromobject(nn_string_takebuffer(state, jw.buf, jw.length, jw.capacity));
 }
 
-NNValue nn_objfnjson_stringify(NNState* state, NNArguments* args)
+/*
+* write(file, value, indent, sortkeys) writes $value as JSON to $file, through a buffer of
+* NEON_CONFIG_JSONWRITEBUFSIZE bytes, without building a string first.
+*/
+NNValue nn_objfnjson_write(NNState* state, NNArguments* args)
 {
-    NNValue v;
-    NNPrinter pr;
-    NNObjString* os;
-    v = args->args[0];
-    nn_printer_makestackstring(state, &pr);
-    pr.jsonmode = true;
-    nn_printer_printvalue(&pr, v, true, false);
-    os = nn_printer_takestring(&pr);
-    return nn_value_fromobject(os);
+    bool ok;
+    char indentbuf[16];
+    NNObjFile* file;
+    NNJSONWriter jw;
+    NNArgCheck check;
+    nn_argcheck_init(state, &check, args);
+    NEON_ARGS_CHECKCOUNTRANGE(&check, 2, 4);
+    NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isfile);
+    file = nn_value_asfile(args->args[0]);
+    if(file->isstd)
+    {
+        nn_printer_flush(state->stdoutprinter);
+    }
+    else if(!file->isopen)
+    {
+        nn_fileobject_open(file);
+    }
+    if(file->handle == NULL)
+    {
+        return nn_exceptions_throw(state, "JSON.write: could not write to %s", file->path->sbuf->data);
+    }
+    nn_jsonwriter_init(state, &jw, file->handle);
+    if(!nn_jsonwriter_setoptions(state, &jw, args, 2, indentbuf))
+    {
+        nn_jsonwriter_destroy(&jw);
+        return nn_value_makenull();
+    }
+    ok = nn_jsonwriter_writevalue(&jw, args->args[1]);
+    nn_jsonwriter_flush(&jw);
+    nn_jsonwriter_destroy(&jw);
+    if(!ok)
+    {
+        return nn_exceptions_throw(state, "JSON.write: %s", jw.error);
+    }
+    return nn_value_makebool(true);
 }
 
 
@@ -13973,6 +23016,7 @@ struct ClsListMethods
 
 void nn_state_initbuiltinmethods(NNState* state)
 {
+    int kind;
     NNObjClass* klass;
     {
         klass = state->classprimprocess;
@@ -13984,6 +23028,11 @@ void nn_state_initbuiltinmethods(NNState* state)
         nn_class_setstaticproperty(klass, nn_string_intern(state, "pid"), nn_value_makenumber(state->processinfo->cliprocessid));
         nn_class_defstaticnativemethod(klass, nn_string_intern(state, "kill"), nn_objfnprocess_kill);
         nn_class_defstaticnativemethod(klass, nn_string_intern(state, "exit"), nn_objfnprocess_exit);
+        nn_class_defstaticnativemethod(klass, nn_string_intern(state, "spawn"), nn_objfnprocess_spawn);
+        nn_class_defstaticnativemethod(klass, nn_string_intern(state, "run"), nn_objfnprocess_run);
+        nn_class_defnativemethod(klass, nn_string_intern(state, "wait"), nn_objfnprocess_wait);
+        nn_class_defnativemethod(klass, nn_string_intern(state, "poll"), nn_objfnprocess_poll);
+        nn_class_defnativemethod(klass, nn_string_intern(state, "kill"), nn_objfnprocess_signal);
     }
     {
         static ClsListMethods objectmethods[] =
@@ -14062,6 +23111,9 @@ void nn_state_initbuiltinmethods(NNState* state)
             {"utf8Chars", nn_objfnstring_utf8chars},
             {"utf8Codepoints", nn_objfnstring_utf8codepoints},
             {"utf8Bytes", nn_objfnstring_utf8codepoints},
+            {"utf8Length", nn_objfnstring_utf8length},
+            {"utf8At", nn_objfnstring_utf8at},
+            {"utf8Substring", nn_objfnstring_utf8substring},
             {"match", nn_objfnstring_matchcapture},
             {"matches", nn_objfnstring_matchonly},
             {NULL, NULL},
@@ -14078,6 +23130,7 @@ void nn_state_initbuiltinmethods(NNState* state)
         static ClsListMethods arraymethods[] =
         {
             {"size", nn_objfnarray_length},
+            {"iter", nn_objfniterator_iterthis},
             {"join", nn_objfnarray_join},
             {"append", nn_objfnarray_append},
             {"push", nn_objfnarray_append},
@@ -14089,10 +23142,13 @@ void nn_state_initbuiltinmethods(NNState* state)
             {"insert", nn_objfnarray_insert},
             {"pop", nn_objfnarray_pop},
             {"shift", nn_objfnarray_shift},
+            {"unshift", nn_objfnarray_unshift},
             {"removeAt", nn_objfnarray_removeat},
             {"remove", nn_objfnarray_remove},
+            {"removeAll", nn_objfnarray_removeall},
             {"reverse", nn_objfnarray_reverse},
             {"sort", nn_objfnarray_sort},
+            {"sorted", nn_objfnarray_sorted},
             {"contains", nn_objfnarray_contains},
             {"delete", nn_objfnarray_delete},
             {"first", nn_objfnarray_first},
@@ -14102,6 +23158,10 @@ void nn_state_initbuiltinmethods(NNState* state)
             {"get", nn_objfnarray_get},
             {"compact", nn_objfnarray_compact},
             {"unique", nn_objfnarray_unique},
+            {"difference", nn_objfnarray_difference},
+            {"intersect", nn_objfnarray_intersect},
+            {"groupBy", nn_objfnarray_groupby},
+            {"countBy", nn_objfnarray_countby},
             {"zip", nn_objfnarray_zip},
             {"zipFrom", nn_objfnarray_zipfrom},
             {"toDict", nn_objfnarray_todict},
@@ -14129,6 +23189,9 @@ void nn_state_initbuiltinmethods(NNState* state)
             {"clear", nn_objfndict_clear},
             {"clone", nn_objfndict_clone},
             {"compact", nn_objfndict_compact},
+            #if NEON_CONFIG_BENCHSTATS == 1
+            {"probeStats", nn_objfndict_probestats},
+            #endif
             {"contains", nn_objfndict_contains},
             {"extend", nn_objfndict_extend},
             {"get", nn_objfndict_get},
@@ -14142,6 +23205,7 @@ void nn_state_initbuiltinmethods(NNState* state)
             {"some", nn_objfndict_some},
             {"every", nn_objfndict_every},
             {"reduce", nn_objfndict_reduce},
+            {"iter", nn_objfniterator_iterthis},
             {"@iter", nn_objfndict_iter},
             {"@itern", nn_objfndict_itern},
             {NULL, NULL},
@@ -14175,6 +23239,13 @@ void nn_state_initbuiltinmethods(NNState* state)
             {"mode", nn_objfnfile_mode},
             {"name", nn_objfnfile_name},
             {"readLine", nn_objfnfile_readline},
+            {"mmap", nn_objfnfile_mmap},
+            {"copyTo", nn_objfnfile_copyto},
+            {"appendFrom", nn_objfnfile_appendfrom},
+            {"writeAll", nn_objfnfile_writeall},
+            {"lines", nn_objfnfile_lines},
+            {"@iter", nn_objfnfile_iter},
+            {"@itern", nn_objfnfile_itern},
             {NULL, NULL},
         };
         nn_class_defnativeconstructor(state->classprimfile, nn_objfnfile_constructor);
@@ -14196,6 +23267,7 @@ void nn_state_initbuiltinmethods(NNState* state)
             {"loop", nn_objfnrange_loop},
             {"expand", nn_objfnrange_expand},
             {"toArray", nn_objfnrange_expand},
+            {"iter", nn_objfniterator_iterthis},
             {"@iter", nn_objfnrange_iter},
             {"@itern", nn_objfnrange_itern},
             {NULL, NULL},
@@ -14203,6 +23275,104 @@ void nn_state_initbuiltinmethods(NNState* state)
         nn_class_defnativeconstructor(state->classprimrange, nn_objfnrange_constructor);
         installmethods(state, state->classprimrange, rangemethods);
     }
+    {
+        static ClsListMethods regexmethods[] =
+        {
+            {"test", nn_objfnregex_test},
+            {"match", nn_objfnregex_match},
+            {"findAll", nn_objfnregex_findall},
+            {"replace", nn_objfnregex_replace},
+            {"split", nn_objfnregex_split},
+            {NULL, NULL},
+        };
+        nn_class_defnativeconstructor(state->classprimregex, nn_objfnregex_constructor);
+        nn_class_defcallablefield(state->classprimregex, nn_string_intern(state, "pattern"), nn_objfnregex_pattern);
+        nn_class_defcallablefield(state->classprimregex, nn_string_intern(state, "engine"), nn_objfnregex_engine);
+        installmethods(state, state->classprimregex, regexmethods);
+    }
+    {
+        static ClsListMethods typedarraymethods[] =
+        {
+            {"fill", nn_objfntypedarray_fill},
+            {"copyWithin", nn_objfntypedarray_copywithin},
+            {"subarray", nn_objfntypedarray_subarray},
+            {"slice", nn_objfntypedarray_slice},
+            {"toArray", nn_objfntypedarray_toarray},
+            {"@iter", nn_objfntypedarray_iter},
+            {"@itern", nn_objfntypedarray_itern},
+            {NULL, NULL},
+        };
+        nn_class_defnativeconstructor(state->classprimtypedarray[NEON_TYPEDARRAY_FLOAT64], nn_objfntypedarray_constructorfloat64);
+        nn_class_defnativeconstructor(state->classprimtypedarray[NEON_TYPEDARRAY_INT32], nn_objfntypedarray_constructorint32);
+        nn_class_defnativeconstructor(state->classprimtypedarray[NEON_TYPEDARRAY_UINT32], nn_objfntypedarray_constructoruint32);
+        nn_class_defnativeconstructor(state->classprimtypedarray[NEON_TYPEDARRAY_UINT8], nn_objfntypedarray_constructoruint8);
+        nn_class_defnativeconstructor(state->classprimtypedarray[NEON_TYPEDARRAY_BYTES], nn_objfntypedarray_constructorbytes);
+        for(kind = 0; kind < NEON_TYPEDARRAY_KINDCOUNT; kind++)
+        {
+            nn_class_defcallablefield(state->classprimtypedarray[kind], nn_string_intern(state, "length"), nn_objfntypedarray_length);
+            installmethods(state, state->classprimtypedarray[kind], typedarraymethods);
+        }
+    }
+    {
+        static ClsListMethods bytesmethods[] =
+        {
+            {"toString", nn_objfnbytes_tostring},
+            {"toHex", nn_objfnbytes_tohex},
+            {NULL, NULL},
+        };
+        klass = state->classprimtypedarray[NEON_TYPEDARRAY_BYTES];
+        for(kind = 0; g_bytesaccessors[kind].readname != NULL; kind++)
+        {
+            nn_class_defnativemethodptr(klass, nn_string_intern(state, g_bytesaccessors[kind].readname), nn_objfnbytes_readnumber, &g_bytesaccessors[kind]);
+            nn_class_defnativemethodptr(klass, nn_string_intern(state, g_bytesaccessors[kind].writename), nn_objfnbytes_writenumber, &g_bytesaccessors[kind]);
+        }
+        installmethods(state, klass, bytesmethods);
+    }
+    {
+        static ClsListMethods setmethods[] =
+        {
+            {"add", nn_objfnset_add},
+            {"remove", nn_objfnset_remove},
+            {"has", nn_objfnset_has},
+            {"isEmpty", nn_objfnset_isempty},
+            {"clear", nn_objfnset_clear},
+            {"clone", nn_objfnset_clone},
+            {"toArray", nn_objfnset_toarray},
+            {"union", nn_objfnset_union},
+            {"intersection", nn_objfnset_intersection},
+            {"difference", nn_objfnset_difference},
+            {"isSubset", nn_objfnset_issubset},
+            {"each", nn_objfnset_each},
+            {"@iter", nn_objfnset_iter},
+            {"@itern", nn_objfnset_itern},
+            {NULL, NULL},
+        };
+        nn_class_defnativeconstructor(state->classprimset, nn_objfnset_constructor);
+        nn_class_defcallablefield(state->classprimset, nn_string_intern(state, "length"), nn_objfnset_length);
+        installmethods(state, state->classprimset, setmethods);
+    }
+    {
+        static ClsListMethods iteratormethods[] =
+        {
+            {"map", nn_objfniterator_map},
+            {"filter", nn_objfniterator_filter},
+            {"take", nn_objfniterator_take},
+            {"skip", nn_objfniterator_skip},
+            {"zip", nn_objfniterator_zip},
+            {"enumerate", nn_objfniterator_enumerate},
+            {"chunk", nn_objfniterator_chunk},
+            {"reduce", nn_objfniterator_reduce},
+            {"collect", nn_objfniterator_collect},
+            {"toArray", nn_objfniterator_collect},
+            {"count", nn_objfniterator_count},
+            {"each", nn_objfniterator_each},
+            {"@iter", nn_objfniterator_iter},
+            {"@itern", nn_objfniterator_itern},
+            {NULL, NULL},
+        };
+        nn_class_defnativeconstructor(state->classprimiterator, nn_objfniterator_constructor);
+        installmethods(state, state->classprimiterator, iteratormethods);
+    }
     {
         klass = nn_util_makeclass(state, "Math", state->classprimobject);
         nn_class_defstaticnativemethod(klass, nn_string_intern(state, "abs"), nn_objfnmath_abs);
@@ -14215,6 +23385,10 @@ void nn_state_initbuiltinmethods(NNState* state)
     {
         klass = nn_util_makeclass(state, "JSON", state->classprimobject);
         nn_class_defstaticnativemethod(klass, nn_string_intern(state, "stringify"), nn_objfnjson_stringify);
+        nn_class_defstaticnativemethod(klass, nn_string_intern(state, "write"), nn_objfnjson_write);
+        nn_class_defstaticnativemethod(klass, nn_string_intern(state, "parse"), nn_objfnjson_parse);
+        nn_class_defstaticnativemethod(klass, nn_string_intern(state, "events"), nn_objfnjson_events);
+        nn_class_defstaticnativemethod(klass, nn_string_intern(state, "lines"), nn_objfnjson_lines);
     }
 }
 
@@ -14237,7 +23411,7 @@ NNValue nn_nativefn_microtime(NNState* state, NNArguments* args)
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNT(&check, 0);
     osfn_gettimeofday(&tv, NULL);
-    return nn_value_makenumber((1000000 * (double)tv.tv_sec) + ((double)tv.tv_usec / 10));
+    return nn_value_makenumber((1000000 * (double)tv.tv_sec) + ((double)tv.tv_usec));
 }
 
 NNValue nn_nativefn_id(NNState* state, NNArguments* args)
@@ -14250,8 +23424,10 @@ NNValue nn_nativefn_id(NNState* state, NNArguments* args)
     return nn_value_makenumber(*(long*)&val);
 }
 
+/* int(value) truncates a number, or a string holding one, towards zero. */
 NNValue nn_nativefn_int(NNState* state, NNArguments* args)
 {
+    NNObjString* os;
     NNArgCheck check;
     nn_argcheck_init(state, &check, args);
     NEON_ARGS_CHECKCOUNTRANGE(&check, 0, 1);
@@ -14259,8 +23435,13 @@ NNValue nn_nativefn_int(NNState* state, NNArguments* args)
     {
         return nn_value_makenumber(0);
     }
+    if(nn_value_isstring(args->args[0]))
+    {
+        os = nn_value_asstring(args->args[0]);
+        return nn_value_makenumber(trunc(nn_util_strtod(os->sbuf->data, os->sbuf->length, NULL)));
+    }
     NEON_ARGS_CHECKTYPE(&check, 0, nn_value_isnumber);
-    return nn_value_makenumber((double)((int)nn_value_asnumber(args->args[0])));
+    return nn_value_makenumber(trunc(nn_value_asnumber(args->args[0])));
 }
 
 NNValue nn_nativefn_chr(NNState* state, NNArguments* args)
@@ -14708,7 +23889,7 @@ bool nn_exceptions_propagate(NNState* state)
     NNObjInstance* exception;
     NNProperty* field;
     exception = nn_value_asinstance(nn_vm_stackpeek(state, 0));
-    while(state->vmstate.framecount > 0)
+    while(state->vmstate.framecount > state->vmstate.nestbase)
     {
         state->vmstate.currentframe = &state->vmstate.framevalues[state->vmstate.framecount - 1];
         for(i = state->vmstate.currentframe->handlercount; i > 0; i--)
@@ -14730,10 +23911,20 @@ bool nn_exceptions_propagate(NNState* state)
         }
         state->vmstate.framecount--;
     }
+    if(state->vmstate.framecount > 0)
+    {
+        /*
+        * not handled by the callback that a native called into; the exception stays on the stack,
+        * and nn_nestcall_callfunction() hands it on once the native has been told.
+        */
+        state->vmstate.currentframe = &state->vmstate.framevalues[state->vmstate.framecount - 1];
+        return false;
+    }
     colred = nn_util_color(NEON_COLOR_RED);
     colreset = nn_util_color(NEON_COLOR_RESET);
     colyellow = nn_util_color(NEON_COLOR_YELLOW);
-    /* at this point, the exception is unhandled; so, print it out. */
+    /* at this point, the exception is unhandled; so, print it out, after whatever was printed so far. */
+    nn_printer_flush(state->stdoutprinter);
     fprintf(stderr, "%sunhandled %s%s", colred, exception->klass->name->sbuf->data, colreset);
     srcfile = "none";
     srcline = 0;
@@ -14968,6 +24159,7 @@ void nn_vm_raisefatalerror(NNState* state, const char* format, ...)
     NNCallFrame* frame;
     NNObjFuncScript* function;
     /* flush out anything on stdout first */
+    nn_printer_flush(state->stdoutprinter);
     fflush(stdout);
     frame = &state->vmstate.framevalues[state->vmstate.framecount - 1];
     function = frame->closure->scriptfunc;
@@ -15165,6 +24357,7 @@ bool nn_vm_resizeframes(NNState* state, size_t needed)
 void nn_state_resetvmstate(NNState* state)
 {
     state->vmstate.framecount = 0;
+    state->vmstate.nestbase = 0;
     state->vmstate.stackidx = 0;
     state->vmstate.openupvalues = NULL;
 }
@@ -15276,6 +24469,7 @@ NNState* nn_state_makewithuserptr(void* userptr)
     }
     memset(state, 0, sizeof(NNState));
     state->memuserptr = userptr;
+    state->hashseed = nn_util_makehashseed(state);
     state->exceptions.stdexception = NULL;
     state->rootphysfile = NULL;
     state->processinfo = NULL;
@@ -15306,6 +24500,7 @@ NNState* nn_state_makewithuserptr(void* userptr)
     {
         state->stdoutprinter = nn_printer_makeio(state, stdout, false);
         state->stdoutprinter->shouldflush = true;
+        nn_printer_setbuffer(state->stdoutprinter, NEON_CONFIG_PRINTBUFSIZE, osfn_isatty(fileno(stdout)));
         state->stderrprinter = nn_printer_makeio(state, stderr, false);
         state->debugwriter = nn_printer_makeio(state, stderr, false);
         state->debugwriter->shortenvalues = true;
@@ -15336,6 +24531,13 @@ NNState* nn_state_makewithuserptr(void* userptr)
         state->classprimdict = nn_util_makeclass(state, "Dict", state->classprimobject);
         state->classprimfile = nn_util_makeclass(state, "File", state->classprimobject);
         state->classprimrange = nn_util_makeclass(state, "Range", state->classprimobject);
+        state->classprimregex = nn_util_makeclass(state, "Regex", state->classprimobject);
+        for(i = 0; i < NEON_TYPEDARRAY_KINDCOUNT; i++)
+        {
+            state->classprimtypedarray[i] = nn_util_makeclass(state, nn_typedarray_kindname(i), state->classprimobject);
+        }
+        state->classprimset = nn_util_makeclass(state, "Set", state->classprimobject);
+        state->classprimiterator = nn_util_makeclass(state, "Iterator", state->classprimobject);
         state->classprimcallable = nn_util_makeclass(state, "Function", state->classprimobject);
         state->classprimprocess = nn_util_makeclass(state, "Process", state->classprimobject);
     }
@@ -15460,9 +24662,11 @@ bool nn_vm_callclosure(NNState* state, NNObjFuncClosure* closure, NNValue thisva
 
 bool nn_vm_callnative(NNState* state, NNObjFuncNative* native, NNValue thisval, int argcount)
 {
+    size_t framecount;
     size_t spos;
     NNValue r;
     NNValue* vargs;
+    NNInstruction* inscode;
     NNArguments fnargs;
     NEON_APIDEBUG(state, "thisval.type=%s, argcount=%d", nn_value_typename(thisval), argcount);
     spos = state->vmstate.stackidx + (-argcount);
@@ -15472,7 +24676,24 @@ bool nn_vm_callnative(NNState* state, NNObjFuncNative* native, NNValue thisval,
     fnargs.thisval = thisval;
     fnargs.userptr = native->userptr;
     fnargs.name = native->name;
+    framecount = state->vmstate.framecount;
+    inscode = state->vmstate.currentframe->inscode;
     r = native->natfunc(state, &fnargs);
+    if((state->vmstate.framecount != framecount) || (state->vmstate.currentframe->inscode != inscode))
+    {
+        /*
+        * the native threw an exception, and execution now continues in its handler, which
+        * expects the exception on top of the stack. it takes the place of the return value.
+        */
+        state->vmstate.stackvalues[spos - 1] = state->vmstate.stackvalues[state->vmstate.stackidx - 1];
+        state->vmstate.stackidx = spos;
+        /* whatever the native protected was dropped from the stack along with everything else. */
+        if(framecount > 0)
+        {
+            state->vmstate.framevalues[framecount - 1].gcprotcount = 0;
+        }
+        return true;
+    }
     {
         state->vmstate.stackvalues[spos - 1] = r;
         state->vmstate.stackidx -= argcount;
@@ -15623,6 +24844,14 @@ NNObjClass* nn_value_getclassfor(NNState* state, NNValue receiver)
                 return state->classprimstring;
             case NEON_OBJTYPE_RANGE:
                 return state->classprimrange;
+            case NEON_OBJTYPE_REGEX:
+                return state->classprimregex;
+            case NEON_OBJTYPE_TYPEDARRAY:
+                return state->classprimtypedarray[nn_value_astypedarray(receiver)->kind];
+            case NEON_OBJTYPE_SET:
+                return state->classprimset;
+            case NEON_OBJTYPE_ITERATOR:
+                return state->classprimiterator;
             case NEON_OBJTYPE_ARRAY:
                 return state->classprimarray;
             case NEON_OBJTYPE_DICT:
@@ -15755,7 +24984,8 @@ NEON_FORCEINLINE bool nn_vmutil_invokemethodfromclass(NNState* state, NNObjClass
         {
             return nn_exceptions_throw(state, "cannot call private method '%s' from instance of %s", name->sbuf->data, klass->name->sbuf->data);
         }
-        return nn_vm_callvaluewithobject(state, field->value, nn_value_fromobject(klass), argcount);
+        /* natives find the instance in thisval, as closures do in their first slot. */
+        return nn_vm_callvaluewithobject(state, field->value, nn_vmbits_stackpeek(state, argcount), argcount);
     }
     return nn_exceptions_throw(state, "undefined method '%s' in %s", name->sbuf->data, klass->name->sbuf->data);
 }
@@ -15897,7 +25127,7 @@ NEON_FORCEINLINE bool nn_vmutil_invokemethodnormal(NNState* state, NNObjString*
                     /* NEW in v0.0.84, dictionaries can declare extra methods as part of their entries. */
                     else
                     {
-                        field = nn_tableval_getfieldbyostr(nn_value_asdict(receiver)->htab, name);
+                        field = nn_dict_getentry(nn_value_asdict(receiver), nn_value_fromobject(name));
                         if(field != NULL)
                         {
                             if(nn_value_iscallable(field->value))
@@ -15990,107 +25220,316 @@ NEON_FORCEINLINE void nn_vmutil_upvaluesclose(NNState* state, const NNValue* las
     }
 }
 
-NEON_FORCEINLINE void nn_vmutil_definemethod(NNState* state, NNObjString* name)
+NEON_FORCEINLINE void nn_vmutil_definemethod(NNState* state, NNObjString* name)
+{
+    NNValue method;
+    NNObjClass* klass;
+    method = nn_vmbits_stackpeek(state, 0);
+    klass = nn_value_asclass(nn_vmbits_stackpeek(state, 1));
+    nn_tableval_set(klass->instmethods, nn_value_fromobject(name), method);
+    if(nn_value_getmethodtype(method) == NEON_FUNCTYPE_INITIALIZER)
+    {
+        klass->constructor = method;
+    }
+    nn_vmbits_stackpop(state);
+}
+
+NEON_FORCEINLINE void nn_vmutil_defineproperty(NNState* state, NNObjString* name, bool isstatic)
+{
+    NNValue property;
+    NNObjClass* klass;
+    property = nn_vmbits_stackpeek(state, 0);
+    klass = nn_value_asclass(nn_vmbits_stackpeek(state, 1));
+    if(!isstatic)
+    {
+        nn_class_defproperty(klass, name, property);
+    }
+    else
+    {
+        nn_class_setstaticproperty(klass, name, property);
+    }
+    nn_vmbits_stackpop(state);
+}
+
+bool nn_value_isfalse(NNValue value)
+{
+    if(nn_value_isbool(value))
+    {
+        return nn_value_isbool(value) && !nn_value_asbool(value);
+    }
+    if(nn_value_isnull(value) || nn_value_isnull(value))
+    {
+        return true;
+    }
+    /* -1 is the number equivalent of false */
+    if(nn_value_isnumber(value))
+    {
+        return nn_value_asnumber(value) < 0;
+    }
+    /* Non-empty strings are true, empty strings are false.*/
+    if(nn_value_isstring(value))
+    {
+        return nn_value_asstring(value)->sbuf->length < 1;
+    }
+    /* Non-empty lists are true, empty lists are false.*/
+    if(nn_value_isarray(value))
+    {
+        return nn_value_asarray(value)->varray->listcount == 0;
+    }
+    /* Non-empty dicts are true, empty dicts are false. */
+    if(nn_value_isdict(value))
+    {
+        return nn_value_asdict(value)->count == 0;
+    }
+    /*
+    // All classes are true
+    // All closures are true
+    // All bound methods are true
+    // All functions are in themselves true if you do not account for what they
+    // return.
+    */
+    return false;
+}
+
+bool nn_util_isinstanceof(NNObjClass* klass1, NNObjClass* expected)
+{
+    size_t klen;
+    size_t elen;
+    const char* kname;
+    const char* ename;
+    while(klass1 != NULL)
+    {
+        elen = expected->name->sbuf->length;
+        klen = klass1->name->sbuf->length;
+        ename = expected->name->sbuf->data;
+        kname = klass1->name->sbuf->data;
+        if(elen == klen && memcmp(kname, ename, klen) == 0)
+        {
+            return true;
+        }
+        klass1 = klass1->superclass;
+    }
+    return false;
+}
+
+NEON_FORCEINLINE int64_t nn_dict_getindex(NNObjDict* dict, size_t slot)
+{
+    if(dict->indexcapacity <= NEON_DICT_MAXINDEX8)
+    {
+        return ((int8_t*)dict->indices)[slot];
+    }
+    else if(dict->indexcapacity <= NEON_DICT_MAXINDEX16)
+    {
+        return ((int16_t*)dict->indices)[slot];
+    }
+    return ((int32_t*)dict->indices)[slot];
+}
+
+NEON_FORCEINLINE void nn_dict_setindex(NNObjDict* dict, size_t slot, int64_t ix)
+{
+    if(dict->indexcapacity <= NEON_DICT_MAXINDEX8)
+    {
+        ((int8_t*)dict->indices)[slot] = (int8_t)ix;
+    }
+    else if(dict->indexcapacity <= NEON_DICT_MAXINDEX16)
+    {
+        ((int16_t*)dict->indices)[slot] = (int16_t)ix;
+    }
+    else
+    {
+        ((int32_t*)dict->indices)[slot] = (int32_t)ix;
+    }
+}
+
+NEON_FORCEINLINE size_t nn_dict_indexbytes(size_t indexcapacity)
+{
+    if(indexcapacity <= NEON_DICT_MAXINDEX8)
+    {
+        return indexcapacity * sizeof(int8_t);
+    }
+    else if(indexcapacity <= NEON_DICT_MAXINDEX16)
+    {
+        return indexcapacity * sizeof(int16_t);
+    }
+    return indexcapacity * sizeof(int32_t);
+}
+
+NEON_FORCEINLINE bool nn_dict_keyequal(NNState* state, NNDictEntry* entry, NNValue key, uint32_t hash)
+{
+    NNObjString* stra;
+    NNObjString* strb;
+    if(entry->hash != hash)
+    {
+        return false;
+    }
+    if(nn_value_isstring(key))
+    {
+        if(!nn_value_isstring(entry->key))
+        {
+            return false;
+        }
+        stra = nn_value_asstring(key);
+        strb = nn_value_asstring(entry->key);
+        if(stra == strb)
+        {
+            return true;
+        }
+        return (stra->sbuf->length == strb->sbuf->length) && (memcmp(stra->sbuf->data, strb->sbuf->data, stra->sbuf->length) == 0);
+    }
+    if(nn_value_isnull(key) || nn_value_isnull(entry->key))
+    {
+        return nn_value_isnull(key) && nn_value_isnull(entry->key);
+    }
+    return nn_value_compare(state, key, entry->key);
+}
+
+/*
+* returns the position of $key in dict->entries, or -1.
+* if $slotdest is not NULL, it receives the slot of dict->indices that refers to the entry.
+*/
+int64_t nn_dict_findentry(NNObjDict* dict, NNValue key, uint32_t hash, size_t* slotdest)
+{
+    size_t slot;
+    size_t mask;
+    int64_t ix;
+    NNState* state;
+    if(dict->count == 0)
+    {
+        return -1;
+    }
+    state = ((NNObject*)dict)->pstate;
+    mask = dict->indexcapacity - 1;
+    slot = hash & mask;
+    while(true)
+    {
+        ix = nn_dict_getindex(dict, slot);
+        if(ix == NEON_DICT_IXEMPTY)
+        {
+            return -1;
+        }
+        if((ix >= 0) && nn_dict_keyequal(state, &dict->entries[ix], key, hash))
+        {
+            if(slotdest != NULL)
+            {
+                *slotdest = slot;
+            }
+            return ix;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+void nn_dict_insertindex(NNObjDict* dict, uint32_t hash, size_t ix)
 {
-    NNValue method;
-    NNObjClass* klass;
-    method = nn_vmbits_stackpeek(state, 0);
-    klass = nn_value_asclass(nn_vmbits_stackpeek(state, 1));
-    nn_tableval_set(klass->instmethods, nn_value_fromobject(name), method);
-    if(nn_value_getmethodtype(method) == NEON_FUNCTYPE_INITIALIZER)
+    size_t slot;
+    size_t mask;
+    mask = dict->indexcapacity - 1;
+    slot = hash & mask;
+    /* removed entries leave a dummy slot behind, which must not end a probe sequence, so only empty slots are reused. */
+    while(nn_dict_getindex(dict, slot) != NEON_DICT_IXEMPTY)
     {
-        klass->constructor = method;
+        slot = (slot + 1) & mask;
     }
-    nn_vmbits_stackpop(state);
+    nn_dict_setindex(dict, slot, ix);
 }
 
-NEON_FORCEINLINE void nn_vmutil_defineproperty(NNState* state, NNObjString* name, bool isstatic)
+#if NEON_CONFIG_BENCHSTATS == 1
+/* returns how many slots past its home slot the index of entry $ix sits. */
+size_t nn_dict_probelength(NNObjDict* dict, size_t ix)
 {
-    NNValue property;
-    NNObjClass* klass;
-    property = nn_vmbits_stackpeek(state, 0);
-    klass = nn_value_asclass(nn_vmbits_stackpeek(state, 1));
-    if(!isstatic)
-    {
-        nn_class_defproperty(klass, name, property);
-    }
-    else
+    size_t slot;
+    size_t mask;
+    size_t length;
+    mask = dict->indexcapacity - 1;
+    slot = dict->entries[ix].hash & mask;
+    length = 0;
+    while(nn_dict_getindex(dict, slot) != (int64_t)ix)
     {
-        nn_class_setstaticproperty(klass, name, property);
+        slot = (slot + 1) & mask;
+        length++;
     }
-    nn_vmbits_stackpop(state);
+    return length;
 }
+#endif
 
-bool nn_value_isfalse(NNValue value)
+/*
+* resizes the dictionary such that it can hold at least $mincount entries,
+* dropping the slots of removed entries in the process.
+*/
+void nn_dict_rebuild(NNObjDict* dict, size_t mincount)
 {
-    if(nn_value_isbool(value))
-    {
-        return nn_value_isbool(value) && !nn_value_asbool(value);
-    }
-    if(nn_value_isnull(value) || nn_value_isnull(value))
+    size_t i;
+    size_t ncap;
+    size_t ncount;
+    NNDictEntry* nentries;
+    ncap = NEON_CONFIG_DICTMININDEX;
+    while(NEON_DICT_USABLE(ncap) < mincount)
     {
-        return true;
+        ncap *= 2;
     }
-    /* -1 is the number equivalent of false */
-    if(nn_value_isnumber(value))
+    nentries = (NNDictEntry*)nn_memory_malloc(sizeof(NNDictEntry) * NEON_DICT_USABLE(ncap));
+    ncount = 0;
+    for(i = 0; i < dict->entrycount; i++)
     {
-        return nn_value_asnumber(value) < 0;
+        if(dict->entries[i].live)
+        {
+            nentries[ncount] = dict->entries[i];
+            ncount++;
+        }
     }
-    /* Non-empty strings are true, empty strings are false.*/
-    if(nn_value_isstring(value))
+    nn_memory_free(dict->entries);
+    nn_memory_free(dict->indices);
+    dict->entries = nentries;
+    dict->entrycount = ncount;
+    dict->entrycapacity = NEON_DICT_USABLE(ncap);
+    dict->indexcapacity = ncap;
+    dict->indices = nn_memory_malloc(nn_dict_indexbytes(ncap));
+    /* every width stores NEON_DICT_IXEMPTY as all bits set. */
+    memset(dict->indices, 0xFF, nn_dict_indexbytes(ncap));
+    for(i = 0; i < ncount; i++)
     {
-        return nn_value_asstring(value)->sbuf->length < 1;
+        nn_dict_insertindex(dict, nentries[i].hash, i);
     }
-    /* Non-empty lists are true, empty lists are false.*/
-    if(nn_value_isarray(value))
+}
+
+bool nn_dict_setentrywithtype(NNObjDict* dict, NNValue key, NNValue value, NNFieldType ftyp)
+{
+    int64_t ix;
+    uint32_t hash;
+    NNState* state;
+    NNDictEntry* entry;
+    state = ((NNObject*)dict)->pstate;
+    if(nn_value_isstring(key))
     {
-        return nn_value_asarray(value)->varray->listcount == 0;
+        /* a key may outlive its source string by far, so it should not keep it alive. */
+        nn_string_materialize(state, nn_value_asstring(key));
     }
-    /* Non-empty dicts are true, empty dicts are false. */
-    if(nn_value_isdict(value))
+    hash = nn_value_hashvalue(key);
+    ix = nn_dict_findentry(dict, key, hash, NULL);
+    if(ix >= 0)
     {
-        return nn_value_asdict(value)->names->listcount == 0;
+        dict->entries[ix].value = nn_property_make(state, value, ftyp);
+        return false;
     }
-    /*
-    // All classes are true
-    // All closures are true
-    // All bound methods are true
-    // All functions are in themselves true if you do not account for what they
-    // return.
-    */
-    return false;
-}
-
-bool nn_util_isinstanceof(NNObjClass* klass1, NNObjClass* expected)
-{
-    size_t klen;
-    size_t elen;
-    const char* kname;
-    const char* ename;
-    while(klass1 != NULL)
+    if(dict->entrycount >= dict->entrycapacity)
     {
-        elen = expected->name->sbuf->length;
-        klen = klass1->name->sbuf->length;
-        ename = expected->name->sbuf->data;
-        kname = klass1->name->sbuf->data;
-        if(elen == klen && memcmp(kname, ename, klen) == 0)
-        {
-            return true;
-        }
-        klass1 = klass1->superclass;
+        nn_dict_rebuild(dict, (dict->count * 2) + 1);
     }
-    return false;
+    entry = &dict->entries[dict->entrycount];
+    entry->live = true;
+    entry->hash = hash;
+    entry->key = key;
+    entry->value = nn_property_make(state, value, ftyp);
+    nn_dict_insertindex(dict, hash, dict->entrycount);
+    dict->entrycount++;
+    dict->count++;
+    return true;
 }
 
 bool nn_dict_setentry(NNObjDict* dict, NNValue key, NNValue value)
 {
-    NNValue tempvalue;
-    if(!nn_tableval_get(dict->htab, key, &tempvalue))
-    {
-        /* add key if it doesn't exist. */
-        nn_vallist_push(dict->names, key);
-    }
-    return nn_tableval_set(dict->htab, key, value);
+    return nn_dict_setentrywithtype(dict, key, value, NEON_PROPTYPE_VALUE);
 }
 
 void nn_dict_addentry(NNObjDict* dict, NNValue key, NNValue value)
@@ -16109,32 +25548,135 @@ void nn_dict_addentrycstr(NNObjDict* dict, const char* ckey, NNValue value)
 
 NNProperty* nn_dict_getentry(NNObjDict* dict, NNValue key)
 {
-    return nn_tableval_getfield(dict->htab, key);
+    int64_t ix;
+    ix = nn_dict_findentry(dict, key, nn_value_hashvalue(key), NULL);
+    if(ix < 0)
+    {
+        return NULL;
+    }
+    return &dict->entries[ix].value;
+}
+
+bool nn_dict_get(NNObjDict* dict, NNValue key, NNValue* dest)
+{
+    NNProperty* field;
+    field = nn_dict_getentry(dict, key);
+    if(field == NULL)
+    {
+        return false;
+    }
+    *dest = field->value;
+    return true;
 }
 
+/*
+* removal only marks the entry and its index slot as dead, so it does not move
+* any other entry; the space is reclaimed by the next nn_dict_rebuild.
+*/
+bool nn_dict_removeentry(NNObjDict* dict, NNValue key, NNValue* dest)
+{
+    size_t slot;
+    int64_t ix;
+    NNDictEntry* entry;
+    ix = nn_dict_findentry(dict, key, nn_value_hashvalue(key), &slot);
+    if(ix < 0)
+    {
+        return false;
+    }
+    entry = &dict->entries[ix];
+    if(dest != NULL)
+    {
+        *dest = entry->value.value;
+    }
+    nn_dict_setindex(dict, slot, NEON_DICT_IXDUMMY);
+    entry->live = false;
+    entry->key = nn_value_makenull();
+    entry->value.value = nn_value_makenull();
+    dict->count--;
+    if(dict->count == 0)
+    {
+        /* nothing left to keep in order, so start over without reallocating. */
+        dict->entrycount = 0;
+        memset(dict->indices, 0xFF, nn_dict_indexbytes(dict->indexcapacity));
+    }
+    return true;
+}
 
-NNObjDict* nn_dict_copy(NNObjDict* dict)
+/* returns the position of the first live entry at or after $from, or -1. */
+int64_t nn_dict_nextentry(NNObjDict* dict, size_t from)
 {
+    size_t i;
+    for(i = from; i < dict->entrycount; i++)
+    {
+        if(dict->entries[i].live)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
 
+NNValue nn_dict_findkey(NNObjDict* dict, NNValue value)
+{
     size_t i;
-    size_t dsz;
-    NNValue key;
-    NNProperty* field;
+    NNDictEntry* entry;
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        entry = &dict->entries[i];
+        if(entry->live && nn_value_compare(((NNObject*)dict)->pstate, entry->value.value, value))
+        {
+            return entry->key;
+        }
+    }
+    return nn_value_makenull();
+}
+
+void nn_dict_clear(NNObjDict* dict)
+{
+    nn_memory_free(dict->entries);
+    nn_memory_free(dict->indices);
+    dict->entries = NULL;
+    dict->indices = NULL;
+    dict->count = 0;
+    dict->entrycount = 0;
+    dict->entrycapacity = 0;
+    dict->indexcapacity = 0;
+}
+
+void nn_dict_mark(NNState* state, NNObjDict* dict)
+{
+    size_t i;
+    NNDictEntry* entry;
+    for(i = 0; i < dict->entrycount; i++)
+    {
+        entry = &dict->entries[i];
+        if(entry->live)
+        {
+            nn_gcmem_markvalue(state, entry->key);
+            nn_gcmem_markvalue(state, entry->value.value);
+        }
+    }
+}
+
+NNObjDict* nn_dict_copy(NNObjDict* dict)
+{
     NNObjDict *ndict;
     NNState* state;
     state = ((NNObject*)dict)->pstate;    
     ndict = nn_object_makedict(state);
-    // @TODO: Figure out how to handle dictionary values correctly
-    // remember that copying keys is redundant and unnecessary
-    dsz = dict->names->listcount;
-    for(i = 0; i < dsz; i++)
-    {
-        key = dict->names->listitems[i];
-        field = nn_tableval_getfield(dict->htab, dict->names->listitems[i]);
-        nn_vallist_push(ndict->names, key);
-        nn_tableval_setwithtype(ndict->htab, key, field->value, field->type, nn_value_isstring(key));
-        
-    }
+    if(dict->count == 0)
+    {
+        return ndict;
+    }
+    /* both tables are laid out identically, so they can be copied as they are. */
+    ndict->entries = (NNDictEntry*)nn_memory_malloc(sizeof(NNDictEntry) * dict->entrycapacity);
+    memcpy(ndict->entries, dict->entries, sizeof(NNDictEntry) * dict->entrycount);
+    ndict->indices = nn_memory_malloc(nn_dict_indexbytes(dict->indexcapacity));
+    memcpy(ndict->indices, dict->indices, nn_dict_indexbytes(dict->indexcapacity));
+    ndict->count = dict->count;
+    ndict->entrycount = dict->entrycount;
+    ndict->entrycapacity = dict->entrycapacity;
+    ndict->indexcapacity = dict->indexcapacity;
     return ndict;
 }
 
@@ -16267,6 +25809,7 @@ NEON_FORCEINLINE bool nn_vmutil_dogetrangedindexofstring(NNState* state, NNObjSt
     int idxlower;
     NNValue valupper;
     NNValue vallower;
+    NNObjString* slice;
     valupper = nn_vmbits_stackpeek(state, 0);
     vallower = nn_vmbits_stackpeek(state, 1);
     if(!(nn_value_isnull(vallower) || nn_value_isnumber(vallower)) || !(nn_value_isnumber(valupper) || nn_value_isnull(valupper)))
@@ -16309,12 +25852,18 @@ NEON_FORCEINLINE bool nn_vmutil_dogetrangedindexofstring(NNState* state, NNObjSt
     }
     start = idxlower;
     end = idxupper;
+    if(end < start)
+    {
+        end = start;
+    }
+    /* make the slice before popping, since string must stay reachable until then. */
+    slice = nn_string_makeslice(state, string, start, end - start);
     if(!willassign)
     {
         /* +1 for the string itself */
         nn_vmbits_stackpopn(state, 3);
     }
-    nn_vmbits_stackpush(state, nn_value_fromobject(nn_string_copylen(state, string->sbuf->data + start, end - start)));
+    nn_vmbits_stackpush(state, nn_value_fromobject(slice));
     return true;
 }
 
@@ -16504,6 +26053,35 @@ NEON_FORCEINLINE bool nn_vmutil_doindexgetarray(NNState* state, NNObjArray* list
     return true;
 }
 
+NEON_FORCEINLINE bool nn_vmutil_doindexgettypedarray(NNState* state, NNObjTypedArray* ta, bool willassign)
+{
+    long index;
+    NNValue finalval;
+    NNValue vindex;
+    vindex = nn_vmbits_stackpeek(state, 0);
+    if(nn_util_unlikely(!nn_value_isnumber(vindex)))
+    {
+        nn_vmbits_stackpop(state);
+        return nn_exceptions_throw(state, "typed arrays are numerically indexed");
+    }
+    index = nn_value_asnumber(vindex);
+    if(nn_util_unlikely(index < 0))
+    {
+        index = ta->length + index;
+    }
+    finalval = nn_value_makenull();
+    if((index < (long)ta->length) && (index >= 0))
+    {
+        finalval = nn_value_makenumber(nn_typedarray_get(ta, index));
+    }
+    if(!willassign)
+    {
+        nn_vmbits_stackpopn(state, 2);
+    }
+    nn_vmbits_stackpush(state, finalval);
+    return true;
+}
+
 NEON_FORCEINLINE bool nn_vmdo_indexget(NNState* state)
 {
     bool isgotten;
@@ -16532,6 +26110,14 @@ NEON_FORCEINLINE bool nn_vmdo_indexget(NNState* state)
                 }
                 break;
             }
+            case NEON_OBJTYPE_TYPEDARRAY:
+            {
+                if(!nn_vmutil_doindexgettypedarray(state, nn_value_astypedarray(peeked), willassign))
+                {
+                    return false;
+                }
+                break;
+            }
             case NEON_OBJTYPE_DICT:
             {
                 if(!nn_vmutil_doindexgetdict(state, nn_value_asdict(peeked), willassign))
@@ -16615,9 +26201,19 @@ NEON_FORCEINLINE bool nn_vmutil_doindexsetarray(NNState* state, NNObjArray* list
     {
         rawpos = list->varray->listcount + rawpos;
     }
-    if(position < ocap && position > -(ocap))
+    if(rawpos >= 0)
+    {
+        /* negative indices count from the end. */
+        position = rawpos;
+    }
+    if(position >= 0 && position < ocap)
     {
         list->varray->listitems[position] = value;
+        if(position > ocnt)
+        {
+            /* the slots in between become visible, and they hold whatever was there. */
+            list->varray->listkind = NEON_ELEMKIND_GENERIC;
+        }
         if(position >= ocnt)
         {
             list->varray->listcount++;
@@ -16651,6 +26247,7 @@ NEON_FORCEINLINE bool nn_vmutil_doindexsetarray(NNState* state, NNObjArray* list
         fprintf(stderr, "setting value at position %ld (array count: %ld)\n", (long)position, (long)list->varray->listcount);
     }
     list->varray->listitems[position] = value;
+    nn_vallist_notekind(list->varray, value);
     /* pop the value, index and list out */
     nn_vmbits_stackpopn(state, 3);
     /*
@@ -16682,6 +26279,8 @@ NEON_FORCEINLINE bool nn_vmutil_dosetindexstring(NNState* state, NNObjString* os
     }
     iv = nn_value_asnumber(value);
     rawpos = nn_value_asnumber(index);
+    nn_string_makewritable(state, os);
+    nn_string_dropcache(os);
     oslen = os->sbuf->length;
     position = rawpos;
     if(rawpos < 0)
@@ -16709,6 +26308,36 @@ NEON_FORCEINLINE bool nn_vmutil_dosetindexstring(NNState* state, NNObjString* os
     return true;
 }
 
+NEON_FORCEINLINE bool nn_vmutil_dosetindextypedarray(NNState* state, NNObjTypedArray* ta, NNValue index, NNValue value)
+{
+    long position;
+    if(nn_util_unlikely(!nn_value_isnumber(index)))
+    {
+        nn_vmbits_stackpopn(state, 3);
+        return nn_exceptions_throw(state, "typed arrays are numerically indexed");
+    }
+    if(nn_util_unlikely(!nn_value_isnumber(value)))
+    {
+        nn_vmbits_stackpopn(state, 3);
+        return nn_exceptions_throw(state, "typed arrays can only hold numbers, not %s", nn_value_typename(value));
+    }
+    position = nn_value_asnumber(index);
+    if(position < 0)
+    {
+        position = ta->length + position;
+    }
+    if(nn_util_unlikely((position < 0) || (position >= (long)ta->length)))
+    {
+        nn_vmbits_stackpopn(state, 3);
+        return nn_exceptions_throw(state, "index %ld out of range of %s of length %ld", (long)nn_value_asnumber(index), nn_typedarray_kindname(ta->kind), (long)ta->length);
+    }
+    nn_typedarray_set(ta, position, nn_value_asnumber(value));
+    /* pop the value, index and array out, and leave the value for consumption */
+    nn_vmbits_stackpopn(state, 3);
+    nn_vmbits_stackpush(state, value);
+    return true;
+}
+
 NEON_FORCEINLINE bool nn_vmdo_indexset(NNState* state)
 {
     bool isset;
@@ -16731,6 +26360,14 @@ NEON_FORCEINLINE bool nn_vmdo_indexset(NNState* state)
                     }
                 }
                 break;
+            case NEON_OBJTYPE_TYPEDARRAY:
+                {
+                    if(!nn_vmutil_dosetindextypedarray(state, nn_value_astypedarray(target), index, value))
+                    {
+                        return false;
+                    }
+                }
+                break;
             case NEON_OBJTYPE_STRING:
                 {
                     if(!nn_vmutil_dosetindexstring(state, nn_value_asstring(target), index, value))
@@ -16804,6 +26441,7 @@ NEON_FORCEINLINE double nn_vmutil_modulo(double a, double b)
 
 NEON_FORCEINLINE NNProperty* nn_vmutil_getproperty(NNState* state, NNValue peeked, NNObjString* name)
 {
+    NNObjClass* klass;
     NNProperty* field;
     switch(nn_value_asobject(peeked)->type)
     {
@@ -16921,9 +26559,54 @@ NEON_FORCEINLINE NNProperty* nn_vmutil_getproperty(NNState* state, NNValue peeke
                 return NULL;
             }
             break;
+        case NEON_OBJTYPE_REGEX:
+            {
+                field = nn_class_getpropertyfield(state->classprimregex, name);
+                if(field != NULL)
+                {
+                    return field;
+                }
+                nn_exceptions_throw(state, "class Regex has no named property '%s'", name->sbuf->data);
+                return NULL;
+            }
+            break;
+        case NEON_OBJTYPE_TYPEDARRAY:
+            {
+                klass = state->classprimtypedarray[nn_value_astypedarray(peeked)->kind];
+                field = nn_class_getpropertyfield(klass, name);
+                if(field != NULL)
+                {
+                    return field;
+                }
+                nn_exceptions_throw(state, "class %s has no named property '%s'", klass->name->sbuf->data, name->sbuf->data);
+                return NULL;
+            }
+            break;
+        case NEON_OBJTYPE_SET:
+            {
+                field = nn_class_getpropertyfield(state->classprimset, name);
+                if(field != NULL)
+                {
+                    return field;
+                }
+                nn_exceptions_throw(state, "class Set has no named property '%s'", name->sbuf->data);
+                return NULL;
+            }
+            break;
+        case NEON_OBJTYPE_ITERATOR:
+            {
+                field = nn_class_getpropertyfield(state->classprimiterator, name);
+                if(field != NULL)
+                {
+                    return field;
+                }
+                nn_exceptions_throw(state, "class Iterator has no named property '%s'", name->sbuf->data);
+                return NULL;
+            }
+            break;
         case NEON_OBJTYPE_DICT:
             {
-                field = nn_tableval_getfieldbyostr(nn_value_asdict(peeked)->htab, name);
+                field = nn_dict_getentry(nn_value_asdict(peeked), nn_value_fromobject(name));
                 if(field == NULL)
                 {
                     field = nn_class_getpropertyfield(state->classprimdict, name);
@@ -17677,7 +27360,7 @@ NNStatus nn_vm_runvm(NNState* state, int exitframe, NNValue* rv)
         // can cause us to go into an invalid mode where frame count == 0
         // to fix this, we need to exit with an appropriate mode here.
         */
-        if(state->vmstate.framecount == 0)
+        if(state->vmstate.framecount <= state->vmstate.nestbase)
         {
             return NEON_STATUS_FAILRUNTIME;
         }
@@ -18397,6 +28080,8 @@ NNStatus nn_vm_runvm(NNState* state, int exitframe, NNValue* rv)
                     {
                         res = nn_value_fromobject(mod);
                     }
+                    /* the module replaces its name */
+                    nn_vmbits_stackpop(state);
                     nn_vmbits_stackpush(state, res);
                 }
                 VM_DISPATCH();
@@ -18593,7 +28278,9 @@ bool nn_nestcall_callfunction(NNState* state, NNValue callable, NNValue thisval,
     size_t i;
     int argc;
     size_t pidx;
+    size_t oldbase;
     NNStatus status;
+    NNValue exception;
     pidx = state->vmstate.stackidx;
     /* set the closure before the args */
     nn_vm_stackpush(state, callable);
@@ -18610,12 +28297,29 @@ bool nn_nestcall_callfunction(NNState* state, NNValue callable, NNValue thisval,
         fprintf(stderr, "nestcall: nn_vm_callvalue() failed\n");
         abort();
     }
+    oldbase = state->vmstate.nestbase;
+    state->vmstate.nestbase = state->vmstate.framecount - 1;
     status = nn_vm_runvm(state, state->vmstate.framecount - 1, NULL);
     if(status != NEON_STATUS_OK)
     {
-        fprintf(stderr, "nestcall: call to runvm failed\n");
-        abort();
+        if(state->vmstate.framecount != state->vmstate.nestbase)
+        {
+            fprintf(stderr, "nestcall: call to runvm failed\n");
+            abort();
+        }
+        /*
+        * the callback threw, and did not catch it. propagate it from the frame that called the
+        * native, and return false, so that the native stops and returns.
+        */
+        state->vmstate.nestbase = oldbase;
+        exception = state->vmstate.stackvalues[state->vmstate.stackidx - 1];
+        state->vmstate.stackidx = pidx;
+        nn_vm_stackpush(state, exception);
+        nn_exceptions_propagate(state);
+        *dest = nn_value_makenull();
+        return false;
     }
+    state->vmstate.nestbase = oldbase;
     *dest = state->vmstate.stackvalues[state->vmstate.stackidx - 1];
     nn_vm_stackpopn(state, argc + 1);
     state->vmstate.stackidx = pidx;
@@ -18681,7 +28385,6 @@ NNStatus nn_state_execsource(NNState* state, NNObjModule* module, const char* so
 
 NNValue nn_state_evalsource(NNState* state, const char* source)
 {
-    bool ok;
     int argc;
     NNValue callme;
     NNValue retval;
@@ -18692,11 +28395,8 @@ NNValue nn_state_evalsource(NNState* state, const char* source)
     callme = nn_value_fromobject(closure);
     args = nn_array_make(state);
     argc = nn_nestcall_prepare(state, callme, nn_value_makenull(), args);
-    ok = nn_nestcall_callfunction(state, callme, nn_value_makenull(), args, &retval);
-    if(!ok)
-    {
-        nn_exceptions_throw(state, "eval() failed");
-    }
+    /* if the code throws, the exception is propagated already, and retval is null. */
+    nn_nestcall_callfunction(state, callme, nn_value_makenull(), args, &retval);
     return retval;
 }
 
@@ -18791,6 +28491,7 @@ bool nn_cli_repl(NNState* state)
         {
             cursor = "";
         }
+        nn_printer_flush(pr);
         line = nn_cli_getinput(cursor);
         //fprintf(stderr, "line = %s. isexit=%d\n", line, strcmp(line, ".exit"));
         if(line == NULL || strcmp(line, ".exit") == 0)
@@ -18885,6 +28586,7 @@ bool nn_cli_repl(NNState* state)
                 rescnt++;
             }
             state->lastreplvalue = nn_value_makenull();
+            nn_printer_flush(pr);
             fflush(stdout);
             continuerepl = false;
         }
@@ -18912,6 +28614,7 @@ bool nn_cli_runfile(NNState* state, const char* file)
     }
     result = nn_state_execsource(state, state->topmodule, source, file, NULL);
     nn_memory_free(source);
+    nn_printer_flush(state->stdoutprinter);
     fflush(stdout);
     if(result == NEON_STATUS_FAILCOMPILE)
     {
@@ -18929,6 +28632,7 @@ bool nn_cli_runcode(NNState* state, char* source)
     NNStatus result;
     state->rootphysfile = NULL;
     result = nn_state_execsource(state, state->topmodule, source, "<-e>", NULL);
+    nn_printer_flush(state->stdoutprinter);
     fflush(stdout);
     if(result == NEON_STATUS_FAILCOMPILE)
     {
@@ -19007,11 +28711,9 @@ void nn_cli_printtypesizes()
     ptyp(NNPrinter);
     ptyp(NNValue);
     ptyp(NNObject);
-    ptyp(NNPropGetSet);
     ptyp(NNProperty);
     ptyp(NNValArray);
     ptyp(NNBlob);
-    ptyp(NNHashValEntry);
     ptyp(NNHashValTable);
     ptyp(NNObjString);
     ptyp(NNObjUpvalue);
@@ -19148,6 +28850,7 @@ int main(int argc, char* argv[], char** envp)
         {"apidebug", 'a', OPTPARSE_NONE, "print calls to API (very verbose, very slow)"},
         {"astdebug", 'A', OPTPARSE_NONE, "print calls to the parser (very verbose, very slow)"},
         {"gcstart", 'g', OPTPARSE_REQUIRED, "set minimum bytes at which the GC should kick in. 0 disables GC"},
+        {"unbuffered", 'u', OPTPARSE_NONE, "do not buffer output to stdout"},
         {0, 0, (optargtype_t)0, NULL}
     };
     #if defined(NEON_PLAT_ISWINDOWS)
@@ -19218,6 +28921,10 @@ int main(int argc, char* argv[], char** envp)
         {
             quitafterinit = true;
         }
+        else if(co == 'u')
+        {
+            nn_printer_setbuffer(state->stdoutprinter, 0, false);
+        }
     }
     if(wasusage || quitafterinit)
     {
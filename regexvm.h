@@ -0,0 +1,1160 @@
+
+/*
+* nn_rxvm: a regex engine that runs in time linear to the input, regardless of the pattern.
+*
+* patterns are parsed into a tree of NNRxNode, which is compiled to a program for a
+* pike VM (a thompson NFA simulation that tracks capture positions per thread).
+* programs without word boundary assertions additionally get two lazily built DFAs
+* (anchored and unanchored), which quickly decide whether a match exists at all; the
+* pike VM is only run when there is a match to report.
+*
+* matching is byte oriented, like indexing of strings. supported syntax:
+*   literals, '.', [classes], [^negated], \d \w \s \D \W \S, \n \t \r \f \v \0 \xHH,
+*   ^ $ \b \B, (groups), (?:groups), a|b, and the quantifiers * + ? {n} {n,} {n,m},
+*   each optionally followed by '?' to make them lazy.
+*
+* priorities follow perl, except for loops whose body matched the empty string: those do not
+* iterate again (like RE2), so the captures, and rarely the match, can differ from backtracking.
+*/
+
+#define NEON_RXVM_MAXREPEAT (1000)
+
+static int nn_rxvm_error(NNRxParser* p, const char* msg)
+{
+    snprintf(p->prog->errorbuf, sizeof(p->prog->errorbuf), "%s at offset %d", msg, (int)p->pos);
+    return -1;
+}
+
+static int nn_rxvm_newnode(NNRxParser* p, int kind, int a, int b, int left, int right, bool greedy)
+{
+    NNRxNode* n;
+    if(p->nodecount == p->nodecapacity)
+    {
+        p->nodecapacity = MC_UTIL_INCCAPACITY(p->nodecapacity);
+        p->nodes = (NNRxNode*)nn_memory_realloc(p->nodes, sizeof(NNRxNode) * p->nodecapacity);
+    }
+    n = &p->nodes[p->nodecount];
+    n->kind = kind;
+    n->a = a;
+    n->b = b;
+    n->left = left;
+    n->right = right;
+    n->greedy = greedy;
+    p->nodecount++;
+    return p->nodecount - 1;
+}
+
+static int nn_rxvm_newclass(NNRxProgram* prog)
+{
+    prog->classes = (uint8_t*)nn_memory_realloc(prog->classes, 32 * (prog->classcount + 1));
+    memset(prog->classes + (32 * prog->classcount), 0, 32);
+    prog->classcount++;
+    return prog->classcount - 1;
+}
+
+NEON_INLINE void nn_rxvm_classset(uint8_t* cls, int lo, int hi)
+{
+    int c;
+    for(c = lo; c <= hi; c++)
+    {
+        cls[c >> 3] |= (uint8_t)(1 << (c & 7));
+    }
+}
+
+NEON_INLINE bool nn_rxvm_classhas(const uint8_t* cls, int c)
+{
+    return (cls[c >> 3] & (1 << (c & 7))) != 0;
+}
+
+NEON_INLINE bool nn_rxvm_isword(int c)
+{
+    return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9')) || (c == '_');
+}
+
+/* adds the set of \d, \w or \s (or their negation, for uppercase letters) to cls. */
+static void nn_rxvm_classaddshorthand(uint8_t* cls, int esc)
+{
+    int i;
+    uint8_t tmp[32];
+    memset(tmp, 0, sizeof(tmp));
+    switch(tolower(esc))
+    {
+        case 'd':
+            nn_rxvm_classset(tmp, '0', '9');
+            break;
+        case 'w':
+            nn_rxvm_classset(tmp, 'a', 'z');
+            nn_rxvm_classset(tmp, 'A', 'Z');
+            nn_rxvm_classset(tmp, '0', '9');
+            nn_rxvm_classset(tmp, '_', '_');
+            break;
+        case 's':
+            nn_rxvm_classset(tmp, ' ', ' ');
+            nn_rxvm_classset(tmp, '\t', '\r');
+            break;
+    }
+    for(i = 0; i < 32; i++)
+    {
+        if(isupper(esc))
+        {
+            cls[i] |= (uint8_t)~tmp[i];
+        }
+        else
+        {
+            cls[i] |= tmp[i];
+        }
+    }
+}
+
+NEON_INLINE bool nn_rxvm_isshorthand(int c)
+{
+    return (c == 'd') || (c == 'w') || (c == 's') || (c == 'D') || (c == 'W') || (c == 'S');
+}
+
+static int nn_rxvm_hexval(int c)
+{
+    if((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    if((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+    if((c >= 'A') && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/* decodes a single-byte escape (the character after the backslash is at p->pos); returns -1 on error. */
+static int nn_rxvm_parsecharescape(NNRxParser* p)
+{
+    int c;
+    int hi;
+    int lo;
+    c = (uint8_t)p->pattern[p->pos];
+    p->pos++;
+    switch(c)
+    {
+        case 'n':
+            return '\n';
+        case 't':
+            return '\t';
+        case 'r':
+            return '\r';
+        case 'f':
+            return '\f';
+        case 'v':
+            return '\v';
+        case '0':
+            return 0;
+        case 'x':
+            {
+                if((p->pos + 2) > p->length)
+                {
+                    return nn_rxvm_error(p, "incomplete \\x escape");
+                }
+                hi = nn_rxvm_hexval(p->pattern[p->pos]);
+                lo = nn_rxvm_hexval(p->pattern[p->pos + 1]);
+                if((hi < 0) || (lo < 0))
+                {
+                    return nn_rxvm_error(p, "invalid \\x escape");
+                }
+                p->pos += 2;
+                return (hi << 4) | lo;
+            }
+        default:
+            break;
+    }
+    return c;
+}
+
+static int nn_rxvm_parseclass(NNRxParser* p)
+{
+    int lo;
+    int hi;
+    int ci;
+    int i;
+    bool negate;
+    bool first;
+    uint8_t* cls;
+    ci = nn_rxvm_newclass(p->prog);
+    negate = false;
+    first = true;
+    if((p->pos < p->length) && (p->pattern[p->pos] == '^'))
+    {
+        negate = true;
+        p->pos++;
+    }
+    while(true)
+    {
+        if(p->pos >= p->length)
+        {
+            return nn_rxvm_error(p, "missing ']'");
+        }
+        /* classes may be reallocated by nn_rxvm_newclass, so fetch it anew. */
+        cls = p->prog->classes + (32 * ci);
+        lo = (uint8_t)p->pattern[p->pos];
+        if((lo == ']') && !first)
+        {
+            p->pos++;
+            break;
+        }
+        first = false;
+        p->pos++;
+        if(lo == '\\')
+        {
+            if(p->pos >= p->length)
+            {
+                return nn_rxvm_error(p, "trailing backslash");
+            }
+            if(nn_rxvm_isshorthand(p->pattern[p->pos]))
+            {
+                nn_rxvm_classaddshorthand(cls, p->pattern[p->pos]);
+                p->pos++;
+                continue;
+            }
+            lo = nn_rxvm_parsecharescape(p);
+            if(lo < 0)
+            {
+                return -1;
+            }
+        }
+        hi = lo;
+        if(((p->pos + 1) < p->length) && (p->pattern[p->pos] == '-') && (p->pattern[p->pos + 1] != ']'))
+        {
+            p->pos++;
+            hi = (uint8_t)p->pattern[p->pos];
+            p->pos++;
+            if(hi == '\\')
+            {
+                if(p->pos >= p->length)
+                {
+                    return nn_rxvm_error(p, "trailing backslash");
+                }
+                hi = nn_rxvm_parsecharescape(p);
+                if(hi < 0)
+                {
+                    return -1;
+                }
+            }
+            if(hi < lo)
+            {
+                return nn_rxvm_error(p, "invalid range in character class");
+            }
+        }
+        nn_rxvm_classset(cls, lo, hi);
+    }
+    if(negate)
+    {
+        cls = p->prog->classes + (32 * ci);
+        for(i = 0; i < 32; i++)
+        {
+            cls[i] = (uint8_t)~cls[i];
+        }
+    }
+    return nn_rxvm_newnode(p, NEON_RXNODE_CLASS, ci, 0, -1, -1, true);
+}
+
+static int nn_rxvm_parsealt(NNRxParser* p);
+
+static int nn_rxvm_parseatom(NNRxParser* p)
+{
+    int c;
+    int ci;
+    int cap;
+    int inner;
+    c = (uint8_t)p->pattern[p->pos];
+    p->pos++;
+    switch(c)
+    {
+        case '(':
+            {
+                cap = -1;
+                if(((p->pos + 1) < p->length) && (p->pattern[p->pos] == '?') && (p->pattern[p->pos + 1] == ':'))
+                {
+                    p->pos += 2;
+                }
+                else
+                {
+                    cap = p->prog->capcount;
+                    p->prog->capcount++;
+                }
+                inner = nn_rxvm_parsealt(p);
+                if(inner < 0)
+                {
+                    return -1;
+                }
+                if((p->pos >= p->length) || (p->pattern[p->pos] != ')'))
+                {
+                    return nn_rxvm_error(p, "missing ')'");
+                }
+                p->pos++;
+                return nn_rxvm_newnode(p, NEON_RXNODE_GROUP, cap, 0, inner, -1, true);
+            }
+        case '[':
+            return nn_rxvm_parseclass(p);
+        case '.':
+            return nn_rxvm_newnode(p, NEON_RXNODE_ANY, 0, 0, -1, -1, true);
+        case '^':
+            return nn_rxvm_newnode(p, NEON_RXNODE_ASSERT, NEON_RXOP_BOL, 0, -1, -1, true);
+        case '$':
+            return nn_rxvm_newnode(p, NEON_RXNODE_ASSERT, NEON_RXOP_EOL, 0, -1, -1, true);
+        case '*':
+        case '+':
+        case '?':
+            p->pos--;
+            return nn_rxvm_error(p, "nothing to repeat");
+        case '\\':
+            {
+                if(p->pos >= p->length)
+                {
+                    return nn_rxvm_error(p, "trailing backslash");
+                }
+                c = p->pattern[p->pos];
+                if(nn_rxvm_isshorthand(c))
+                {
+                    p->pos++;
+                    ci = nn_rxvm_newclass(p->prog);
+                    nn_rxvm_classaddshorthand(p->prog->classes + (32 * ci), c);
+                    return nn_rxvm_newnode(p, NEON_RXNODE_CLASS, ci, 0, -1, -1, true);
+                }
+                if((c == 'b') || (c == 'B'))
+                {
+                    p->pos++;
+                    return nn_rxvm_newnode(p, NEON_RXNODE_ASSERT, (c == 'b') ? NEON_RXOP_WORDB : NEON_RXOP_NWORDB, 0, -1, -1, true);
+                }
+                c = nn_rxvm_parsecharescape(p);
+                if(c < 0)
+                {
+                    return -1;
+                }
+                return nn_rxvm_newnode(p, NEON_RXNODE_CHAR, c, 0, -1, -1, true);
+            }
+        default:
+            break;
+    }
+    return nn_rxvm_newnode(p, NEON_RXNODE_CHAR, c, 0, -1, -1, true);
+}
+
+/* parses "{n}", "{n,}" or "{n,m}" at p->pos. returns false (and leaves pos alone) if it is not one. */
+static bool nn_rxvm_parsecount(NNRxParser* p, int* min, int* max)
+{
+    size_t i;
+    long v;
+    i = p->pos + 1;
+    if((i >= p->length) || !isdigit((uint8_t)p->pattern[i]))
+    {
+        return false;
+    }
+    v = 0;
+    while((i < p->length) && isdigit((uint8_t)p->pattern[i]) && (v <= NEON_RXVM_MAXREPEAT))
+    {
+        v = (v * 10) + (p->pattern[i] - '0');
+        i++;
+    }
+    *min = v;
+    *max = v;
+    if((i < p->length) && (p->pattern[i] == ','))
+    {
+        i++;
+        *max = -1;
+        if((i < p->length) && isdigit((uint8_t)p->pattern[i]))
+        {
+            v = 0;
+            while((i < p->length) && isdigit((uint8_t)p->pattern[i]) && (v <= NEON_RXVM_MAXREPEAT))
+            {
+                v = (v * 10) + (p->pattern[i] - '0');
+                i++;
+            }
+            *max = v;
+        }
+    }
+    if((i >= p->length) || (p->pattern[i] != '}'))
+    {
+        return false;
+    }
+    p->pos = i + 1;
+    return true;
+}
+
+static int nn_rxvm_parserepeat(NNRxParser* p)
+{
+    int c;
+    int min;
+    int max;
+    int atom;
+    bool greedy;
+    atom = nn_rxvm_parseatom(p);
+    while((atom >= 0) && (p->pos < p->length))
+    {
+        c = p->pattern[p->pos];
+        if(c == '*')
+        {
+            min = 0;
+            max = -1;
+            p->pos++;
+        }
+        else if(c == '+')
+        {
+            min = 1;
+            max = -1;
+            p->pos++;
+        }
+        else if(c == '?')
+        {
+            min = 0;
+            max = 1;
+            p->pos++;
+        }
+        else if((c == '{') && nn_rxvm_parsecount(p, &min, &max))
+        {
+            if((min > NEON_RXVM_MAXREPEAT) || (max > NEON_RXVM_MAXREPEAT) || ((max != -1) && (max < min)))
+            {
+                return nn_rxvm_error(p, "invalid repetition count");
+            }
+        }
+        else
+        {
+            break;
+        }
+        greedy = true;
+        if((p->pos < p->length) && (p->pattern[p->pos] == '?'))
+        {
+            greedy = false;
+            p->pos++;
+        }
+        atom = nn_rxvm_newnode(p, NEON_RXNODE_REPEAT, min, max, atom, -1, greedy);
+    }
+    return atom;
+}
+
+static int nn_rxvm_parsecat(NNRxParser* p)
+{
+    int c;
+    int node;
+    int right;
+    node = -1;
+    while(p->pos < p->length)
+    {
+        c = p->pattern[p->pos];
+        if((c == '|') || (c == ')'))
+        {
+            break;
+        }
+        right = nn_rxvm_parserepeat(p);
+        if(right < 0)
+        {
+            return -1;
+        }
+        if(node == -1)
+        {
+            node = right;
+        }
+        else
+        {
+            node = nn_rxvm_newnode(p, NEON_RXNODE_CAT, 0, 0, node, right, true);
+        }
+    }
+    if(node == -1)
+    {
+        node = nn_rxvm_newnode(p, NEON_RXNODE_EMPTY, 0, 0, -1, -1, true);
+    }
+    return node;
+}
+
+static int nn_rxvm_parsealt(NNRxParser* p)
+{
+    int left;
+    int right;
+    left = nn_rxvm_parsecat(p);
+    while((left >= 0) && (p->pos < p->length) && (p->pattern[p->pos] == '|'))
+    {
+        p->pos++;
+        right = nn_rxvm_parsecat(p);
+        if(right < 0)
+        {
+            return -1;
+        }
+        left = nn_rxvm_newnode(p, NEON_RXNODE_ALT, 0, 0, left, right, true);
+    }
+    return left;
+}
+
+static int nn_rxvm_emit(NNRxProgram* prog, int op, int x, int y)
+{
+    if(prog->count == prog->capacity)
+    {
+        if(prog->capacity >= NEON_CONFIG_REGEXMAXPROGRAM)
+        {
+            return -1;
+        }
+        prog->capacity = MC_UTIL_INCCAPACITY(prog->capacity);
+        prog->code = (NNRxInstr*)nn_memory_realloc(prog->code, sizeof(NNRxInstr) * prog->capacity);
+    }
+    prog->code[prog->count].op = op;
+    prog->code[prog->count].x = x;
+    prog->code[prog->count].y = y;
+    prog->count++;
+    return prog->count - 1;
+}
+
+/* compiles an optional (x?) or looping (x*) instance of node n. */
+static bool nn_rxvm_compilenode(NNRxParser* p, int ni);
+
+static bool nn_rxvm_compilestar(NNRxParser* p, NNRxNode* n, bool loop)
+{
+    int split;
+    int jmp;
+    split = nn_rxvm_emit(p->prog, NEON_RXOP_SPLIT, 0, 0);
+    if((split < 0) || !nn_rxvm_compilenode(p, n->left))
+    {
+        return false;
+    }
+    if(loop)
+    {
+        jmp = nn_rxvm_emit(p->prog, NEON_RXOP_JMP, split, 0);
+        if(jmp < 0)
+        {
+            return false;
+        }
+    }
+    if(n->greedy)
+    {
+        p->prog->code[split].x = split + 1;
+        p->prog->code[split].y = p->prog->count;
+    }
+    else
+    {
+        p->prog->code[split].x = p->prog->count;
+        p->prog->code[split].y = split + 1;
+    }
+    return true;
+}
+
+static bool nn_rxvm_compilenode(NNRxParser* p, int ni)
+{
+    int i;
+    int split;
+    int jmp;
+    NNRxNode n;
+    NNRxProgram* prog;
+    prog = p->prog;
+    /* copied, since compiling children never adds nodes, but better safe than sorry. */
+    n = p->nodes[ni];
+    switch(n.kind)
+    {
+        case NEON_RXNODE_EMPTY:
+            return true;
+        case NEON_RXNODE_CHAR:
+            return nn_rxvm_emit(prog, NEON_RXOP_CHAR, n.a, 0) >= 0;
+        case NEON_RXNODE_ANY:
+            return nn_rxvm_emit(prog, NEON_RXOP_ANY, 0, 0) >= 0;
+        case NEON_RXNODE_CLASS:
+            return nn_rxvm_emit(prog, NEON_RXOP_CLASS, n.a, 0) >= 0;
+        case NEON_RXNODE_ASSERT:
+            return nn_rxvm_emit(prog, n.a, 0, 0) >= 0;
+        case NEON_RXNODE_CAT:
+            return nn_rxvm_compilenode(p, n.left) && nn_rxvm_compilenode(p, n.right);
+        case NEON_RXNODE_ALT:
+            {
+                split = nn_rxvm_emit(prog, NEON_RXOP_SPLIT, 0, 0);
+                if((split < 0) || !nn_rxvm_compilenode(p, n.left))
+                {
+                    return false;
+                }
+                jmp = nn_rxvm_emit(prog, NEON_RXOP_JMP, 0, 0);
+                if(jmp < 0)
+                {
+                    return false;
+                }
+                prog->code[split].x = split + 1;
+                prog->code[split].y = prog->count;
+                if(!nn_rxvm_compilenode(p, n.right))
+                {
+                    return false;
+                }
+                prog->code[jmp].x = prog->count;
+                return true;
+            }
+        case NEON_RXNODE_GROUP:
+            {
+                if(n.a < 0)
+                {
+                    return nn_rxvm_compilenode(p, n.left);
+                }
+                return (nn_rxvm_emit(prog, NEON_RXOP_SAVE, 2 * n.a, 0) >= 0)
+                    && nn_rxvm_compilenode(p, n.left)
+                    && (nn_rxvm_emit(prog, NEON_RXOP_SAVE, (2 * n.a) + 1, 0) >= 0);
+            }
+        case NEON_RXNODE_REPEAT:
+            {
+                for(i = 0; i < n.a; i++)
+                {
+                    if(!nn_rxvm_compilenode(p, n.left))
+                    {
+                        return false;
+                    }
+                }
+                if(n.b == -1)
+                {
+                    return nn_rxvm_compilestar(p, &n, true);
+                }
+                for(i = n.a; i < n.b; i++)
+                {
+                    if(!nn_rxvm_compilestar(p, &n, false))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        default:
+            break;
+    }
+    return false;
+}
+
+static void nn_rxvm_dfainit(NNRxDfa* dfa, bool unanchored)
+{
+    int i;
+    dfa->unanchored = unanchored;
+    dfa->gaveup = false;
+    dfa->statecount = 0;
+    dfa->startbol = -1;
+    dfa->startnobol = -1;
+    dfa->states = NULL;
+    dfa->lookup = (int32_t*)nn_memory_malloc(sizeof(int32_t) * NEON_CONFIG_REGEXDFAMAXSTATES * 2);
+    for(i = 0; i < (NEON_CONFIG_REGEXDFAMAXSTATES * 2); i++)
+    {
+        dfa->lookup[i] = -1;
+    }
+}
+
+static void nn_rxvm_dfadestroy(NNRxDfa* dfa)
+{
+    int i;
+    for(i = 0; i < dfa->statecount; i++)
+    {
+        nn_memory_free(dfa->states[i].pcs);
+    }
+    nn_memory_free(dfa->states);
+    nn_memory_free(dfa->lookup);
+}
+
+void nn_rxvm_destroy(NNRxProgram* prog)
+{
+    nn_rxvm_dfadestroy(&prog->dfaanchored);
+    nn_rxvm_dfadestroy(&prog->dfasearch);
+    nn_memory_free(prog->code);
+    nn_memory_free(prog->classes);
+    nn_memory_free(prog->marks);
+    nn_memory_free(prog->stack);
+    nn_memory_free(prog->clistpcs);
+    nn_memory_free(prog->nlistpcs);
+    nn_memory_free(prog->clistcaps);
+    nn_memory_free(prog->nlistcaps);
+    nn_memory_free(prog->workcaps);
+    memset(prog, 0, sizeof(NNRxProgram));
+}
+
+/*
+* compiles pattern into prog. on failure, returns false, and prog->errorbuf describes the problem;
+* prog must be destroyed with nn_rxvm_destroy either way.
+*/
+bool nn_rxvm_compile(NNRxProgram* prog, const char* pattern, size_t length)
+{
+    int i;
+    int root;
+    size_t ncs;
+    bool ok;
+    NNRxParser p;
+    memset(prog, 0, sizeof(NNRxProgram));
+    nn_rxvm_dfainit(&prog->dfaanchored, false);
+    nn_rxvm_dfainit(&prog->dfasearch, true);
+    prog->capcount = 1;
+    p.pattern = pattern;
+    p.length = length;
+    p.pos = 0;
+    p.nodecount = 0;
+    p.nodecapacity = 0;
+    p.nodes = NULL;
+    p.prog = prog;
+    ok = false;
+    root = nn_rxvm_parsealt(&p);
+    if(root >= 0)
+    {
+        if(p.pos < p.length)
+        {
+            nn_rxvm_error(&p, "unmatched ')'");
+        }
+        else
+        {
+            ok = (nn_rxvm_emit(prog, NEON_RXOP_SAVE, 0, 0) >= 0)
+                && nn_rxvm_compilenode(&p, root)
+                && (nn_rxvm_emit(prog, NEON_RXOP_SAVE, 1, 0) >= 0)
+                && (nn_rxvm_emit(prog, NEON_RXOP_MATCH, 0, 0) >= 0);
+            if(!ok)
+            {
+                snprintf(prog->errorbuf, sizeof(prog->errorbuf), "pattern is too large");
+            }
+        }
+    }
+    nn_memory_free(p.nodes);
+    if(!ok)
+    {
+        return false;
+    }
+    prog->usedfa = true;
+    for(i = 0; i < prog->count; i++)
+    {
+        if((prog->code[i].op == NEON_RXOP_WORDB) || (prog->code[i].op == NEON_RXOP_NWORDB))
+        {
+            prog->usedfa = false;
+        }
+    }
+    ncs = 2 * prog->capcount;
+    prog->marks = (int*)nn_memory_calloc(prog->count, sizeof(int));
+    prog->stack = (int64_t*)nn_memory_malloc(sizeof(int64_t) * ((3 * prog->count) + 4));
+    prog->clistpcs = (int*)nn_memory_malloc(sizeof(int) * prog->count);
+    prog->nlistpcs = (int*)nn_memory_malloc(sizeof(int) * prog->count);
+    prog->clistcaps = (int64_t*)nn_memory_malloc(sizeof(int64_t) * ncs * prog->count);
+    prog->nlistcaps = (int64_t*)nn_memory_malloc(sizeof(int64_t) * ncs * prog->count);
+    prog->workcaps = (int64_t*)nn_memory_malloc(sizeof(int64_t) * ncs);
+    return true;
+}
+
+NEON_INLINE bool nn_rxvm_atwordboundary(const char* str, size_t len, size_t pos)
+{
+    bool before;
+    bool after;
+    before = (pos > 0) && nn_rxvm_isword((uint8_t)str[pos - 1]);
+    after = (pos < len) && nn_rxvm_isword((uint8_t)str[pos]);
+    return before != after;
+}
+
+/*
+* adds the thread at pc (and everything reachable from it without consuming input) to a list,
+* in priority order. caps is modified while exploring, but restored before returning.
+*/
+static void nn_rxvm_addthread(NNRxProgram* prog, int* pcs, int64_t* listcaps, int* count, int pc0, int64_t* caps, const char* str, size_t len, size_t pos, int stamp)
+{
+    int sp;
+    int pc;
+    int ncs;
+    int64_t v;
+    NNRxInstr* ins;
+    ncs = 2 * prog->capcount;
+    sp = 0;
+    prog->stack[sp++] = pc0;
+    while(sp > 0)
+    {
+        v = prog->stack[--sp];
+        if(v < 0)
+        {
+            /* restore a capture slot that was set by SAVE. */
+            sp--;
+            caps[(-v) - 1] = prog->stack[sp];
+            continue;
+        }
+        pc = (int)v;
+        if(prog->marks[pc] == stamp)
+        {
+            continue;
+        }
+        prog->marks[pc] = stamp;
+        ins = &prog->code[pc];
+        switch(ins->op)
+        {
+            case NEON_RXOP_JMP:
+                prog->stack[sp++] = ins->x;
+                break;
+            case NEON_RXOP_SPLIT:
+                prog->stack[sp++] = ins->y;
+                prog->stack[sp++] = ins->x;
+                break;
+            case NEON_RXOP_SAVE:
+                prog->stack[sp++] = caps[ins->x];
+                prog->stack[sp++] = -((int64_t)ins->x + 1);
+                caps[ins->x] = pos;
+                prog->stack[sp++] = pc + 1;
+                break;
+            case NEON_RXOP_BOL:
+                if(pos == 0)
+                {
+                    prog->stack[sp++] = pc + 1;
+                }
+                break;
+            case NEON_RXOP_EOL:
+                if(pos == len)
+                {
+                    prog->stack[sp++] = pc + 1;
+                }
+                break;
+            case NEON_RXOP_WORDB:
+                if(nn_rxvm_atwordboundary(str, len, pos))
+                {
+                    prog->stack[sp++] = pc + 1;
+                }
+                break;
+            case NEON_RXOP_NWORDB:
+                if(!nn_rxvm_atwordboundary(str, len, pos))
+                {
+                    prog->stack[sp++] = pc + 1;
+                }
+                break;
+            default:
+                pcs[*count] = pc;
+                memcpy(listcaps + ((*count) * ncs), caps, sizeof(int64_t) * ncs);
+                (*count)++;
+                break;
+        }
+    }
+}
+
+/*
+* runs the pike VM on str, starting at start. if anchored, the match must begin at start;
+* otherwise the leftmost match is found. priorities follow perl: greedy quantifiers prefer
+* more, lazy ones less, and the left side of an alternation wins.
+* on a match, returns true and stores 2 * capcount positions (-1 for unset groups) in outcaps.
+*/
+bool nn_rxvm_exec(NNRxProgram* prog, const char* str, size_t len, size_t start, bool anchored, int64_t* outcaps)
+{
+    int i;
+    int j;
+    int pc;
+    int ncs;
+    int ccount;
+    int ncount;
+    int stamp;
+    int c;
+    int* tmppcs;
+    int64_t* tmpcaps;
+    int64_t* caps;
+    size_t pos;
+    bool matched;
+    NNRxInstr* ins;
+    ncs = 2 * prog->capcount;
+    memset(prog->marks, 0, sizeof(int) * prog->count);
+    matched = false;
+    ccount = 0;
+    stamp = 0;
+    for(pos = start; ; pos++)
+    {
+        /* threads in the current list were added with the stamp of this position. */
+        stamp++;
+        if(!matched && (!anchored || (pos == start)))
+        {
+            for(j = 0; j < ncs; j++)
+            {
+                prog->workcaps[j] = -1;
+            }
+            nn_rxvm_addthread(prog, prog->clistpcs, prog->clistcaps, &ccount, 0, prog->workcaps, str, len, pos, stamp);
+        }
+        /* unanchored, a seed that died on an assertion here may still match further on. */
+        if((ccount == 0) && (matched || anchored))
+        {
+            break;
+        }
+        ncount = 0;
+        c = -1;
+        if(pos < len)
+        {
+            c = (uint8_t)str[pos];
+        }
+        for(i = 0; i < ccount; i++)
+        {
+            pc = prog->clistpcs[i];
+            caps = prog->clistcaps + (i * ncs);
+            ins = &prog->code[pc];
+            if(ins->op == NEON_RXOP_MATCH)
+            {
+                memcpy(outcaps, caps, sizeof(int64_t) * ncs);
+                matched = true;
+                /* threads of lower priority are cut off. */
+                break;
+            }
+            if(c == -1)
+            {
+                continue;
+            }
+            if(((ins->op == NEON_RXOP_CHAR) && (c == ins->x))
+                || ((ins->op == NEON_RXOP_ANY) && (c != '\n'))
+                || ((ins->op == NEON_RXOP_CLASS) && nn_rxvm_classhas(prog->classes + (32 * ins->x), c)))
+            {
+                nn_rxvm_addthread(prog, prog->nlistpcs, prog->nlistcaps, &ncount, pc + 1, caps, str, len, pos + 1, stamp + 1);
+            }
+        }
+        tmppcs = prog->clistpcs;
+        prog->clistpcs = prog->nlistpcs;
+        prog->nlistpcs = tmppcs;
+        tmpcaps = prog->clistcaps;
+        prog->clistcaps = prog->nlistcaps;
+        prog->nlistcaps = tmpcaps;
+        ccount = ncount;
+        if(pos >= len)
+        {
+            break;
+        }
+    }
+    return matched;
+}
+
+/*
+* computes the DFA closure of pc into the set held in prog->clistpcs.
+* SAVE is ignored; EOL is kept in the set unless ateol, so it can be resolved at the end of input.
+*/
+static void nn_rxvm_dfaclosure(NNRxProgram* prog, int* count, int pc0, bool atbol, bool ateol, int stamp)
+{
+    int sp;
+    int pc;
+    NNRxInstr* ins;
+    sp = 0;
+    prog->stack[sp++] = pc0;
+    while(sp > 0)
+    {
+        pc = (int)prog->stack[--sp];
+        if(prog->marks[pc] == stamp)
+        {
+            continue;
+        }
+        prog->marks[pc] = stamp;
+        ins = &prog->code[pc];
+        switch(ins->op)
+        {
+            case NEON_RXOP_JMP:
+                prog->stack[sp++] = ins->x;
+                break;
+            case NEON_RXOP_SPLIT:
+                prog->stack[sp++] = ins->y;
+                prog->stack[sp++] = ins->x;
+                break;
+            case NEON_RXOP_SAVE:
+                prog->stack[sp++] = pc + 1;
+                break;
+            case NEON_RXOP_BOL:
+                if(atbol)
+                {
+                    prog->stack[sp++] = pc + 1;
+                }
+                break;
+            case NEON_RXOP_EOL:
+                if(ateol)
+                {
+                    prog->stack[sp++] = pc + 1;
+                }
+                else
+                {
+                    prog->clistpcs[(*count)++] = pc;
+                }
+                break;
+            default:
+                prog->clistpcs[(*count)++] = pc;
+                break;
+        }
+    }
+}
+
+static int nn_rxvm_cmpint(const void* a, const void* b)
+{
+    return (*(const int*)a) - (*(const int*)b);
+}
+
+/*
+* returns the index of the state for the pc set in prog->clistpcs, creating it if needed.
+* returns -1 if the DFA is full.
+*/
+static int nn_rxvm_dfagetstate(NNRxProgram* prog, NNRxDfa* dfa, int count)
+{
+    int i;
+    int si;
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t mask;
+    NNRxDfaState* st;
+    qsort(prog->clistpcs, count, sizeof(int), nn_rxvm_cmpint);
+    hash = 2166136261u;
+    for(i = 0; i < count; i++)
+    {
+        hash = (hash ^ (uint32_t)prog->clistpcs[i]) * 16777619u;
+    }
+    mask = (NEON_CONFIG_REGEXDFAMAXSTATES * 2) - 1;
+    slot = hash & mask;
+    while(dfa->lookup[slot] != -1)
+    {
+        st = &dfa->states[dfa->lookup[slot]];
+        if((st->hash == hash) && (st->pccount == count) && (memcmp(st->pcs, prog->clistpcs, sizeof(int) * count) == 0))
+        {
+            return dfa->lookup[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    if(dfa->statecount == NEON_CONFIG_REGEXDFAMAXSTATES)
+    {
+        dfa->gaveup = true;
+        return -1;
+    }
+    dfa->states = (NNRxDfaState*)nn_memory_realloc(dfa->states, sizeof(NNRxDfaState) * (dfa->statecount + 1));
+    si = dfa->statecount;
+    dfa->statecount++;
+    st = &dfa->states[si];
+    st->hash = hash;
+    st->pccount = count;
+    st->pcs = (int*)nn_memory_malloc(sizeof(int) * (count + 1));
+    memcpy(st->pcs, prog->clistpcs, sizeof(int) * count);
+    st->ismatch = false;
+    st->eolmatch = -1;
+    for(i = 0; i < count; i++)
+    {
+        if(prog->code[st->pcs[i]].op == NEON_RXOP_MATCH)
+        {
+            st->ismatch = true;
+        }
+    }
+    for(i = 0; i < 256; i++)
+    {
+        st->next[i] = -1;
+    }
+    dfa->lookup[slot] = si;
+    return si;
+}
+
+static int nn_rxvm_dfastep(NNRxProgram* prog, NNRxDfa* dfa, int si, int c, int* stamp)
+{
+    int i;
+    int pc;
+    int count;
+    NNRxInstr* ins;
+    (*stamp)++;
+    count = 0;
+    for(i = 0; i < dfa->states[si].pccount; i++)
+    {
+        pc = dfa->states[si].pcs[i];
+        ins = &prog->code[pc];
+        if(((ins->op == NEON_RXOP_CHAR) && (c == ins->x))
+            || ((ins->op == NEON_RXOP_ANY) && (c != '\n'))
+            || ((ins->op == NEON_RXOP_CLASS) && nn_rxvm_classhas(prog->classes + (32 * ins->x), c)))
+        {
+            nn_rxvm_dfaclosure(prog, &count, pc + 1, false, false, *stamp);
+        }
+    }
+    if(dfa->unanchored)
+    {
+        nn_rxvm_dfaclosure(prog, &count, 0, false, false, *stamp);
+    }
+    return nn_rxvm_dfagetstate(prog, dfa, count);
+}
+
+static bool nn_rxvm_dfaeolmatch(NNRxProgram* prog, NNRxDfaState* st, int* stamp)
+{
+    int i;
+    int j;
+    int count;
+    if(st->eolmatch == -1)
+    {
+        st->eolmatch = 0;
+        for(i = 0; (i < st->pccount) && (st->eolmatch == 0); i++)
+        {
+            if(prog->code[st->pcs[i]].op == NEON_RXOP_EOL)
+            {
+                (*stamp)++;
+                count = 0;
+                nn_rxvm_dfaclosure(prog, &count, st->pcs[i] + 1, false, true, *stamp);
+                for(j = 0; j < count; j++)
+                {
+                    if(prog->code[prog->clistpcs[j]].op == NEON_RXOP_MATCH)
+                    {
+                        st->eolmatch = 1;
+                    }
+                }
+            }
+        }
+    }
+    return st->eolmatch == 1;
+}
+
+/*
+* decides with the lazily built DFA whether str has a match at start (anchored) or anywhere
+* at or after start. returns 1 or 0, or -1 if the DFA cannot be used, in which case the caller
+* has to use nn_rxvm_exec.
+*/
+int nn_rxvm_dfaexists(NNRxProgram* prog, const char* str, size_t len, size_t start, bool anchored)
+{
+    int c;
+    int si;
+    int ni;
+    int count;
+    int stamp;
+    size_t pos;
+    NNRxDfa* dfa;
+    /* on empty input, ^ and $ hold at the same time, which the states do not model. */
+    if(!prog->usedfa || (len == 0))
+    {
+        return -1;
+    }
+    dfa = &prog->dfasearch;
+    if(anchored)
+    {
+        dfa = &prog->dfaanchored;
+    }
+    if(dfa->gaveup)
+    {
+        return -1;
+    }
+    memset(prog->marks, 0, sizeof(int) * prog->count);
+    stamp = 1;
+    si = dfa->startnobol;
+    if(start == 0)
+    {
+        si = dfa->startbol;
+    }
+    if(si == -1)
+    {
+        count = 0;
+        nn_rxvm_dfaclosure(prog, &count, 0, (start == 0), false, stamp);
+        si = nn_rxvm_dfagetstate(prog, dfa, count);
+        if(si < 0)
+        {
+            return -1;
+        }
+        if(start == 0)
+        {
+            dfa->startbol = si;
+        }
+        else
+        {
+            dfa->startnobol = si;
+        }
+    }
+    for(pos = start; pos < len; pos++)
+    {
+        if(dfa->states[si].ismatch)
+        {
+            return 1;
+        }
+        if(dfa->states[si].pccount == 0)
+        {
+            return 0;
+        }
+        c = (uint8_t)str[pos];
+        ni = dfa->states[si].next[c];
+        if(ni == -1)
+        {
+            ni = nn_rxvm_dfastep(prog, dfa, si, c, &stamp);
+            if(ni < 0)
+            {
+                return -1;
+            }
+            dfa->states[si].next[c] = ni;
+        }
+        si = ni;
+    }
+    if(dfa->states[si].ismatch || nn_rxvm_dfaeolmatch(prog, &dfa->states[si], &stamp))
+    {
+        return 1;
+    }
+    return 0;
+}
+
@@ -17,6 +17,8 @@ NNValArray* nn_vallist_make(NNState* state)
     list->listcount = 0;
     list->listcapacity = 0;
     list->listitems = NULL;
+    list->listoffset = 0;
+    list->listkind = NEON_ELEMKIND_EMPTY;
     list->listname = NULL;
     if(initialsize > 0)
     {
@@ -35,12 +37,42 @@ void nn_vallist_destroy(NNValArray* list)
     #endif
     if(list != NULL)
     {
-        nn_memory_free(list->listitems);
+        if(list->listitems != NULL)
+        {
+            nn_memory_free(list->listitems - list->listoffset);
+        }
         nn_memory_free(list);
         list = NULL;
     }
 }
 
+/* widens $listkind, if needed, to account for $value being stored. */
+NEON_FORCEINLINE void nn_vallist_notekind(NNValArray* list, NNValue value)
+{
+    NNElemKind kind;
+    if(list->listkind == NEON_ELEMKIND_GENERIC)
+    {
+        return;
+    }
+    kind = NEON_ELEMKIND_GENERIC;
+    if(nn_value_isnumber(value))
+    {
+        kind = NEON_ELEMKIND_NUMBER;
+    }
+    else if(nn_value_isstring(value))
+    {
+        kind = NEON_ELEMKIND_STRING;
+    }
+    if(list->listkind == NEON_ELEMKIND_EMPTY)
+    {
+        list->listkind = kind;
+    }
+    else if(list->listkind != kind)
+    {
+        list->listkind = NEON_ELEMKIND_GENERIC;
+    }
+}
+
 NEON_INLINE size_t nn_vallist_count(NNValArray* list)
 {
     return list->listcount;
@@ -70,24 +102,47 @@ NEON_INLINE void nn_vallist_mark(NNValArray* list)
     }
 }
 
-NEON_INLINE bool nn_vallist_push(NNValArray* list, NNValue value)
+/*
+* resizes the allocation such that $ncap slots are available from listitems onwards.
+* if at least as many slots were shifted off the front as there are elements left,
+* they are reclaimed first, which is enough for queues that are pushed and shifted alike.
+*/
+NEON_INLINE void nn_vallist_resize(NNValArray* list, size_t ncap)
 {
-    size_t oldcap;
-    if(list->listcapacity < list->listcount + 1)
+    NNValue* base;
+    if((list->listoffset > 0) && (list->listoffset >= list->listcount))
     {
-        oldcap = list->listcapacity;
-        list->listcapacity = MC_UTIL_INCCAPACITY(oldcap);
-        if(list->listitems == NULL)
-        {
-            list->listitems = (NNValue*)nn_memory_malloc(sizeof(NNValue) * list->listcapacity);
-        }
-        else
+        base = list->listitems - list->listoffset;
+        memmove(base, list->listitems, sizeof(NNValue) * list->listcount);
+        list->listitems = base;
+        list->listcapacity += list->listoffset;
+        list->listoffset = 0;
+        if(list->listcapacity >= ncap)
         {
-            list->listitems = (NNValue*)nn_memory_realloc(list->listitems, sizeof(NNValue) * list->listcapacity);
+            return;
         }
     }
+    if(list->listitems == NULL)
+    {
+        list->listitems = (NNValue*)nn_memory_malloc(sizeof(NNValue) * ncap);
+    }
+    else
+    {
+        base = (NNValue*)nn_memory_realloc(list->listitems - list->listoffset, sizeof(NNValue) * (list->listoffset + ncap));
+        list->listitems = base + list->listoffset;
+    }
+    list->listcapacity = ncap;
+}
+
+NEON_INLINE bool nn_vallist_push(NNValArray* list, NNValue value)
+{
+    if(list->listcapacity < list->listcount + 1)
+    {
+        nn_vallist_resize(list, MC_UTIL_INCCAPACITY(list->listcapacity));
+    }
     list->listitems[list->listcount] = value;
     list->listcount++;
+    nn_vallist_notekind(list, value);
     return true;
 }
 
@@ -110,8 +165,11 @@ NEON_INLINE bool nn_vallist_set(NNValArray* list, size_t idx, NNValue val)
         nn_vallist_ensurecapacity(list, need, nn_value_makenull(), false);
     }
     list->listitems[idx] = val;
+    nn_vallist_notekind(list, val);
     if(idx > list->listcount)
     {
+        /* the slots in between become visible, and they hold whatever was there. */
+        list->listkind = NEON_ELEMKIND_GENERIC;
         list->listcount = idx;
     }
     return true;
@@ -140,8 +198,8 @@ NEON_INLINE bool nn_vallist_removeatintern(NNValArray* list, unsigned int ix)
         return true;
     }
     tomovebytes = (list->listcount - 1 - ix) * sizeof(NNValue);
-    dest = list->listitems + (ix * sizeof(NNValue));
-    src = list->listitems + ((ix + 1) * sizeof(NNValue));
+    dest = list->listitems + ix;
+    src = list->listitems + (ix + 1);
     memmove(dest, src, tomovebytes);
     list->listcount--;
     return true;
@@ -155,23 +213,69 @@ NEON_INLINE bool nn_vallist_removeat(NNValArray* list, unsigned int ix)
     }
     if(ix == 0)
     {
-        list->listitems += sizeof(NNValue);
-        list->listcapacity--;
-        list->listcount--;
-        return true;
+        return nn_vallist_shift(list, NULL);
     }
     return nn_vallist_removeatintern(list, ix);
 }
 
+/* removes the first element in O(1) by advancing listitems past it. */
+NEON_INLINE bool nn_vallist_shift(NNValArray* list, NNValue* dest)
+{
+    if(list->listcount == 0)
+    {
+        return false;
+    }
+    if(dest != NULL)
+    {
+        *dest = list->listitems[0];
+    }
+    list->listitems++;
+    list->listoffset++;
+    list->listcapacity--;
+    list->listcount--;
+    return true;
+}
+
+/*
+* prepends $value, using a slot left behind by shift if there is one. otherwise the
+* elements are moved back by a gap as large as the list, so that a run of unshifts
+* costs amortized O(1) each.
+*/
+NEON_INLINE void nn_vallist_unshift(NNValArray* list, NNValue value)
+{
+    size_t gap;
+    NNValue* base;
+    if(list->listoffset == 0)
+    {
+        gap = MC_UTIL_INCCAPACITY(list->listcount);
+        base = (NNValue*)nn_memory_malloc(sizeof(NNValue) * (gap + list->listcapacity));
+        if(list->listitems != NULL)
+        {
+            memcpy(base + gap, list->listitems, sizeof(NNValue) * list->listcount);
+            nn_memory_free(list->listitems);
+        }
+        list->listitems = base + gap;
+        list->listoffset = gap;
+    }
+    list->listitems--;
+    list->listoffset--;
+    list->listcapacity++;
+    list->listcount++;
+    list->listitems[0] = value;
+    nn_vallist_notekind(list, value);
+}
+
 NEON_INLINE void nn_vallist_ensurecapacity(NNValArray* list, size_t needsize, NNValue fillval, bool first)
 {
     size_t i;
     size_t ncap;
     size_t oldcap;
+    size_t oldoffset;
     (void)first;
     if(list->listcapacity < needsize)
     {
         oldcap = list->listcapacity;
+        oldoffset = list->listoffset;
         if(oldcap == 0)
         {
             ncap = needsize;
@@ -180,16 +284,13 @@ NEON_INLINE void nn_vallist_ensurecapacity(NNValArray* list, size_t needsize, NN
         {
             ncap = MC_UTIL_INCCAPACITY(list->listcapacity + needsize);
         }
-        list->listcapacity = ncap;
-        if(list->listitems == NULL)
+        nn_vallist_resize(list, ncap);
+        if(list->listoffset != oldoffset)
         {
-            list->listitems = (NNValue*)nn_memory_malloc(sizeof(NNValue) * ncap);
+            /* shifted slots were reclaimed, so only the elements themselves were kept. */
+            oldcap = list->listcount;
         }
-        else
-        {
-            list->listitems = (NNValue*)nn_memory_realloc(list->listitems, sizeof(NNValue) * ncap);
-        }
-        for(i = oldcap; i < ncap; i++)
+        for(i = oldcap; i < list->listcapacity; i++)
         {
             list->listitems[i] = fillval;
         }
@@ -210,10 +311,13 @@ NEON_INLINE NNValArray* nn_vallist_copy(NNValArray* list)
 
 NEON_INLINE void nn_vallist_setempty(NNValArray* list)
 {
-    if((list->listcapacity > 0) && (list->listitems != NULL))
+    if(list->listitems != NULL)
     {
-        memset(list->listitems, 0, sizeof(NNValue) * list->listcapacity);
+        nn_memory_free(list->listitems - list->listoffset);
     }
+    list->listitems = NULL;
+    list->listoffset = 0;
+    list->listkind = NEON_ELEMKIND_EMPTY;
     list->listcount = 0;
     list->listcapacity = 0;
 }